@@ -0,0 +1,23 @@
+#ifndef _LIBNFTNL_CACHE_INTERNAL_H_
+#define _LIBNFTNL_CACHE_INTERNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct nftnl_cache;
+struct nlattr;
+
+/*
+ * Apply one element event, @attr being its NFTA_LIST_ELEM attribute, as
+ * nftnl_cache_apply() does for whole messages.
+ */
+int nftnl_cache_apply_elem(struct nftnl_cache *cache, uint16_t type,
+			   uint32_t family, const char *table,
+			   const char *name, const struct nlattr *attr);
+
+/* Whether the element in @attr is in the cached set, false if unknown. */
+bool nftnl_cache_has_elem(const struct nftnl_cache *cache, uint32_t family,
+			  const char *table, const char *name,
+			  const struct nlattr *attr);
+
+#endif
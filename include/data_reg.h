@@ -36,5 +36,10 @@ struct nlattr;
 
 int nftnl_parse_data(union nftnl_data_reg *data, struct nlattr *attr, int *type);
 void nftnl_free_verdict(const union nftnl_data_reg *data);
+int nftnl_clone_verdict(union nftnl_data_reg *data);
+bool nftnl_data_reg_cmp(const union nftnl_data_reg *r1,
+			const union nftnl_data_reg *r2, int reg_type);
+uint32_t nftnl_data_reg_hash(uint32_t h, const union nftnl_data_reg *reg,
+			     int reg_type);
 
 #endif
@@ -0,0 +1,75 @@
+#ifndef _LIBNFTNL_DUMP_INTERNAL_H_
+#define _LIBNFTNL_DUMP_INTERNAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libmnl/libmnl.h>
+
+/* Dumps are done again this many times if the ruleset changes meanwhile. */
+#define NFTNL_DUMP_TRIES	8
+
+/*
+ * The kernel flags dump parts with NLM_F_DUMP_INTR if the ruleset changed
+ * since the dump started, and puts the generation, cut to 16 bits, in the
+ * res_id of every part. libmnl stops at the first flagged part and leaves
+ * the rest queued on the socket, so nftnl_dump_check() takes the flag off
+ * the @len bytes of messages in @buf, for the dump to be read to its end,
+ * and notes it in @check. Parts of several dumps checked against the same
+ * @check must be of the same generation.
+ */
+struct nftnl_dump_check {
+	bool		intr;
+	bool		has_genid;
+	uint16_t	genid;
+};
+
+void nftnl_dump_check(struct nftnl_dump_check *check, void *buf, int len);
+
+/*
+ * Whether the @len bytes of messages in @buf end a dump, with NLMSG_DONE or
+ * NLMSG_ERROR. @error is set to the errno the kernel ended it with, zero if
+ * none; libmnl does not report the one NLMSG_DONE carries.
+ */
+bool nftnl_dump_ended(const void *buf, int len, int *error);
+
+/*
+ * Read the rest of the dump running on @nl into @buf and drop it, for the
+ * next request not to find it queued. Keeps errno.
+ */
+void nftnl_dump_drain(struct mnl_socket *nl, void *buf, size_t size);
+
+/* Wait before try number @try, 1 being the first one done again. */
+void nftnl_dump_backoff(int try);
+
+/*
+ * Send @nlh over @nl and run @cb on every message of the reply. Returns -1
+ * with errno EINTR once all of a dump is read if the ruleset changed while
+ * it was taken. A dump is read to its end if @cb fails, too. Errors the
+ * kernel ends a dump with are returned.
+ */
+int nftnl_nlmsg_request(struct mnl_socket *nl, const struct nlmsghdr *nlh,
+			mnl_cb_t cb, void *data);
+
+/*
+ * Same for dump requests, done again after a while if they are interrupted.
+ * @reset drops what @cb collected before every new try. Returns -1 with
+ * errno EAGAIN if the ruleset keeps changing.
+ */
+int nftnl_nlmsg_dump(struct mnl_socket *nl, struct nlmsghdr *nlh,
+		     mnl_cb_t cb, void (*reset)(void *data), void *data);
+
+/*
+ * Parse the @num buffers of reply in @iov as nftnl_dump_pipeline_run()
+ * does with those it receives for a dump of @type, once, and append what
+ * they hold to @list. Buffers are read up to the end of the dump even if
+ * parsing fails, @num is set to the number read. For testing.
+ */
+struct nftnl_dump_pipeline;
+struct iovec;
+int nftnl_dump_pipeline_parse(struct nftnl_dump_pipeline *p, uint16_t type,
+			      const struct iovec *iov, unsigned int *num,
+			      void *list);
+
+#endif
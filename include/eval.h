@@ -0,0 +1,128 @@
+#ifndef _LIBNFTNL_EVAL_INTERNAL_H_
+#define _LIBNFTNL_EVAL_INTERNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/eval.h>
+
+/*
+ * Register file as seen by the kernel: the verdict register overlays the
+ * first four 32-bit words, the data registers follow.
+ */
+#define EVAL_REGS		(4 + NFT_REG32_COUNT)
+#define EVAL_DATA_WORDS		(NFT_DATA_VALUE_MAXLEN / sizeof(uint32_t))
+#define EVAL_JUMP_STACK_MAX	16
+
+enum eval_op_type {
+	EVAL_OP_PAYLOAD	= 0,
+	EVAL_OP_META,
+	EVAL_OP_META_SET,
+	EVAL_OP_CT_STATE,
+	EVAL_OP_CMP,
+	EVAL_OP_RANGE,
+	EVAL_OP_BITWISE,
+	EVAL_OP_BYTEORDER,
+	EVAL_OP_IMMEDIATE,
+	EVAL_OP_VERDICT,
+	EVAL_OP_LOOKUP,
+};
+
+struct nftnl_eval_chain;
+struct eval_set;
+
+struct eval_op {
+	enum eval_op_type	type;
+	/* cmp, range, bitwise and byteorder operation, payload base */
+	uint32_t		op;
+	uint32_t		sreg;
+	uint32_t		dreg;
+	uint32_t		len;
+	/* payload offset, meta key, byteorder size, lookup flags */
+	uint32_t		arg;
+	int32_t			verdict;
+	struct nftnl_eval_chain	*chain;
+	struct eval_set		*set;
+	/* cmp and immediate data, range start, bitwise mask and shift */
+	uint32_t		data[EVAL_DATA_WORDS];
+	/* range end, bitwise xor */
+	uint32_t		data2[EVAL_DATA_WORDS];
+};
+
+struct eval_rule {
+	uint64_t		handle;
+	/* index among all rules of the ruleset */
+	uint32_t		id;
+	struct eval_op		*ops;
+	uint32_t		num_ops;
+};
+
+struct nftnl_eval_chain {
+	struct nftnl_eval_chain	*next;
+	uint32_t		hash;
+	uint32_t		family;
+	const char		*table;
+	const char		*name;
+	uint32_t		policy;
+	struct eval_rule	*rules;
+	uint32_t		num_rules;
+};
+
+struct nftnl_eval {
+	struct nftnl_eval_chain	*chains;
+	uint32_t		num_chains;
+	struct nftnl_eval_chain	**chain_buckets;
+	uint32_t		chain_mask;
+	uint32_t		num_rules;
+	struct eval_set		*sets;
+	uint32_t		num_sets;
+	struct eval_set		**set_buckets;
+	uint32_t		set_mask;
+};
+
+/* Packet being evaluated, offsets resolved. */
+struct eval_pkt {
+	const uint8_t		*data;
+	uint32_t		len;
+	uint32_t		nhoff;
+	uint32_t		thoff;
+	bool			ll;
+	bool			l4;
+	uint16_t		protocol;
+	uint8_t			nfproto;
+	uint8_t			l4proto;
+	uint32_t		mark;
+	uint32_t		iif;
+	uint32_t		oif;
+	uint32_t		ct_state;
+};
+
+struct eval_verdict {
+	int32_t			code;
+	const struct nftnl_eval_chain *chain;
+};
+
+struct eval_rule_count {
+	uint64_t		evals;
+	uint64_t		hits;
+};
+
+/* What packets run with eval_run() went through. */
+struct eval_counters {
+	struct eval_rule_count	*rules;
+	struct nftnl_eval_cost	cost;
+};
+
+int eval_reg(uint32_t reg, uint32_t len);
+void eval_pkt_init(struct eval_pkt *p, const struct nftnl_eval_pkt *pkt);
+bool eval_payload_offset(const struct eval_op *op, const struct eval_pkt *p,
+			 uint32_t *off);
+void eval_op_run(const struct eval_op *op, uint32_t *regs,
+		 struct eval_verdict *v, struct eval_pkt *p);
+int eval_run(const struct nftnl_eval_chain *chain,
+	     const struct nftnl_eval_pkt *pkt, struct nftnl_eval_result *res,
+	     struct eval_counters *cnt);
+
+#endif
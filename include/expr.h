@@ -2,18 +2,64 @@
 #define _LIBNFTNL_EXPR_INTERNAL_H_
 
 struct expr_ops;
+struct nftnl_rule;
+
+/*
+ * Expressions of a parsed rule are carved out of a single allocation, which
+ * is released once the last expression placed in it is freed.
+ */
+struct nftnl_expr_block {
+	uint32_t		refcnt;
+	uint32_t		size;
+	uint32_t		used;
+	uint8_t			data[] __attribute__((aligned(8)));
+};
 
 struct nftnl_expr {
 	struct list_head	head;
 	uint32_t		flags;
 	struct expr_ops		*ops;
-	uint8_t			data[];
+	struct nftnl_expr_block	*block;
+	/* expression type id + 1 if taken from the expression pool */
+	uint16_t		pool;
+	/* owner whose cached encoding includes this expression */
+	struct nftnl_rule	*rule;
+	struct nftnl_expr	*parent;
+	bool			wire_cache;
+	struct nftnl_wire	wire;
+	/* points to inline_data, or to storage shared with copy-on-write clones */
+	void			*data;
+	struct nftnl_expr_shared *shared;
+	uint8_t			inline_data[] __attribute__((aligned(8)));
+};
+
+/*
+ * Expression data shared by copy-on-write clones. The last reference to go
+ * away releases whatever the data points to.
+ */
+struct nftnl_expr_shared {
+	uint32_t		refcnt;
+	uint8_t			data[] __attribute__((aligned(8)));
 };
 
 struct nlmsghdr;
 
 void nftnl_expr_build_payload(struct nlmsghdr *nlh, struct nftnl_expr *expr);
 struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr);
+uint32_t nftnl_expr_block_len(struct nlattr *attr);
+struct nftnl_expr_block *nftnl_expr_block_alloc(uint32_t size);
+void nftnl_expr_block_put(struct nftnl_expr_block *block);
+uint32_t nftnl_expr_size(const struct expr_ops *ops);
+
+bool nftnl_expr_pool_enabled(void);
+struct nftnl_expr *nftnl_expr_pool_get(const struct expr_ops *ops, uint32_t id);
+void nftnl_expr_pool_put(struct nftnl_expr *expr);
+
+struct nftnl_expr *nftnl_expr_block_parse(struct nftnl_expr_block *block,
+					  struct nlattr *attr);
+void nftnl_expr_wire_invalidate(struct nftnl_expr *expr);
+bool nftnl_expr_list_cmp(const struct list_head *l1,
+			 const struct list_head *l2);
 
 
 #endif
@@ -12,8 +12,16 @@ struct expr_ops {
 	const char *name;
 	uint32_t alloc_len;
 	int	max_attr;
+	/* expression carries child expressions, its data is never shared */
+	bool	nested;
+	/* attributes reporting runtime state, ignored by cmp and hash */
+	uint32_t state_attrs;
 	void	(*init)(const struct nftnl_expr *e);
 	void	(*free)(const struct nftnl_expr *e);
+	/* called on a bitwise copy of src to take private copies of its pointers */
+	int	(*clone)(struct nftnl_expr *e, const struct nftnl_expr *src);
+	bool	(*cmp)(const struct nftnl_expr *e1, const struct nftnl_expr *e2);
+	uint32_t (*hash)(const struct nftnl_expr *e, uint32_t h);
 	int	(*set)(struct nftnl_expr *e, uint16_t type, const void *data, uint32_t data_len);
 	const void *(*get)(const struct nftnl_expr *e, uint16_t type, uint32_t *data_len);
 	int 	(*parse)(struct nftnl_expr *e, struct nlattr *attr);
@@ -21,7 +29,11 @@ struct expr_ops {
 	int	(*output)(char *buf, size_t len, uint32_t flags, const struct nftnl_expr *e);
 };
 
+/* Upper bound on the number of registered expression types. */
+#define EXPR_OPS_MAX	64
+
 struct expr_ops *nftnl_expr_ops_lookup(const char *name);
+struct expr_ops *nftnl_expr_ops_lookup_id(const char *name, uint32_t *id);
 
 #define nftnl_expr_data(ops) (void *)ops->data
 
@@ -0,0 +1,124 @@
+#ifndef _LIBNFTNL_CACHE_H_
+#define _LIBNFTNL_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * In-memory copy of the ruleset, kept up to date from netlink messages:
+ * the replies to dump requests seed it, monitor events keep it exact. Rules
+ * are held by their chains, elements by their sets, all objects are indexed
+ * by family, table and name, rules by handle.
+ */
+struct nftnl_cache;
+
+struct nftnl_table;
+struct nftnl_chain;
+struct nftnl_rule;
+struct nftnl_set;
+struct nftnl_obj;
+struct nftnl_flowtable;
+struct nftnl_table_list;
+struct nftnl_chain_list;
+struct nftnl_set_list;
+struct nftnl_obj_list;
+struct nftnl_flowtable_list;
+struct nlmsghdr;
+struct mnl_socket;
+
+/* Object types, as a mask of what to flush or dump again. */
+enum nftnl_cache_type {
+	NFTNL_CACHE_TABLE	= (1 << 0),
+	NFTNL_CACHE_CHAIN	= (1 << 1),
+	NFTNL_CACHE_RULE	= (1 << 2),
+	NFTNL_CACHE_SET		= (1 << 3),
+	NFTNL_CACHE_SETELEM	= (1 << 4),
+	NFTNL_CACHE_OBJ		= (1 << 5),
+	NFTNL_CACHE_FLOWTABLE	= (1 << 6),
+};
+#define NFTNL_CACHE_ALL		((1 << 7) - 1)
+
+struct nftnl_cache *nftnl_cache_alloc(void);
+void nftnl_cache_free(struct nftnl_cache *cache);
+
+/*
+ * Apply one message, a dump reply or an event, to the cache. Messages that
+ * carry no object are ignored. A generation message that does not follow
+ * the generation the cache is at means events were missed: the cache is
+ * marked stale and this returns -1 with errno set to ESTALE. So does a
+ * message for an object, or the parent of an object, the cache does not
+ * hold. Otherwise returns 0, or -1 with errno set if parsing failed.
+ */
+int nftnl_cache_apply(struct nftnl_cache *cache, const struct nlmsghdr *nlh);
+
+/*
+ * Drop all objects of the types in @types, and what they hold: flushing
+ * chains drops their rules, flushing sets drops their elements.
+ */
+void nftnl_cache_flush(struct nftnl_cache *cache, uint32_t types);
+
+/*
+ * Generation the cache contents belong to, to be set once seeding dumps
+ * are done. Setting it clears the stale mark.
+ */
+void nftnl_cache_set_genid(struct nftnl_cache *cache, uint32_t genid);
+uint32_t nftnl_cache_get_genid(const struct nftnl_cache *cache);
+
+/*
+ * A new cache is stale until its generation is set. The stale types are
+ * those of the objects that events could not be applied to, along with the
+ * types of objects they hold, and all types after a generation gap.
+ */
+bool nftnl_cache_is_stale(const struct nftnl_cache *cache);
+uint32_t nftnl_cache_stale_types(const struct nftnl_cache *cache);
+
+/* Mark objects of @types stale, after events were lost. */
+void nftnl_cache_set_stale(struct nftnl_cache *cache, uint32_t types);
+
+/*
+ * Ask the kernel for the current generation over @nl, a netfilter socket,
+ * and compare it with the cache. Nothing else is sent while they match and
+ * the cache is not stale. Otherwise the stale types, or all of them if the
+ * generation moved on, are flushed and dumped again, until the generation
+ * holds still over the dumps. Returns 0 if the cache was up to date, 1 if it
+ * was refreshed, or -1 with errno set; EAGAIN if the ruleset kept changing.
+ */
+int nftnl_cache_validate(struct nftnl_cache *cache, struct mnl_socket *nl);
+
+struct nftnl_table *nftnl_cache_table_lookup(const struct nftnl_cache *cache,
+					     uint32_t family, const char *name);
+struct nftnl_chain *nftnl_cache_chain_lookup(const struct nftnl_cache *cache,
+					     uint32_t family, const char *table,
+					     const char *name);
+struct nftnl_rule *nftnl_cache_rule_lookup(const struct nftnl_cache *cache,
+					   uint32_t family, const char *table,
+					   uint64_t handle);
+struct nftnl_set *nftnl_cache_set_lookup(const struct nftnl_cache *cache,
+					 uint32_t family, const char *table,
+					 const char *name);
+struct nftnl_obj *nftnl_cache_obj_lookup(const struct nftnl_cache *cache,
+					 uint32_t family, const char *table,
+					 const char *name, uint32_t type);
+struct nftnl_flowtable *
+nftnl_cache_flowtable_lookup(const struct nftnl_cache *cache, uint32_t family,
+			     const char *table, const char *name);
+
+/* All objects of a type, in the order they were added. */
+const struct nftnl_table_list *
+nftnl_cache_tables(const struct nftnl_cache *cache);
+const struct nftnl_chain_list *
+nftnl_cache_chains(const struct nftnl_cache *cache);
+const struct nftnl_set_list *nftnl_cache_sets(const struct nftnl_cache *cache);
+const struct nftnl_obj_list *nftnl_cache_objs(const struct nftnl_cache *cache);
+const struct nftnl_flowtable_list *
+nftnl_cache_flowtables(const struct nftnl_cache *cache);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_CACHE_H_ */
@@ -17,6 +17,8 @@ struct nftnl_rule;
 
 struct nftnl_chain *nftnl_chain_alloc(void);
 void nftnl_chain_free(const struct nftnl_chain *);
+struct nftnl_chain *nftnl_chain_clone(const struct nftnl_chain *c,
+				      uint32_t flags);
 
 enum nftnl_chain_attr {
 	NFTNL_CHAIN_NAME	= 0,
@@ -86,8 +88,14 @@ int nftnl_rule_foreach(struct nftnl_chain *c,
 			  void *data);
 struct nftnl_rule *nftnl_rule_lookup_byindex(struct nftnl_chain *c, uint32_t index);
 
-struct nftnl_rule_iter;
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_rule_iter {
+	const struct nftnl_chain	*c;
+	struct nftnl_rule		*cur;
+};
 
+void nftnl_rule_iter_init(struct nftnl_rule_iter *iter,
+			  const struct nftnl_chain *c);
 struct nftnl_rule_iter *nftnl_rule_iter_create(const struct nftnl_chain *c);
 struct nftnl_rule *nftnl_rule_iter_next(struct nftnl_rule_iter *iter);
 void nftnl_rule_iter_destroy(struct nftnl_rule_iter *iter);
@@ -104,8 +112,18 @@ void nftnl_chain_list_add(struct nftnl_chain *r, struct nftnl_chain_list *list);
 void nftnl_chain_list_add_tail(struct nftnl_chain *r, struct nftnl_chain_list *list);
 void nftnl_chain_list_del(struct nftnl_chain *c);
 
-struct nftnl_chain_list_iter;
+/* Same as nftnl_table_list_dump(). */
+struct mnl_socket;
+int nftnl_chain_list_dump(struct nftnl_chain_list *list,
+			  struct mnl_socket *nl, uint32_t family);
+
+struct nftnl_chain_list_iter {
+	const struct nftnl_chain_list	*list;
+	struct nftnl_chain		*cur;
+};
 
+void nftnl_chain_list_iter_init(struct nftnl_chain_list_iter *iter,
+				const struct nftnl_chain_list *l);
 struct nftnl_chain_list_iter *nftnl_chain_list_iter_create(const struct nftnl_chain_list *l);
 struct nftnl_chain *nftnl_chain_list_iter_next(struct nftnl_chain_list_iter *iter);
 void nftnl_chain_list_iter_destroy(struct nftnl_chain_list_iter *iter);
@@ -26,6 +26,15 @@ enum nftnl_output_flags {
 	NFTNL_OF_EVENT_ANY	= (NFTNL_OF_EVENT_NEW | NFTNL_OF_EVENT_DEL),
 };
 
+/*
+ * Flags for the *_clone() functions. With NFTNL_CLONE_F_COW, expressions of
+ * the clone share their data with the original until either side modifies
+ * them.
+ */
+enum nftnl_clone_flags {
+	NFTNL_CLONE_F_COW	= (1 << 0),
+};
+
 enum nftnl_cmd_type {
 	NFTNL_CMD_UNSPEC		= 0,
 	NFTNL_CMD_ADD,
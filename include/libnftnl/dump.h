@@ -0,0 +1,40 @@
+#ifndef _LIBNFTNL_DUMP_H_
+#define _LIBNFTNL_DUMP_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pool of threads that parse dump replies. The calling thread receives the
+ * reply into buffers, workers parse each buffer into a list of its own and
+ * the calling thread appends those lists to the result in the order of the
+ * dump. Objects may be freed by any thread afterwards.
+ */
+struct nftnl_dump_pipeline;
+
+struct mnl_socket;
+struct nlmsghdr;
+
+struct nftnl_dump_pipeline *nftnl_dump_pipeline_alloc(unsigned int workers);
+void nftnl_dump_pipeline_free(struct nftnl_dump_pipeline *p);
+
+/*
+ * Send the dump request @nlh over @nl and append what it returns to @list:
+ * a struct nftnl_table_list for NFT_MSG_GETTABLE, nftnl_chain_list,
+ * nftnl_rule_list, nftnl_set_list, nftnl_obj_list or nftnl_flowtable_list
+ * for the other types, or the struct nftnl_set the elements belong to for
+ * NFT_MSG_GETSETELEM. Interrupted dumps are done again as in
+ * nftnl_table_list_dump(). Only one dump runs on a pipeline at a time.
+ */
+int nftnl_dump_pipeline_run(struct nftnl_dump_pipeline *p,
+			    struct mnl_socket *nl, struct nlmsghdr *nlh,
+			    void *list);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_DUMP_H_ */
@@ -0,0 +1,146 @@
+#ifndef _LIBNFTNL_EVAL_H_
+#define _LIBNFTNL_EVAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Userspace evaluation of a ruleset: chains are compiled from the rules of a
+ * ruleset and run against packet buffers the way the kernel would, with the
+ * same register file and set lookups. Stateful expressions such as counter,
+ * limit and quota are skipped; expressions that need state that is not
+ * available here make compilation fail with EOPNOTSUPP.
+ */
+struct nftnl_eval;
+struct nftnl_eval_chain;
+struct nftnl_ruleset;
+
+struct nftnl_eval_pkt {
+	/* starts at the link layer header, if there is one */
+	const void	*data;
+	uint32_t	len;
+	/* network header offset, 0 if the packet has no link layer header */
+	uint32_t	nhoff;
+	/* transport header offset, 0 to derive it from the IP header */
+	uint32_t	thoff;
+	uint32_t	mark;
+	uint32_t	iif;
+	uint32_t	oif;
+	/* conntrack state bits, as in ct state */
+	uint32_t	ct_state;
+};
+
+struct nftnl_eval_result {
+	/* NF_ACCEPT, NF_DROP, NF_QUEUE... */
+	uint32_t	verdict;
+	/* rule that issued the verdict, 0 if the chain policy applies */
+	uint64_t	handle;
+	/* chain of that rule, or base chain whose policy applies */
+	const char	*chain;
+	/* packet mark after meta mark set */
+	uint32_t	mark;
+};
+
+/*
+ * The compiled chains refer to objects of @rs, which must not be modified or
+ * released while the evaluation context is in use.
+ */
+struct nftnl_eval *nftnl_eval_alloc(const struct nftnl_ruleset *rs);
+void nftnl_eval_free(struct nftnl_eval *ev);
+
+struct nftnl_eval_chain *nftnl_eval_chain_lookup(const struct nftnl_eval *ev,
+						 uint32_t family,
+						 const char *table,
+						 const char *chain);
+
+/*
+ * Returns 0 and fills @res, or -1 with errno ELOOP if jumps and gotos nest
+ * deeper than the kernel allows.
+ */
+int nftnl_eval_run(const struct nftnl_eval *ev,
+		   const struct nftnl_eval_chain *chain,
+		   const struct nftnl_eval_pkt *pkt,
+		   struct nftnl_eval_result *res);
+
+/*
+ * Same as nftnl_eval_run() for @num packets at once: each rule is run over
+ * all packets that reach it before moving to the next one. @res[i] is the
+ * result for @pkts[i]. Fails as a whole if a single packet nests too deep.
+ */
+int nftnl_eval_run_batch(const struct nftnl_eval *ev,
+			 const struct nftnl_eval_chain *chain,
+			 const struct nftnl_eval_pkt *pkts, uint32_t num,
+			 struct nftnl_eval_result *res);
+
+/*
+ * Cost model: what a packet goes through on its way through a chain.
+ * Expressions that are skipped, such as counters, do not count.
+ */
+struct nftnl_eval_cost {
+	uint64_t	rules;
+	uint64_t	exprs;
+	uint64_t	lookups;
+	/* jumps and gotos */
+	uint64_t	jumps;
+};
+
+/*
+ * Upper bound for a single packet: every rule of @chain is evaluated to the
+ * end, and so is every chain it jumps or goes to.
+ */
+int nftnl_eval_chain_cost(const struct nftnl_eval_chain *chain,
+			  struct nftnl_eval_cost *cost);
+
+/* Per rule hit counts and cost of a traffic sample. */
+struct nftnl_eval_profile;
+
+struct nftnl_eval_profile *nftnl_eval_profile_alloc(const struct nftnl_eval *ev);
+void nftnl_eval_profile_free(struct nftnl_eval_profile *prof);
+
+int nftnl_eval_profile_run(struct nftnl_eval_profile *prof,
+			   const struct nftnl_eval_chain *chain,
+			   const struct nftnl_eval_pkt *pkts, uint32_t num);
+
+/* Adds up the cost of all packets run so far, returns their number. */
+uint64_t nftnl_eval_profile_cost(const struct nftnl_eval_profile *prof,
+				 struct nftnl_eval_cost *cost);
+
+enum nftnl_eval_rule_flags {
+	/*
+	 * Late in a long chain, and the packets it matches spend a large share
+	 * of the chain's rule evaluations getting there. Worth moving up.
+	 */
+	NFTNL_EVAL_RULE_F_HOT_LATE	= (1 << 0),
+};
+
+struct nftnl_eval_rule_stats {
+	const char	*table;
+	const char	*chain;
+	uint64_t	handle;
+	/* rules before this one in its chain */
+	uint32_t	position;
+	uint32_t	chain_rules;
+	/* packets that reached the rule, and that got a verdict from it */
+	uint64_t	evals;
+	uint64_t	hits;
+	uint32_t	flags;
+};
+
+/* Calls @cb for each rule, chain by chain, in rule order. */
+int nftnl_eval_profile_foreach(const struct nftnl_eval_profile *prof,
+			       int (*cb)(const struct nftnl_eval_rule_stats *st,
+					 void *data),
+			       void *data);
+
+int nftnl_eval_profile_snprintf(char *buf, size_t size,
+				const struct nftnl_eval_profile *prof);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_EVAL_H_ */
@@ -18,6 +18,15 @@ enum {
 
 struct nftnl_expr *nftnl_expr_alloc(const char *name);
 void nftnl_expr_free(const struct nftnl_expr *expr);
+struct nftnl_expr *nftnl_expr_clone(const struct nftnl_expr *expr,
+				    uint32_t flags);
+
+/*
+ * Structural comparison and hashing, runtime state such as counter values
+ * is ignored. Equal expressions hash to the same value for a given seed.
+ */
+bool nftnl_expr_cmp(const struct nftnl_expr *e1, const struct nftnl_expr *e2);
+uint32_t nftnl_expr_hash(const struct nftnl_expr *expr, uint32_t seed);
 
 bool nftnl_expr_is_set(const struct nftnl_expr *expr, uint16_t type);
 int nftnl_expr_set(struct nftnl_expr *expr, uint16_t type, const void *data, uint32_t data_len);
@@ -37,6 +46,14 @@ uint64_t nftnl_expr_get_u64(const struct nftnl_expr *expr, uint16_t type);
 const char *nftnl_expr_get_str(const struct nftnl_expr *expr, uint16_t type);
 
 void nftnl_expr_build_payload(struct nlmsghdr *nlh, struct nftnl_expr *expr);
+void nftnl_expr_cache_wire(struct nftnl_expr *expr, bool enable);
+
+/*
+ * Recycle expressions through per-type slabs with thread-local free lists
+ * instead of the heap. Safe to use from several threads.
+ */
+int nftnl_expr_pool_enable(void);
+void nftnl_expr_pool_disable(void);
 
 /* For dynset expressions. */
 void nftnl_expr_add_expr(struct nftnl_expr *expr, uint32_t type, struct nftnl_expr *e);
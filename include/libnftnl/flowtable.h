@@ -55,6 +55,10 @@ const char *const *nftnl_flowtable_get_array(const struct nftnl_flowtable *t, ui
 struct nlmsghdr;
 
 void nftnl_flowtable_nlmsg_build_payload(struct nlmsghdr *nlh, const struct nftnl_flowtable *t);
+/* Same for flowtables, see nftnl_rule_nlmsg_build_dump_filter(). */
+void nftnl_flowtable_nlmsg_build_dump_filter(struct nlmsghdr *nlh,
+					     uint32_t family,
+					     const char *table);
 
 int nftnl_flowtable_parse(struct nftnl_flowtable *c, enum nftnl_parse_type type,
 		    const char *data, struct nftnl_parse_err *err);
@@ -76,9 +80,33 @@ void nftnl_flowtable_list_add(struct nftnl_flowtable *s,
 void nftnl_flowtable_list_add_tail(struct nftnl_flowtable *s,
 				   struct nftnl_flowtable_list *list);
 void nftnl_flowtable_list_del(struct nftnl_flowtable *s);
+
+/*
+ * Same as nftnl_table_list_dump(), with the filter of
+ * nftnl_flowtable_nlmsg_build_dump_filter().
+ */
+struct mnl_socket;
+int nftnl_flowtable_list_dump(struct nftnl_flowtable_list *list,
+			      struct mnl_socket *nl, uint32_t family,
+			      const char *table);
+
 int nftnl_flowtable_list_foreach(struct nftnl_flowtable_list *flowtable_list,
 				 int (*cb)(struct nftnl_flowtable *t, void *data), void *data);
 
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_flowtable_list_iter {
+	const struct nftnl_flowtable_list	*list;
+	struct nftnl_flowtable			*cur;
+};
+
+void nftnl_flowtable_list_iter_init(struct nftnl_flowtable_list_iter *iter,
+				    const struct nftnl_flowtable_list *l);
+struct nftnl_flowtable_list_iter *
+nftnl_flowtable_list_iter_create(const struct nftnl_flowtable_list *l);
+struct nftnl_flowtable *
+nftnl_flowtable_list_iter_next(struct nftnl_flowtable_list_iter *iter);
+void nftnl_flowtable_list_iter_destroy(struct nftnl_flowtable_list_iter *iter);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
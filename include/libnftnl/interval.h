@@ -0,0 +1,43 @@
+#ifndef _LIBNFTNL_INTERVAL_H_
+#define _LIBNFTNL_INTERVAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interval set builder: collects ranges and prefixes in any order, merges
+ * overlapping and adjacent ones and turns the result into the fewest
+ * elements of an interval set. Keys are in network byte order.
+ */
+struct nftnl_interval;
+struct nftnl_set;
+
+enum nftnl_interval_flags {
+	/* one element per range, with its last key in NFTNL_SET_ELEM_KEY_END */
+	NFTNL_INTERVAL_F_KEY_END	= (1 << 0),
+};
+
+struct nftnl_interval *nftnl_interval_alloc(uint32_t key_len);
+void nftnl_interval_free(struct nftnl_interval *iv);
+
+int nftnl_interval_add_range(struct nftnl_interval *iv, const void *from,
+			     const void *to);
+int nftnl_interval_add_prefix(struct nftnl_interval *iv, const void *addr,
+			      uint32_t prefix_len);
+
+/*
+ * Append the merged ranges to @s, either as a start element plus an element
+ * flagged NFT_SET_ELEM_INTERVAL_END right past the range, or as a single
+ * element with NFTNL_INTERVAL_F_KEY_END. Returns the number of ranges.
+ */
+int nftnl_interval_set_elems(struct nftnl_interval *iv, struct nftnl_set *s,
+			     uint32_t flags);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_INTERVAL_H_ */
@@ -0,0 +1,105 @@
+#ifndef _LIBNFTNL_MONITOR_H_
+#define _LIBNFTNL_MONITOR_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader of nf_tables events. Many datagrams are read per system call and
+ * set element events are delivered one element at a time, without parsing
+ * them into objects. Element events may be held for a while: an element
+ * added and deleted again before it is delivered is never delivered, an
+ * element deleted and added again is delivered as added only. Other events
+ * are delivered as they come, after all held element events.
+ */
+struct nftnl_monitor;
+struct nftnl_monitor_event;
+
+struct mnl_socket;
+struct nlmsghdr;
+struct nftnl_set_elem;
+struct nftnl_cache;
+
+enum nftnl_monitor_attr {
+	NFTNL_MONITOR_WINDOW	= 0,	/* u32, ms element events are held */
+	NFTNL_MONITOR_EVENTS,		/* u64, events read */
+	NFTNL_MONITOR_DELIVERED,	/* u64, events delivered */
+	NFTNL_MONITOR_COALESCED,	/* u64, events not delivered */
+	NFTNL_MONITOR_DROPS,		/* u64, times events were lost */
+	NFTNL_MONITOR_RESYNCS,		/* u64, times the cache was dumped */
+	__NFTNL_MONITOR_MAX
+};
+#define NFTNL_MONITOR_MAX (__NFTNL_MONITOR_MAX - 1)
+
+/* Return -1 to stop processing, the rest of what was read is dropped. */
+typedef int (*nftnl_monitor_cb_t)(const struct nftnl_monitor_event *ev,
+				  void *data);
+
+/*
+ * Read events from @nl, a netfilter socket subscribed to NFNLGRP_NFTABLES,
+ * into a buffer of @size bytes, split in datagram-sized slots.
+ */
+struct nftnl_monitor *nftnl_monitor_alloc(struct mnl_socket *nl, size_t size,
+					  nftnl_monitor_cb_t cb, void *data);
+void nftnl_monitor_free(struct nftnl_monitor *mon);
+
+void nftnl_monitor_set_u32(struct nftnl_monitor *mon, uint16_t attr,
+			   uint32_t val);
+uint32_t nftnl_monitor_get_u32(const struct nftnl_monitor *mon, uint16_t attr);
+uint64_t nftnl_monitor_get_u64(const struct nftnl_monitor *mon, uint16_t attr);
+
+/*
+ * Apply events to @cache as they are delivered. When the socket overflows,
+ * or events do not apply, the types of objects that may have changed are
+ * dumped again over @dump_nl, a netfilter socket that is not subscribed to
+ * events: element and object state if the generation did not move on, all
+ * of the ruleset otherwise. Events queued at the overflow are dropped.
+ */
+void nftnl_monitor_set_cache(struct nftnl_monitor *mon,
+			     struct nftnl_cache *cache,
+			     struct mnl_socket *dump_nl);
+
+/*
+ * Wait for events, read as many as there are room for and deliver them,
+ * along with held events that are due. Returns the number of events
+ * delivered, or -1 with errno set. On overflow without a cache, held events
+ * are delivered, queued ones dropped, and errno is ENOBUFS; the caller has
+ * to dump what it keeps track of again.
+ */
+int nftnl_monitor_read(struct nftnl_monitor *mon);
+
+/* Same for @len bytes of datagrams received by other means. */
+int nftnl_monitor_process(struct nftnl_monitor *mon, const void *buf,
+			  size_t len);
+
+/* Deliver all held events. */
+int nftnl_monitor_flush(struct nftnl_monitor *mon);
+
+/* Milliseconds until held events are due, -1 if none are held. */
+int nftnl_monitor_timeout(const struct nftnl_monitor *mon);
+
+/* Event type, NFT_MSG_*. */
+uint16_t nftnl_monitor_event_type(const struct nftnl_monitor_event *ev);
+uint32_t nftnl_monitor_event_family(const struct nftnl_monitor_event *ev);
+
+/* The message, for events other than set elements, NULL otherwise. */
+const struct nlmsghdr *
+nftnl_monitor_event_nlmsg(const struct nftnl_monitor_event *ev);
+
+/* Set element events only. */
+const char *nftnl_monitor_event_table(const struct nftnl_monitor_event *ev);
+const char *nftnl_monitor_event_set(const struct nftnl_monitor_event *ev);
+const void *nftnl_monitor_event_key(const struct nftnl_monitor_event *ev,
+				    uint32_t *len);
+struct nftnl_set_elem *
+nftnl_monitor_event_elem(const struct nftnl_monitor_event *ev);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_MONITOR_H_ */
@@ -120,6 +120,7 @@ struct nftnl_obj;
 
 struct nftnl_obj *nftnl_obj_alloc(void);
 void nftnl_obj_free(const struct nftnl_obj *ne);
+struct nftnl_obj *nftnl_obj_clone(const struct nftnl_obj *obj);
 
 bool nftnl_obj_is_set(const struct nftnl_obj *ne, uint16_t attr);
 void nftnl_obj_unset(struct nftnl_obj *ne, uint16_t attr);
@@ -142,6 +143,9 @@ const char *nftnl_obj_get_str(struct nftnl_obj *ne, uint16_t attr);
 
 void nftnl_obj_nlmsg_build_payload(struct nlmsghdr *nlh,
 				   const struct nftnl_obj *ne);
+/* Same for objects, of any type if @type is NFT_OBJECT_UNSPEC. */
+void nftnl_obj_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+				       const char *table, uint32_t type);
 int nftnl_obj_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_obj *ne);
 int nftnl_obj_parse(struct nftnl_obj *ne, enum nftnl_parse_type type,
 		    const char *data, struct nftnl_parse_err *err);
@@ -155,15 +159,31 @@ int nftnl_obj_fprintf(FILE *fp, const struct nftnl_obj *ne, uint32_t type,
 struct nftnl_obj_list;
 struct nftnl_obj_list *nftnl_obj_list_alloc(void);
 void nftnl_obj_list_free(struct nftnl_obj_list *list);
-int nftnl_obj_list_is_empty(struct nftnl_obj_list *list);
+int nftnl_obj_list_is_empty(const struct nftnl_obj_list *list);
 void nftnl_obj_list_add(struct nftnl_obj *r, struct nftnl_obj_list *list);
 void nftnl_obj_list_add_tail(struct nftnl_obj *r, struct nftnl_obj_list *list);
 void nftnl_obj_list_del(struct nftnl_obj *t);
+
+/*
+ * Same as nftnl_table_list_dump(), with the filter of
+ * nftnl_obj_nlmsg_build_dump_filter().
+ */
+struct mnl_socket;
+int nftnl_obj_list_dump(struct nftnl_obj_list *list, struct mnl_socket *nl,
+			uint32_t family, const char *table, uint32_t type);
+
 int nftnl_obj_list_foreach(struct nftnl_obj_list *table_list,
 			   int (*cb)(struct nftnl_obj *t, void *data),
 			   void *data);
 
-struct nftnl_obj_list_iter;
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_obj_list_iter {
+	const struct nftnl_obj_list	*list;
+	struct nftnl_obj		*cur;
+};
+
+void nftnl_obj_list_iter_init(struct nftnl_obj_list_iter *iter,
+			      const struct nftnl_obj_list *l);
 struct nftnl_obj_list_iter *nftnl_obj_list_iter_create(struct nftnl_obj_list *l);
 struct nftnl_obj *nftnl_obj_list_iter_next(struct nftnl_obj_list_iter *iter);
 void nftnl_obj_list_iter_destroy(struct nftnl_obj_list_iter *iter);
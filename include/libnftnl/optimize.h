@@ -0,0 +1,65 @@
+#ifndef _LIBNFTNL_OPTIMIZE_H_
+#define _LIBNFTNL_OPTIMIZE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optimization passes over the rules of a chain. Rules are rewritten in
+ * place; every packet still gets the same verdict. New rules carry no
+ * handle, the caller adds them and deletes the replaced ones.
+ */
+struct nftnl_chain;
+struct nftnl_chain_list;
+struct nftnl_rule;
+struct nftnl_rule_list;
+struct nftnl_set_list;
+
+/*
+ * Replace runs of at least four consecutive rules that load the same field,
+ * compare it with a constant and issue a verdict, and do nothing else, by a
+ * single lookup into an anonymous set, or into a verdict map when verdicts
+ * differ. New sets are appended to @sets, numbered from *@set_id onwards,
+ * and named for the kernel to pick the name. The replaced rules are moved
+ * to @replaced, with their handles. Returns by how many rules @c shrank.
+ */
+int nftnl_chain_optimize_lookups(struct nftnl_chain *c,
+				 struct nftnl_set_list *sets,
+				 uint32_t *set_id,
+				 struct nftnl_rule_list *replaced);
+
+/*
+ * Spread runs of at least sixteen consecutive rules that match the same
+ * address field against a prefix over a tree of regular chains, one address
+ * byte per level and up to four levels deep. Each level dispatches through
+ * an anonymous verdict map that jumps to the chain for the byte value. Rules
+ * that goto or return, or dispatch through a verdict map themselves, stay in
+ * @c. New chains are appended to @chains, new maps to @sets numbered from
+ * *@set_id onwards. Rules moved to the new chains lose their handles, and
+ * copies of them as they were in @c, handles included, are appended to
+ * @replaced. Returns the number of chains added.
+ */
+int nftnl_chain_partition(struct nftnl_chain *c,
+			  struct nftnl_chain_list *chains,
+			  struct nftnl_set_list *sets, uint32_t *set_id,
+			  struct nftnl_rule_list *replaced);
+
+/*
+ * Drop expressions of @r that do not change what the rule does: bitwise
+ * operations with an all-ones mask or a zero shift, byteorder conversions
+ * undone right away, reloads of a payload field still in its register and
+ * compares implied by a preceding range on the same register. Compares
+ * that narrow such a range are folded into it, unless a counter, log,
+ * limit or quota sits in between. Returns the number of expressions
+ * removed.
+ */
+int nftnl_rule_optimize_exprs(struct nftnl_rule *r);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_OPTIMIZE_H_ */
@@ -17,6 +17,14 @@ struct nftnl_expr;
 
 struct nftnl_rule *nftnl_rule_alloc(void);
 void nftnl_rule_free(const struct nftnl_rule *);
+struct nftnl_rule *nftnl_rule_clone(const struct nftnl_rule *r, uint32_t flags);
+
+/*
+ * Compare rules by what they do: handle and position are ignored, and so is
+ * runtime state of their expressions such as counter values.
+ */
+bool nftnl_rule_equal(const struct nftnl_rule *r1, const struct nftnl_rule *r2);
+uint32_t nftnl_rule_hash(const struct nftnl_rule *r);
 
 enum nftnl_rule_attr {
 	NFTNL_RULE_FAMILY	= 0,
@@ -56,6 +64,20 @@ void nftnl_rule_del_expr(struct nftnl_expr *expr);
 struct nlmsghdr;
 
 void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *t);
+/*
+ * Restrict a NFT_MSG_GETRULE dump request to the rules of @table, and of
+ * @chain in it, where not NULL. The kernel ignores @chain without @table.
+ * @family, NFPROTO_UNSPEC for all, replaces the one in the header.
+ */
+void nftnl_rule_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+					const char *table, const char *chain);
+
+/*
+ * Keep the encoded expressions of this rule around so that later builds only
+ * copy them. The cache is dropped whenever the expression list or any of its
+ * expressions is modified.
+ */
+void nftnl_rule_cache_wire(struct nftnl_rule *r, bool enable);
 
 int nftnl_rule_parse(struct nftnl_rule *r, enum nftnl_parse_type type,
 		   const char *data, struct nftnl_parse_err *err);
@@ -71,8 +93,17 @@ int nftnl_expr_foreach(struct nftnl_rule *r,
 			  int (*cb)(struct nftnl_expr *e, void *data),
 			  void *data);
 
-struct nftnl_expr_iter;
+/*
+ * Iterators may live on the stack: set them up with nftnl_*_iter_init(),
+ * no nftnl_*_iter_destroy() call is needed then. Their fields are private.
+ */
+struct nftnl_expr_iter {
+	const struct nftnl_rule	*r;
+	struct nftnl_expr	*cur;
+};
 
+void nftnl_expr_iter_init(struct nftnl_expr_iter *iter,
+			  const struct nftnl_rule *r);
 struct nftnl_expr_iter *nftnl_expr_iter_create(const struct nftnl_rule *r);
 struct nftnl_expr *nftnl_expr_iter_next(struct nftnl_expr_iter *iter);
 void nftnl_expr_iter_destroy(struct nftnl_expr_iter *iter);
@@ -86,10 +117,24 @@ void nftnl_rule_list_add(struct nftnl_rule *r, struct nftnl_rule_list *list);
 void nftnl_rule_list_add_tail(struct nftnl_rule *r, struct nftnl_rule_list *list);
 void nftnl_rule_list_insert_at(struct nftnl_rule *r, struct nftnl_rule *pos);
 void nftnl_rule_list_del(struct nftnl_rule *r);
+
+/*
+ * Same as nftnl_table_list_dump(), with the filter of
+ * nftnl_rule_nlmsg_build_dump_filter().
+ */
+struct mnl_socket;
+int nftnl_rule_list_dump(struct nftnl_rule_list *list, struct mnl_socket *nl,
+			 uint32_t family, const char *table, const char *chain);
+
 int nftnl_rule_list_foreach(struct nftnl_rule_list *rule_list, int (*cb)(struct nftnl_rule *t, void *data), void *data);
 
-struct nftnl_rule_list_iter;
+struct nftnl_rule_list_iter {
+	const struct nftnl_rule_list	*list;
+	struct nftnl_rule		*cur;
+};
 
+void nftnl_rule_list_iter_init(struct nftnl_rule_list_iter *iter,
+			       const struct nftnl_rule_list *l);
 struct nftnl_rule_list_iter *nftnl_rule_list_iter_create(const struct nftnl_rule_list *l);
 struct nftnl_rule *nftnl_rule_list_iter_cur(struct nftnl_rule_list_iter *iter);
 struct nftnl_rule *nftnl_rule_list_iter_next(struct nftnl_rule_list_iter *iter);
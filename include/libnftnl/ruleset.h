@@ -23,6 +23,8 @@ enum {
 	NFTNL_RULESET_CHAINLIST,
 	NFTNL_RULESET_SETLIST,
 	NFTNL_RULESET_RULELIST,
+	NFTNL_RULESET_OBJLIST,
+	NFTNL_RULESET_FLOWTABLELIST,
 };
 
 enum nftnl_ruleset_type {
@@ -70,6 +72,32 @@ int nftnl_ruleset_parse_file(struct nftnl_ruleset *rs, enum nftnl_parse_type typ
 int nftnl_ruleset_snprintf(char *buf, size_t size, const struct nftnl_ruleset *rs, uint32_t type, uint32_t flags);
 int nftnl_ruleset_fprintf(FILE *fp, const struct nftnl_ruleset *rs, uint32_t type, uint32_t flags);
 
+/*
+ * Add the messages that turn ruleset @cur, as dumped from the kernel, into
+ * @want to @batch, numbered from *@seq onwards. Only the object lists that
+ * are set in @want are compared, and only the attributes set in @want.
+ * Current rules must carry their handle. The caller adds the batch begin and
+ * end messages. Returns the number of messages added, or -1 on error.
+ */
+struct nftnl_batch;
+int nftnl_ruleset_diff(const struct nftnl_ruleset *cur,
+		       const struct nftnl_ruleset *want,
+		       struct nftnl_batch *batch, uint32_t *seq);
+
+/*
+ * Dump tables, chains, rules, sets with their elements, objects and
+ * flowtables of @family, NFPROTO_UNSPEC for all, into the lists of @rs. The
+ * dumps are spread over the @num netlink sockets in @nl, one running on each
+ * at a time, so element dumps of many sets run side by side. If any dump is
+ * interrupted, they span more than one generation, or a set is gone by the
+ * time its elements are dumped, all of them are done again, after a while,
+ * as nftnl_table_list_dump() does. @rs is left as it was on error, dumps
+ * still running are read to their end before returning.
+ */
+struct mnl_socket;
+int nftnl_ruleset_dump(struct nftnl_ruleset *rs, struct mnl_socket **nl,
+		       unsigned int num, uint32_t family);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -63,6 +63,9 @@ struct nlmsghdr;
 
 #define nftnl_set_nlmsg_build_hdr	nftnl_nlmsg_build_hdr
 void nftnl_set_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_set *s);
+/* Same for sets, see nftnl_rule_nlmsg_build_dump_filter(). */
+void nftnl_set_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+				       const char *table);
 int nftnl_set_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s);
 int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s);
 
@@ -77,6 +80,17 @@ int nftnl_set_list_is_empty(const struct nftnl_set_list *list);
 void nftnl_set_list_add(struct nftnl_set *s, struct nftnl_set_list *list);
 void nftnl_set_list_add_tail(struct nftnl_set *s, struct nftnl_set_list *list);
 void nftnl_set_list_del(struct nftnl_set *s);
+
+/*
+ * Same as nftnl_table_list_dump(), with the filter of
+ * nftnl_set_nlmsg_build_dump_filter().
+ */
+struct mnl_socket;
+int nftnl_set_list_dump(struct nftnl_set_list *list, struct mnl_socket *nl,
+			uint32_t family, const char *table);
+/* Append the elements of @s, found by family, table and name. */
+int nftnl_set_elems_dump(struct nftnl_set *s, struct mnl_socket *nl);
+
 int nftnl_set_list_foreach(struct nftnl_set_list *set_list, int (*cb)(struct nftnl_set *t, void *data), void *data);
 struct nftnl_set *nftnl_set_list_lookup_byname(struct nftnl_set_list *set_list,
 					       const char *set);
@@ -87,7 +101,14 @@ int nftnl_set_expr_foreach(const struct nftnl_set *s,
 			   int (*cb)(struct nftnl_expr *e, void *data),
 			   void *data);
 
-struct nftnl_set_list_iter;
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_set_list_iter {
+	const struct nftnl_set_list	*list;
+	struct nftnl_set		*cur;
+};
+
+void nftnl_set_list_iter_init(struct nftnl_set_list_iter *iter,
+			      const struct nftnl_set_list *l);
 struct nftnl_set_list_iter *nftnl_set_list_iter_create(const struct nftnl_set_list *l);
 struct nftnl_set *nftnl_set_list_iter_cur(const struct nftnl_set_list_iter *iter);
 struct nftnl_set *nftnl_set_list_iter_next(struct nftnl_set_list_iter *iter);
@@ -162,7 +183,17 @@ int nftnl_set_elem_expr_foreach(struct nftnl_set_elem *e,
 
 int nftnl_set_elem_foreach(struct nftnl_set *s, int (*cb)(struct nftnl_set_elem *e, void *data), void *data);
 
-struct nftnl_set_elems_iter;
+struct list_head;
+
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_set_elems_iter {
+	const struct nftnl_set		*set;
+	const struct list_head		*list;
+	struct nftnl_set_elem		*cur;
+};
+
+void nftnl_set_elems_iter_init(struct nftnl_set_elems_iter *iter,
+			       const struct nftnl_set *s);
 struct nftnl_set_elems_iter *nftnl_set_elems_iter_create(const struct nftnl_set *s);
 struct nftnl_set_elem *nftnl_set_elems_iter_cur(const struct nftnl_set_elems_iter *iter);
 struct nftnl_set_elem *nftnl_set_elems_iter_next(struct nftnl_set_elems_iter *iter);
@@ -171,6 +202,39 @@ void nftnl_set_elems_iter_destroy(struct nftnl_set_elems_iter *iter);
 int nftnl_set_elems_nlmsg_build_payload_iter(struct nlmsghdr *nlh,
 					   struct nftnl_set_elems_iter *iter);
 
+/*
+ * Append the elements that turn the content of @cur into that of @want to
+ * @add and @del, which may be NULL. Elements are matched on their key, key
+ * end and interval end flag; elements whose data changed show up in both.
+ * Deleted elements only carry what is needed to delete them.
+ */
+int nftnl_set_elems_diff(const struct nftnl_set *cur,
+			 const struct nftnl_set *want,
+			 struct nftnl_set *add, struct nftnl_set *del);
+/*
+ * Same as above for a plain set whose desired content is the array of @num
+ * keys of @key_len bytes each, sorted in memcmp() order.
+ */
+int nftnl_set_elems_diff_keys(const struct nftnl_set *cur, const void *keys,
+			      uint32_t key_len, uint32_t num,
+			      struct nftnl_set *add, struct nftnl_set *del);
+
+/*
+ * Concatenated keys, laid out after NFTNL_SET_DESC_CONCAT: each field starts
+ * on a 32-bit boundary. A tuple holds the same fields without padding.
+ */
+int nftnl_set_concat_key_len(const struct nftnl_set *s);
+int nftnl_set_concat_pack(const struct nftnl_set *s, void *key,
+			  const void *tuple);
+int nftnl_set_concat_unpack(const struct nftnl_set *s, void *tuple,
+			    const void *key, uint32_t key_len);
+/*
+ * Add @num elements keyed by consecutive tuples, with their range ends in
+ * @tuples_end unless NULL.
+ */
+int nftnl_set_elems_add_concat(struct nftnl_set *s, const void *tuples,
+			       const void *tuples_end, uint32_t num);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -72,8 +72,24 @@ void nftnl_table_list_add(struct nftnl_table *r, struct nftnl_table_list *list);
 void nftnl_table_list_add_tail(struct nftnl_table *r, struct nftnl_table_list *list);
 void nftnl_table_list_del(struct nftnl_table *r);
 
-struct nftnl_table_list_iter;
+/*
+ * Dump the tables of @family, NFPROTO_UNSPEC for all, over @nl and append
+ * them to @list. Dumps interrupted by ruleset updates are done again, after
+ * a while; if that keeps happening, -1 is returned with errno EAGAIN and
+ * @list is left as it was.
+ */
+struct mnl_socket;
+int nftnl_table_list_dump(struct nftnl_table_list *list,
+			  struct mnl_socket *nl, uint32_t family);
+
+/* See nftnl_expr_iter, fields are private. */
+struct nftnl_table_list_iter {
+	const struct nftnl_table_list	*list;
+	struct nftnl_table		*cur;
+};
 
+void nftnl_table_list_iter_init(struct nftnl_table_list_iter *iter,
+				const struct nftnl_table_list *l);
 struct nftnl_table_list_iter *nftnl_table_list_iter_create(const struct nftnl_table_list *l);
 struct nftnl_table *nftnl_table_list_iter_next(struct nftnl_table_list_iter *iter);
 void nftnl_table_list_iter_destroy(const struct nftnl_table_list_iter *iter);
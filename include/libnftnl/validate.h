@@ -0,0 +1,38 @@
+#ifndef _LIBNFTNL_VALIDATE_H_
+#define _LIBNFTNL_VALIDATE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Register dataflow checks on rules before they are sent to the kernel.
+ * Expressions are walked in order, a register may only be read after an
+ * earlier expression of the same rule wrote to it.
+ */
+struct nftnl_expr;
+struct nftnl_rule;
+struct nftnl_set_list;
+
+/*
+ * Check the registers used by the expressions of @r. Sets referenced by
+ * lookup and dynset expressions are searched in @sets, by set id or by name
+ * and table, and their key and data lengths checked against the registers;
+ * if @sets is NULL, only registers are checked. Returns 0 if @r is fine,
+ * otherwise -1 with errno set and *@bad, if @bad is not NULL, pointing to
+ * the first offending expression:
+ *
+ *   EINVAL	register out of range or too narrow for the length it holds,
+ *		or a length that is not what the set or operation expects
+ *   ENODATA	register read before anything was written to it
+ *   ENOENT	set not found in @sets
+ */
+int nftnl_rule_validate(const struct nftnl_rule *r,
+			const struct nftnl_set_list *sets,
+			const struct nftnl_expr **bad);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_VALIDATE_H_ */
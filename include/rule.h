@@ -22,6 +22,31 @@ struct nftnl_rule {
 	} compat;
 
 	struct list_head expr_list;
+
+	bool		wire_cache;
+	struct nftnl_wire wire;
 };
 
+void nftnl_rule_wire_invalidate(struct nftnl_rule *r);
+
+/*
+ * nftnl_rule_equal() and nftnl_rule_hash() with the expressions compared and
+ * hashed by @cmp and @hash.
+ */
+struct nftnl_expr;
+bool __nftnl_rule_equal(const struct nftnl_rule *r1,
+			const struct nftnl_rule *r2,
+			bool (*cmp)(const struct nftnl_expr *e1,
+				    const struct nftnl_expr *e2, void *data),
+			void *data);
+uint32_t __nftnl_rule_hash(const struct nftnl_rule *r,
+			   uint32_t (*hash)(const struct nftnl_expr *e,
+					    uint32_t seed, void *data),
+			   void *data);
+
+/* nftnl_rule_nlmsg_build_payload() limited to the attributes in @attrs. */
+struct nlmsghdr;
+void nftnl_rule_nlmsg_build_attrs(struct nlmsghdr *nlh, struct nftnl_rule *r,
+				  uint32_t attrs);
+
 #endif
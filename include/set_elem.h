@@ -20,6 +20,29 @@ struct nftnl_set_elem {
 	} user;
 };
 
+/* Elements to delete from and to add to a set, pointing into both sets. */
+struct nftnl_set_elems_delta {
+	struct nftnl_set_elem	**del;
+	uint32_t		num_del;
+	struct nftnl_set_elem	**add;
+	uint32_t		num_add;
+};
+
+uint32_t nftnl_set_elem_key_hash(const struct nftnl_set_elem *e);
+bool nftnl_set_elem_key_eq(const struct nftnl_set_elem *e1,
+			   const struct nftnl_set_elem *e2);
+
+/* Parse the NFTA_LIST_ELEM attribute @nest into @e. */
+struct nlattr;
+int nftnl_set_elem_nlattr_parse(struct nftnl_set_elem *e,
+				const struct nlattr *nest);
+
+struct nftnl_set;
+int nftnl_set_elems_delta(struct nftnl_set_elems_delta *d,
+			  const struct nftnl_set *cur,
+			  const struct nftnl_set *want);
+void nftnl_set_elems_delta_release(struct nftnl_set_elems_delta *d);
+
 int nftnl_set_elem_snprintf_default(char *buf, size_t size,
 				    const struct nftnl_set_elem *e);
 
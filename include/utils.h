@@ -92,6 +92,32 @@ uint32_t nftnl_str2cmd(const char *cmd);
 
 enum nftnl_cmd_type nftnl_flag2cmd(uint32_t flags);
 
+struct nlmsghdr;
+
+/* Netlink encoding of an object kept around for rebuilds. */
+struct nftnl_wire {
+	void		*data;
+	uint32_t	len;
+};
+
+void nftnl_wire_reset(struct nftnl_wire *wire);
+void nftnl_wire_save(struct nftnl_wire *wire, const void *data, uint32_t len);
+void nftnl_wire_put(struct nlmsghdr *nlh, const struct nftnl_wire *wire);
+
+struct nlattr;
+bool nftnl_attr_nest_overflow(struct nlmsghdr *nlh, const struct nlattr *from,
+			      const struct nlattr *to);
+
+struct nftnl_batch;
+uint32_t nftnl_batch_room(struct nftnl_batch *batch);
+
+/* Incremental hashing of object attributes, finish with nftnl_hash_final(). */
+uint32_t nftnl_hash_u32(uint32_t h, uint32_t val);
+uint32_t nftnl_hash_u64(uint32_t h, uint64_t val);
+uint32_t nftnl_hash_mem(uint32_t h, const void *data, uint32_t len);
+uint32_t nftnl_hash_str(uint32_t h, const char *str);
+uint32_t nftnl_hash_final(uint32_t h);
+
 int nftnl_fprintf(FILE *fpconst, const void *obj, uint32_t cmd, uint32_t type,
 		  uint32_t flags,
 		  int (*snprintf_cb)(char *buf, size_t bufsiz, const void *obj,
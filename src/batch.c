@@ -134,6 +134,13 @@ uint32_t nftnl_batch_buffer_len(struct nftnl_batch *batch)
 	return mnl_nlmsg_batch_size(batch->current_page->batch);
 }
 
+/* Bytes left for the message being built at nftnl_batch_buffer(). */
+uint32_t nftnl_batch_room(struct nftnl_batch *batch)
+{
+	return batch->page_size + batch->page_overrun_size -
+	       mnl_nlmsg_batch_size(batch->current_page->batch);
+}
+
 EXPORT_SYMBOL(nftnl_batch_iovec_len);
 int nftnl_batch_iovec_len(struct nftnl_batch *batch)
 {
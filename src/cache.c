@@ -0,0 +1,1516 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "cache.h"
+#include "dump.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/cache.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
+#include <libnftnl/gen.h>
+
+/*
+ * Every cached object has a node in one hash table, keyed by type, family,
+ * table and name, or handle for rules. Chains are also found by handle, to
+ * follow renames. Elements are keyed by the node of their set and their
+ * key. Nodes of each type are also on a list, for flushing.
+ */
+
+#define CACHE_NODE_TYPES	7
+
+struct cache_key {
+	uint32_t			type;
+	uint32_t			family;
+	const char			*table;
+	const char			*name;
+	uint32_t			obj_type;
+	uint64_t			handle;
+	/* set elements */
+	const struct cache_node		*set;
+	const struct nftnl_set_elem	*elem;
+};
+
+struct cache_node {
+	struct cache_node	*next;
+	struct list_head	head;
+	uint32_t		hash;
+	struct cache_key	key;
+	void			*obj;
+	/* chains, the node that finds them by handle */
+	struct cache_node	*handle_node;
+};
+
+struct nftnl_cache {
+	struct cache_node		**buckets;
+	uint32_t			size;
+	uint32_t			count;
+	struct list_head		nodes[CACHE_NODE_TYPES];
+
+	struct nftnl_table_list		*tables;
+	struct nftnl_chain_list		*chains;
+	struct nftnl_set_list		*sets;
+	struct nftnl_obj_list		*objs;
+	struct nftnl_flowtable_list	*flowtables;
+
+	uint32_t			genid;
+	/* NFTNL_CACHE_* types that must be dumped again */
+	uint32_t			stale_types;
+};
+
+/* Index of the node list for type @type, one of NFTNL_CACHE_*. */
+static uint32_t cache_list_idx(uint32_t type)
+{
+	return __builtin_ctz(type);
+}
+
+static uint32_t cache_key_hash(const struct cache_key *key)
+{
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, key->type);
+	if (key->type == NFTNL_CACHE_SETELEM) {
+		h = nftnl_hash_u64(h, (uintptr_t)key->set);
+		h = nftnl_hash_u32(h, nftnl_set_elem_key_hash(key->elem));
+		return nftnl_hash_final(h);
+	}
+
+	h = nftnl_hash_u32(h, key->family);
+	if (key->table)
+		h = nftnl_hash_str(h, key->table);
+	if (key->name)
+		h = nftnl_hash_str(h, key->name);
+	h = nftnl_hash_u32(h, key->obj_type);
+	h = nftnl_hash_u64(h, key->handle);
+
+	return nftnl_hash_final(h);
+}
+
+static bool cache_str_eq(const char *s1, const char *s2)
+{
+	if (s1 == NULL || s2 == NULL)
+		return s1 == s2;
+
+	return !strcmp(s1, s2);
+}
+
+static bool cache_key_eq(const struct cache_key *k1,
+			 const struct cache_key *k2)
+{
+	if (k1->type != k2->type)
+		return false;
+
+	if (k1->type == NFTNL_CACHE_SETELEM)
+		return k1->set == k2->set &&
+		       nftnl_set_elem_key_eq(k1->elem, k2->elem);
+
+	return k1->family == k2->family &&
+	       k1->obj_type == k2->obj_type &&
+	       k1->handle == k2->handle &&
+	       cache_str_eq(k1->table, k2->table) &&
+	       cache_str_eq(k1->name, k2->name);
+}
+
+static struct cache_node *cache_find(const struct nftnl_cache *cache,
+				     const struct cache_key *key)
+{
+	uint32_t hash = cache_key_hash(key);
+	struct cache_node *n;
+
+	for (n = cache->buckets[hash & (cache->size - 1)]; n; n = n->next) {
+		if (n->hash == hash && cache_key_eq(&n->key, key))
+			return n;
+	}
+	return NULL;
+}
+
+static int cache_grow(struct nftnl_cache *cache)
+{
+	uint32_t size = cache->size * 2, i;
+	struct cache_node **buckets, *n, *next;
+
+	buckets = calloc(size, sizeof(struct cache_node *));
+	if (buckets == NULL)
+		return -1;
+
+	for (i = 0; i < cache->size; i++) {
+		for (n = cache->buckets[i]; n; n = next) {
+			next = n->next;
+			n->next = buckets[n->hash & (size - 1)];
+			buckets[n->hash & (size - 1)] = n;
+		}
+	}
+
+	xfree(cache->buckets);
+	cache->buckets = buckets;
+	cache->size = size;
+	return 0;
+}
+
+static void cache_link(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct cache_node **b;
+
+	n->hash = cache_key_hash(&n->key);
+	b = &cache->buckets[n->hash & (cache->size - 1)];
+	n->next = *b;
+	*b = n;
+	cache->count++;
+}
+
+static void cache_unlink(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct cache_node **p;
+
+	for (p = &cache->buckets[n->hash & (cache->size - 1)]; *p;
+	     p = &(*p)->next) {
+		if (*p == n) {
+			*p = n->next;
+			cache->count--;
+			return;
+		}
+	}
+}
+
+/* Nodes without a list, for the handles of chains, keep @listed false. */
+static struct cache_node *cache_add(struct nftnl_cache *cache,
+				    const struct cache_key *key, void *obj,
+				    bool listed)
+{
+	struct cache_node *n;
+
+	if (cache->count >= cache->size && cache_grow(cache) < 0)
+		return NULL;
+
+	n = calloc(1, sizeof(struct cache_node));
+	if (n == NULL)
+		return NULL;
+
+	n->key = *key;
+	n->obj = obj;
+	cache_link(cache, n);
+
+	if (listed)
+		list_add_tail(&n->head,
+			      &cache->nodes[cache_list_idx(key->type)]);
+	else
+		INIT_LIST_HEAD(&n->head);
+
+	return n;
+}
+
+static void cache_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	cache_unlink(cache, n);
+	list_del(&n->head);
+	xfree(n);
+}
+
+/* Add the types whose objects hold objects of @types. */
+static uint32_t cache_types_expand(uint32_t types)
+{
+	if (types & NFTNL_CACHE_TABLE)
+		return NFTNL_CACHE_ALL;
+	if (types & NFTNL_CACHE_CHAIN)
+		types |= NFTNL_CACHE_RULE;
+	if (types & NFTNL_CACHE_SET)
+		types |= NFTNL_CACHE_SETELEM;
+
+	return types;
+}
+
+/*
+ * Objects the cache does not hold, or updates out of order. Objects of
+ * @types, and what they hold, are out of date.
+ */
+static int cache_stale(struct nftnl_cache *cache, uint32_t types)
+{
+	cache->stale_types |= cache_types_expand(types);
+	errno = ESTALE;
+	return -1;
+}
+
+static void cache_table_key(struct cache_key *key, const struct nftnl_table *t)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_TABLE;
+	key->family = nftnl_table_get_u32(t, NFTNL_TABLE_FAMILY);
+	key->name = nftnl_table_get_str(t, NFTNL_TABLE_NAME);
+}
+
+static void cache_chain_key(struct cache_key *key, const struct nftnl_chain *c)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_CHAIN;
+	key->family = nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY);
+	key->table = nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE);
+	key->name = nftnl_chain_get_str(c, NFTNL_CHAIN_NAME);
+}
+
+static void cache_chain_handle_key(struct cache_key *key,
+				   const struct nftnl_chain *c)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_CHAIN;
+	key->family = nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY);
+	key->table = nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE);
+	key->handle = nftnl_chain_get_u64(c, NFTNL_CHAIN_HANDLE);
+}
+
+static void cache_rule_key(struct cache_key *key, const struct nftnl_rule *r)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_RULE;
+	key->family = nftnl_rule_get_u32(r, NFTNL_RULE_FAMILY);
+	key->table = nftnl_rule_get_str(r, NFTNL_RULE_TABLE);
+	key->handle = nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE);
+}
+
+static void cache_set_key(struct cache_key *key, const struct nftnl_set *s)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_SET;
+	key->family = nftnl_set_get_u32(s, NFTNL_SET_FAMILY);
+	key->table = nftnl_set_get_str(s, NFTNL_SET_TABLE);
+	key->name = nftnl_set_get_str(s, NFTNL_SET_NAME);
+}
+
+static void cache_elem_key(struct cache_key *key, const struct cache_node *set,
+			   const struct nftnl_set_elem *e)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_SETELEM;
+	key->set = set;
+	key->elem = e;
+}
+
+static void cache_obj_key(struct cache_key *key, struct nftnl_obj *o)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_OBJ;
+	key->family = nftnl_obj_get_u32(o, NFTNL_OBJ_FAMILY);
+	key->table = nftnl_obj_get_str(o, NFTNL_OBJ_TABLE);
+	key->name = nftnl_obj_get_str(o, NFTNL_OBJ_NAME);
+	key->obj_type = nftnl_obj_get_u32(o, NFTNL_OBJ_TYPE);
+}
+
+static void cache_flowtable_key(struct cache_key *key,
+				const struct nftnl_flowtable *ft)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = NFTNL_CACHE_FLOWTABLE;
+	key->family = nftnl_flowtable_get_u32(ft, NFTNL_FLOWTABLE_FAMILY);
+	key->table = nftnl_flowtable_get_str(ft, NFTNL_FLOWTABLE_TABLE);
+	key->name = nftnl_flowtable_get_str(ft, NFTNL_FLOWTABLE_NAME);
+}
+
+static struct cache_node *cache_find_parent(const struct nftnl_cache *cache,
+					    uint32_t type, uint32_t family,
+					    const char *table, const char *name)
+{
+	struct cache_key key = {
+		.type	= type,
+		.family	= family,
+		.table	= type == NFTNL_CACHE_TABLE ? NULL : table,
+		.name	= type == NFTNL_CACHE_TABLE ? table : name,
+	};
+
+	if (table == NULL || (type != NFTNL_CACHE_TABLE && name == NULL))
+		return NULL;
+
+	return cache_find(cache, &key);
+}
+
+static void cache_rule_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct nftnl_rule *r = n->obj;
+
+	nftnl_chain_rule_del(r);
+	nftnl_rule_free(r);
+	cache_del(cache, n);
+}
+
+static struct cache_node *cache_rule_node(const struct nftnl_cache *cache,
+					  const struct nftnl_rule *r)
+{
+	struct cache_key key;
+
+	cache_rule_key(&key, r);
+	return cache_find(cache, &key);
+}
+
+static void cache_chain_flush(struct nftnl_cache *cache, struct nftnl_chain *c)
+{
+	struct nftnl_rule_iter iter;
+	struct nftnl_rule *r;
+
+	for (;;) {
+		nftnl_rule_iter_init(&iter, c);
+		r = nftnl_rule_iter_next(&iter);
+		if (r == NULL)
+			break;
+
+		nftnl_chain_rule_del(r);
+		cache_del(cache, cache_rule_node(cache, r));
+		nftnl_rule_free(r);
+	}
+}
+
+static void cache_chain_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct nftnl_chain *c = n->obj;
+
+	cache_chain_flush(cache, c);
+	if (n->handle_node)
+		cache_del(cache, n->handle_node);
+	nftnl_chain_list_del(c);
+	nftnl_chain_free(c);
+	cache_del(cache, n);
+}
+
+static void cache_elem_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct nftnl_set_elem *e = (struct nftnl_set_elem *)n->key.elem;
+
+	list_del(&e->head);
+	nftnl_set_elem_free(e);
+	cache_del(cache, n);
+}
+
+static void cache_set_flush(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct nftnl_set *s = n->obj;
+	struct nftnl_set_elem *e, *next;
+	struct cache_key key;
+
+	list_for_each_entry_safe(e, next, &s->element_list, head) {
+		cache_elem_key(&key, n, e);
+		cache_elem_del(cache, cache_find(cache, &key));
+	}
+}
+
+static void cache_set_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	struct nftnl_set *s = n->obj;
+
+	cache_set_flush(cache, n);
+	nftnl_set_list_del(s);
+	nftnl_set_free(s);
+	cache_del(cache, n);
+}
+
+static void cache_obj_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	nftnl_obj_list_del(n->obj);
+	nftnl_obj_free(n->obj);
+	cache_del(cache, n);
+}
+
+static void cache_flowtable_del(struct nftnl_cache *cache,
+				struct cache_node *n)
+{
+	nftnl_flowtable_list_del(n->obj);
+	nftnl_flowtable_free(n->obj);
+	cache_del(cache, n);
+}
+
+static void cache_table_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	nftnl_table_list_del(n->obj);
+	nftnl_table_free(n->obj);
+	cache_del(cache, n);
+}
+
+static void cache_node_del(struct nftnl_cache *cache, struct cache_node *n)
+{
+	switch (n->key.type) {
+	case NFTNL_CACHE_TABLE:
+		cache_table_del(cache, n);
+		break;
+	case NFTNL_CACHE_CHAIN:
+		cache_chain_del(cache, n);
+		break;
+	case NFTNL_CACHE_RULE:
+		cache_rule_del(cache, n);
+		break;
+	case NFTNL_CACHE_SET:
+		cache_set_del(cache, n);
+		break;
+	case NFTNL_CACHE_SETELEM:
+		cache_elem_del(cache, n);
+		break;
+	case NFTNL_CACHE_OBJ:
+		cache_obj_del(cache, n);
+		break;
+	case NFTNL_CACHE_FLOWTABLE:
+		cache_flowtable_del(cache, n);
+		break;
+	}
+}
+
+/* Deleting a table takes everything in it along. */
+static void cache_table_flush(struct nftnl_cache *cache, uint32_t family,
+			      const char *table)
+{
+	static const uint32_t types[] = {
+		NFTNL_CACHE_CHAIN, NFTNL_CACHE_SET, NFTNL_CACHE_OBJ,
+		NFTNL_CACHE_FLOWTABLE,
+	};
+	struct cache_node *n, *next;
+	uint32_t i;
+
+	for (i = 0; i < array_size(types); i++) {
+		list_for_each_entry_safe(n, next,
+				&cache->nodes[cache_list_idx(types[i])], head) {
+			if (n->key.family == family &&
+			    !strcmp(n->key.table, table))
+				cache_node_del(cache, n);
+		}
+	}
+}
+
+EXPORT_SYMBOL(nftnl_cache_alloc);
+struct nftnl_cache *nftnl_cache_alloc(void)
+{
+	struct nftnl_cache *cache;
+	uint32_t i;
+
+	cache = calloc(1, sizeof(struct nftnl_cache));
+	if (cache == NULL)
+		return NULL;
+
+	cache->size = 64;
+	cache->buckets = calloc(cache->size, sizeof(struct cache_node *));
+	if (cache->buckets == NULL)
+		goto err;
+
+	for (i = 0; i < CACHE_NODE_TYPES; i++)
+		INIT_LIST_HEAD(&cache->nodes[i]);
+
+	/* nothing was dumped yet */
+	cache->stale_types = NFTNL_CACHE_ALL;
+
+	cache->tables = nftnl_table_list_alloc();
+	cache->chains = nftnl_chain_list_alloc();
+	cache->sets = nftnl_set_list_alloc();
+	cache->objs = nftnl_obj_list_alloc();
+	cache->flowtables = nftnl_flowtable_list_alloc();
+	if (!cache->tables || !cache->chains || !cache->sets ||
+	    !cache->objs || !cache->flowtables)
+		goto err;
+
+	return cache;
+err:
+	nftnl_cache_free(cache);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_free);
+void nftnl_cache_free(struct nftnl_cache *cache)
+{
+	if (cache->buckets)
+		nftnl_cache_flush(cache, NFTNL_CACHE_ALL);
+
+	if (cache->tables)
+		nftnl_table_list_free(cache->tables);
+	if (cache->chains)
+		nftnl_chain_list_free(cache->chains);
+	if (cache->sets)
+		nftnl_set_list_free(cache->sets);
+	if (cache->objs)
+		nftnl_obj_list_free(cache->objs);
+	if (cache->flowtables)
+		nftnl_flowtable_list_free(cache->flowtables);
+	xfree(cache->buckets);
+	xfree(cache);
+}
+
+EXPORT_SYMBOL(nftnl_cache_flush);
+void nftnl_cache_flush(struct nftnl_cache *cache, uint32_t types)
+{
+	struct cache_node *n, *next;
+	uint32_t i;
+
+	/* rules and elements go first, their chains and sets hold them */
+	types = cache_types_expand(types);
+	for (i = CACHE_NODE_TYPES; i-- > 0;) {
+		if (!(types & (1 << i)))
+			continue;
+
+		list_for_each_entry_safe(n, next, &cache->nodes[i], head)
+			cache_node_del(cache, n);
+	}
+}
+
+static int cache_table_new(struct nftnl_cache *cache,
+			   const struct nlmsghdr *nlh)
+{
+	struct nftnl_table *t;
+	struct cache_node *n;
+	struct cache_key key;
+
+	t = nftnl_table_alloc();
+	if (t == NULL)
+		return -1;
+	if (nftnl_table_nlmsg_parse(nlh, t) < 0)
+		goto err;
+
+	cache_table_key(&key, t);
+	if (key.name == NULL) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	/* an update replaces the table, it holds nothing */
+	n = cache_find(cache, &key);
+	if (n) {
+		cache_unlink(cache, n);
+		nftnl_table_list_del(n->obj);
+		nftnl_table_free(n->obj);
+		n->obj = t;
+		cache_table_key(&n->key, t);
+		cache_link(cache, n);
+		nftnl_table_list_add_tail(t, cache->tables);
+		return 0;
+	}
+
+	if (cache_add(cache, &key, t, true) == NULL)
+		goto err;
+
+	nftnl_table_list_add_tail(t, cache->tables);
+	return 0;
+err:
+	nftnl_table_free(t);
+	return -1;
+}
+
+static int cache_table_del_msg(struct nftnl_cache *cache,
+			       const struct nlmsghdr *nlh)
+{
+	struct nftnl_table *t;
+	struct cache_node *n;
+	struct cache_key key;
+	int ret = 0;
+
+	t = nftnl_table_alloc();
+	if (t == NULL)
+		return -1;
+	if (nftnl_table_nlmsg_parse(nlh, t) < 0) {
+		nftnl_table_free(t);
+		return -1;
+	}
+
+	cache_table_key(&key, t);
+	n = cache_find(cache, &key);
+	if (n) {
+		cache_table_flush(cache, key.family, key.name);
+		cache_table_del(cache, n);
+	} else {
+		ret = cache_stale(cache, NFTNL_CACHE_TABLE);
+	}
+
+	nftnl_table_free(t);
+	return ret;
+}
+
+/* The rules of @old move over to @c, which takes the place of @old. */
+static int cache_chain_replace(struct nftnl_cache *cache,
+			       struct cache_node *n, struct nftnl_chain *c)
+{
+	const char *name = nftnl_chain_get_str(c, NFTNL_CHAIN_NAME);
+	struct nftnl_chain *old = n->obj;
+	struct nftnl_rule_iter iter;
+	struct nftnl_rule *r;
+	bool renamed;
+
+	renamed = strcmp(name, nftnl_chain_get_str(old, NFTNL_CHAIN_NAME));
+
+	for (;;) {
+		nftnl_rule_iter_init(&iter, old);
+		r = nftnl_rule_iter_next(&iter);
+		if (r == NULL)
+			break;
+
+		nftnl_chain_rule_del(r);
+		if (renamed)
+			nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, name);
+		nftnl_chain_rule_add_tail(r, c);
+	}
+
+	nftnl_chain_list_del(old);
+	nftnl_chain_free(old);
+	nftnl_chain_list_add_tail(c, cache->chains);
+
+	cache_unlink(cache, n);
+	n->obj = c;
+	cache_chain_key(&n->key, c);
+	cache_link(cache, n);
+
+	if (n->handle_node) {
+		cache_unlink(cache, n->handle_node);
+		cache_chain_handle_key(&n->handle_node->key, c);
+		cache_link(cache, n->handle_node);
+	} else if (nftnl_chain_is_set(c, NFTNL_CHAIN_HANDLE)) {
+		struct cache_key key;
+
+		cache_chain_handle_key(&key, c);
+		n->handle_node = cache_add(cache, &key, n, false);
+		if (n->handle_node == NULL)
+			return -1;
+	}
+	return 0;
+}
+
+static struct cache_node *cache_chain_find(const struct nftnl_cache *cache,
+					   const struct nftnl_chain *c)
+{
+	struct cache_node *n;
+	struct cache_key key;
+
+	cache_chain_key(&key, c);
+	if (key.name) {
+		n = cache_find(cache, &key);
+		if (n)
+			return n;
+	}
+
+	/* renamed chains are only found by their handle */
+	if (!nftnl_chain_is_set(c, NFTNL_CHAIN_HANDLE))
+		return NULL;
+
+	cache_chain_handle_key(&key, c);
+	n = cache_find(cache, &key);
+	return n ? n->obj : NULL;
+}
+
+static int cache_chain_new(struct nftnl_cache *cache,
+			   const struct nlmsghdr *nlh)
+{
+	struct cache_node *n;
+	struct nftnl_chain *c;
+	struct cache_key key;
+
+	c = nftnl_chain_alloc();
+	if (c == NULL)
+		return -1;
+	if (nftnl_chain_nlmsg_parse(nlh, c) < 0)
+		goto err;
+
+	cache_chain_key(&key, c);
+	if (key.table == NULL || key.name == NULL) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	n = cache_chain_find(cache, c);
+	if (n)
+		return cache_chain_replace(cache, n, c);
+
+	if (!cache_find_parent(cache, NFTNL_CACHE_TABLE, key.family,
+			       key.table, NULL)) {
+		nftnl_chain_free(c);
+		return cache_stale(cache, NFTNL_CACHE_TABLE);
+	}
+
+	n = cache_add(cache, &key, c, true);
+	if (n == NULL)
+		goto err;
+
+	if (nftnl_chain_is_set(c, NFTNL_CHAIN_HANDLE)) {
+		cache_chain_handle_key(&key, c);
+		/* the node points to the node that finds the chain by name */
+		n->handle_node = cache_add(cache, &key, n, false);
+		if (n->handle_node == NULL) {
+			cache_del(cache, n);
+			goto err;
+		}
+	}
+
+	nftnl_chain_list_add_tail(c, cache->chains);
+	return 0;
+err:
+	nftnl_chain_free(c);
+	return -1;
+}
+
+static int cache_chain_del_msg(struct nftnl_cache *cache,
+			       const struct nlmsghdr *nlh)
+{
+	struct nftnl_chain *c;
+	struct cache_node *n;
+	int ret = 0;
+
+	c = nftnl_chain_alloc();
+	if (c == NULL)
+		return -1;
+	if (nftnl_chain_nlmsg_parse(nlh, c) < 0) {
+		nftnl_chain_free(c);
+		return -1;
+	}
+
+	n = cache_chain_find(cache, c);
+	if (n)
+		cache_chain_del(cache, n);
+	else
+		ret = cache_stale(cache, NFTNL_CACHE_CHAIN);
+
+	nftnl_chain_free(c);
+	return ret;
+}
+
+/*
+ * Dumped rules carry the handle of the rule they follow, the first rule of a
+ * chain carries none. Events may carry no position, rules appended to their
+ * chain are flagged NLM_F_APPEND then. The position is only good until the
+ * next update, so it is not kept.
+ */
+static int cache_rule_new(struct nftnl_cache *cache,
+			  const struct nlmsghdr *nlh)
+{
+	struct cache_node *n, *chain, *prev = NULL;
+	struct cache_key key;
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return -1;
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0)
+		goto err;
+
+	cache_rule_key(&key, r);
+	if (key.table == NULL || !nftnl_rule_is_set(r, NFTNL_RULE_HANDLE)) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	chain = cache_find_parent(cache, NFTNL_CACHE_CHAIN, key.family,
+				  key.table,
+				  nftnl_rule_get_str(r, NFTNL_RULE_CHAIN));
+	if (chain == NULL) {
+		nftnl_rule_free(r);
+		return cache_stale(cache, NFTNL_CACHE_CHAIN);
+	}
+
+	if (nftnl_rule_is_set(r, NFTNL_RULE_POSITION)) {
+		key.handle = nftnl_rule_get_u64(r, NFTNL_RULE_POSITION);
+		prev = cache_find(cache, &key);
+		if (prev == NULL) {
+			nftnl_rule_free(r);
+			return cache_stale(cache, NFTNL_CACHE_RULE);
+		}
+		key.handle = nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE);
+		nftnl_rule_unset(r, NFTNL_RULE_POSITION);
+	}
+
+	n = cache_find(cache, &key);
+	if (n)
+		cache_rule_del(cache, n);
+
+	if (cache_add(cache, &key, r, true) == NULL)
+		goto err;
+
+	if (prev)
+		nftnl_chain_rule_append_at(r, prev->obj);
+	else if (nlh->nlmsg_flags & NLM_F_APPEND)
+		nftnl_chain_rule_add_tail(r, chain->obj);
+	else
+		nftnl_chain_rule_add(r, chain->obj);
+	return 0;
+err:
+	nftnl_rule_free(r);
+	return -1;
+}
+
+static int cache_rule_del_msg(struct nftnl_cache *cache,
+			      const struct nlmsghdr *nlh)
+{
+	struct nftnl_rule *r;
+	struct cache_node *n;
+	int ret = 0;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return -1;
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0) {
+		nftnl_rule_free(r);
+		return -1;
+	}
+
+	n = cache_rule_node(cache, r);
+	if (n)
+		cache_rule_del(cache, n);
+	else
+		ret = cache_stale(cache, NFTNL_CACHE_RULE);
+
+	nftnl_rule_free(r);
+	return ret;
+}
+
+/* Elements of @old move over to @s, which takes the place of @old. */
+static void cache_set_replace(struct nftnl_cache *cache,
+			      struct cache_node *n, struct nftnl_set *s)
+{
+	struct nftnl_set *old = n->obj;
+
+	list_splice_init(&old->element_list, &s->element_list);
+	nftnl_set_list_del(old);
+	nftnl_set_free(old);
+	nftnl_set_list_add_tail(s, cache->sets);
+
+	/* same key, the strings of the new set now back it */
+	n->obj = s;
+	cache_set_key(&n->key, s);
+}
+
+static int cache_set_new(struct nftnl_cache *cache, const struct nlmsghdr *nlh)
+{
+	struct cache_node *n;
+	struct nftnl_set *s;
+	struct cache_key key;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return -1;
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0)
+		goto err;
+
+	cache_set_key(&key, s);
+	if (key.table == NULL || key.name == NULL) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	n = cache_find(cache, &key);
+	if (n) {
+		cache_set_replace(cache, n, s);
+		return 0;
+	}
+
+	if (!cache_find_parent(cache, NFTNL_CACHE_TABLE, key.family,
+			       key.table, NULL)) {
+		nftnl_set_free(s);
+		return cache_stale(cache, NFTNL_CACHE_TABLE);
+	}
+
+	if (cache_add(cache, &key, s, true) == NULL)
+		goto err;
+
+	nftnl_set_list_add_tail(s, cache->sets);
+	return 0;
+err:
+	nftnl_set_free(s);
+	return -1;
+}
+
+static int cache_set_del_msg(struct nftnl_cache *cache,
+			     const struct nlmsghdr *nlh)
+{
+	struct nftnl_set *s;
+	struct cache_node *n;
+	struct cache_key key;
+	int ret = 0;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return -1;
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0) {
+		nftnl_set_free(s);
+		return -1;
+	}
+
+	cache_set_key(&key, s);
+	n = cache_find(cache, &key);
+	if (n)
+		cache_set_del(cache, n);
+	else
+		ret = cache_stale(cache, NFTNL_CACHE_SET);
+
+	nftnl_set_free(s);
+	return ret;
+}
+
+/* Takes @e over. */
+static int cache_elem_apply(struct nftnl_cache *cache, struct cache_node *set,
+			    struct nftnl_set_elem *e, bool add)
+{
+	struct cache_node *n;
+	struct cache_key key;
+
+	cache_elem_key(&key, set, e);
+	n = cache_find(cache, &key);
+	if (n)
+		cache_elem_del(cache, n);
+
+	if (!add) {
+		nftnl_set_elem_free(e);
+		return n ? 0 : cache_stale(cache, NFTNL_CACHE_SETELEM);
+	}
+
+	if (cache_add(cache, &key, e, true) == NULL) {
+		nftnl_set_elem_free(e);
+		return -1;
+	}
+	nftnl_set_elem_add(set->obj, e);
+	return 0;
+}
+
+static int cache_elems_msg(struct nftnl_cache *cache,
+			   const struct nlmsghdr *nlh, bool add)
+{
+	struct nftnl_set_elem *e, *next;
+	struct cache_node *set;
+	struct cache_key key;
+	struct nftnl_set *s;
+	int ret = 0;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return -1;
+	if (nftnl_set_elems_nlmsg_parse(nlh, s) < 0) {
+		nftnl_set_free(s);
+		return -1;
+	}
+
+	cache_set_key(&key, s);
+	set = cache_find_parent(cache, NFTNL_CACHE_SET, key.family, key.table,
+				key.name);
+	if (set == NULL) {
+		nftnl_set_free(s);
+		return cache_stale(cache, NFTNL_CACHE_SET);
+	}
+
+	/* elements missing from the cache do not stop the others */
+	list_for_each_entry_safe(e, next, &s->element_list, head) {
+		list_del(&e->head);
+		if (cache_elem_apply(cache, set, e, add) < 0) {
+			ret = -1;
+			if (errno != ESTALE)
+				break;
+		}
+	}
+
+	nftnl_set_free(s);
+	return ret;
+}
+
+int nftnl_cache_apply_elem(struct nftnl_cache *cache, uint16_t type,
+			   uint32_t family, const char *table,
+			   const char *name, const struct nlattr *attr)
+{
+	struct nftnl_set_elem *e;
+	struct cache_node *set;
+
+	set = cache_find_parent(cache, NFTNL_CACHE_SET, family, table, name);
+	if (set == NULL)
+		return cache_stale(cache, NFTNL_CACHE_SET);
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return -1;
+	if (nftnl_set_elem_nlattr_parse(e, attr) < 0) {
+		nftnl_set_elem_free(e);
+		return -1;
+	}
+
+	return cache_elem_apply(cache, set, e, type == NFT_MSG_NEWSETELEM);
+}
+
+bool nftnl_cache_has_elem(const struct nftnl_cache *cache, uint32_t family,
+			  const char *table, const char *name,
+			  const struct nlattr *attr)
+{
+	struct nftnl_set_elem *e;
+	struct cache_node *set;
+	struct cache_key key;
+	bool found;
+
+	set = cache_find_parent(cache, NFTNL_CACHE_SET, family, table, name);
+	if (set == NULL)
+		return false;
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return false;
+	if (nftnl_set_elem_nlattr_parse(e, attr) < 0) {
+		nftnl_set_elem_free(e);
+		return false;
+	}
+
+	cache_elem_key(&key, set, e);
+	found = cache_find(cache, &key) != NULL;
+	nftnl_set_elem_free(e);
+	return found;
+}
+
+static int cache_obj_msg(struct nftnl_cache *cache,
+			 const struct nlmsghdr *nlh, bool add)
+{
+	struct cache_node *n;
+	struct cache_key key;
+	struct nftnl_obj *o;
+
+	o = nftnl_obj_alloc();
+	if (o == NULL)
+		return -1;
+	if (nftnl_obj_nlmsg_parse(nlh, o) < 0)
+		goto err;
+
+	cache_obj_key(&key, o);
+	if (key.table == NULL || key.name == NULL) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	n = cache_find(cache, &key);
+	if (n)
+		cache_obj_del(cache, n);
+	else if (!add ||
+		 !cache_find_parent(cache, NFTNL_CACHE_TABLE, key.family,
+				    key.table, NULL))
+		goto stale;
+
+	if (!add) {
+		nftnl_obj_free(o);
+		return 0;
+	}
+
+	if (cache_add(cache, &key, o, true) == NULL)
+		goto err;
+
+	nftnl_obj_list_add_tail(o, cache->objs);
+	return 0;
+stale:
+	nftnl_obj_free(o);
+	return cache_stale(cache, add ? NFTNL_CACHE_TABLE : NFTNL_CACHE_OBJ);
+err:
+	nftnl_obj_free(o);
+	return -1;
+}
+
+static int cache_flowtable_msg(struct nftnl_cache *cache,
+			       const struct nlmsghdr *nlh, bool add)
+{
+	struct nftnl_flowtable *ft;
+	struct cache_node *n;
+	struct cache_key key;
+
+	ft = nftnl_flowtable_alloc();
+	if (ft == NULL)
+		return -1;
+	if (nftnl_flowtable_nlmsg_parse(nlh, ft) < 0)
+		goto err;
+
+	cache_flowtable_key(&key, ft);
+	if (key.table == NULL || key.name == NULL) {
+		errno = EINVAL;
+		goto err;
+	}
+
+	n = cache_find(cache, &key);
+	if (n)
+		cache_flowtable_del(cache, n);
+	else if (!add ||
+		 !cache_find_parent(cache, NFTNL_CACHE_TABLE, key.family,
+				    key.table, NULL))
+		goto stale;
+
+	if (!add) {
+		nftnl_flowtable_free(ft);
+		return 0;
+	}
+
+	if (cache_add(cache, &key, ft, true) == NULL)
+		goto err;
+
+	nftnl_flowtable_list_add_tail(ft, cache->flowtables);
+	return 0;
+stale:
+	nftnl_flowtable_free(ft);
+	return cache_stale(cache, add ? NFTNL_CACHE_TABLE :
+					 NFTNL_CACHE_FLOWTABLE);
+err:
+	nftnl_flowtable_free(ft);
+	return -1;
+}
+
+/* Each committed transaction ends with the generation it created. */
+static int cache_gen_msg(struct nftnl_cache *cache,
+			 const struct nlmsghdr *nlh)
+{
+	struct nftnl_gen *gen;
+	uint32_t genid;
+
+	gen = nftnl_gen_alloc();
+	if (gen == NULL)
+		return -1;
+	if (nftnl_gen_nlmsg_parse(nlh, gen) < 0) {
+		nftnl_gen_free(gen);
+		return -1;
+	}
+	genid = nftnl_gen_get_u32(gen, NFTNL_GEN_ID);
+	nftnl_gen_free(gen);
+
+	/* replayed after the cache was dumped again */
+	if ((int32_t)(genid - cache->genid) <= 0)
+		return 0;
+	if (genid != cache->genid + 1)
+		return cache_stale(cache, NFTNL_CACHE_ALL);
+
+	cache->genid = genid;
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_cache_apply);
+int nftnl_cache_apply(struct nftnl_cache *cache, const struct nlmsghdr *nlh)
+{
+	if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES)
+		return 0;
+
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWTABLE:
+		return cache_table_new(cache, nlh);
+	case NFT_MSG_DELTABLE:
+		return cache_table_del_msg(cache, nlh);
+	case NFT_MSG_NEWCHAIN:
+		return cache_chain_new(cache, nlh);
+	case NFT_MSG_DELCHAIN:
+		return cache_chain_del_msg(cache, nlh);
+	case NFT_MSG_NEWRULE:
+		return cache_rule_new(cache, nlh);
+	case NFT_MSG_DELRULE:
+		return cache_rule_del_msg(cache, nlh);
+	case NFT_MSG_NEWSET:
+		return cache_set_new(cache, nlh);
+	case NFT_MSG_DELSET:
+		return cache_set_del_msg(cache, nlh);
+	case NFT_MSG_NEWSETELEM:
+		return cache_elems_msg(cache, nlh, true);
+	case NFT_MSG_DELSETELEM:
+		return cache_elems_msg(cache, nlh, false);
+	case NFT_MSG_NEWOBJ:
+		return cache_obj_msg(cache, nlh, true);
+	case NFT_MSG_DELOBJ:
+		return cache_obj_msg(cache, nlh, false);
+	case NFT_MSG_NEWFLOWTABLE:
+		return cache_flowtable_msg(cache, nlh, true);
+	case NFT_MSG_DELFLOWTABLE:
+		return cache_flowtable_msg(cache, nlh, false);
+	case NFT_MSG_NEWGEN:
+		return cache_gen_msg(cache, nlh);
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_cache_set_genid);
+void nftnl_cache_set_genid(struct nftnl_cache *cache, uint32_t genid)
+{
+	cache->genid = genid;
+	cache->stale_types = 0;
+}
+
+EXPORT_SYMBOL(nftnl_cache_get_genid);
+uint32_t nftnl_cache_get_genid(const struct nftnl_cache *cache)
+{
+	return cache->genid;
+}
+
+EXPORT_SYMBOL(nftnl_cache_is_stale);
+bool nftnl_cache_is_stale(const struct nftnl_cache *cache)
+{
+	return cache->stale_types != 0;
+}
+
+EXPORT_SYMBOL(nftnl_cache_set_stale);
+void nftnl_cache_set_stale(struct nftnl_cache *cache, uint32_t types)
+{
+	cache->stale_types |= cache_types_expand(types);
+}
+
+EXPORT_SYMBOL(nftnl_cache_stale_types);
+uint32_t nftnl_cache_stale_types(const struct nftnl_cache *cache)
+{
+	return cache->stale_types;
+}
+
+EXPORT_SYMBOL(nftnl_cache_table_lookup);
+struct nftnl_table *nftnl_cache_table_lookup(const struct nftnl_cache *cache,
+					     uint32_t family, const char *name)
+{
+	struct cache_node *n;
+
+	n = cache_find_parent(cache, NFTNL_CACHE_TABLE, family, name, NULL);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_chain_lookup);
+struct nftnl_chain *nftnl_cache_chain_lookup(const struct nftnl_cache *cache,
+					     uint32_t family, const char *table,
+					     const char *name)
+{
+	struct cache_node *n;
+
+	n = cache_find_parent(cache, NFTNL_CACHE_CHAIN, family, table, name);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_rule_lookup);
+struct nftnl_rule *nftnl_cache_rule_lookup(const struct nftnl_cache *cache,
+					   uint32_t family, const char *table,
+					   uint64_t handle)
+{
+	struct cache_key key = {
+		.type	= NFTNL_CACHE_RULE,
+		.family	= family,
+		.table	= table,
+		.handle	= handle,
+	};
+	struct cache_node *n;
+
+	n = cache_find(cache, &key);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_set_lookup);
+struct nftnl_set *nftnl_cache_set_lookup(const struct nftnl_cache *cache,
+					 uint32_t family, const char *table,
+					 const char *name)
+{
+	struct cache_node *n;
+
+	n = cache_find_parent(cache, NFTNL_CACHE_SET, family, table, name);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_obj_lookup);
+struct nftnl_obj *nftnl_cache_obj_lookup(const struct nftnl_cache *cache,
+					 uint32_t family, const char *table,
+					 const char *name, uint32_t type)
+{
+	struct cache_key key = {
+		.type		= NFTNL_CACHE_OBJ,
+		.family		= family,
+		.table		= table,
+		.name		= name,
+		.obj_type	= type,
+	};
+	struct cache_node *n;
+
+	n = cache_find(cache, &key);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_flowtable_lookup);
+struct nftnl_flowtable *
+nftnl_cache_flowtable_lookup(const struct nftnl_cache *cache, uint32_t family,
+			     const char *table, const char *name)
+{
+	struct cache_node *n;
+
+	n = cache_find_parent(cache, NFTNL_CACHE_FLOWTABLE, family, table,
+			      name);
+	return n ? n->obj : NULL;
+}
+
+EXPORT_SYMBOL(nftnl_cache_tables);
+const struct nftnl_table_list *
+nftnl_cache_tables(const struct nftnl_cache *cache)
+{
+	return cache->tables;
+}
+
+EXPORT_SYMBOL(nftnl_cache_chains);
+const struct nftnl_chain_list *
+nftnl_cache_chains(const struct nftnl_cache *cache)
+{
+	return cache->chains;
+}
+
+EXPORT_SYMBOL(nftnl_cache_sets);
+const struct nftnl_set_list *nftnl_cache_sets(const struct nftnl_cache *cache)
+{
+	return cache->sets;
+}
+
+EXPORT_SYMBOL(nftnl_cache_objs);
+const struct nftnl_obj_list *nftnl_cache_objs(const struct nftnl_cache *cache)
+{
+	return cache->objs;
+}
+
+EXPORT_SYMBOL(nftnl_cache_flowtables);
+const struct nftnl_flowtable_list *
+nftnl_cache_flowtables(const struct nftnl_cache *cache)
+{
+	return cache->flowtables;
+}
+
+/* Dumps are done again this many times if the ruleset changes meanwhile. */
+#define CACHE_DUMP_TRIES	4
+
+static int cache_genid_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_gen *gen;
+	uint32_t *genid = data;
+
+	gen = nftnl_gen_alloc();
+	if (gen == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_gen_nlmsg_parse(nlh, gen) < 0) {
+		nftnl_gen_free(gen);
+		return MNL_CB_ERROR;
+	}
+	*genid = nftnl_gen_get_u32(gen, NFTNL_GEN_ID);
+	nftnl_gen_free(gen);
+
+	return MNL_CB_OK;
+}
+
+static int cache_genid(struct mnl_socket *nl, uint32_t *seq, uint32_t *genid)
+{
+	char buf[NLMSG_HDRLEN + sizeof(struct nfgenmsg)];
+	struct nlmsghdr *nlh;
+
+	/* the acknowledgement ends the reply */
+	nlh = nftnl_gen_nlmsg_build_hdr(buf, NFT_MSG_GETGEN, AF_UNSPEC,
+					NLM_F_ACK, (*seq)++);
+	return nftnl_nlmsg_request(nl, nlh, cache_genid_cb, genid);
+}
+
+/* Objects the ruleset changes meanwhile leave the cache stale. */
+static int cache_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	if (nftnl_cache_apply(data, nlh) < 0 && errno != ESTALE)
+		return MNL_CB_ERROR;
+
+	return MNL_CB_OK;
+}
+
+static int cache_dump_type(struct nftnl_cache *cache, struct mnl_socket *nl,
+			   uint32_t *seq, uint16_t type)
+{
+	char buf[NLMSG_HDRLEN + sizeof(struct nfgenmsg)];
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, type, AF_UNSPEC, NLM_F_DUMP,
+				    (*seq)++);
+	return nftnl_nlmsg_request(nl, nlh, cache_dump_cb, cache);
+}
+
+/* Elements are dumped set by set. */
+static int cache_dump_elems(struct nftnl_cache *cache, struct mnl_socket *nl,
+			    uint32_t *seq)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct cache_node *n, *next;
+	struct nlmsghdr *nlh;
+
+	list_for_each_entry_safe(n, next,
+			&cache->nodes[cache_list_idx(NFTNL_CACHE_SET)], head) {
+		nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETSETELEM,
+					    n->key.family, NLM_F_DUMP,
+					    (*seq)++);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, n->key.table);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, n->key.name);
+
+		if (nftnl_nlmsg_request(nl, nlh, cache_dump_cb, cache) < 0) {
+			/* the set went away after the sets were dumped */
+			if (errno == ENOENT)
+				errno = EINTR;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int cache_dump(struct nftnl_cache *cache, struct mnl_socket *nl,
+		      uint32_t *seq, uint32_t types)
+{
+	static const struct {
+		uint32_t	type;
+		uint16_t	msg;
+	} dumps[] = {
+		{ NFTNL_CACHE_TABLE,	 NFT_MSG_GETTABLE },
+		{ NFTNL_CACHE_CHAIN,	 NFT_MSG_GETCHAIN },
+		{ NFTNL_CACHE_RULE,	 NFT_MSG_GETRULE },
+		{ NFTNL_CACHE_SET,	 NFT_MSG_GETSET },
+		{ NFTNL_CACHE_OBJ,	 NFT_MSG_GETOBJ },
+		{ NFTNL_CACHE_FLOWTABLE, NFT_MSG_GETFLOWTABLE },
+	};
+	uint32_t i;
+
+	/* parents first, elements last, once their sets are there */
+	for (i = 0; i < array_size(dumps); i++) {
+		if (!(types & dumps[i].type))
+			continue;
+		if (cache_dump_type(cache, nl, seq, dumps[i].msg) < 0)
+			return -1;
+	}
+
+	if (types & NFTNL_CACHE_SETELEM)
+		return cache_dump_elems(cache, nl, seq);
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_cache_validate);
+int nftnl_cache_validate(struct nftnl_cache *cache, struct mnl_socket *nl)
+{
+	uint32_t seq = time(NULL), genid, dump_genid, types;
+	int i, ret;
+
+	if (cache_genid(nl, &seq, &genid) < 0)
+		return -1;
+
+	if (!cache->stale_types && genid == cache->genid)
+		return 0;
+
+	/*
+	 * Events told which types are out of date, unless transactions the
+	 * cache did not see were committed since. Then anything may have
+	 * changed.
+	 */
+	types = genid == cache->genid ? cache->stale_types : NFTNL_CACHE_ALL;
+
+	for (i = 0; i < CACHE_DUMP_TRIES; i++) {
+		nftnl_cache_flush(cache, types);
+		cache->stale_types = 0;
+
+		ret = cache_dump(cache, nl, &seq, types);
+		if ((ret < 0 && errno != EINTR) ||
+		    cache_genid(nl, &seq, &dump_genid) < 0) {
+			cache->stale_types = types;
+			return -1;
+		}
+
+		if (ret == 0 && dump_genid == genid && !cache->stale_types) {
+			cache->genid = genid;
+			return 1;
+		}
+
+		/* dumps were interrupted or mixed two generations */
+		genid = dump_genid;
+		types = NFTNL_CACHE_ALL;
+	}
+
+	cache->stale_types = types;
+	errno = EAGAIN;
+	return -1;
+}
@@ -9,6 +9,7 @@
  * This code has been sponsored by Sophos Astaro <http://www.sophos.com>
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -141,6 +142,42 @@ void nftnl_chain_free(const struct nftnl_chain *c)
 	xfree(c);
 }
 
+EXPORT_SYMBOL(nftnl_chain_clone);
+struct nftnl_chain *nftnl_chain_clone(const struct nftnl_chain *c,
+				      uint32_t flags)
+{
+	struct nftnl_rule *r, *newr;
+	struct nftnl_chain *newc;
+	const void *data;
+	uint32_t data_len;
+	uint16_t attr;
+
+	newc = nftnl_chain_alloc();
+	if (newc == NULL)
+		return NULL;
+
+	for (attr = 0; attr <= NFTNL_CHAIN_MAX; attr++) {
+		if (!(c->flags & (1 << attr)))
+			continue;
+
+		data = nftnl_chain_get_data(c, attr, &data_len);
+		if (nftnl_chain_set_data(newc, attr, data, data_len) < 0)
+			goto err;
+	}
+
+	list_for_each_entry(r, &c->rule_list, head) {
+		newr = nftnl_rule_clone(r, flags);
+		if (newr == NULL)
+			goto err;
+		nftnl_chain_rule_add_tail(newr, newc);
+	}
+
+	return newc;
+err:
+	nftnl_chain_free(newc);
+	return NULL;
+}
+
 EXPORT_SYMBOL(nftnl_chain_is_set);
 bool nftnl_chain_is_set(const struct nftnl_chain *c, uint16_t attr)
 {
@@ -953,13 +990,9 @@ nftnl_rule_lookup_byindex(struct nftnl_chain *c, uint32_t index)
 	return NULL;
 }
 
-struct nftnl_rule_iter {
-	const struct nftnl_chain	*c;
-	struct nftnl_rule		*cur;
-};
-
-static void nftnl_rule_iter_init(const struct nftnl_chain *c,
-				 struct nftnl_rule_iter *iter)
+EXPORT_SYMBOL(nftnl_rule_iter_init);
+void nftnl_rule_iter_init(struct nftnl_rule_iter *iter,
+			  const struct nftnl_chain *c)
 {
 	iter->c = c;
 	if (list_empty(&c->rule_list))
@@ -978,7 +1011,7 @@ struct nftnl_rule_iter *nftnl_rule_iter_create(const struct nftnl_chain *c)
 	if (iter == NULL)
 		return NULL;
 
-	nftnl_rule_iter_init(c, iter);
+	nftnl_rule_iter_init(iter, c);
 
 	return iter;
 }
@@ -1084,6 +1117,64 @@ void nftnl_chain_list_del(struct nftnl_chain *r)
 	hlist_del(&r->hnode);
 }
 
+static int nftnl_chain_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_chain_list *list = data;
+	struct nftnl_chain *c;
+
+	c = nftnl_chain_alloc();
+	if (c == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_chain_nlmsg_parse(nlh, c) < 0) {
+		nftnl_chain_free(c);
+		return MNL_CB_ERROR;
+	}
+	nftnl_chain_list_add_tail(c, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_chain_dump_reset(void *data)
+{
+	struct nftnl_chain_list *list = data;
+	struct nftnl_chain *c, *tmp;
+
+	list_for_each_entry_safe(c, tmp, &list->list, head) {
+		nftnl_chain_list_del(c);
+		nftnl_chain_free(c);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_chain_list_dump);
+int nftnl_chain_list_dump(struct nftnl_chain_list *list,
+			  struct mnl_socket *nl, uint32_t family)
+{
+	char buf[NLMSG_HDRLEN + sizeof(struct nfgenmsg)];
+	struct nftnl_chain_list *dump;
+	struct nftnl_chain *c, *tmp;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_chain_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETCHAIN, family, NLM_F_DUMP,
+				    time(NULL));
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_chain_dump_cb,
+			       nftnl_chain_dump_reset, dump);
+	if (ret == 0) {
+		list_for_each_entry_safe(c, tmp, &dump->list, head) {
+			nftnl_chain_list_del(c);
+			nftnl_chain_list_add_tail(c, list);
+		}
+	}
+	nftnl_chain_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_chain_list_foreach);
 int nftnl_chain_list_foreach(struct nftnl_chain_list *chain_list,
 			   int (*cb)(struct nftnl_chain *r, void *data),
@@ -1116,10 +1207,16 @@ nftnl_chain_list_lookup_byname(struct nftnl_chain_list *chain_list,
 	return NULL;
 }
 
-struct nftnl_chain_list_iter {
-	const struct nftnl_chain_list	*list;
-	struct nftnl_chain		*cur;
-};
+EXPORT_SYMBOL(nftnl_chain_list_iter_init);
+void nftnl_chain_list_iter_init(struct nftnl_chain_list_iter *iter,
+				const struct nftnl_chain_list *l)
+{
+	iter->list = l;
+	if (nftnl_chain_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_chain, head);
+}
 
 EXPORT_SYMBOL(nftnl_chain_list_iter_create);
 struct nftnl_chain_list_iter *
@@ -1131,11 +1228,7 @@ nftnl_chain_list_iter_create(const struct nftnl_chain_list *l)
 	if (iter == NULL)
 		return NULL;
 
-	iter->list = l;
-	if (nftnl_chain_list_is_empty(l))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(l->list.next, struct nftnl_chain, head);
+	nftnl_chain_list_iter_init(iter, l);
 
 	return iter;
 }
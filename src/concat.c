@@ -0,0 +1,163 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/set.h>
+
+/*
+ * Concatenated keys: each field of the set's NFTNL_SET_DESC_CONCAT
+ * description starts on a 32-bit register boundary, the padding is zeroed.
+ * Tuples are the same fields back to back without padding.
+ */
+
+struct concat_layout {
+	uint32_t	count;
+	uint32_t	tuple_len;
+	uint32_t	key_len;
+	uint8_t		len[NFT_REG32_COUNT];
+};
+
+static int concat_layout(struct concat_layout *l, const struct nftnl_set *s)
+{
+	uint32_t i;
+
+	if (!(s->flags & (1 << NFTNL_SET_DESC_CONCAT)) ||
+	    s->desc.field_count == 0 ||
+	    s->desc.field_count > NFT_REG32_COUNT) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	l->count = s->desc.field_count;
+	l->tuple_len = 0;
+	l->key_len = 0;
+	for (i = 0; i < l->count; i++) {
+		l->len[i] = s->desc.field_len[i];
+		l->tuple_len += l->len[i];
+		l->key_len += div_round_up(l->len[i], sizeof(uint32_t)) *
+			      sizeof(uint32_t);
+	}
+
+	if (l->key_len > NFT_DATA_VALUE_MAXLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+static void concat_pack(const struct concat_layout *l, uint8_t *key,
+			const uint8_t *tuple)
+{
+	uint32_t i, pad;
+
+	for (i = 0; i < l->count; i++) {
+		memcpy(key, tuple, l->len[i]);
+		key += l->len[i];
+		tuple += l->len[i];
+
+		pad = -l->len[i] & (sizeof(uint32_t) - 1);
+		memset(key, 0, pad);
+		key += pad;
+	}
+}
+
+EXPORT_SYMBOL(nftnl_set_concat_key_len);
+int nftnl_set_concat_key_len(const struct nftnl_set *s)
+{
+	struct concat_layout l;
+
+	if (concat_layout(&l, s) < 0)
+		return -1;
+
+	return l.key_len;
+}
+
+EXPORT_SYMBOL(nftnl_set_concat_pack);
+int nftnl_set_concat_pack(const struct nftnl_set *s, void *key,
+			  const void *tuple)
+{
+	struct concat_layout l;
+
+	if (concat_layout(&l, s) < 0)
+		return -1;
+
+	concat_pack(&l, key, tuple);
+	return l.key_len;
+}
+
+EXPORT_SYMBOL(nftnl_set_concat_unpack);
+int nftnl_set_concat_unpack(const struct nftnl_set *s, void *tuple,
+			    const void *key, uint32_t key_len)
+{
+	const uint8_t *src = key;
+	struct concat_layout l;
+	uint8_t *dst = tuple;
+	uint32_t i;
+
+	if (concat_layout(&l, s) < 0)
+		return -1;
+
+	if (key_len != l.key_len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < l.count; i++) {
+		memcpy(dst, src, l.len[i]);
+		dst += l.len[i];
+		src += div_round_up(l.len[i], sizeof(uint32_t)) *
+		       sizeof(uint32_t);
+	}
+	return l.tuple_len;
+}
+
+EXPORT_SYMBOL(nftnl_set_elems_add_concat);
+int nftnl_set_elems_add_concat(struct nftnl_set *s, const void *tuples,
+			       const void *tuples_end, uint32_t num)
+{
+	const uint8_t *tuple = tuples, *tuple_end = tuples_end;
+	struct nftnl_set_elem *e, *next;
+	struct concat_layout l;
+	LIST_HEAD(elems);
+	uint32_t i;
+
+	if (concat_layout(&l, s) < 0)
+		return -1;
+
+	/* Keys are packed in place, the set only sees complete elements. */
+	for (i = 0; i < num; i++) {
+		e = nftnl_set_elem_alloc();
+		if (e == NULL)
+			goto err;
+
+		concat_pack(&l, (uint8_t *)e->key.val,
+			    tuple + i * l.tuple_len);
+		e->key.len = l.key_len;
+		e->flags |= (1 << NFTNL_SET_ELEM_KEY);
+
+		if (tuple_end) {
+			concat_pack(&l, (uint8_t *)e->key_end.val,
+				    tuple_end + i * l.tuple_len);
+			e->key_end.len = l.key_len;
+			e->flags |= (1 << NFTNL_SET_ELEM_KEY_END);
+		}
+		list_add_tail(&e->head, &elems);
+	}
+
+	list_splice(&elems, s->element_list.prev);
+	return 0;
+err:
+	list_for_each_entry_safe(e, next, &elems, head)
+		nftnl_set_elem_free(e);
+	return -1;
+}
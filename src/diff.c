@@ -0,0 +1,1517 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/batch.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+/*
+ * Ruleset diff: objects of both rulesets are indexed by family, table and
+ * name. Objects only found in the current ruleset are deleted, objects only
+ * found in the desired one are created. Rules are matched per chain by
+ * content, the longest subsequence of matched rules that keeps its order
+ * stays in place and everything else is deleted by handle or inserted
+ * relative to the kept rules.
+ *
+ * Anonymous sets are named by the kernel and come and go with the rule using
+ * them, so lookups on them are matched by set content and the sets are
+ * created right before the rules that use them.
+ */
+
+enum {
+	DIFF_CUR	= 0,
+	DIFF_WANT,
+};
+
+enum diff_state {
+	DIFF_KEEP	= 0,
+	DIFF_UPDATE,	/* modified in place */
+	DIFF_REPLACE,	/* deleted and created again */
+};
+
+struct diff_node {
+	struct diff_node	*next;
+	uint32_t		hash;
+	uint32_t		family;
+	const char		*table;
+	const char		*name;
+	void			*obj;
+	struct diff_node	*peer;
+	enum diff_state		state;
+	/* element changes of a set found in both rulesets */
+	struct nftnl_set_elems_delta *elems;
+	/* hash of the elements of an anonymous set */
+	uint32_t		elems_hash;
+};
+
+struct diff_index {
+	struct diff_node	*nodes;
+	uint32_t		num;
+	struct diff_node	**buckets;
+	uint32_t		mask;
+};
+
+/* Rules of one chain, in both rulesets. */
+struct diff_rules {
+	struct nftnl_rule	**rules[2];
+	uint32_t		num[2];
+	bool			*keep[2];
+	/* kept current rule that each added rule goes before, or -1 */
+	int32_t			*before;
+	bool			skip;
+	bool			append;
+};
+
+/* Anonymous sets of one ruleset, by name and by set id. */
+struct diff_anon {
+	struct diff_index	names;
+	struct diff_node	**ids;
+	uint32_t		num_ids;
+};
+
+struct diff_ctx {
+	struct nftnl_batch	*batch;
+	uint32_t		*seq;
+	int			num_msgs;
+
+	bool			tables, chains, sets, rules;
+	struct diff_index	table_idx[2];
+	struct diff_index	chain_idx[2];
+	struct diff_index	set_idx[2];
+	struct diff_anon	anon[2];
+	struct diff_index	rule_idx;
+	struct diff_rules	*groups;
+	struct nftnl_rule	**rule_array;
+	bool			*keep_array;
+	int32_t			*before_array;
+};
+
+/* Room left for a single element when filling a NEWSETELEM message. */
+#define DIFF_ELEM_ROOM	2048
+
+static uint32_t diff_key_hash(uint32_t family, const char *table,
+			      const char *name)
+{
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, family);
+	h = nftnl_hash_str(h, table);
+	if (name)
+		h = nftnl_hash_str(h, name);
+
+	return nftnl_hash_final(h);
+}
+
+static int diff_index_init(struct diff_index *idx, uint32_t num)
+{
+	uint32_t size = 1;
+
+	while (size < num)
+		size <<= 1;
+
+	idx->nodes = calloc(num ? num : 1, sizeof(struct diff_node));
+	if (idx->nodes == NULL)
+		return -1;
+
+	idx->buckets = calloc(size, sizeof(struct diff_node *));
+	if (idx->buckets == NULL)
+		return -1;
+
+	idx->mask = size - 1;
+	return 0;
+}
+
+static void diff_index_free(struct diff_index *idx)
+{
+	xfree(idx->nodes);
+	xfree(idx->buckets);
+}
+
+static struct diff_node *diff_index_lookup(const struct diff_index *idx,
+					   uint32_t family, const char *table,
+					   const char *name)
+{
+	uint32_t hash = diff_key_hash(family, table, name);
+	struct diff_node *n;
+
+	if (idx->buckets == NULL)
+		return NULL;
+
+	for (n = idx->buckets[hash & idx->mask]; n; n = n->next) {
+		if (n->hash == hash && n->family == family &&
+		    !strcmp(n->table, table) &&
+		    (name == NULL || !strcmp(n->name, name)))
+			return n;
+	}
+	return NULL;
+}
+
+static struct diff_node *diff_index_add(struct diff_index *idx,
+					uint32_t family, const char *table,
+					const char *name, void *obj)
+{
+	struct diff_node *n = &idx->nodes[idx->num++];
+
+	n->hash = diff_key_hash(family, table, name);
+	n->family = family;
+	n->table = table;
+	n->name = name;
+	n->obj = obj;
+	n->next = idx->buckets[n->hash & idx->mask];
+	idx->buckets[n->hash & idx->mask] = n;
+
+	return n;
+}
+
+/* Pair each desired object with its current counterpart, if any. */
+static void diff_index_join(struct diff_index *cur, struct diff_index *want)
+{
+	struct diff_node *n, *peer;
+	uint32_t i;
+
+	for (i = 0; i < want->num; i++) {
+		n = &want->nodes[i];
+		peer = diff_index_lookup(cur, n->family, n->table, n->name);
+		if (peer == NULL)
+			continue;
+
+		n->peer = peer;
+		peer->peer = n;
+	}
+}
+
+static bool diff_table_deleted(const struct diff_ctx *ctx, uint32_t family,
+			       const char *table)
+{
+	const struct diff_node *n;
+
+	if (!ctx->tables)
+		return false;
+
+	n = diff_index_lookup(&ctx->table_idx[DIFF_CUR], family, table, NULL);
+	return n && n->peer == NULL;
+}
+
+static struct nlmsghdr *diff_msg_start(struct diff_ctx *ctx, uint16_t type,
+				       uint16_t family, uint16_t flags)
+{
+	return nftnl_nlmsg_build_hdr(nftnl_batch_buffer(ctx->batch), type,
+				     family, flags, (*ctx->seq)++);
+}
+
+static int diff_msg_end(struct diff_ctx *ctx)
+{
+	ctx->num_msgs++;
+	return nftnl_batch_update(ctx->batch);
+}
+
+/*
+ * Tables
+ */
+
+static int diff_tables_index(struct diff_index *idx,
+			     const struct nftnl_table_list *list)
+{
+	struct nftnl_table_list_iter iter;
+	struct nftnl_table *t;
+	uint32_t num = 0;
+
+	if (list) {
+		nftnl_table_list_iter_init(&iter, list);
+		while (nftnl_table_list_iter_next(&iter))
+			num++;
+	}
+
+	if (diff_index_init(idx, num) < 0)
+		return -1;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_table_list_iter_init(&iter, list);
+	while ((t = nftnl_table_list_iter_next(&iter))) {
+		if (!nftnl_table_is_set(t, NFTNL_TABLE_NAME))
+			goto err_inval;
+
+		diff_index_add(idx, nftnl_table_get_u32(t, NFTNL_TABLE_FAMILY),
+			       nftnl_table_get_str(t, NFTNL_TABLE_NAME), NULL,
+			       t);
+	}
+	return 0;
+err_inval:
+	errno = EINVAL;
+	return -1;
+}
+
+static bool diff_table_attr_eq(const struct nftnl_table *cur,
+			       const struct nftnl_table *want, uint16_t attr)
+{
+	const void *d1, *d2;
+	uint32_t len1, len2;
+
+	if (!nftnl_table_is_set(want, attr))
+		return true;
+	if (!nftnl_table_is_set(cur, attr))
+		return false;
+
+	d1 = nftnl_table_get_data(cur, attr, &len1);
+	d2 = nftnl_table_get_data(want, attr, &len2);
+
+	return len1 == len2 && !memcmp(d1, d2, len1);
+}
+
+static void diff_tables_cmp(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->table_idx[DIFF_WANT];
+	const struct nftnl_table *cur, *want;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer == NULL)
+			continue;
+
+		cur = n->peer->obj;
+		want = n->obj;
+		if (!diff_table_attr_eq(cur, want, NFTNL_TABLE_FLAGS) ||
+		    !diff_table_attr_eq(cur, want, NFTNL_TABLE_USERDATA))
+			n->state = n->peer->state = DIFF_UPDATE;
+	}
+}
+
+static int diff_tables_del(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->table_idx[DIFF_CUR];
+	struct nlmsghdr *nlh;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer)
+			continue;
+
+		nlh = diff_msg_start(ctx, NFT_MSG_DELTABLE, n->family, 0);
+		mnl_attr_put_strz(nlh, NFTA_TABLE_NAME, n->table);
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int diff_tables_add(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->table_idx[DIFF_WANT];
+	struct nlmsghdr *nlh;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer && n->state == DIFF_KEEP)
+			continue;
+
+		nlh = diff_msg_start(ctx, NFT_MSG_NEWTABLE, n->family,
+				     NLM_F_CREATE);
+		nftnl_table_nlmsg_build_payload(nlh, n->obj);
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Chains
+ */
+
+static int diff_chains_index(struct diff_index *idx,
+			     const struct nftnl_chain_list *list)
+{
+	struct nftnl_chain_list_iter iter;
+	struct nftnl_chain *c;
+	uint32_t num = 0;
+
+	if (list) {
+		nftnl_chain_list_iter_init(&iter, list);
+		while (nftnl_chain_list_iter_next(&iter))
+			num++;
+	}
+
+	if (diff_index_init(idx, num) < 0)
+		return -1;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_chain_list_iter_init(&iter, list);
+	while ((c = nftnl_chain_list_iter_next(&iter))) {
+		if (!nftnl_chain_is_set(c, NFTNL_CHAIN_TABLE) ||
+		    !nftnl_chain_is_set(c, NFTNL_CHAIN_NAME))
+			goto err_inval;
+
+		diff_index_add(idx, nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY),
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE),
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_NAME), c);
+	}
+	return 0;
+err_inval:
+	errno = EINVAL;
+	return -1;
+}
+
+static bool diff_chain_attr_eq(const struct nftnl_chain *cur,
+			       const struct nftnl_chain *want, uint16_t attr)
+{
+	const char *const *dev1, *const *dev2;
+	const void *d1, *d2;
+	uint32_t len1, len2;
+
+	if (!nftnl_chain_is_set(want, attr))
+		return true;
+	if (!nftnl_chain_is_set(cur, attr))
+		return false;
+
+	if (attr == NFTNL_CHAIN_DEVICES) {
+		dev1 = nftnl_chain_get_array(cur, attr);
+		dev2 = nftnl_chain_get_array(want, attr);
+		for (; *dev1 && *dev2; dev1++, dev2++) {
+			if (strcmp(*dev1, *dev2))
+				return false;
+		}
+		return *dev1 == *dev2;
+	}
+
+	d1 = nftnl_chain_get_data(cur, attr, &len1);
+	d2 = nftnl_chain_get_data(want, attr, &len2);
+
+	return len1 == len2 && !memcmp(d1, d2, len1);
+}
+
+static void diff_chains_cmp(struct diff_ctx *ctx)
+{
+	static const uint16_t replace_attrs[] = {
+		NFTNL_CHAIN_HOOKNUM, NFTNL_CHAIN_PRIO, NFTNL_CHAIN_TYPE,
+		NFTNL_CHAIN_DEV, NFTNL_CHAIN_DEVICES, NFTNL_CHAIN_FLAGS,
+	};
+	struct diff_index *idx = &ctx->chain_idx[DIFF_WANT];
+	const struct nftnl_chain *cur, *want;
+	struct diff_node *n;
+	uint32_t i, j;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer == NULL)
+			continue;
+
+		cur = n->peer->obj;
+		want = n->obj;
+		for (j = 0; j < array_size(replace_attrs); j++) {
+			if (!diff_chain_attr_eq(cur, want, replace_attrs[j])) {
+				n->state = DIFF_REPLACE;
+				break;
+			}
+		}
+		if (n->state == DIFF_KEEP &&
+		    (!diff_chain_attr_eq(cur, want, NFTNL_CHAIN_POLICY) ||
+		     !diff_chain_attr_eq(cur, want, NFTNL_CHAIN_USERDATA)))
+			n->state = DIFF_UPDATE;
+
+		n->peer->state = n->state;
+	}
+}
+
+static int diff_chains_del(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->chain_idx[DIFF_CUR];
+	struct nlmsghdr *nlh;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer && n->state != DIFF_REPLACE)
+			continue;
+		if (diff_table_deleted(ctx, n->family, n->table))
+			continue;
+
+		nlh = diff_msg_start(ctx, NFT_MSG_DELCHAIN, n->family, 0);
+		mnl_attr_put_strz(nlh, NFTA_CHAIN_TABLE, n->table);
+		mnl_attr_put_strz(nlh, NFTA_CHAIN_NAME, n->name);
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int diff_chains_add(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->chain_idx[DIFF_WANT];
+	struct nlmsghdr *nlh;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer && n->state == DIFF_KEEP)
+			continue;
+
+		nlh = diff_msg_start(ctx, NFT_MSG_NEWCHAIN, n->family,
+				     NLM_F_CREATE);
+		nftnl_chain_nlmsg_build_payload(nlh, n->obj);
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Sets and elements
+ */
+
+static int diff_sets_index(struct diff_index *idx,
+			   const struct nftnl_set_list *list)
+{
+	struct nftnl_set_list_iter iter;
+	struct nftnl_set *s;
+	uint32_t num = 0;
+
+	if (list) {
+		nftnl_set_list_iter_init(&iter, list);
+		while (nftnl_set_list_iter_next(&iter))
+			num++;
+	}
+
+	if (diff_index_init(idx, num) < 0)
+		return -1;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_set_list_iter_init(&iter, list);
+	while ((s = nftnl_set_list_iter_next(&iter))) {
+		if (!(s->flags & (1 << NFTNL_SET_TABLE)) ||
+		    !(s->flags & (1 << NFTNL_SET_NAME)))
+			goto err_inval;
+
+		/* Anonymous sets come and go with the rules using them. */
+		if (s->flags & (1 << NFTNL_SET_FLAGS) &&
+		    s->set_flags & NFT_SET_ANONYMOUS)
+			continue;
+
+		diff_index_add(idx, s->family, s->table, s->name, s);
+	}
+	return 0;
+err_inval:
+	errno = EINVAL;
+	return -1;
+}
+
+/* Set attributes that cannot be changed without creating the set again. */
+#define DIFF_SET_ATTRS	((1 << NFTNL_SET_FLAGS) |		\
+			 (1 << NFTNL_SET_KEY_TYPE) |		\
+			 (1 << NFTNL_SET_KEY_LEN) |		\
+			 (1 << NFTNL_SET_DATA_TYPE) |		\
+			 (1 << NFTNL_SET_DATA_LEN) |		\
+			 (1 << NFTNL_SET_OBJ_TYPE) |		\
+			 (1 << NFTNL_SET_POLICY) |		\
+			 (1 << NFTNL_SET_DESC_SIZE) |		\
+			 (1 << NFTNL_SET_TIMEOUT) |		\
+			 (1 << NFTNL_SET_GC_INTERVAL) |		\
+			 (1 << NFTNL_SET_USERDATA) |		\
+			 (1 << NFTNL_SET_DESC_CONCAT))
+
+static bool diff_set_equal(const struct nftnl_set *cur,
+			   const struct nftnl_set *want)
+{
+	uint32_t flags = want->flags & DIFF_SET_ATTRS;
+
+	if ((cur->flags & flags) != flags)
+		return false;
+
+	if (flags & (1 << NFTNL_SET_FLAGS) && cur->set_flags != want->set_flags)
+		return false;
+	if (flags & (1 << NFTNL_SET_KEY_TYPE) && cur->key_type != want->key_type)
+		return false;
+	if (flags & (1 << NFTNL_SET_KEY_LEN) && cur->key_len != want->key_len)
+		return false;
+	if (flags & (1 << NFTNL_SET_DATA_TYPE) &&
+	    cur->data_type != want->data_type)
+		return false;
+	if (flags & (1 << NFTNL_SET_DATA_LEN) && cur->data_len != want->data_len)
+		return false;
+	if (flags & (1 << NFTNL_SET_OBJ_TYPE) && cur->obj_type != want->obj_type)
+		return false;
+	if (flags & (1 << NFTNL_SET_POLICY) && cur->policy != want->policy)
+		return false;
+	if (flags & (1 << NFTNL_SET_DESC_SIZE) &&
+	    cur->desc.size != want->desc.size)
+		return false;
+	if (flags & (1 << NFTNL_SET_TIMEOUT) && cur->timeout != want->timeout)
+		return false;
+	if (flags & (1 << NFTNL_SET_GC_INTERVAL) &&
+	    cur->gc_interval != want->gc_interval)
+		return false;
+	if (flags & (1 << NFTNL_SET_USERDATA) &&
+	    (cur->user.len != want->user.len ||
+	     memcmp(cur->user.data, want->user.data, cur->user.len)))
+		return false;
+	if (flags & (1 << NFTNL_SET_DESC_CONCAT) &&
+	    (cur->desc.field_count != want->desc.field_count ||
+	     memcmp(cur->desc.field_len, want->desc.field_len,
+		    cur->desc.field_count)))
+		return false;
+
+	if (!list_empty(&want->expr_list) &&
+	    !nftnl_expr_list_cmp(&cur->expr_list, &want->expr_list))
+		return false;
+
+	return true;
+}
+
+static void diff_elem_build_key(struct nlmsghdr *nlh,
+				const struct nftnl_set_elem *e)
+{
+	struct nlattr *nest;
+
+	if (e->flags & (1 << NFTNL_SET_ELEM_FLAGS))
+		mnl_attr_put_u32(nlh, NFTA_SET_ELEM_FLAGS,
+				 htonl(e->set_elem_flags));
+	if (e->flags & (1 << NFTNL_SET_ELEM_KEY)) {
+		nest = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY);
+		mnl_attr_put(nlh, NFTA_DATA_VALUE, e->key.len, e->key.val);
+		mnl_attr_nest_end(nlh, nest);
+	}
+	if (e->flags & (1 << NFTNL_SET_ELEM_KEY_END)) {
+		nest = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY_END);
+		mnl_attr_put(nlh, NFTA_DATA_VALUE, e->key_end.len,
+			     e->key_end.val);
+		mnl_attr_nest_end(nlh, nest);
+	}
+}
+
+/*
+ * Emit elements in as few messages as possible. A message is closed when the
+ * element list attribute or the batch page runs out of room. Deletions only
+ * carry the element key.
+ */
+static int diff_elems_emit(struct diff_ctx *ctx, uint16_t type,
+			   const struct nftnl_set *s,
+			   struct nftnl_set_elem **elems, uint32_t num)
+{
+	struct nlattr *nest1, *nest2;
+	struct nlmsghdr *nlh;
+	uint32_t i = 0, n;
+
+	while (i < num) {
+		nlh = diff_msg_start(ctx, type, s->family,
+				     type == NFT_MSG_NEWSETELEM ?
+				     NLM_F_CREATE : 0);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, s->table);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, s->name);
+		if (s->flags & (1 << NFTNL_SET_ID))
+			mnl_attr_put_u32(nlh, NFTA_SET_ELEM_LIST_SET_ID,
+					 htonl(s->id));
+
+		nest1 = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+		for (n = 0; i < num; i++, n++) {
+			if (n > 0 && nlh->nlmsg_len + DIFF_ELEM_ROOM >
+				     nftnl_batch_room(ctx->batch))
+				break;
+
+			nest2 = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+			if (type == NFT_MSG_NEWSETELEM)
+				nftnl_set_elem_nlmsg_build_payload(nlh,
+								   elems[i]);
+			else
+				diff_elem_build_key(nlh, elems[i]);
+			mnl_attr_nest_end(nlh, nest2);
+
+			if (n > 0 && nftnl_attr_nest_overflow(nlh, nest1, nest2))
+				break;
+		}
+		mnl_attr_nest_end(nlh, nest1);
+
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static void diff_sets_cmp(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->set_idx[DIFF_WANT];
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer == NULL)
+			continue;
+
+		if (!diff_set_equal(n->peer->obj, n->obj))
+			n->state = n->peer->state = DIFF_REPLACE;
+	}
+}
+
+static int diff_sets_join(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->set_idx[DIFF_WANT];
+	struct nftnl_set_elems_delta *d;
+	struct diff_node *n;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer == NULL || n->state != DIFF_KEEP)
+			continue;
+
+		d = malloc(sizeof(*d));
+		if (d == NULL)
+			return -1;
+
+		if (nftnl_set_elems_delta(d, n->peer->obj, n->obj) < 0) {
+			xfree(d);
+			return -1;
+		}
+		n->elems = d;
+	}
+	return 0;
+}
+
+static int diff_sets_del(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->set_idx[DIFF_CUR];
+	struct nftnl_set_elems_delta *d;
+	const struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+	struct diff_node *n;
+	uint32_t i;
+
+	/* Elements go first, so sets are deleted after all their updates. */
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer == NULL || n->state != DIFF_KEEP)
+			continue;
+
+		d = n->peer->elems;
+		s = n->obj;
+		if (diff_elems_emit(ctx, NFT_MSG_DELSETELEM, s,
+				    d->del, d->num_del) < 0)
+			return -1;
+	}
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		if (n->peer && n->state != DIFF_REPLACE)
+			continue;
+		if (diff_table_deleted(ctx, n->family, n->table))
+			continue;
+
+		nlh = diff_msg_start(ctx, NFT_MSG_DELSET, n->family, 0);
+		mnl_attr_put_strz(nlh, NFTA_SET_TABLE, n->table);
+		mnl_attr_put_strz(nlh, NFTA_SET_NAME, n->name);
+		if (diff_msg_end(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* Create set @s with all its elements. */
+static int diff_set_create(struct diff_ctx *ctx, struct nftnl_set *s)
+{
+	struct nftnl_set_elem **elems;
+	struct nftnl_set_elem *e;
+	struct nlmsghdr *nlh;
+	uint32_t num = 0;
+	int ret;
+
+	nlh = diff_msg_start(ctx, NFT_MSG_NEWSET, s->family, NLM_F_CREATE);
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	if (diff_msg_end(ctx) < 0)
+		return -1;
+
+	list_for_each_entry(e, &s->element_list, head)
+		num++;
+	if (num == 0)
+		return 0;
+
+	elems = calloc(num, sizeof(struct nftnl_set_elem *));
+	if (elems == NULL)
+		return -1;
+
+	num = 0;
+	list_for_each_entry(e, &s->element_list, head)
+		elems[num++] = e;
+
+	ret = diff_elems_emit(ctx, NFT_MSG_NEWSETELEM, s, elems, num);
+	xfree(elems);
+	return ret;
+}
+
+static int diff_sets_add(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->set_idx[DIFF_WANT];
+	struct nftnl_set_elems_delta *d;
+	struct diff_node *n;
+	struct nftnl_set *s;
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		n = &idx->nodes[i];
+		s = n->obj;
+
+		if (n->peer && n->state == DIFF_KEEP) {
+			d = n->elems;
+			if (diff_elems_emit(ctx, NFT_MSG_NEWSETELEM, s,
+					    d->add, d->num_add) < 0)
+				return -1;
+			continue;
+		}
+
+		if (diff_set_create(ctx, s) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Anonymous sets
+ */
+
+static bool diff_set_is_anon(const struct nftnl_set *s)
+{
+	return s->flags & (1 << NFTNL_SET_FLAGS) &&
+	       s->set_flags & NFT_SET_ANONYMOUS;
+}
+
+/* Same elements hash the same, whatever their order. */
+static uint32_t diff_anon_hash(const struct nftnl_set *s)
+{
+	struct nftnl_set_elem *e;
+	uint32_t num = 0, sum = 0;
+
+	list_for_each_entry(e, &s->element_list, head) {
+		sum += nftnl_set_elem_key_hash(e);
+		num++;
+	}
+
+	return nftnl_hash_final(nftnl_hash_u32(nftnl_hash_u32(0, num), sum));
+}
+
+static int diff_anon_id_cmp(const void *a, const void *b)
+{
+	const struct nftnl_set *s1 = (*(struct diff_node **)a)->obj;
+	const struct nftnl_set *s2 = (*(struct diff_node **)b)->obj;
+
+	return s1->id < s2->id ? -1 : s1->id > s2->id;
+}
+
+static int diff_anon_index(struct diff_anon *a,
+			   const struct nftnl_set_list *list)
+{
+	struct nftnl_set_list_iter iter;
+	struct diff_node *n;
+	struct nftnl_set *s;
+	uint32_t num = 0;
+
+	if (list) {
+		nftnl_set_list_iter_init(&iter, list);
+		while ((s = nftnl_set_list_iter_next(&iter))) {
+			if (diff_set_is_anon(s))
+				num++;
+		}
+	}
+
+	if (diff_index_init(&a->names, num) < 0)
+		return -1;
+
+	a->ids = calloc(num ? num : 1, sizeof(struct diff_node *));
+	if (a->ids == NULL)
+		return -1;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_set_list_iter_init(&iter, list);
+	while ((s = nftnl_set_list_iter_next(&iter))) {
+		if (!diff_set_is_anon(s))
+			continue;
+		if (!(s->flags & (1 << NFTNL_SET_TABLE)) ||
+		    !(s->flags & (1 << NFTNL_SET_NAME))) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		n = diff_index_add(&a->names, s->family, s->table, s->name, s);
+		n->elems_hash = diff_anon_hash(s);
+		if (s->flags & (1 << NFTNL_SET_ID))
+			a->ids[a->num_ids++] = n;
+	}
+
+	qsort(a->ids, a->num_ids, sizeof(struct diff_node *),
+	      diff_anon_id_cmp);
+	return 0;
+}
+
+static void diff_anon_free(struct diff_anon *a)
+{
+	diff_index_free(&a->names);
+	xfree(a->ids);
+}
+
+/* Expressions that refer to a set, by name or by id. */
+static const struct {
+	const char	*name;
+	uint16_t	set;
+	uint16_t	set_id;
+} diff_set_refs[] = {
+	{ "lookup",	NFTNL_EXPR_LOOKUP_SET,	NFTNL_EXPR_LOOKUP_SET_ID },
+	{ "dynset",	NFTNL_EXPR_DYNSET_SET_NAME, NFTNL_EXPR_DYNSET_SET_ID },
+	{ "objref",	NFTNL_EXPR_OBJREF_SET_NAME, NFTNL_EXPR_OBJREF_SET_ID },
+};
+
+/* Anonymous set that @e of rule @r refers to, the set id goes first. */
+static struct diff_node *diff_anon_find(const struct diff_anon *a,
+					const struct nftnl_rule *r,
+					const struct nftnl_expr *e)
+{
+	uint32_t lo = 0, hi = a->num_ids, mid, id;
+	const struct nftnl_set *s;
+	uint32_t i;
+
+	if (a->names.num == 0)
+		return NULL;
+
+	for (i = 0; i < array_size(diff_set_refs); i++) {
+		if (!strcmp(e->ops->name, diff_set_refs[i].name))
+			break;
+	}
+	if (i == array_size(diff_set_refs))
+		return NULL;
+
+	if (nftnl_expr_is_set(e, diff_set_refs[i].set_id)) {
+		id = nftnl_expr_get_u32(e, diff_set_refs[i].set_id);
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			s = a->ids[mid]->obj;
+			if (s->id == id)
+				return a->ids[mid];
+			if (s->id < id)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	}
+
+	if (!nftnl_expr_is_set(e, diff_set_refs[i].set))
+		return NULL;
+
+	return diff_index_lookup(&a->names, r->family, r->table,
+				 nftnl_expr_get_str(e, diff_set_refs[i].set));
+}
+
+static bool diff_anon_equal(const struct diff_node *cur,
+			    const struct diff_node *want)
+{
+	struct nftnl_set_elems_delta d;
+	bool eq;
+
+	if (cur->elems_hash != want->elems_hash ||
+	    !diff_set_equal(cur->obj, want->obj))
+		return false;
+
+	if (nftnl_set_elems_delta(&d, cur->obj, want->obj) < 0)
+		return false;
+
+	eq = d.num_add == 0 && d.num_del == 0;
+	nftnl_set_elems_delta_release(&d);
+	return eq;
+}
+
+/* Lookup attributes other than the set it refers to. */
+static const uint16_t diff_lookup_attrs[] = {
+	NFTNL_EXPR_LOOKUP_SREG,
+	NFTNL_EXPR_LOOKUP_DREG,
+	NFTNL_EXPR_LOOKUP_FLAGS,
+};
+
+static bool diff_lookup_cmp(const struct nftnl_expr *e1,
+			    const struct nftnl_expr *e2)
+{
+	uint16_t attr;
+	uint32_t i;
+
+	for (i = 0; i < array_size(diff_lookup_attrs); i++) {
+		attr = diff_lookup_attrs[i];
+		if (nftnl_expr_is_set(e1, attr) != nftnl_expr_is_set(e2, attr))
+			return false;
+		if (nftnl_expr_is_set(e1, attr) &&
+		    nftnl_expr_get_u32(e1, attr) !=
+		    nftnl_expr_get_u32(e2, attr))
+			return false;
+	}
+	return true;
+}
+
+/* Rules compared, with the current one first. */
+struct diff_rule_pair {
+	const struct diff_ctx		*ctx;
+	const struct nftnl_rule		*rule[2];
+};
+
+static struct diff_node *diff_lookup_anon(const struct diff_rule_pair *p,
+					  int side, const struct nftnl_expr *e)
+{
+	if (strcmp(e->ops->name, "lookup"))
+		return NULL;
+
+	return diff_anon_find(&p->ctx->anon[side], p->rule[side], e);
+}
+
+static bool diff_expr_cmp(const struct nftnl_expr *e1,
+			  const struct nftnl_expr *e2, void *data)
+{
+	const struct diff_rule_pair *p = data;
+	struct diff_node *n1, *n2;
+
+	n1 = diff_lookup_anon(p, DIFF_CUR, e1);
+	n2 = diff_lookup_anon(p, DIFF_WANT, e2);
+	if (n1 == NULL && n2 == NULL)
+		return nftnl_expr_cmp(e1, e2);
+	if (n1 == NULL || n2 == NULL)
+		return false;
+
+	return diff_lookup_cmp(e1, e2) && diff_anon_equal(n1, n2);
+}
+
+static uint32_t diff_expr_hash(const struct nftnl_expr *e, uint32_t h,
+			       void *data)
+{
+	const struct diff_rule_pair *p = data;
+	struct diff_node *n;
+	uint16_t attr;
+	uint32_t i;
+
+	n = diff_lookup_anon(p, p->rule[DIFF_CUR] ? DIFF_CUR : DIFF_WANT, e);
+	if (n == NULL)
+		return nftnl_expr_hash(e, h);
+
+	h = nftnl_hash_str(h, "lookup");
+	for (i = 0; i < array_size(diff_lookup_attrs); i++) {
+		attr = diff_lookup_attrs[i];
+		if (nftnl_expr_is_set(e, attr))
+			h = nftnl_hash_u32(h, nftnl_expr_get_u32(e, attr));
+	}
+	return nftnl_hash_u32(h, n->elems_hash);
+}
+
+static bool diff_rule_equal(const struct diff_ctx *ctx,
+			    const struct nftnl_rule *cur,
+			    const struct nftnl_rule *want)
+{
+	struct diff_rule_pair p = {
+		.ctx	= ctx,
+		.rule	= { cur, want },
+	};
+
+	return __nftnl_rule_equal(cur, want, diff_expr_cmp, &p);
+}
+
+static uint32_t diff_rule_hash(const struct diff_ctx *ctx, int side,
+			       const struct nftnl_rule *r)
+{
+	struct diff_rule_pair p = { .ctx = ctx };
+
+	p.rule[side] = r;
+	return __nftnl_rule_hash(r, diff_expr_hash, &p);
+}
+
+/* Create the anonymous sets rule @r refers to, before @r itself. */
+static int diff_anon_add(struct diff_ctx *ctx, struct nftnl_rule *r)
+{
+	struct nftnl_expr *e;
+	struct diff_node *n;
+
+	list_for_each_entry(e, &r->expr_list, head) {
+		n = diff_anon_find(&ctx->anon[DIFF_WANT], r, e);
+		if (n && diff_set_create(ctx, n->obj) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Rules
+ */
+
+static int diff_rules_group(struct diff_ctx *ctx,
+			    const struct nftnl_rule_list *list, int side,
+			    bool fill)
+{
+	struct nftnl_rule_list_iter iter;
+	struct diff_rules *g;
+	struct diff_node *n;
+	struct nftnl_rule *r;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_rule_list_iter_init(&iter, list);
+	while ((r = nftnl_rule_list_iter_next(&iter))) {
+		if (!(r->flags & (1 << NFTNL_RULE_TABLE)) ||
+		    !(r->flags & (1 << NFTNL_RULE_CHAIN)) ||
+		    (side == DIFF_CUR && !(r->flags & (1 << NFTNL_RULE_HANDLE)))) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		n = diff_index_lookup(&ctx->rule_idx, r->family, r->table,
+				      r->chain);
+		if (n == NULL)
+			n = diff_index_add(&ctx->rule_idx, r->family, r->table,
+					   r->chain, NULL);
+
+		g = &ctx->groups[n - ctx->rule_idx.nodes];
+		if (fill)
+			g->rules[side][g->num[side]] = r;
+		g->num[side]++;
+	}
+	return 0;
+}
+
+static uint32_t diff_rule_count(const struct nftnl_rule_list *list)
+{
+	struct nftnl_rule_list_iter iter;
+	uint32_t num = 0;
+
+	if (list == NULL)
+		return 0;
+
+	nftnl_rule_list_iter_init(&iter, list);
+	while (nftnl_rule_list_iter_next(&iter))
+		num++;
+
+	return num;
+}
+
+static int diff_rules_index(struct diff_ctx *ctx,
+			    const struct nftnl_rule_list *cur,
+			    const struct nftnl_rule_list *want)
+{
+	uint32_t total = diff_rule_count(cur) + diff_rule_count(want);
+	uint32_t i, off = 0;
+	struct diff_rules *g;
+	int side;
+
+	if (diff_index_init(&ctx->rule_idx, total) < 0)
+		return -1;
+
+	ctx->groups = calloc(total ? total : 1, sizeof(struct diff_rules));
+	ctx->rule_array = calloc(total ? total : 1, sizeof(struct nftnl_rule *));
+	ctx->keep_array = calloc(total ? total : 1, sizeof(bool));
+	ctx->before_array = calloc(total ? total : 1, sizeof(int32_t));
+	if (ctx->groups == NULL || ctx->rule_array == NULL ||
+	    ctx->keep_array == NULL || ctx->before_array == NULL)
+		return -1;
+
+	/* Count rules per chain first, then carve out their slots. */
+	if (diff_rules_group(ctx, cur, DIFF_CUR, false) < 0 ||
+	    diff_rules_group(ctx, want, DIFF_WANT, false) < 0)
+		return -1;
+
+	for (i = 0; i < ctx->rule_idx.num; i++) {
+		g = &ctx->groups[i];
+		for (side = DIFF_CUR; side <= DIFF_WANT; side++) {
+			g->rules[side] = &ctx->rule_array[off];
+			g->keep[side] = &ctx->keep_array[off];
+			if (side == DIFF_WANT)
+				g->before = &ctx->before_array[off];
+			off += g->num[side];
+			g->num[side] = 0;
+		}
+	}
+
+	if (diff_rules_group(ctx, cur, DIFF_CUR, true) < 0 ||
+	    diff_rules_group(ctx, want, DIFF_WANT, true) < 0)
+		return -1;
+
+	return 0;
+}
+
+struct diff_rule_node {
+	struct diff_rule_node	*next;
+	uint32_t		hash;
+	uint32_t		pos;
+	bool			used;
+};
+
+/*
+ * Mark the longest run of matched rules that keeps its order, @match holds the
+ * position of the current rule each desired rule was matched with, or -1.
+ */
+static int diff_rules_lis(struct diff_rules *g, const int32_t *match)
+{
+	uint32_t num = g->num[DIFF_WANT], len = 0, lo, hi, mid, j;
+	int32_t *tails, *prev, k;
+
+	tails = calloc(num, sizeof(int32_t));
+	prev = calloc(num, sizeof(int32_t));
+	if (tails == NULL || prev == NULL) {
+		xfree(tails);
+		xfree(prev);
+		return -1;
+	}
+
+	for (j = 0; j < num; j++) {
+		if (match[j] < 0)
+			continue;
+
+		lo = 0;
+		hi = len;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (match[tails[mid]] < match[j])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		prev[j] = lo > 0 ? tails[lo - 1] : -1;
+		tails[lo] = j;
+		if (lo == len)
+			len++;
+	}
+
+	for (k = len ? tails[len - 1] : -1; k >= 0; k = prev[k]) {
+		g->keep[DIFF_WANT][k] = true;
+		g->keep[DIFF_CUR][match[k]] = true;
+	}
+
+	xfree(tails);
+	xfree(prev);
+	return 0;
+}
+
+static int diff_rules_match(const struct diff_ctx *ctx,
+			    struct diff_rules *g)
+{
+	uint32_t num_cur = g->num[DIFF_CUR], num_want = g->num[DIFF_WANT];
+	struct diff_rule_node *nodes, **buckets, *n;
+	uint32_t size = 1, hash, i;
+	int32_t *match, next;
+	int ret = -1;
+
+	if (num_want == 0)
+		return 0;
+
+	while (size < num_cur)
+		size <<= 1;
+
+	nodes = calloc(num_cur ? num_cur : 1, sizeof(*nodes));
+	buckets = calloc(size, sizeof(*buckets));
+	match = calloc(num_want, sizeof(int32_t));
+	if (nodes == NULL || buckets == NULL || match == NULL)
+		goto out;
+
+	/* Inserted backwards, so each bucket lists rules in chain order. */
+	for (i = num_cur; i-- > 0;) {
+		n = &nodes[i];
+		n->hash = diff_rule_hash(ctx, DIFF_CUR, g->rules[DIFF_CUR][i]);
+		n->pos = i;
+		n->next = buckets[n->hash & (size - 1)];
+		buckets[n->hash & (size - 1)] = n;
+	}
+
+	for (i = 0; i < num_want; i++) {
+		hash = diff_rule_hash(ctx, DIFF_WANT, g->rules[DIFF_WANT][i]);
+		match[i] = -1;
+		for (n = buckets[hash & (size - 1)]; n; n = n->next) {
+			if (n->used || n->hash != hash ||
+			    !diff_rule_equal(ctx, g->rules[DIFF_CUR][n->pos],
+					     g->rules[DIFF_WANT][i]))
+				continue;
+
+			n->used = true;
+			match[i] = n->pos;
+			break;
+		}
+	}
+
+	if (diff_rules_lis(g, match) < 0)
+		goto out;
+
+	/* Added rules go in front of the next rule that stays. */
+	next = -1;
+	for (i = num_want; i-- > 0;) {
+		if (g->keep[DIFF_WANT][i])
+			next = match[i];
+		else
+			g->before[i] = next;
+	}
+	ret = 0;
+out:
+	xfree(nodes);
+	xfree(buckets);
+	xfree(match);
+	return ret;
+}
+
+static int diff_rules_cmp(struct diff_ctx *ctx)
+{
+	struct diff_node *n, *chain;
+	struct diff_rules *g;
+	uint32_t i, j;
+
+	for (i = 0; i < ctx->rule_idx.num; i++) {
+		n = &ctx->rule_idx.nodes[i];
+		g = &ctx->groups[i];
+
+		if (diff_table_deleted(ctx, n->family, n->table)) {
+			g->skip = true;
+			continue;
+		}
+
+		if (ctx->chains) {
+			chain = diff_index_lookup(&ctx->chain_idx[DIFF_CUR],
+						  n->family, n->table, n->name);
+			if (chain && chain->peer == NULL) {
+				g->skip = true;
+				continue;
+			}
+			if (chain == NULL || chain->state == DIFF_REPLACE) {
+				g->append = true;
+				continue;
+			}
+		}
+
+		if (diff_rules_match(ctx, g) < 0)
+			return -1;
+	}
+
+	for (i = 0; i < ctx->rule_idx.num; i++) {
+		g = &ctx->groups[i];
+		if (!g->append)
+			continue;
+
+		for (j = 0; j < g->num[DIFF_WANT]; j++)
+			g->before[j] = -1;
+	}
+	return 0;
+}
+
+static int diff_rules_del(struct diff_ctx *ctx)
+{
+	struct nftnl_rule *r;
+	struct diff_rules *g;
+	struct nlmsghdr *nlh;
+	uint32_t i, j;
+
+	for (i = 0; i < ctx->rule_idx.num; i++) {
+		g = &ctx->groups[i];
+		if (g->skip || g->append)
+			continue;
+
+		for (j = 0; j < g->num[DIFF_CUR]; j++) {
+			if (g->keep[DIFF_CUR][j])
+				continue;
+
+			r = g->rules[DIFF_CUR][j];
+			nlh = diff_msg_start(ctx, NFT_MSG_DELRULE, r->family, 0);
+			mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, r->table);
+			mnl_attr_put_strz(nlh, NFTA_RULE_CHAIN, r->chain);
+			mnl_attr_put_u64(nlh, NFTA_RULE_HANDLE,
+					 htobe64(r->handle));
+			if (diff_msg_end(ctx) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+/* Attributes of a desired rule that do not apply to the current ruleset. */
+#define DIFF_RULE_SKIP_ATTRS	((1 << NFTNL_RULE_HANDLE) |		\
+				 (1 << NFTNL_RULE_POSITION) |		\
+				 (1 << NFTNL_RULE_ID) |			\
+				 (1 << NFTNL_RULE_POSITION_ID))
+
+static int diff_rule_add(struct diff_ctx *ctx, struct nftnl_rule *r,
+			 const struct nftnl_rule *before)
+{
+	uint16_t flags = NLM_F_CREATE;
+	struct nlmsghdr *nlh;
+
+	if (before == NULL)
+		flags |= NLM_F_APPEND;
+
+	nlh = diff_msg_start(ctx, NFT_MSG_NEWRULE, r->family, flags);
+	nftnl_rule_nlmsg_build_attrs(nlh, r, ~DIFF_RULE_SKIP_ATTRS);
+	if (before)
+		mnl_attr_put_u64(nlh, NFTA_RULE_POSITION,
+				 htobe64(before->handle));
+
+	return diff_msg_end(ctx);
+}
+
+static int diff_rules_add(struct diff_ctx *ctx)
+{
+	struct nftnl_rule *before;
+	struct diff_rules *g;
+	uint32_t i, j;
+
+	for (i = 0; i < ctx->rule_idx.num; i++) {
+		g = &ctx->groups[i];
+		if (g->skip)
+			continue;
+
+		for (j = 0; j < g->num[DIFF_WANT]; j++) {
+			if (g->keep[DIFF_WANT][j])
+				continue;
+
+			before = g->before[j] < 0 ? NULL :
+				 g->rules[DIFF_CUR][g->before[j]];
+			if (diff_anon_add(ctx, g->rules[DIFF_WANT][j]) < 0 ||
+			    diff_rule_add(ctx, g->rules[DIFF_WANT][j],
+					  before) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static void diff_ctx_free(struct diff_ctx *ctx)
+{
+	struct diff_index *idx = &ctx->set_idx[DIFF_WANT];
+	uint32_t i;
+
+	for (i = 0; i < idx->num; i++) {
+		if (idx->nodes[i].elems == NULL)
+			continue;
+
+		nftnl_set_elems_delta_release(idx->nodes[i].elems);
+		xfree(idx->nodes[i].elems);
+	}
+
+	for (i = DIFF_CUR; i <= DIFF_WANT; i++) {
+		diff_index_free(&ctx->table_idx[i]);
+		diff_index_free(&ctx->chain_idx[i]);
+		diff_index_free(&ctx->set_idx[i]);
+		diff_anon_free(&ctx->anon[i]);
+	}
+	diff_index_free(&ctx->rule_idx);
+	xfree(ctx->groups);
+	xfree(ctx->rule_array);
+	xfree(ctx->keep_array);
+	xfree(ctx->before_array);
+}
+
+static int diff_index_all(struct diff_ctx *ctx,
+			  const struct nftnl_ruleset *cur,
+			  const struct nftnl_ruleset *want)
+{
+	if (ctx->tables) {
+		if (diff_tables_index(&ctx->table_idx[DIFF_CUR],
+			nftnl_ruleset_get(cur, NFTNL_RULESET_TABLELIST)) < 0 ||
+		    diff_tables_index(&ctx->table_idx[DIFF_WANT],
+			nftnl_ruleset_get(want, NFTNL_RULESET_TABLELIST)) < 0)
+			return -1;
+
+		diff_index_join(&ctx->table_idx[DIFF_CUR],
+				&ctx->table_idx[DIFF_WANT]);
+		diff_tables_cmp(ctx);
+	}
+
+	if (ctx->chains) {
+		if (diff_chains_index(&ctx->chain_idx[DIFF_CUR],
+			nftnl_ruleset_get(cur, NFTNL_RULESET_CHAINLIST)) < 0 ||
+		    diff_chains_index(&ctx->chain_idx[DIFF_WANT],
+			nftnl_ruleset_get(want, NFTNL_RULESET_CHAINLIST)) < 0)
+			return -1;
+
+		diff_index_join(&ctx->chain_idx[DIFF_CUR],
+				&ctx->chain_idx[DIFF_WANT]);
+		diff_chains_cmp(ctx);
+	}
+
+	if (ctx->sets) {
+		if (diff_sets_index(&ctx->set_idx[DIFF_CUR],
+			nftnl_ruleset_get(cur, NFTNL_RULESET_SETLIST)) < 0 ||
+		    diff_sets_index(&ctx->set_idx[DIFF_WANT],
+			nftnl_ruleset_get(want, NFTNL_RULESET_SETLIST)) < 0)
+			return -1;
+
+		diff_index_join(&ctx->set_idx[DIFF_CUR],
+				&ctx->set_idx[DIFF_WANT]);
+		diff_sets_cmp(ctx);
+		if (diff_sets_join(ctx) < 0)
+			return -1;
+	}
+
+	if (ctx->rules) {
+		if (diff_anon_index(&ctx->anon[DIFF_CUR],
+			nftnl_ruleset_get(cur, NFTNL_RULESET_SETLIST)) < 0 ||
+		    diff_anon_index(&ctx->anon[DIFF_WANT],
+			nftnl_ruleset_get(want, NFTNL_RULESET_SETLIST)) < 0)
+			return -1;
+		if (diff_rules_index(ctx,
+			nftnl_ruleset_get(cur, NFTNL_RULESET_RULELIST),
+			nftnl_ruleset_get(want, NFTNL_RULESET_RULELIST)) < 0)
+			return -1;
+		if (diff_rules_cmp(ctx) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_ruleset_diff);
+int nftnl_ruleset_diff(const struct nftnl_ruleset *cur,
+		       const struct nftnl_ruleset *want,
+		       struct nftnl_batch *batch, uint32_t *seq)
+{
+	struct diff_ctx ctx = {
+		.batch	= batch,
+		.seq	= seq,
+		.tables	= nftnl_ruleset_is_set(want, NFTNL_RULESET_TABLELIST),
+		.chains	= nftnl_ruleset_is_set(want, NFTNL_RULESET_CHAINLIST),
+		.sets	= nftnl_ruleset_is_set(want, NFTNL_RULESET_SETLIST),
+		.rules	= nftnl_ruleset_is_set(want, NFTNL_RULESET_RULELIST),
+	};
+	int ret = -1;
+
+	if (diff_index_all(&ctx, cur, want) < 0)
+		goto out;
+
+	/* Deletions from the innermost object out, then creations. */
+	if ((ctx.rules && diff_rules_del(&ctx) < 0) ||
+	    (ctx.sets && diff_sets_del(&ctx) < 0) ||
+	    (ctx.chains && diff_chains_del(&ctx) < 0) ||
+	    (ctx.tables && diff_tables_del(&ctx) < 0) ||
+	    (ctx.tables && diff_tables_add(&ctx) < 0) ||
+	    (ctx.chains && diff_chains_add(&ctx) < 0) ||
+	    (ctx.sets && diff_sets_add(&ctx) < 0) ||
+	    (ctx.rules && diff_rules_add(&ctx) < 0))
+		goto out;
+
+	ret = ctx.num_msgs;
+out:
+	diff_ctx_free(&ctx);
+	return ret;
+}
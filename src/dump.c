@@ -0,0 +1,152 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "dump.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+
+#include <libmnl/libmnl.h>
+
+/* Wait before the second try, doubled for every other one. */
+#define DUMP_BACKOFF_NSEC	1000000L
+
+void nftnl_dump_check(struct nftnl_dump_check *check, void *buf, int len)
+{
+	struct nlmsghdr *nlh = buf;
+	struct nfgenmsg *nfg;
+
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (nlh->nlmsg_flags & NLM_F_DUMP_INTR) {
+			nlh->nlmsg_flags &= ~NLM_F_DUMP_INTR;
+			check->intr = true;
+		}
+
+		if (nlh->nlmsg_type >= NLMSG_MIN_TYPE &&
+		    mnl_nlmsg_get_payload_len(nlh) >= sizeof(*nfg)) {
+			nfg = mnl_nlmsg_get_payload(nlh);
+			if (!check->has_genid) {
+				check->genid = nfg->res_id;
+				check->has_genid = true;
+			} else if (nfg->res_id != check->genid) {
+				check->intr = true;
+			}
+		}
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+}
+
+bool nftnl_dump_ended(const void *buf, int len, int *error)
+{
+	const struct nlmsghdr *nlh = buf;
+	const struct nlmsgerr *err;
+
+	*error = 0;
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (nlh->nlmsg_type == NLMSG_DONE) {
+			if (mnl_nlmsg_get_payload_len(nlh) >= sizeof(int))
+				*error = -*(int *)mnl_nlmsg_get_payload(nlh);
+			return true;
+		}
+		if (nlh->nlmsg_type == NLMSG_ERROR) {
+			err = mnl_nlmsg_get_payload(nlh);
+			if (mnl_nlmsg_get_payload_len(nlh) >= sizeof(*err))
+				*error = -err->error;
+			return true;
+		}
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+	return false;
+}
+
+void nftnl_dump_drain(struct mnl_socket *nl, void *buf, size_t size)
+{
+	int err = errno, len, error;
+
+	for (;;) {
+		len = mnl_socket_recvfrom(nl, buf, size);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0 || nftnl_dump_ended(buf, len, &error))
+			break;
+	}
+	errno = err;
+}
+
+int nftnl_nlmsg_request(struct mnl_socket *nl, const struct nlmsghdr *nlh,
+			mnl_cb_t cb, void *data)
+{
+	uint32_t portid = mnl_socket_get_portid(nl);
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_dump_check check = {};
+	int ret, len, error;
+
+	if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0)
+		return -1;
+
+	ret = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+	while (ret > 0) {
+		len = ret;
+		nftnl_dump_check(&check, buf, len);
+		ret = mnl_cb_run(buf, len, nlh->nlmsg_seq, portid, cb, data);
+		if (ret > 0) {
+			ret = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+			continue;
+		}
+
+		/* callbacks may stop before the end, the rest must go */
+		if (!nftnl_dump_ended(buf, len, &error) &&
+		    (nlh->nlmsg_flags & NLM_F_DUMP) == NLM_F_DUMP)
+			nftnl_dump_drain(nl, buf, sizeof(buf));
+		/* libmnl stops at NLMSG_DONE without its error */
+		if (ret == 0 && error) {
+			errno = error;
+			ret = -1;
+		}
+		break;
+	}
+	if (ret < 0)
+		return -1;
+
+	if (check.intr) {
+		errno = EINTR;
+		return -1;
+	}
+	return 0;
+}
+
+void nftnl_dump_backoff(int try)
+{
+	struct timespec ts = { .tv_nsec = DUMP_BACKOFF_NSEC << (try - 1) };
+
+	nanosleep(&ts, NULL);
+}
+
+int nftnl_nlmsg_dump(struct mnl_socket *nl, struct nlmsghdr *nlh,
+		     mnl_cb_t cb, void (*reset)(void *data), void *data)
+{
+	int i;
+
+	for (i = 0; i < NFTNL_DUMP_TRIES; i++) {
+		if (i > 0) {
+			reset(data);
+			nftnl_dump_backoff(i);
+		}
+
+		if (nftnl_nlmsg_request(nl, nlh, cb, data) == 0)
+			return 0;
+		if (errno != EINTR)
+			return -1;
+	}
+
+	errno = EAGAIN;
+	return -1;
+}
@@ -0,0 +1,523 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "dump.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/dump.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
+
+/*
+ * Buffers received and not merged yet are kept in a ring of jobs, in the
+ * order of the dump. Workers take the oldest job nobody took and parse it
+ * into a list of its own. The receiving thread merges jobs from the oldest
+ * one on as they are done, and waits for the oldest one when the ring is
+ * full. Parsing allocates from the heap and the expression pool, both safe
+ * to use from any thread.
+ */
+
+#define PIPELINE_JOBS		64
+/* The kernel fills dump parts up to the size of the receive buffer. */
+#define PIPELINE_BUF_SIZE	32768
+
+struct pipeline_ops {
+	uint16_t	type;
+	void		*(*alloc)(void);
+	void		(*free)(void *list);
+	mnl_cb_t	parse;
+	/* move all of @from to the end of @to */
+	void		(*splice)(void *from, void *to);
+};
+
+struct pipeline_job {
+	char		*buf;
+	int		len;
+	void		*list;
+	bool		done;
+	int		ret;
+	int		err;
+};
+
+struct nftnl_dump_pipeline {
+	pthread_t		*workers;
+	unsigned int		num_workers;
+
+	pthread_mutex_t		lock;
+	/* workers wait for jobs on this, the receiver for jobs done */
+	pthread_cond_t		work_cond;
+	pthread_cond_t		done_cond;
+	bool			stop;
+
+	struct pipeline_job	jobs[PIPELINE_JOBS];
+	/* job counters, the slot is the counter modulo PIPELINE_JOBS */
+	unsigned int		head;	/* oldest not merged */
+	unsigned int		next;	/* next for a worker to take */
+	unsigned int		tail;	/* next to receive */
+
+	/* of the dump running */
+	const struct pipeline_ops *ops;
+	uint32_t		seq;
+	uint32_t		portid;
+};
+
+#define PIPELINE_LIST_OPS(name)						\
+static void *pipeline_##name##_alloc(void)				\
+{									\
+	return nftnl_##name##_list_alloc();				\
+}									\
+									\
+static void pipeline_##name##_free(void *list)				\
+{									\
+	nftnl_##name##_list_free(list);					\
+}									\
+									\
+static int pipeline_##name##_parse(const struct nlmsghdr *nlh,		\
+				   void *list)				\
+{									\
+	struct nftnl_##name *obj;					\
+									\
+	obj = nftnl_##name##_alloc();					\
+	if (obj == NULL)						\
+		return MNL_CB_ERROR;					\
+									\
+	if (nftnl_##name##_nlmsg_parse(nlh, obj) < 0) {			\
+		nftnl_##name##_free(obj);				\
+		return MNL_CB_ERROR;					\
+	}								\
+	nftnl_##name##_list_add_tail(obj, list);			\
+									\
+	return MNL_CB_OK;						\
+}									\
+									\
+static int pipeline_##name##_move(struct nftnl_##name *obj, void *to)	\
+{									\
+	nftnl_##name##_list_del(obj);					\
+	nftnl_##name##_list_add_tail(obj, to);				\
+	return 0;							\
+}									\
+									\
+static void pipeline_##name##_splice(void *from, void *to)		\
+{									\
+	nftnl_##name##_list_foreach(from, pipeline_##name##_move, to);	\
+}
+
+PIPELINE_LIST_OPS(table)
+PIPELINE_LIST_OPS(chain)
+PIPELINE_LIST_OPS(rule)
+PIPELINE_LIST_OPS(set)
+PIPELINE_LIST_OPS(obj)
+PIPELINE_LIST_OPS(flowtable)
+
+static void *pipeline_elems_alloc(void)
+{
+	return nftnl_set_alloc();
+}
+
+static void pipeline_elems_free(void *s)
+{
+	nftnl_set_free(s);
+}
+
+static int pipeline_elems_parse(const struct nlmsghdr *nlh, void *s)
+{
+	if (nftnl_set_elems_nlmsg_parse(nlh, s) < 0)
+		return MNL_CB_ERROR;
+
+	return MNL_CB_OK;
+}
+
+static void pipeline_elems_splice(void *from, void *to)
+{
+	struct nftnl_set *s_from = from, *s_to = to;
+
+	list_splice_init(&s_from->element_list, s_to->element_list.prev);
+}
+
+#define PIPELINE_OPS(_type, name)			\
+	{						\
+		.type	= _type,			\
+		.alloc	= pipeline_##name##_alloc,	\
+		.free	= pipeline_##name##_free,	\
+		.parse	= pipeline_##name##_parse,	\
+		.splice	= pipeline_##name##_splice,	\
+	}
+
+static const struct pipeline_ops pipeline_ops[] = {
+	PIPELINE_OPS(NFT_MSG_GETTABLE, table),
+	PIPELINE_OPS(NFT_MSG_GETCHAIN, chain),
+	PIPELINE_OPS(NFT_MSG_GETRULE, rule),
+	PIPELINE_OPS(NFT_MSG_GETSET, set),
+	PIPELINE_OPS(NFT_MSG_GETSETELEM, elems),
+	PIPELINE_OPS(NFT_MSG_GETOBJ, obj),
+	PIPELINE_OPS(NFT_MSG_GETFLOWTABLE, flowtable),
+};
+
+static const struct pipeline_ops *pipeline_ops_find(uint16_t type)
+{
+	uint32_t i;
+
+	for (i = 0; i < array_size(pipeline_ops); i++) {
+		if (pipeline_ops[i].type == type)
+			return &pipeline_ops[i];
+	}
+	return NULL;
+}
+
+static void *pipeline_worker(void *data)
+{
+	struct nftnl_dump_pipeline *p = data;
+	struct pipeline_job *job;
+
+	pthread_mutex_lock(&p->lock);
+	for (;;) {
+		while (!p->stop && p->next == p->tail)
+			pthread_cond_wait(&p->work_cond, &p->lock);
+		if (p->stop)
+			break;
+
+		job = &p->jobs[p->next++ % PIPELINE_JOBS];
+		pthread_mutex_unlock(&p->lock);
+
+		errno = 0;
+		job->ret = mnl_cb_run(job->buf, job->len, p->seq, p->portid,
+				      p->ops->parse, job->list);
+		/* parsers fail without errno on malformed messages */
+		job->err = errno ? errno : EINVAL;
+
+		pthread_mutex_lock(&p->lock);
+		job->done = true;
+		pthread_cond_broadcast(&p->done_cond);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_dump_pipeline_alloc);
+struct nftnl_dump_pipeline *nftnl_dump_pipeline_alloc(unsigned int workers)
+{
+	struct nftnl_dump_pipeline *p;
+	unsigned int i;
+
+	if (workers == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		return NULL;
+
+	p->workers = calloc(workers, sizeof(*p->workers));
+	if (p->workers == NULL)
+		goto err;
+
+	for (i = 0; i < PIPELINE_JOBS; i++) {
+		p->jobs[i].buf = malloc(PIPELINE_BUF_SIZE);
+		if (p->jobs[i].buf == NULL)
+			goto err;
+	}
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->work_cond, NULL);
+	pthread_cond_init(&p->done_cond, NULL);
+
+	for (i = 0; i < workers; i++) {
+		if (pthread_create(&p->workers[i], NULL, pipeline_worker,
+				   p) != 0) {
+			nftnl_dump_pipeline_free(p);
+			errno = EAGAIN;
+			return NULL;
+		}
+		p->num_workers++;
+	}
+
+	return p;
+err:
+	for (i = 0; i < PIPELINE_JOBS; i++)
+		xfree(p->jobs[i].buf);
+	xfree(p->workers);
+	xfree(p);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_dump_pipeline_free);
+void nftnl_dump_pipeline_free(struct nftnl_dump_pipeline *p)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&p->lock);
+	p->stop = true;
+	pthread_cond_broadcast(&p->work_cond);
+	pthread_mutex_unlock(&p->lock);
+
+	for (i = 0; i < p->num_workers; i++)
+		pthread_join(p->workers[i], NULL);
+
+	pthread_cond_destroy(&p->done_cond);
+	pthread_cond_destroy(&p->work_cond);
+	pthread_mutex_destroy(&p->lock);
+
+	for (i = 0; i < PIPELINE_JOBS; i++)
+		xfree(p->jobs[i].buf);
+	xfree(p->workers);
+	xfree(p);
+}
+
+/*
+ * Merge jobs that are done into @out, in order, until there is room for
+ * one more, or until none is left if @all. The first error of a job is
+ * kept in @err, lists of jobs after it are dropped.
+ */
+static void pipeline_merge(struct nftnl_dump_pipeline *p, void *out,
+			   bool all, int *err)
+{
+	struct pipeline_job *job;
+
+	pthread_mutex_lock(&p->lock);
+	while (p->head != p->tail) {
+		job = &p->jobs[p->head % PIPELINE_JOBS];
+		if (!job->done) {
+			if (!all && p->tail - p->head < PIPELINE_JOBS)
+				break;
+
+			pthread_cond_wait(&p->done_cond, &p->lock);
+			continue;
+		}
+		pthread_mutex_unlock(&p->lock);
+
+		if (job->ret < 0 && *err == 0)
+			*err = job->err;
+		if (*err == 0)
+			p->ops->splice(job->list, out);
+		p->ops->free(job->list);
+		job->list = NULL;
+
+		pthread_mutex_lock(&p->lock);
+		p->head++;
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+/* Whether the dump ends in these @len bytes of messages. */
+static bool pipeline_last(const void *buf, int len)
+{
+	const struct nlmsghdr *nlh = buf;
+
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (nlh->nlmsg_type == NLMSG_DONE ||
+		    nlh->nlmsg_type == NLMSG_ERROR)
+			return true;
+
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+	return false;
+}
+
+/* Where the parts of the reply come from, one per call to @recv. */
+struct pipeline_src {
+	int		(*recv)(void *data, char *buf, size_t size);
+	void		*data;
+};
+
+static int pipeline_sock_recv(void *nl, char *buf, size_t size)
+{
+	return mnl_socket_recvfrom(nl, buf, size);
+}
+
+static int pipeline_dump(struct nftnl_dump_pipeline *p,
+			 const struct pipeline_src *src, void *out)
+{
+	struct nftnl_dump_check check = {};
+	struct pipeline_job *job;
+	bool last = false, drain = true;
+	char *buf;
+	int err = 0, len;
+
+	while (!last && err == 0) {
+		pipeline_merge(p, out, false, &err);
+		if (err)
+			break;
+
+		job = &p->jobs[p->tail % PIPELINE_JOBS];
+		job->list = p->ops->alloc();
+		if (job->list == NULL) {
+			err = errno;
+			break;
+		}
+
+		job->len = src->recv(src->data, job->buf, PIPELINE_BUF_SIZE);
+		if (job->len < 0) {
+			err = errno;
+			drain = false;
+			p->ops->free(job->list);
+			job->list = NULL;
+			break;
+		}
+		nftnl_dump_check(&check, job->buf, job->len);
+		last = pipeline_last(job->buf, job->len);
+
+		pthread_mutex_lock(&p->lock);
+		job->done = false;
+		p->tail++;
+		pthread_cond_signal(&p->work_cond);
+		pthread_mutex_unlock(&p->lock);
+	}
+	pipeline_merge(p, out, true, &err);
+
+	/*
+	 * The kernel goes on with the dump after an error here, read it to its
+	 * end for nothing to be left queued. All jobs are merged, no worker
+	 * uses the buffer of the next one.
+	 */
+	buf = p->jobs[p->tail % PIPELINE_JOBS].buf;
+	while (!last && drain) {
+		len = src->recv(src->data, buf, PIPELINE_BUF_SIZE);
+		if (len < 0)
+			break;
+		last = pipeline_last(buf, len);
+	}
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	if (check.intr) {
+		errno = EINTR;
+		return -1;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_dump_pipeline_run);
+int nftnl_dump_pipeline_run(struct nftnl_dump_pipeline *p,
+			    struct mnl_socket *nl, struct nlmsghdr *nlh,
+			    void *list)
+{
+	struct pipeline_src src = {
+		.recv	= pipeline_sock_recv,
+		.data	= nl,
+	};
+	void *out;
+	int i, ret, err;
+
+	p->ops = pipeline_ops_find(NFNL_MSG_TYPE(nlh->nlmsg_type));
+	if (p->ops == NULL || !(nlh->nlmsg_flags & NLM_F_DUMP)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	p->seq = nlh->nlmsg_seq;
+	p->portid = mnl_socket_get_portid(nl);
+
+	for (i = 0; i < NFTNL_DUMP_TRIES; i++) {
+		if (i > 0)
+			nftnl_dump_backoff(i);
+
+		if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0)
+			return -1;
+
+		out = p->ops->alloc();
+		if (out == NULL)
+			return -1;
+
+		ret = pipeline_dump(p, &src, out);
+		err = errno;
+		if (ret == 0)
+			p->ops->splice(out, list);
+		p->ops->free(out);
+
+		if (ret == 0)
+			return 0;
+		if (err != EINTR) {
+			errno = err;
+			return -1;
+		}
+	}
+
+	errno = EAGAIN;
+	return -1;
+}
+
+struct pipeline_iov {
+	const struct iovec	*iov;
+	unsigned int		num;
+	unsigned int		next;
+};
+
+static int pipeline_iov_recv(void *data, char *buf, size_t size)
+{
+	struct pipeline_iov *src = data;
+	const struct iovec *iov;
+
+	if (src->next == src->num) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	iov = &src->iov[src->next++];
+	if (iov->iov_len > size) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	memcpy(buf, iov->iov_base, iov->iov_len);
+
+	return iov->iov_len;
+}
+
+int nftnl_dump_pipeline_parse(struct nftnl_dump_pipeline *p, uint16_t type,
+			      const struct iovec *iov, unsigned int *num,
+			      void *list)
+{
+	struct pipeline_iov data = {
+		.iov	= iov,
+		.num	= *num,
+	};
+	struct pipeline_src src = {
+		.recv	= pipeline_iov_recv,
+		.data	= &data,
+	};
+	void *out;
+	int ret, err;
+
+	p->ops = pipeline_ops_find(type);
+	if (p->ops == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	p->seq = 0;
+	p->portid = 0;
+
+	out = p->ops->alloc();
+	if (out == NULL)
+		return -1;
+
+	ret = pipeline_dump(p, &src, out);
+	err = errno;
+	if (ret == 0)
+		p->ops->splice(out, list);
+	p->ops->free(out);
+	*num = data.next;
+
+	errno = err;
+	return ret;
+}
@@ -0,0 +1,1318 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "eval.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/eval.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+/*
+ * Evaluation engine: expressions are compiled into flat operations on a
+ * register file laid out as in the kernel, so that rules behave as they do
+ * in nft_do_chain(). Sets become a hash table, a sorted array of interval
+ * boundaries or, for elements with a key end, a list of ranges.
+ */
+
+enum eval_set_kind {
+	EVAL_SET_HASH	= 0,
+	EVAL_SET_INTERVAL,
+	EVAL_SET_RANGE,
+};
+
+struct eval_elem {
+	struct eval_elem	*next;
+	uint32_t		hash;
+	uint32_t		key_len;
+	const uint8_t		*key;
+	const uint8_t		*key_end;
+	/* closes the interval started by the previous element */
+	bool			end;
+	bool			has_data;
+	int32_t			verdict;
+	struct nftnl_eval_chain	*chain;
+	const uint32_t		*data;
+};
+
+struct eval_set {
+	struct eval_set		*next;
+	uint32_t		hash;
+	uint32_t		family;
+	const char		*table;
+	const char		*name;
+	/* sets added in the same batch are known by their id */
+	bool			has_id;
+	uint32_t		id;
+	enum eval_set_kind	kind;
+	uint32_t		key_len;
+	uint32_t		data_len;
+	bool			map;
+	bool			verdict_map;
+	struct eval_elem	*elems;
+	uint32_t		num;
+	struct eval_elem	**buckets;
+	uint32_t		mask;
+	/* fields of concatenated range keys, each padded to 32 bits */
+	uint32_t		field_count;
+	uint8_t			field_len[NFT_REG32_COUNT];
+};
+
+static uint32_t eval_key_hash(uint32_t family, const char *table,
+			      const char *name)
+{
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, family);
+	h = nftnl_hash_str(h, table);
+	h = nftnl_hash_str(h, name);
+
+	return nftnl_hash_final(h);
+}
+
+static uint32_t eval_buckets(uint32_t num)
+{
+	uint32_t size = 1;
+
+	while (size < num)
+		size <<= 1;
+
+	return size;
+}
+
+EXPORT_SYMBOL(nftnl_eval_chain_lookup);
+struct nftnl_eval_chain *nftnl_eval_chain_lookup(const struct nftnl_eval *ev,
+						 uint32_t family,
+						 const char *table,
+						 const char *chain)
+{
+	uint32_t hash = eval_key_hash(family, table, chain);
+	struct nftnl_eval_chain *c;
+
+	for (c = ev->chain_buckets[hash & ev->chain_mask]; c; c = c->next) {
+		if (c->hash == hash && c->family == family &&
+		    !strcmp(c->table, table) && !strcmp(c->name, chain))
+			return c;
+	}
+	return NULL;
+}
+
+static struct eval_set *eval_set_lookup(const struct nftnl_eval *ev,
+					uint32_t family, const char *table,
+					const char *name)
+{
+	uint32_t hash = eval_key_hash(family, table, name);
+	struct eval_set *s;
+
+	for (s = ev->set_buckets[hash & ev->set_mask]; s; s = s->next) {
+		if (s->hash == hash && s->family == family &&
+		    !strcmp(s->table, table) && !strcmp(s->name, name))
+			return s;
+	}
+	return NULL;
+}
+
+static struct eval_set *eval_set_lookup_id(const struct nftnl_eval *ev,
+					   uint32_t family, const char *table,
+					   uint32_t id)
+{
+	uint32_t i;
+
+	for (i = 0; i < ev->num_sets; i++) {
+		if (ev->sets[i].has_id && ev->sets[i].id == id &&
+		    ev->sets[i].family == family &&
+		    !strcmp(ev->sets[i].table, table))
+			return &ev->sets[i];
+	}
+	return NULL;
+}
+
+static struct nftnl_eval_chain *eval_chain_add(struct nftnl_eval *ev,
+					       uint32_t family,
+					       const char *table,
+					       const char *name)
+{
+	struct nftnl_eval_chain *c;
+
+	c = nftnl_eval_chain_lookup(ev, family, table, name);
+	if (c)
+		return c;
+
+	c = &ev->chains[ev->num_chains++];
+	c->hash = eval_key_hash(family, table, name);
+	c->family = family;
+	c->table = table;
+	c->name = name;
+	c->policy = NF_ACCEPT;
+	c->next = ev->chain_buckets[c->hash & ev->chain_mask];
+	ev->chain_buckets[c->hash & ev->chain_mask] = c;
+
+	return c;
+}
+
+static int eval_verdict_chain(struct nftnl_eval *ev, uint32_t family,
+			      const char *table, int32_t verdict,
+			      const char *name, struct nftnl_eval_chain **c)
+{
+	if (verdict != NFT_JUMP && verdict != NFT_GOTO) {
+		*c = NULL;
+		return 0;
+	}
+
+	if (name == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	*c = nftnl_eval_chain_lookup(ev, family, table, name);
+	if (*c == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+	return 0;
+}
+
+static int eval_elem_cmp(const void *a, const void *b)
+{
+	const struct eval_elem *e1 = a, *e2 = b;
+	int ret;
+
+	ret = memcmp(e1->key, e2->key, e1->key_len);
+	if (ret)
+		return ret;
+
+	/* an interval closed where the next one starts ends first */
+	return e2->end - e1->end;
+}
+
+static int eval_set_compile(struct nftnl_eval *ev, struct eval_set *es,
+			    const struct nftnl_set *s)
+{
+	struct nftnl_set_elem *e;
+	struct eval_elem *ee;
+	uint32_t num = 0, i;
+
+	es->family = s->family;
+	es->table = s->table;
+	es->name = s->name;
+	es->has_id = s->flags & (1 << NFTNL_SET_ID);
+	es->id = s->id;
+	es->key_len = s->key_len;
+	es->data_len = s->data_len;
+	es->map = s->set_flags & NFT_SET_MAP;
+	es->verdict_map = es->map && s->data_type == NFT_DATA_VERDICT;
+	es->kind = s->set_flags & NFT_SET_INTERVAL ? EVAL_SET_INTERVAL :
+						     EVAL_SET_HASH;
+
+	if (s->flags & (1 << NFTNL_SET_DESC_CONCAT) && s->desc.field_count) {
+		es->field_count = s->desc.field_count;
+		memcpy(es->field_len, s->desc.field_len, es->field_count);
+	}
+
+	list_for_each_entry(e, &s->element_list, head) {
+		if (e->flags & (1 << NFTNL_SET_ELEM_KEY_END))
+			es->kind = EVAL_SET_RANGE;
+		if (es->key_len == 0)
+			es->key_len = e->key.len;
+		num++;
+	}
+	if (es->key_len == 0 || es->key_len > NFT_DATA_VALUE_MAXLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (es->field_count == 0) {
+		es->field_count = 1;
+		es->field_len[0] = es->key_len;
+	}
+
+	es->elems = calloc(num ? num : 1, sizeof(struct eval_elem));
+	es->mask = eval_buckets(num) - 1;
+	es->buckets = calloc(es->mask + 1, sizeof(struct eval_elem *));
+	if (es->elems == NULL || es->buckets == NULL)
+		return -1;
+
+	list_for_each_entry(e, &s->element_list, head) {
+		if (!(e->flags & (1 << NFTNL_SET_ELEM_KEY)) ||
+		    e->key.len != es->key_len ||
+		    (e->flags & (1 << NFTNL_SET_ELEM_KEY_END) &&
+		     e->key_end.len != es->key_len)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		ee = &es->elems[es->num++];
+		ee->key_len = es->key_len;
+		ee->key = (const uint8_t *)e->key.val;
+		if (e->flags & (1 << NFTNL_SET_ELEM_KEY_END))
+			ee->key_end = (const uint8_t *)e->key_end.val;
+		ee->end = e->set_elem_flags & NFT_SET_ELEM_INTERVAL_END;
+
+		if (e->flags & (1 << NFTNL_SET_ELEM_VERDICT)) {
+			ee->has_data = true;
+			ee->verdict = e->data.verdict;
+			if (eval_verdict_chain(ev, s->family, s->table,
+					       ee->verdict, e->data.chain,
+					       &ee->chain) < 0)
+				return -1;
+		} else if (e->flags & (1 << NFTNL_SET_ELEM_DATA)) {
+			ee->has_data = true;
+			ee->data = e->data.val;
+		}
+	}
+
+	switch (es->kind) {
+	case EVAL_SET_HASH:
+		for (i = 0; i < es->num; i++) {
+			ee = &es->elems[i];
+			ee->hash = nftnl_hash_final(nftnl_hash_mem(0, ee->key,
+								   es->key_len));
+			ee->next = es->buckets[ee->hash & es->mask];
+			es->buckets[ee->hash & es->mask] = ee;
+		}
+		break;
+	case EVAL_SET_INTERVAL:
+		qsort(es->elems, es->num, sizeof(struct eval_elem),
+		      eval_elem_cmp);
+		break;
+	case EVAL_SET_RANGE:
+		break;
+	}
+	return 0;
+}
+
+static bool eval_range_match(const struct eval_set *s,
+			     const struct eval_elem *e, const uint8_t *key)
+{
+	uint32_t i, off = 0;
+
+	for (i = 0; i < s->field_count; i++) {
+		if (memcmp(key + off, e->key + off, s->field_len[i]) < 0 ||
+		    memcmp(key + off, e->key_end + off, s->field_len[i]) > 0)
+			return false;
+
+		off += div_round_up(s->field_len[i], sizeof(uint32_t)) *
+		       sizeof(uint32_t);
+	}
+	return true;
+}
+
+static const struct eval_elem *eval_set_find(const struct eval_set *s,
+					     const uint8_t *key)
+{
+	const struct eval_elem *e;
+	uint32_t hash, lo, hi, mid;
+
+	switch (s->kind) {
+	case EVAL_SET_HASH:
+		hash = nftnl_hash_final(nftnl_hash_mem(0, key, s->key_len));
+		for (e = s->buckets[hash & s->mask]; e; e = e->next) {
+			if (e->hash == hash && !memcmp(e->key, key, s->key_len))
+				return e;
+		}
+		break;
+	case EVAL_SET_INTERVAL:
+		/* last boundary that is not past the key */
+		lo = 0;
+		hi = s->num;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (memcmp(s->elems[mid].key, key, s->key_len) <= 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo > 0 && !s->elems[lo - 1].end)
+			return &s->elems[lo - 1];
+		break;
+	case EVAL_SET_RANGE:
+		for (e = s->elems; e < s->elems + s->num; e++) {
+			if (e->key_end ? eval_range_match(s, e, key) :
+					 !memcmp(e->key, key, s->key_len))
+				return e;
+		}
+		break;
+	}
+	return NULL;
+}
+
+/* Register file word of register @reg holding @len bytes, or -1. */
+int eval_reg(uint32_t reg, uint32_t len)
+{
+	uint32_t word;
+
+	if (reg >= NFT_REG_1 && reg <= NFT_REG_4)
+		word = reg * NFT_REG_SIZE / NFT_REG32_SIZE;
+	else if (reg >= NFT_REG32_00 && reg <= NFT_REG32_15)
+		word = reg - NFT_REG32_00 + 4;
+	else
+		goto err;
+
+	if (len == 0 || len > NFT_DATA_VALUE_MAXLEN ||
+	    word + div_round_up(len, NFT_REG32_SIZE) > EVAL_REGS)
+		goto err;
+
+	return word;
+err:
+	errno = EINVAL;
+	return -1;
+}
+
+static int eval_op_reg(const struct nftnl_expr *e, uint16_t attr,
+		       uint32_t len, uint32_t *word)
+{
+	int ret;
+
+	if (!nftnl_expr_is_set(e, attr)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = eval_reg(nftnl_expr_get_u32(e, attr), len);
+	if (ret < 0)
+		return -1;
+
+	*word = ret;
+	return 0;
+}
+
+static int eval_op_data(const struct nftnl_expr *e, uint16_t attr,
+			uint32_t *data, uint32_t *len)
+{
+	const void *val;
+	uint32_t val_len;
+
+	val = nftnl_expr_get(e, attr, &val_len);
+	if (val == NULL || val_len == 0 || val_len > NFT_DATA_VALUE_MAXLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(data, val, val_len);
+	if (len)
+		*len = val_len;
+	return 0;
+}
+
+static int eval_compile_payload(struct eval_op *op, const struct nftnl_expr *e)
+{
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_PAYLOAD_SREG)) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	op->type = EVAL_OP_PAYLOAD;
+	op->op = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_BASE);
+	op->arg = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET);
+	op->len = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_LEN);
+	if (op->op > NFT_PAYLOAD_TRANSPORT_HEADER) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	return eval_op_reg(e, NFTNL_EXPR_PAYLOAD_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_meta(struct eval_op *op, const struct nftnl_expr *e)
+{
+	op->arg = nftnl_expr_get_u32(e, NFTNL_EXPR_META_KEY);
+
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_META_SREG)) {
+		if (op->arg != NFT_META_MARK) {
+			errno = EOPNOTSUPP;
+			return -1;
+		}
+		op->type = EVAL_OP_META_SET;
+		op->len = sizeof(uint32_t);
+		return eval_op_reg(e, NFTNL_EXPR_META_SREG, op->len, &op->sreg);
+	}
+
+	switch (op->arg) {
+	case NFT_META_LEN:
+	case NFT_META_PROTOCOL:
+	case NFT_META_NFPROTO:
+	case NFT_META_L4PROTO:
+	case NFT_META_MARK:
+	case NFT_META_IIF:
+	case NFT_META_OIF:
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	op->type = EVAL_OP_META;
+	op->len = sizeof(uint32_t);
+	return eval_op_reg(e, NFTNL_EXPR_META_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_ct(struct eval_op *op, const struct nftnl_expr *e)
+{
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_CT_SREG) ||
+	    nftnl_expr_get_u32(e, NFTNL_EXPR_CT_KEY) != NFT_CT_STATE) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	op->type = EVAL_OP_CT_STATE;
+	op->len = sizeof(uint32_t);
+	return eval_op_reg(e, NFTNL_EXPR_CT_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_cmp(struct eval_op *op, const struct nftnl_expr *e)
+{
+	op->type = EVAL_OP_CMP;
+	op->op = nftnl_expr_get_u32(e, NFTNL_EXPR_CMP_OP);
+	if (op->op > NFT_CMP_GTE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (eval_op_data(e, NFTNL_EXPR_CMP_DATA, op->data, &op->len) < 0)
+		return -1;
+
+	return eval_op_reg(e, NFTNL_EXPR_CMP_SREG, op->len, &op->sreg);
+}
+
+static int eval_compile_range(struct eval_op *op, const struct nftnl_expr *e)
+{
+	uint32_t len;
+
+	op->type = EVAL_OP_RANGE;
+	op->op = nftnl_expr_get_u32(e, NFTNL_EXPR_RANGE_OP);
+	if (op->op != NFT_RANGE_EQ && op->op != NFT_RANGE_NEQ) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (eval_op_data(e, NFTNL_EXPR_RANGE_FROM_DATA, op->data,
+			 &op->len) < 0 ||
+	    eval_op_data(e, NFTNL_EXPR_RANGE_TO_DATA, op->data2, &len) < 0)
+		return -1;
+
+	if (len != op->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return eval_op_reg(e, NFTNL_EXPR_RANGE_SREG, op->len, &op->sreg);
+}
+
+static int eval_compile_bitwise(struct eval_op *op, const struct nftnl_expr *e)
+{
+	op->type = EVAL_OP_BITWISE;
+	op->op = nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_OP);
+	op->len = nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_LEN);
+
+	switch (op->op) {
+	case NFT_BITWISE_BOOL:
+		if (eval_op_data(e, NFTNL_EXPR_BITWISE_MASK, op->data,
+				 NULL) < 0 ||
+		    eval_op_data(e, NFTNL_EXPR_BITWISE_XOR, op->data2,
+				 NULL) < 0)
+			return -1;
+		break;
+	case NFT_BITWISE_LSHIFT:
+	case NFT_BITWISE_RSHIFT:
+		if (eval_op_data(e, NFTNL_EXPR_BITWISE_DATA, op->data,
+				 NULL) < 0)
+			return -1;
+		if (op->data[0] >= 32) {
+			errno = EINVAL;
+			return -1;
+		}
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	if (eval_op_reg(e, NFTNL_EXPR_BITWISE_SREG, op->len, &op->sreg) < 0)
+		return -1;
+
+	return eval_op_reg(e, NFTNL_EXPR_BITWISE_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_byteorder(struct eval_op *op,
+				  const struct nftnl_expr *e)
+{
+	op->type = EVAL_OP_BYTEORDER;
+	op->op = nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_OP);
+	op->len = nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_LEN);
+	op->arg = nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_SIZE);
+
+	if (op->arg != 2 && op->arg != 4 && op->arg != 8) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (eval_op_reg(e, NFTNL_EXPR_BYTEORDER_SREG, op->len, &op->sreg) < 0)
+		return -1;
+
+	return eval_op_reg(e, NFTNL_EXPR_BYTEORDER_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_immediate(struct nftnl_eval *ev, struct eval_op *op,
+				  const struct nftnl_rule *r,
+				  const struct nftnl_expr *e)
+{
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_IMM_VERDICT)) {
+		op->type = EVAL_OP_VERDICT;
+		op->verdict = nftnl_expr_get_u32(e, NFTNL_EXPR_IMM_VERDICT);
+		return eval_verdict_chain(ev, r->family, r->table, op->verdict,
+					  nftnl_expr_get_str(e, NFTNL_EXPR_IMM_CHAIN),
+					  &op->chain);
+	}
+
+	op->type = EVAL_OP_IMMEDIATE;
+	if (eval_op_data(e, NFTNL_EXPR_IMM_DATA, op->data, &op->len) < 0)
+		return -1;
+
+	return eval_op_reg(e, NFTNL_EXPR_IMM_DREG, op->len, &op->dreg);
+}
+
+static int eval_compile_lookup(struct nftnl_eval *ev, struct eval_op *op,
+			       const struct nftnl_rule *r,
+			       const struct nftnl_expr *e)
+{
+	const char *name = nftnl_expr_get_str(e, NFTNL_EXPR_LOOKUP_SET);
+	uint32_t id;
+
+	op->type = EVAL_OP_LOOKUP;
+	op->arg = nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_FLAGS);
+
+	op->set = NULL;
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_SET_ID)) {
+		id = nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_SET_ID);
+		op->set = eval_set_lookup_id(ev, r->family, r->table, id);
+	}
+	if (op->set == NULL && name)
+		op->set = eval_set_lookup(ev, r->family, r->table, name);
+	if (op->set == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	op->len = op->set->key_len;
+	if (eval_op_reg(e, NFTNL_EXPR_LOOKUP_SREG, op->len, &op->sreg) < 0)
+		return -1;
+
+	if (!nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_DREG))
+		return 0;
+
+	if (!op->set->map || op->arg & NFT_LOOKUP_F_INV) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* maps to the verdict register */
+	if (op->set->verdict_map) {
+		if (nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_DREG) !=
+		    NFT_REG_VERDICT) {
+			errno = EINVAL;
+			return -1;
+		}
+		return 0;
+	}
+
+	return eval_op_reg(e, NFTNL_EXPR_LOOKUP_DREG, op->set->data_len,
+			   &op->dreg);
+}
+
+/* Expressions without effect on the verdict of a single packet. */
+static const char *eval_nop_exprs[] = {
+	"counter", "log", "limit", "quota", "last",
+};
+
+static int eval_compile_expr(struct nftnl_eval *ev, struct eval_op *op,
+			     const struct nftnl_rule *r,
+			     const struct nftnl_expr *e)
+{
+	const char *name = nftnl_expr_get_str(e, NFTNL_EXPR_NAME);
+
+	memset(op, 0, sizeof(*op));
+
+	if (!strcmp(name, "payload"))
+		return eval_compile_payload(op, e);
+	if (!strcmp(name, "meta"))
+		return eval_compile_meta(op, e);
+	if (!strcmp(name, "ct"))
+		return eval_compile_ct(op, e);
+	if (!strcmp(name, "cmp"))
+		return eval_compile_cmp(op, e);
+	if (!strcmp(name, "range"))
+		return eval_compile_range(op, e);
+	if (!strcmp(name, "bitwise"))
+		return eval_compile_bitwise(op, e);
+	if (!strcmp(name, "byteorder"))
+		return eval_compile_byteorder(op, e);
+	if (!strcmp(name, "immediate"))
+		return eval_compile_immediate(ev, op, r, e);
+	if (!strcmp(name, "lookup"))
+		return eval_compile_lookup(ev, op, r, e);
+
+	errno = EOPNOTSUPP;
+	return -1;
+}
+
+static bool eval_expr_is_nop(const struct nftnl_expr *e)
+{
+	const char *name = nftnl_expr_get_str(e, NFTNL_EXPR_NAME);
+	uint32_t i;
+
+	for (i = 0; i < array_size(eval_nop_exprs); i++) {
+		if (!strcmp(name, eval_nop_exprs[i]))
+			return true;
+	}
+	return false;
+}
+
+static int eval_rule_compile(struct nftnl_eval *ev, struct eval_rule *er,
+			     const struct nftnl_rule *r)
+{
+	struct nftnl_expr *e;
+	uint32_t num = 0;
+
+	er->handle = r->handle;
+	er->id = ev->num_rules++;
+
+	list_for_each_entry(e, &r->expr_list, head)
+		num++;
+
+	er->ops = calloc(num ? num : 1, sizeof(struct eval_op));
+	if (er->ops == NULL)
+		return -1;
+
+	list_for_each_entry(e, &r->expr_list, head) {
+		if (eval_expr_is_nop(e))
+			continue;
+		if (eval_compile_expr(ev, &er->ops[er->num_ops], r, e) < 0)
+			return -1;
+		er->num_ops++;
+	}
+	return 0;
+}
+
+static int eval_index_chains(struct nftnl_eval *ev,
+			     const struct nftnl_chain_list *chains,
+			     const struct nftnl_rule_list *rules)
+{
+	struct nftnl_chain_list_iter citer;
+	struct nftnl_rule_list_iter riter;
+	struct nftnl_eval_chain *c;
+	struct nftnl_chain *chain;
+	struct nftnl_rule *r;
+	uint32_t num = 0, i;
+
+	if (chains) {
+		nftnl_chain_list_iter_init(&citer, chains);
+		while (nftnl_chain_list_iter_next(&citer))
+			num++;
+	}
+	if (rules) {
+		nftnl_rule_list_iter_init(&riter, rules);
+		while (nftnl_rule_list_iter_next(&riter))
+			num++;
+	}
+
+	/* rules may belong to chains that are not in the chain list */
+	ev->chains = calloc(num ? num : 1, sizeof(struct nftnl_eval_chain));
+	ev->chain_mask = eval_buckets(num) - 1;
+	ev->chain_buckets = calloc(ev->chain_mask + 1,
+				   sizeof(struct nftnl_eval_chain *));
+	if (ev->chains == NULL || ev->chain_buckets == NULL)
+		return -1;
+
+	if (chains) {
+		nftnl_chain_list_iter_init(&citer, chains);
+		while ((chain = nftnl_chain_list_iter_next(&citer))) {
+			if (!nftnl_chain_is_set(chain, NFTNL_CHAIN_TABLE) ||
+			    !nftnl_chain_is_set(chain, NFTNL_CHAIN_NAME)) {
+				errno = EINVAL;
+				return -1;
+			}
+
+			c = eval_chain_add(ev,
+				nftnl_chain_get_u32(chain, NFTNL_CHAIN_FAMILY),
+				nftnl_chain_get_str(chain, NFTNL_CHAIN_TABLE),
+				nftnl_chain_get_str(chain, NFTNL_CHAIN_NAME));
+			if (nftnl_chain_is_set(chain, NFTNL_CHAIN_POLICY))
+				c->policy = nftnl_chain_get_u32(chain,
+							NFTNL_CHAIN_POLICY);
+		}
+	}
+
+	if (rules) {
+		nftnl_rule_list_iter_init(&riter, rules);
+		while ((r = nftnl_rule_list_iter_next(&riter))) {
+			if (r->table == NULL || r->chain == NULL) {
+				errno = EINVAL;
+				return -1;
+			}
+			c = eval_chain_add(ev, r->family, r->table, r->chain);
+			c->num_rules++;
+		}
+	}
+
+	for (i = 0; i < ev->num_chains; i++) {
+		c = &ev->chains[i];
+		c->rules = calloc(c->num_rules ? c->num_rules : 1,
+				  sizeof(struct eval_rule));
+		if (c->rules == NULL)
+			return -1;
+		c->num_rules = 0;
+	}
+	return 0;
+}
+
+static int eval_compile_rules(struct nftnl_eval *ev,
+			      const struct nftnl_rule_list *rules)
+{
+	struct nftnl_rule_list_iter iter;
+	struct nftnl_eval_chain *c;
+	struct nftnl_rule *r;
+
+	if (rules == NULL)
+		return 0;
+
+	nftnl_rule_list_iter_init(&iter, rules);
+	while ((r = nftnl_rule_list_iter_next(&iter))) {
+		c = nftnl_eval_chain_lookup(ev, r->family, r->table, r->chain);
+		if (eval_rule_compile(ev, &c->rules[c->num_rules++], r) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int eval_compile_sets(struct nftnl_eval *ev,
+			     const struct nftnl_set_list *sets)
+{
+	struct nftnl_set_list_iter iter;
+	struct eval_set *es;
+	struct nftnl_set *s;
+	uint32_t num = 0;
+
+	if (sets) {
+		nftnl_set_list_iter_init(&iter, sets);
+		while (nftnl_set_list_iter_next(&iter))
+			num++;
+	}
+
+	ev->sets = calloc(num ? num : 1, sizeof(struct eval_set));
+	ev->set_mask = eval_buckets(num) - 1;
+	ev->set_buckets = calloc(ev->set_mask + 1, sizeof(struct eval_set *));
+	if (ev->sets == NULL || ev->set_buckets == NULL)
+		return -1;
+
+	if (sets == NULL)
+		return 0;
+
+	nftnl_set_list_iter_init(&iter, sets);
+	while ((s = nftnl_set_list_iter_next(&iter))) {
+		if (s->table == NULL || s->name == NULL) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		es = &ev->sets[ev->num_sets++];
+		if (eval_set_compile(ev, es, s) < 0)
+			return -1;
+
+		es->hash = eval_key_hash(es->family, es->table, es->name);
+		es->next = ev->set_buckets[es->hash & ev->set_mask];
+		ev->set_buckets[es->hash & ev->set_mask] = es;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_eval_alloc);
+struct nftnl_eval *nftnl_eval_alloc(const struct nftnl_ruleset *rs)
+{
+	struct nftnl_rule_list *rules;
+	struct nftnl_eval *ev;
+
+	ev = calloc(1, sizeof(struct nftnl_eval));
+	if (ev == NULL)
+		return NULL;
+
+	rules = nftnl_ruleset_get(rs, NFTNL_RULESET_RULELIST);
+
+	/* jumps in set elements and rules refer to chains, rules to sets */
+	if (eval_index_chains(ev, nftnl_ruleset_get(rs, NFTNL_RULESET_CHAINLIST),
+			      rules) < 0 ||
+	    eval_compile_sets(ev, nftnl_ruleset_get(rs, NFTNL_RULESET_SETLIST)) < 0 ||
+	    eval_compile_rules(ev, rules) < 0)
+		goto err;
+
+	return ev;
+err:
+	nftnl_eval_free(ev);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_eval_free);
+void nftnl_eval_free(struct nftnl_eval *ev)
+{
+	struct nftnl_eval_chain *c;
+	uint32_t i, j;
+
+	for (i = 0; ev->chains && i < ev->num_chains; i++) {
+		c = &ev->chains[i];
+		for (j = 0; c->rules && j < c->num_rules; j++)
+			xfree(c->rules[j].ops);
+		xfree(c->rules);
+	}
+	for (i = 0; ev->sets && i < ev->num_sets; i++) {
+		xfree(ev->sets[i].elems);
+		xfree(ev->sets[i].buckets);
+	}
+
+	xfree(ev->chains);
+	xfree(ev->chain_buckets);
+	xfree(ev->sets);
+	xfree(ev->set_buckets);
+	xfree(ev);
+}
+
+/* Walk IPv6 extension headers up to the transport header. */
+static void eval_pkt_ipv6(struct eval_pkt *p)
+{
+	uint32_t off = p->nhoff + 40;
+	uint8_t next = p->data[p->nhoff + 6];
+	const uint8_t *h;
+
+	for (;;) {
+		switch (next) {
+		case IPPROTO_HOPOPTS:
+		case IPPROTO_ROUTING:
+		case IPPROTO_DSTOPTS:
+			if (off + 8 > p->len)
+				return;
+			h = p->data + off;
+			next = h[0];
+			off += (h[1] + 1) * 8;
+			continue;
+		case IPPROTO_FRAGMENT:
+			if (off + 8 > p->len)
+				return;
+			h = p->data + off;
+			/* only the first fragment has a transport header */
+			if ((h[2] << 8 | h[3]) & ~0x7)
+				return;
+			next = h[0];
+			off += 8;
+			continue;
+		}
+		break;
+	}
+
+	p->l4proto = next;
+	p->thoff = off;
+	p->l4 = true;
+}
+
+void eval_pkt_init(struct eval_pkt *p, const struct nftnl_eval_pkt *pkt)
+{
+	const uint8_t *nh;
+
+	memset(p, 0, sizeof(*p));
+	p->data = pkt->data;
+	p->len = pkt->len;
+	p->nhoff = pkt->nhoff;
+	p->ll = pkt->nhoff != 0;
+	p->mark = pkt->mark;
+	p->iif = pkt->iif;
+	p->oif = pkt->oif;
+	p->ct_state = pkt->ct_state;
+
+	if (p->nhoff >= p->len)
+		return;
+
+	nh = p->data + p->nhoff;
+	switch (nh[0] >> 4) {
+	case 4:
+		if (p->nhoff + 20 > p->len)
+			return;
+		p->nfproto = NFPROTO_IPV4;
+		p->protocol = htons(0x0800);
+		p->l4proto = nh[9];
+		p->thoff = p->nhoff + (nh[0] & 0xf) * 4;
+		/* no transport header in later fragments */
+		p->l4 = !((nh[6] << 8 | nh[7]) & 0x1fff);
+		break;
+	case 6:
+		if (p->nhoff + 40 > p->len)
+			return;
+		p->nfproto = NFPROTO_IPV6;
+		p->protocol = htons(0x86dd);
+		eval_pkt_ipv6(p);
+		break;
+	default:
+		return;
+	}
+
+	if (pkt->thoff) {
+		p->thoff = pkt->thoff;
+		p->l4 = true;
+	}
+}
+
+static void eval_reg_store8(uint32_t *dreg, uint8_t val)
+{
+	*dreg = 0;
+	*(uint8_t *)dreg = val;
+}
+
+static void eval_reg_store16(uint32_t *dreg, uint16_t val)
+{
+	*dreg = 0;
+	memcpy(dreg, &val, sizeof(val));
+}
+
+bool eval_payload_offset(const struct eval_op *op, const struct eval_pkt *p,
+			 uint32_t *off)
+{
+	switch (op->op) {
+	case NFT_PAYLOAD_LL_HEADER:
+		if (!p->ll)
+			return false;
+		*off = 0;
+		break;
+	case NFT_PAYLOAD_NETWORK_HEADER:
+		*off = p->nhoff;
+		break;
+	case NFT_PAYLOAD_TRANSPORT_HEADER:
+		if (!p->l4)
+			return false;
+		*off = p->thoff;
+		break;
+	default:
+		return false;
+	}
+
+	*off += op->arg;
+	return *off <= p->len && op->len <= p->len - *off;
+}
+
+static bool eval_payload(const struct eval_op *op, uint32_t *dest,
+			 const struct eval_pkt *p)
+{
+	uint32_t off;
+
+	if (!eval_payload_offset(op, p, &off))
+		return false;
+
+	if (op->len % NFT_REG32_SIZE)
+		dest[op->len / NFT_REG32_SIZE] = 0;
+	memcpy(dest, p->data + off, op->len);
+	return true;
+}
+
+static bool eval_meta(const struct eval_op *op, uint32_t *dest,
+		      const struct eval_pkt *p)
+{
+	switch (op->arg) {
+	case NFT_META_LEN:
+		*dest = p->len - p->nhoff;
+		break;
+	case NFT_META_PROTOCOL:
+		eval_reg_store16(dest, p->protocol);
+		break;
+	case NFT_META_NFPROTO:
+		eval_reg_store8(dest, p->nfproto);
+		break;
+	case NFT_META_L4PROTO:
+		if (!p->l4)
+			return false;
+		eval_reg_store8(dest, p->l4proto);
+		break;
+	case NFT_META_MARK:
+		*dest = p->mark;
+		break;
+	case NFT_META_IIF:
+		*dest = p->iif;
+		break;
+	case NFT_META_OIF:
+		*dest = p->oif;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static bool eval_cmp(uint32_t op, int d)
+{
+	switch (op) {
+	case NFT_CMP_EQ:
+		return d == 0;
+	case NFT_CMP_NEQ:
+		return d != 0;
+	case NFT_CMP_LT:
+		return d < 0;
+	case NFT_CMP_LTE:
+		return d <= 0;
+	case NFT_CMP_GT:
+		return d > 0;
+	case NFT_CMP_GTE:
+		return d >= 0;
+	}
+	return false;
+}
+
+static void eval_bitwise(const struct eval_op *op, uint32_t *dst,
+			 const uint32_t *src)
+{
+	uint32_t n = div_round_up(op->len, NFT_REG32_SIZE);
+	uint32_t shift = op->data[0], carry = 0, val, i;
+
+	switch (op->op) {
+	case NFT_BITWISE_BOOL:
+		for (i = 0; i < n; i++)
+			dst[i] = (src[i] & op->data[i]) ^ op->data2[i];
+		break;
+	case NFT_BITWISE_LSHIFT:
+		for (i = n; i > 0; i--) {
+			val = src[i - 1];
+			dst[i - 1] = val << shift | carry;
+			carry = shift ? val >> (32 - shift) : 0;
+		}
+		break;
+	case NFT_BITWISE_RSHIFT:
+		for (i = 0; i < n; i++) {
+			val = src[i];
+			dst[i] = carry | val >> shift;
+			carry = shift ? val << (32 - shift) : 0;
+		}
+		break;
+	}
+}
+
+/* Both directions swap bytes on little endian hosts, none on big endian. */
+static void eval_byteorder(const struct eval_op *op, uint32_t *dst,
+			   const uint32_t *src)
+{
+	uint64_t v64;
+	uint16_t v16;
+	uint32_t i;
+
+	switch (op->arg) {
+	case 8:
+		for (i = 0; i < op->len / 8; i++) {
+			memcpy(&v64, &src[i * 2], sizeof(v64));
+			v64 = be64toh(v64);
+			memcpy(&dst[i * 2], &v64, sizeof(v64));
+		}
+		break;
+	case 4:
+		for (i = 0; i < op->len / 4; i++)
+			dst[i] = ntohl(src[i]);
+		break;
+	case 2:
+		/* one 16-bit value per register word, as in the kernel */
+		for (i = 0; i < op->len / 2; i++) {
+			memcpy(&v16, &src[i], sizeof(v16));
+			eval_reg_store16(&dst[i], ntohs(v16));
+		}
+		break;
+	}
+}
+
+static bool eval_lookup(const struct eval_op *op, uint32_t *regs,
+			struct eval_verdict *v)
+{
+	const struct eval_set *s = op->set;
+	const struct eval_elem *e;
+
+	e = eval_set_find(s, (const uint8_t *)&regs[op->sreg]);
+	if (op->arg & NFT_LOOKUP_F_INV)
+		return e == NULL;
+	if (e == NULL)
+		return false;
+
+	if (!s->map || !e->has_data)
+		return true;
+
+	if (s->verdict_map) {
+		v->code = e->verdict;
+		v->chain = e->chain;
+	} else {
+		if (s->data_len % NFT_REG32_SIZE)
+			regs[op->dreg + s->data_len / NFT_REG32_SIZE] = 0;
+		memcpy(&regs[op->dreg], e->data, s->data_len);
+	}
+	return true;
+}
+
+void eval_op_run(const struct eval_op *op, uint32_t *regs,
+		 struct eval_verdict *v, struct eval_pkt *p)
+{
+	const uint32_t *src = &regs[op->sreg];
+	uint32_t *dst = &regs[op->dreg];
+	bool match = true;
+
+	switch (op->type) {
+	case EVAL_OP_PAYLOAD:
+		match = eval_payload(op, dst, p);
+		break;
+	case EVAL_OP_META:
+		match = eval_meta(op, dst, p);
+		break;
+	case EVAL_OP_META_SET:
+		p->mark = *src;
+		break;
+	case EVAL_OP_CT_STATE:
+		*dst = p->ct_state;
+		break;
+	case EVAL_OP_CMP:
+		match = eval_cmp(op->op, memcmp(src, op->data, op->len));
+		break;
+	case EVAL_OP_RANGE:
+		match = memcmp(src, op->data, op->len) >= 0 &&
+			memcmp(src, op->data2, op->len) <= 0;
+		if (op->op == NFT_RANGE_NEQ)
+			match = !match;
+		break;
+	case EVAL_OP_BITWISE:
+		eval_bitwise(op, dst, src);
+		break;
+	case EVAL_OP_BYTEORDER:
+		eval_byteorder(op, dst, src);
+		break;
+	case EVAL_OP_IMMEDIATE:
+		if (op->len % NFT_REG32_SIZE)
+			dst[op->len / NFT_REG32_SIZE] = 0;
+		memcpy(dst, op->data, op->len);
+		break;
+	case EVAL_OP_VERDICT:
+		v->code = op->verdict;
+		v->chain = op->chain;
+		break;
+	case EVAL_OP_LOOKUP:
+		match = eval_lookup(op, regs, v);
+		break;
+	}
+
+	if (!match)
+		v->code = NFT_BREAK;
+}
+
+static void eval_count(struct eval_counters *cnt, const struct eval_rule *r,
+		       uint32_t num_ops, int32_t code)
+{
+	uint32_t i;
+
+	cnt->rules[r->id].evals++;
+	cnt->cost.rules++;
+	cnt->cost.exprs += num_ops;
+	for (i = 0; i < num_ops; i++) {
+		if (r->ops[i].type == EVAL_OP_LOOKUP)
+			cnt->cost.lookups++;
+	}
+
+	if (code == NFT_CONTINUE || code == NFT_BREAK)
+		return;
+
+	cnt->rules[r->id].hits++;
+	if (code == NFT_JUMP || code == NFT_GOTO)
+		cnt->cost.jumps++;
+}
+
+int eval_run(const struct nftnl_eval_chain *chain,
+	     const struct nftnl_eval_pkt *pkt, struct nftnl_eval_result *res,
+	     struct eval_counters *cnt)
+{
+	struct {
+		const struct nftnl_eval_chain	*chain;
+		uint32_t			rule;
+		uint32_t			level;
+	} stack[EVAL_JUMP_STACK_MAX];
+	const struct nftnl_eval_chain *c = chain;
+	uint32_t regs[EVAL_REGS] = {}, i = 0, j;
+	const struct eval_rule *r;
+	struct eval_verdict v;
+	uint32_t level = 0;
+	struct eval_pkt p;
+	int sp = 0;
+
+	eval_pkt_init(&p, pkt);
+do_chain:
+	for (; i < c->num_rules; i++) {
+		r = &c->rules[i];
+		v.code = NFT_CONTINUE;
+		for (j = 0; j < r->num_ops && v.code == NFT_CONTINUE; j++)
+			eval_op_run(&r->ops[j], regs, &v, &p);
+
+		if (cnt)
+			eval_count(cnt, r, j, v.code);
+
+		if (v.code == NFT_CONTINUE || v.code == NFT_BREAK)
+			continue;
+
+		switch (v.code) {
+		case NFT_JUMP:
+		case NFT_GOTO:
+			/* the kernel refuses rulesets that nest deeper */
+			if (level == EVAL_JUMP_STACK_MAX) {
+				errno = ELOOP;
+				return -1;
+			}
+			if (v.code == NFT_JUMP) {
+				stack[sp].chain = c;
+				stack[sp].rule = i + 1;
+				stack[sp].level = level;
+				sp++;
+			}
+			level++;
+			c = v.chain;
+			i = 0;
+			goto do_chain;
+		case NFT_RETURN:
+			break;
+		default:
+			/* queue verdicts carry the queue number above the mask */
+			res->verdict = v.code;
+			res->handle = r->handle;
+			res->chain = c->name;
+			res->mark = p.mark;
+			return 0;
+		}
+		break;
+	}
+
+	if (sp > 0) {
+		sp--;
+		c = stack[sp].chain;
+		i = stack[sp].rule;
+		level = stack[sp].level;
+		goto do_chain;
+	}
+
+	res->verdict = chain->policy;
+	res->handle = 0;
+	res->chain = chain->name;
+	res->mark = p.mark;
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_eval_run);
+int nftnl_eval_run(const struct nftnl_eval *ev,
+		   const struct nftnl_eval_chain *chain,
+		   const struct nftnl_eval_pkt *pkt,
+		   struct nftnl_eval_result *res)
+{
+	return eval_run(chain, pkt, res, NULL);
+}
@@ -0,0 +1,369 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "eval.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/eval.h>
+
+/*
+ * Batch evaluation: packets go through a chain in blocks of EVAL_BATCH lanes,
+ * one rule at a time. Registers are stored word by word across lanes so that
+ * compares and immediates on up to 32 bits are plain loops over all lanes,
+ * which the compiler turns into vector instructions. The lanes taking part
+ * in each step are a bitmask, operations without a lane-wise version run the
+ * scalar code on each lane that is still alive.
+ */
+
+#define EVAL_BATCH	64
+
+struct eval_batch {
+	uint32_t			regs[EVAL_REGS][EVAL_BATCH];
+	int32_t				code[EVAL_BATCH];
+	const struct nftnl_eval_chain	*chain[EVAL_BATCH];
+	struct eval_pkt			pkt[EVAL_BATCH];
+	struct nftnl_eval_result	*res;
+};
+
+static inline uint64_t lane_bit(uint32_t lane)
+{
+	return (uint64_t)1 << lane;
+}
+
+static inline uint32_t lane_first(uint64_t mask)
+{
+	return __builtin_ctzll(mask);
+}
+
+/* Bytes of the last register word that belong to a @len bytes value. */
+static uint32_t eval_tail_mask(uint32_t len)
+{
+	uint32_t mask = 0;
+
+	memset(&mask, 0xff, len % NFT_REG32_SIZE ? len % NFT_REG32_SIZE :
+						   NFT_REG32_SIZE);
+	return mask;
+}
+
+static void eval_batch_lane(struct eval_batch *b, const struct eval_op *op,
+			    uint32_t lane, uint64_t *live, uint64_t *verdict)
+{
+	struct eval_verdict v = { .code = NFT_CONTINUE };
+	uint32_t regs[EVAL_REGS], w;
+
+	for (w = 0; w < EVAL_REGS; w++)
+		regs[w] = b->regs[w][lane];
+
+	eval_op_run(op, regs, &v, &b->pkt[lane]);
+
+	for (w = 0; w < EVAL_REGS; w++)
+		b->regs[w][lane] = regs[w];
+
+	if (v.code == NFT_CONTINUE)
+		return;
+
+	*live &= ~lane_bit(lane);
+	if (v.code != NFT_BREAK) {
+		b->code[lane] = v.code;
+		b->chain[lane] = v.chain;
+		*verdict |= lane_bit(lane);
+	}
+}
+
+static void eval_batch_lanes(struct eval_batch *b, const struct eval_op *op,
+			     uint64_t *live, uint64_t *verdict)
+{
+	uint64_t m;
+
+	for (m = *live; m; m &= m - 1)
+		eval_batch_lane(b, op, lane_first(m), live, verdict);
+}
+
+static void eval_batch_payload(struct eval_batch *b, const struct eval_op *op,
+			       uint64_t *live)
+{
+	uint32_t words = div_round_up(op->len, NFT_REG32_SIZE);
+	uint32_t val[EVAL_DATA_WORDS], off, lane, w;
+	uint64_t m;
+
+	for (m = *live; m; m &= m - 1) {
+		lane = lane_first(m);
+		if (!eval_payload_offset(op, &b->pkt[lane], &off)) {
+			*live &= ~lane_bit(lane);
+			continue;
+		}
+
+		val[words - 1] = 0;
+		memcpy(val, b->pkt[lane].data + off, op->len);
+		for (w = 0; w < words; w++)
+			b->regs[op->dreg + w][lane] = val[w];
+	}
+}
+
+static inline bool eval_cmp_u32(uint32_t op, uint32_t a, uint32_t b)
+{
+	switch (op) {
+	case NFT_CMP_EQ:
+		return a == b;
+	case NFT_CMP_NEQ:
+		return a != b;
+	case NFT_CMP_LT:
+		return a < b;
+	case NFT_CMP_LTE:
+		return a <= b;
+	case NFT_CMP_GT:
+		return a > b;
+	case NFT_CMP_GTE:
+		return a >= b;
+	}
+	return false;
+}
+
+/*
+ * Values of up to 32 bits are compared as host order integers, the register
+ * holds them in network byte order. Longer values are only compared lane-wise
+ * for equality.
+ */
+static bool eval_batch_cmp(struct eval_batch *b, const struct eval_op *op,
+			   uint64_t *live)
+{
+	uint32_t words = div_round_up(op->len, NFT_REG32_SIZE);
+	uint32_t tail = eval_tail_mask(op->len), diff[EVAL_BATCH] = {};
+	const uint32_t *src = b->regs[op->sreg];
+	uint32_t i, w, mask, data;
+	uint64_t match = 0;
+
+	if (words == 1) {
+		data = ntohl(op->data[0] & tail);
+		for (i = 0; i < EVAL_BATCH; i++)
+			match |= (uint64_t)eval_cmp_u32(op->op,
+							ntohl(src[i] & tail),
+							data) << i;
+		*live &= match;
+		return true;
+	}
+
+	if (op->op != NFT_CMP_EQ && op->op != NFT_CMP_NEQ)
+		return false;
+
+	for (w = 0; w < words; w++) {
+		src = b->regs[op->sreg + w];
+		mask = w == words - 1 ? tail : ~0U;
+		data = op->data[w] & mask;
+		for (i = 0; i < EVAL_BATCH; i++)
+			diff[i] |= (src[i] & mask) ^ data;
+	}
+	for (i = 0; i < EVAL_BATCH; i++)
+		match |= (uint64_t)((diff[i] == 0) == (op->op == NFT_CMP_EQ)) << i;
+
+	*live &= match;
+	return true;
+}
+
+static bool eval_batch_range(struct eval_batch *b, const struct eval_op *op,
+			     uint64_t *live)
+{
+	uint32_t tail = eval_tail_mask(op->len), from, to, val, i;
+	const uint32_t *src = b->regs[op->sreg];
+	bool neq = op->op == NFT_RANGE_NEQ;
+	uint64_t match = 0;
+
+	if (op->len > NFT_REG32_SIZE)
+		return false;
+
+	from = ntohl(op->data[0] & tail);
+	to = ntohl(op->data2[0] & tail);
+	for (i = 0; i < EVAL_BATCH; i++) {
+		val = ntohl(src[i] & tail);
+		match |= (uint64_t)((val >= from && val <= to) != neq) << i;
+	}
+
+	*live &= match;
+	return true;
+}
+
+static void eval_batch_immediate(struct eval_batch *b,
+				 const struct eval_op *op, uint64_t live)
+{
+	uint32_t words = div_round_up(op->len, NFT_REG32_SIZE), i, w;
+	uint32_t *dst;
+
+	/* lanes waiting in other chains keep their registers */
+	for (w = 0; w < words; w++) {
+		dst = b->regs[op->dreg + w];
+		for (i = 0; i < EVAL_BATCH; i++)
+			dst[i] = live >> i & 1 ? op->data[w] : dst[i];
+	}
+}
+
+static void eval_batch_op(struct eval_batch *b, const struct eval_op *op,
+			  uint64_t *live, uint64_t *verdict)
+{
+	uint64_t m;
+
+	switch (op->type) {
+	case EVAL_OP_PAYLOAD:
+		eval_batch_payload(b, op, live);
+		return;
+	case EVAL_OP_CMP:
+		if (eval_batch_cmp(b, op, live))
+			return;
+		break;
+	case EVAL_OP_RANGE:
+		if (eval_batch_range(b, op, live))
+			return;
+		break;
+	case EVAL_OP_IMMEDIATE:
+		eval_batch_immediate(b, op, *live);
+		return;
+	case EVAL_OP_VERDICT:
+		/* as in eval_run(), continue goes on and break ends the rule */
+		if (op->verdict == NFT_CONTINUE)
+			return;
+		if (op->verdict == NFT_BREAK) {
+			*live = 0;
+			return;
+		}
+		for (m = *live; m; m &= m - 1) {
+			b->code[lane_first(m)] = op->verdict;
+			b->chain[lane_first(m)] = op->chain;
+		}
+		*verdict |= *live;
+		*live = 0;
+		return;
+	default:
+		break;
+	}
+
+	eval_batch_lanes(b, op, live, verdict);
+}
+
+/*
+ * Run the lanes in @mask through chain @c. Lanes that reach the end of the
+ * chain or return from it are left in *@back for the caller.
+ */
+static int eval_batch_chain(struct eval_batch *b,
+			    const struct nftnl_eval_chain *c, uint64_t mask,
+			    uint32_t level, uint64_t *back)
+{
+	const struct nftnl_eval_chain *target;
+	uint64_t live, verdict, returned = 0, sub, ret, m;
+	const struct eval_rule *r;
+	struct nftnl_eval_result *res;
+	uint32_t i, j, lane;
+	int32_t code;
+
+	for (i = 0; i < c->num_rules && mask; i++) {
+		r = &c->rules[i];
+		live = mask;
+		verdict = 0;
+		for (j = 0; j < r->num_ops && live; j++)
+			eval_batch_op(b, &r->ops[j], &live, &verdict);
+
+		while (verdict) {
+			lane = lane_first(verdict);
+			code = b->code[lane];
+
+			switch (code) {
+			case NFT_JUMP:
+			case NFT_GOTO:
+				if (level == EVAL_JUMP_STACK_MAX) {
+					errno = ELOOP;
+					return -1;
+				}
+
+				/* all lanes heading to the same chain at once */
+				target = b->chain[lane];
+				sub = 0;
+				for (m = verdict; m; m &= m - 1) {
+					if (b->code[lane_first(m)] == code &&
+					    b->chain[lane_first(m)] == target)
+						sub |= lane_bit(lane_first(m));
+				}
+				verdict &= ~sub;
+				mask &= ~sub;
+
+				if (eval_batch_chain(b, target, sub, level + 1,
+						     &ret) < 0)
+					return -1;
+
+				if (code == NFT_JUMP)
+					mask |= ret;
+				else
+					returned |= ret;
+				break;
+			case NFT_RETURN:
+				verdict &= ~lane_bit(lane);
+				mask &= ~lane_bit(lane);
+				returned |= lane_bit(lane);
+				break;
+			default:
+				res = &b->res[lane];
+				res->verdict = code;
+				res->handle = r->handle;
+				res->chain = c->name;
+				res->mark = b->pkt[lane].mark;
+				verdict &= ~lane_bit(lane);
+				mask &= ~lane_bit(lane);
+				break;
+			}
+		}
+	}
+
+	*back = returned | mask;
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_eval_run_batch);
+int nftnl_eval_run_batch(const struct nftnl_eval *ev,
+			 const struct nftnl_eval_chain *chain,
+			 const struct nftnl_eval_pkt *pkts, uint32_t num,
+			 struct nftnl_eval_result *res)
+{
+	struct nftnl_eval_result *r;
+	uint32_t i, n, lane;
+	struct eval_batch *b;
+	uint64_t mask, back;
+	int ret = 0;
+
+	b = malloc(sizeof(struct eval_batch));
+	if (b == NULL)
+		return -1;
+
+	for (i = 0; i < num; i += n) {
+		n = num - i < EVAL_BATCH ? num - i : EVAL_BATCH;
+		mask = n == EVAL_BATCH ? ~(uint64_t)0 : lane_bit(n) - 1;
+
+		memset(b->regs, 0, sizeof(b->regs));
+		for (lane = 0; lane < n; lane++)
+			eval_pkt_init(&b->pkt[lane], &pkts[i + lane]);
+		b->res = res + i;
+
+		ret = eval_batch_chain(b, chain, mask, 0, &back);
+		if (ret < 0)
+			break;
+
+		/* the base chain policy applies to what is left */
+		for (; back; back &= back - 1) {
+			lane = lane_first(back);
+			r = &b->res[lane];
+			r->verdict = chain->policy;
+			r->handle = 0;
+			r->chain = chain->name;
+			r->mark = b->pkt[lane].mark;
+		}
+	}
+
+	xfree(b);
+	return ret;
+}
@@ -0,0 +1,309 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "eval.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/eval.h>
+
+/*
+ * A rule is flagged as hot and late when at least this many rules come
+ * before it and the packets it matches spend at least a tenth of the rule
+ * evaluations of its chain on the way there.
+ */
+#define EVAL_LATE_POSITION	8
+#define EVAL_HOT_SHARE		10
+
+struct nftnl_eval_profile {
+	const struct nftnl_eval	*ev;
+	uint64_t		packets;
+	struct eval_counters	cnt;
+};
+
+/*
+ * Chains reached over several paths are costed once per call, as a cost
+ * that includes the chains they jump to, and how deep those jumps nest.
+ */
+#define EVAL_COST_BUCKETS	256
+
+struct eval_memo {
+	struct eval_memo		*next;
+	const struct nftnl_eval_chain	*chain;
+	struct nftnl_eval_cost		cost;
+	uint32_t			depth;
+};
+
+static void eval_cost_add(struct nftnl_eval_cost *to,
+			  const struct nftnl_eval_cost *from)
+{
+	to->rules += from->rules;
+	to->exprs += from->exprs;
+	to->lookups += from->lookups;
+	to->jumps += from->jumps;
+}
+
+static const struct eval_memo *eval_chain_cost(struct eval_memo **memo,
+					       const struct nftnl_eval_chain *c,
+					       uint32_t level)
+{
+	uint32_t bucket = c->hash % EVAL_COST_BUCKETS, i, j;
+	const struct eval_memo *sub;
+	struct eval_memo *m;
+	const struct eval_op *op;
+
+	for (m = memo[bucket]; m; m = m->next) {
+		if (m->chain != c)
+			continue;
+
+		if (level + m->depth > EVAL_JUMP_STACK_MAX) {
+			errno = ELOOP;
+			return NULL;
+		}
+		return m;
+	}
+
+	m = calloc(1, sizeof(struct eval_memo));
+	if (m == NULL)
+		return NULL;
+	m->chain = c;
+
+	for (i = 0; i < c->num_rules; i++) {
+		m->cost.rules++;
+		for (j = 0; j < c->rules[i].num_ops; j++) {
+			op = &c->rules[i].ops[j];
+			m->cost.exprs++;
+
+			if (op->type == EVAL_OP_LOOKUP)
+				m->cost.lookups++;
+			if (op->type != EVAL_OP_VERDICT || op->chain == NULL)
+				continue;
+
+			/* chains still being costed are not known yet */
+			if (level == EVAL_JUMP_STACK_MAX) {
+				errno = ELOOP;
+				goto err;
+			}
+			m->cost.jumps++;
+			sub = eval_chain_cost(memo, op->chain, level + 1);
+			if (sub == NULL)
+				goto err;
+
+			eval_cost_add(&m->cost, &sub->cost);
+			if (sub->depth + 1 > m->depth)
+				m->depth = sub->depth + 1;
+		}
+	}
+
+	m->next = memo[bucket];
+	memo[bucket] = m;
+	return m;
+err:
+	xfree(m);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_eval_chain_cost);
+int nftnl_eval_chain_cost(const struct nftnl_eval_chain *chain,
+			  struct nftnl_eval_cost *cost)
+{
+	struct eval_memo **memo, *m, *next;
+	const struct eval_memo *res;
+	uint32_t i;
+
+	memo = calloc(EVAL_COST_BUCKETS, sizeof(struct eval_memo *));
+	if (memo == NULL)
+		return -1;
+
+	memset(cost, 0, sizeof(*cost));
+	res = eval_chain_cost(memo, chain, 0);
+	if (res)
+		*cost = res->cost;
+
+	for (i = 0; i < EVAL_COST_BUCKETS; i++) {
+		for (m = memo[i]; m; m = next) {
+			next = m->next;
+			xfree(m);
+		}
+	}
+	xfree(memo);
+
+	return res ? 0 : -1;
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_alloc);
+struct nftnl_eval_profile *nftnl_eval_profile_alloc(const struct nftnl_eval *ev)
+{
+	struct nftnl_eval_profile *prof;
+
+	prof = calloc(1, sizeof(struct nftnl_eval_profile));
+	if (prof == NULL)
+		return NULL;
+
+	prof->cnt.rules = calloc(ev->num_rules ? ev->num_rules : 1,
+				 sizeof(struct eval_rule_count));
+	if (prof->cnt.rules == NULL) {
+		xfree(prof);
+		return NULL;
+	}
+	prof->ev = ev;
+
+	return prof;
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_free);
+void nftnl_eval_profile_free(struct nftnl_eval_profile *prof)
+{
+	xfree(prof->cnt.rules);
+	xfree(prof);
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_run);
+int nftnl_eval_profile_run(struct nftnl_eval_profile *prof,
+			   const struct nftnl_eval_chain *chain,
+			   const struct nftnl_eval_pkt *pkts, uint32_t num)
+{
+	struct nftnl_eval_result res;
+	uint32_t i;
+
+	for (i = 0; i < num; i++) {
+		if (eval_run(chain, &pkts[i], &res, &prof->cnt) < 0)
+			return -1;
+		prof->packets++;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_cost);
+uint64_t nftnl_eval_profile_cost(const struct nftnl_eval_profile *prof,
+				 struct nftnl_eval_cost *cost)
+{
+	*cost = prof->cnt.cost;
+	return prof->packets;
+}
+
+static void eval_chain_stats(const struct nftnl_eval_profile *prof,
+			     const struct nftnl_eval_chain *c, uint32_t i,
+			     uint64_t chain_evals,
+			     struct nftnl_eval_rule_stats *st)
+{
+	const struct eval_rule_count *rc = &prof->cnt.rules[c->rules[i].id];
+
+	memset(st, 0, sizeof(*st));
+	st->table = c->table;
+	st->chain = c->name;
+	st->handle = c->rules[i].handle;
+	st->position = i;
+	st->chain_rules = c->num_rules;
+	st->evals = rc->evals;
+	st->hits = rc->hits;
+
+	if (st->hits && i >= EVAL_LATE_POSITION &&
+	    st->hits * i * EVAL_HOT_SHARE >= chain_evals)
+		st->flags |= NFTNL_EVAL_RULE_F_HOT_LATE;
+}
+
+static uint64_t eval_chain_evals(const struct nftnl_eval_profile *prof,
+				 const struct nftnl_eval_chain *c)
+{
+	uint64_t evals = 0;
+	uint32_t i;
+
+	for (i = 0; i < c->num_rules; i++)
+		evals += prof->cnt.rules[c->rules[i].id].evals;
+
+	return evals;
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_foreach);
+int nftnl_eval_profile_foreach(const struct nftnl_eval_profile *prof,
+			       int (*cb)(const struct nftnl_eval_rule_stats *st,
+					 void *data),
+			       void *data)
+{
+	const struct nftnl_eval *ev = prof->ev;
+	struct nftnl_eval_rule_stats st;
+	const struct nftnl_eval_chain *c;
+	uint64_t chain_evals;
+	uint32_t i, j;
+	int ret;
+
+	for (i = 0; i < ev->num_chains; i++) {
+		c = &ev->chains[i];
+		chain_evals = eval_chain_evals(prof, c);
+
+		for (j = 0; j < c->num_rules; j++) {
+			eval_chain_stats(prof, c, j, chain_evals, &st);
+			ret = cb(&st, data);
+			if (ret < 0)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static double eval_per_packet(uint64_t val, uint64_t packets)
+{
+	return packets ? (double)val / packets : 0;
+}
+
+EXPORT_SYMBOL(nftnl_eval_profile_snprintf);
+int nftnl_eval_profile_snprintf(char *buf, size_t size,
+				const struct nftnl_eval_profile *prof)
+{
+	const struct nftnl_eval *ev = prof->ev;
+	const struct nftnl_eval_cost *cost = &prof->cnt.cost;
+	int ret, remain = size, offset = 0;
+	struct nftnl_eval_rule_stats st;
+	const struct nftnl_eval_chain *c;
+	uint64_t chain_evals;
+	uint32_t i, j;
+
+	ret = snprintf(buf, remain,
+		       "packets %" PRIu64 " per packet: rules %.2f exprs %.2f "
+		       "lookups %.2f jumps %.2f\n", prof->packets,
+		       eval_per_packet(cost->rules, prof->packets),
+		       eval_per_packet(cost->exprs, prof->packets),
+		       eval_per_packet(cost->lookups, prof->packets),
+		       eval_per_packet(cost->jumps, prof->packets));
+	SNPRINTF_BUFFER_SIZE(ret, remain, offset);
+
+	for (i = 0; i < ev->num_chains; i++) {
+		c = &ev->chains[i];
+		chain_evals = eval_chain_evals(prof, c);
+		if (chain_evals == 0)
+			continue;
+
+		ret = snprintf(buf + offset, remain,
+			       "table %s chain %s rules %u evals %" PRIu64 "\n",
+			       c->table, c->name, c->num_rules, chain_evals);
+		SNPRINTF_BUFFER_SIZE(ret, remain, offset);
+
+		for (j = 0; j < c->num_rules; j++) {
+			eval_chain_stats(prof, c, j, chain_evals, &st);
+			if (st.hits == 0)
+				continue;
+
+			ret = snprintf(buf + offset, remain,
+				       "  handle %" PRIu64 " position %u "
+				       "evals %" PRIu64 " hits %" PRIu64 "%s\n",
+				       st.handle, st.position, st.evals,
+				       st.hits,
+				       st.flags & NFTNL_EVAL_RULE_F_HOT_LATE ?
+				       " hot-late" : "");
+			SNPRINTF_BUFFER_SIZE(ret, remain, offset);
+		}
+	}
+
+	return offset;
+}
@@ -24,37 +24,221 @@
 
 #include <libnftnl/expr.h>
 
+uint32_t nftnl_expr_size(const struct expr_ops *ops)
+{
+	return (sizeof(struct nftnl_expr) + ops->alloc_len + 7) & ~7;
+}
+
+static struct nftnl_expr *nftnl_expr_init(struct nftnl_expr *expr,
+					  struct expr_ops *ops)
+{
+	/* Manually set expression name attribute */
+	expr->flags |= (1 << NFTNL_EXPR_NAME);
+	expr->ops = ops;
+	expr->data = expr->inline_data;
+
+	if (ops->init)
+		ops->init(expr);
+
+	return expr;
+}
+
+static struct nftnl_expr *nftnl_expr_node_alloc(const struct expr_ops *ops,
+						 uint32_t id)
+{
+	if (nftnl_expr_pool_enabled())
+		return nftnl_expr_pool_get(ops, id);
+
+	return calloc(1, sizeof(struct nftnl_expr) + ops->alloc_len);
+}
+
 EXPORT_SYMBOL(nftnl_expr_alloc);
 struct nftnl_expr *nftnl_expr_alloc(const char *name)
 {
 	struct nftnl_expr *expr;
 	struct expr_ops *ops;
+	uint32_t id;
 
-	ops = nftnl_expr_ops_lookup(name);
+	ops = nftnl_expr_ops_lookup_id(name, &id);
 	if (ops == NULL)
 		return NULL;
 
-	expr = calloc(1, sizeof(struct nftnl_expr) + ops->alloc_len);
+	expr = nftnl_expr_node_alloc(ops, id);
 	if (expr == NULL)
 		return NULL;
 
-	/* Manually set expression name attribute */
-	expr->flags |= (1 << NFTNL_EXPR_NAME);
-	expr->ops = ops;
+	return nftnl_expr_init(expr, ops);
+}
 
-	if (ops->init)
-		ops->init(expr);
+struct nftnl_expr_block *nftnl_expr_block_alloc(uint32_t size)
+{
+	struct nftnl_expr_block *block;
 
-	return expr;
+	block = calloc(1, sizeof(struct nftnl_expr_block) + size);
+	if (block == NULL)
+		return NULL;
+
+	block->refcnt = 1;
+	block->size = size;
+
+	return block;
+}
+
+void nftnl_expr_block_put(struct nftnl_expr_block *block)
+{
+	if (--block->refcnt == 0)
+		xfree(block);
+}
+
+static struct nftnl_expr *nftnl_expr_block_get(struct nftnl_expr_block *block,
+					       struct expr_ops *ops)
+{
+	uint32_t size = nftnl_expr_size(ops);
+	struct nftnl_expr *expr;
+
+	if (block->used + size > block->size)
+		return NULL;
+
+	expr = (struct nftnl_expr *)(block->data + block->used);
+	block->used += size;
+	block->refcnt++;
+	expr->block = block;
+
+	return nftnl_expr_init(expr, ops);
+}
+
+static void nftnl_expr_release(const struct nftnl_expr *expr)
+{
+	xfree(expr->wire.data);
+
+	if (expr->block)
+		nftnl_expr_block_put(expr->block);
+	else if (expr->pool)
+		nftnl_expr_pool_put((struct nftnl_expr *)expr);
+	else
+		xfree(expr);
+}
+
+/* Drop a reference to the shared data @expr points to. */
+static void nftnl_expr_shared_put(const struct nftnl_expr *expr)
+{
+	struct nftnl_expr_shared *shared = expr->shared;
+
+	if (__atomic_sub_fetch(&shared->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	if (expr->ops->free)
+		expr->ops->free(expr);
+	xfree(shared);
+}
+
+/* Move the data of @expr out of line so that clones can refer to it. */
+static int nftnl_expr_share(struct nftnl_expr *expr)
+{
+	struct nftnl_expr_shared *shared;
+
+	if (expr->shared)
+		return 0;
+
+	shared = malloc(sizeof(*shared) + expr->ops->alloc_len);
+	if (shared == NULL)
+		return -1;
+
+	shared->refcnt = 1;
+	memcpy(shared->data, expr->data, expr->ops->alloc_len);
+	expr->shared = shared;
+	expr->data = shared->data;
+
+	return 0;
+}
+
+/* Give @expr a private copy of its data before it is modified. */
+static int nftnl_expr_unshare(struct nftnl_expr *expr)
+{
+	struct nftnl_expr_shared *shared = expr->shared;
+	struct nftnl_expr view = {
+		.flags	= expr->flags,
+		.ops	= expr->ops,
+		.shared	= shared,
+		.data	= shared->data,
+	};
+
+	memcpy(expr->inline_data, shared->data, expr->ops->alloc_len);
+	expr->data = expr->inline_data;
+	expr->shared = NULL;
+
+	/* Sole owner, the pointers in the data move over as they are. */
+	if (__atomic_load_n(&shared->refcnt, __ATOMIC_ACQUIRE) == 1) {
+		xfree(shared);
+		return 0;
+	}
+
+	if (expr->ops->clone && expr->ops->clone(expr, &view) < 0) {
+		if (expr->ops->free)
+			expr->ops->free(expr);
+		expr->flags = view.flags;
+		expr->data = shared->data;
+		expr->shared = shared;
+		return -1;
+	}
+
+	nftnl_expr_shared_put(&view);
+	return 0;
 }
 
 EXPORT_SYMBOL(nftnl_expr_free);
 void nftnl_expr_free(const struct nftnl_expr *expr)
 {
-	if (expr->ops->free)
+	if (expr->shared)
+		nftnl_expr_shared_put(expr);
+	else if (expr->ops->free)
 		expr->ops->free(expr);
 
-	xfree(expr);
+	nftnl_expr_release(expr);
+}
+
+EXPORT_SYMBOL(nftnl_expr_clone);
+struct nftnl_expr *nftnl_expr_clone(const struct nftnl_expr *src,
+				    uint32_t flags)
+{
+	struct nftnl_expr *orig = (struct nftnl_expr *)src;
+	struct nftnl_expr *expr;
+	struct expr_ops *ops;
+	uint32_t id;
+
+	ops = nftnl_expr_ops_lookup_id(src->ops->name, &id);
+	if (ops == NULL)
+		return NULL;
+
+	expr = nftnl_expr_node_alloc(ops, id);
+	if (expr == NULL)
+		return NULL;
+
+	expr->flags = src->flags;
+	expr->ops = ops;
+	expr->data = expr->inline_data;
+	expr->wire_cache = src->wire_cache;
+	if (src->wire.data)
+		nftnl_wire_save(&expr->wire, src->wire.data, src->wire.len);
+
+	if ((flags & NFTNL_CLONE_F_COW) && !ops->nested) {
+		if (nftnl_expr_share(orig) < 0) {
+			nftnl_expr_release(expr);
+			return NULL;
+		}
+		__atomic_add_fetch(&orig->shared->refcnt, 1, __ATOMIC_RELAXED);
+		expr->shared = orig->shared;
+		expr->data = orig->shared->data;
+		return expr;
+	}
+
+	memcpy(expr->data, src->data, ops->alloc_len);
+	if (ops->clone && ops->clone(expr, src) < 0) {
+		nftnl_expr_free(expr);
+		return NULL;
+	}
+
+	return expr;
 }
 
 EXPORT_SYMBOL(nftnl_expr_is_set);
@@ -71,10 +255,13 @@ int nftnl_expr_set(struct nftnl_expr *expr, uint16_t type,
 	case NFTNL_EXPR_NAME:	/* cannot be modified */
 		return 0;
 	default:
+		if (expr->shared && nftnl_expr_unshare(expr) < 0)
+			return -1;
 		if (expr->ops->set(expr, type, data, data_len) < 0)
 			return -1;
 	}
 	expr->flags |= (1 << type);
+	nftnl_expr_wire_invalidate(expr);
 	return 0;
 }
 
@@ -206,19 +393,95 @@ const char *nftnl_expr_get_str(const struct nftnl_expr *expr, uint16_t type)
 	return (const char *)nftnl_expr_get(expr, type, &data_len);
 }
 
+EXPORT_SYMBOL(nftnl_expr_cmp);
+bool nftnl_expr_cmp(const struct nftnl_expr *e1, const struct nftnl_expr *e2)
+{
+	uint32_t mask;
+
+	if (e1->ops != e2->ops)
+		return false;
+
+	mask = ~e1->ops->state_attrs;
+	if ((e1->flags & mask) != (e2->flags & mask))
+		return false;
+
+	/* copy-on-write clones that still share their data */
+	if (e1->data == e2->data)
+		return true;
+
+	return !e1->ops->cmp || e1->ops->cmp(e1, e2);
+}
+
+EXPORT_SYMBOL(nftnl_expr_hash);
+uint32_t nftnl_expr_hash(const struct nftnl_expr *expr, uint32_t seed)
+{
+	uint32_t h;
+
+	h = nftnl_hash_str(seed, expr->ops->name);
+	h = nftnl_hash_u32(h, expr->flags & ~expr->ops->state_attrs);
+	if (expr->ops->hash)
+		h = expr->ops->hash(expr, h);
+
+	return h;
+}
+
+bool nftnl_expr_list_cmp(const struct list_head *l1,
+			 const struct list_head *l2)
+{
+	const struct list_head *p1, *p2;
+	const struct nftnl_expr *e1, *e2;
+
+	for (p1 = l1->next, p2 = l2->next; p1 != l1 && p2 != l2;
+	     p1 = p1->next, p2 = p2->next) {
+		e1 = list_entry(p1, const struct nftnl_expr, head);
+		e2 = list_entry(p2, const struct nftnl_expr, head);
+		if (!nftnl_expr_cmp(e1, e2))
+			return false;
+	}
+
+	return p1 == l1 && p2 == l2;
+}
+
 EXPORT_SYMBOL(nftnl_expr_build_payload);
 void nftnl_expr_build_payload(struct nlmsghdr *nlh, struct nftnl_expr *expr)
 {
 	struct nlattr *nest;
+	char *start;
 
+	if (expr->wire.data) {
+		nftnl_wire_put(nlh, &expr->wire);
+		return;
+	}
+
+	start = mnl_nlmsg_get_payload_tail(nlh);
 	mnl_attr_put_strz(nlh, NFTA_EXPR_NAME, expr->ops->name);
 
-	if (!expr->ops->build)
-		return;
+	if (expr->ops->build) {
+		nest = mnl_attr_nest_start(nlh, NFTA_EXPR_DATA);
+		expr->ops->build(nlh, expr);
+		mnl_attr_nest_end(nlh, nest);
+	}
 
-	nest = mnl_attr_nest_start(nlh, NFTA_EXPR_DATA);
-	expr->ops->build(nlh, expr);
-	mnl_attr_nest_end(nlh, nest);
+	if (expr->wire_cache)
+		nftnl_wire_save(&expr->wire, start,
+				(char *)mnl_nlmsg_get_payload_tail(nlh) - start);
+}
+
+EXPORT_SYMBOL(nftnl_expr_cache_wire);
+void nftnl_expr_cache_wire(struct nftnl_expr *expr, bool enable)
+{
+	expr->wire_cache = enable;
+	if (!enable)
+		nftnl_wire_reset(&expr->wire);
+}
+
+void nftnl_expr_wire_invalidate(struct nftnl_expr *expr)
+{
+	for (; expr; expr = expr->parent) {
+		nftnl_wire_reset(&expr->wire);
+		if (expr->rule)
+			nftnl_rule_wire_invalidate(expr->rule);
+	}
 }
 
 static int nftnl_rule_parse_expr_cb(const struct nlattr *attr, void *data)
@@ -244,15 +507,25 @@ static int nftnl_rule_parse_expr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
-struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr)
+struct nftnl_expr *nftnl_expr_block_parse(struct nftnl_expr_block *block,
+					  struct nlattr *attr)
 {
 	struct nlattr *tb[NFTA_EXPR_MAX+1] = {};
 	struct nftnl_expr *expr;
+	struct expr_ops *ops;
 
 	if (mnl_attr_parse_nested(attr, nftnl_rule_parse_expr_cb, tb) < 0)
 		goto err1;
 
-	expr = nftnl_expr_alloc(mnl_attr_get_str(tb[NFTA_EXPR_NAME]));
+	if (block) {
+		ops = nftnl_expr_ops_lookup(mnl_attr_get_str(tb[NFTA_EXPR_NAME]));
+		if (ops == NULL)
+			goto err1;
+
+		expr = nftnl_expr_block_get(block, ops);
+	} else {
+		expr = nftnl_expr_alloc(mnl_attr_get_str(tb[NFTA_EXPR_NAME]));
+	}
 	if (expr == NULL)
 		goto err1;
 
@@ -264,11 +537,37 @@ struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr)
 	return expr;
 
 err2:
-	xfree(expr);
+	nftnl_expr_release(expr);
 err1:
 	return NULL;
 }
 
+struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr)
+{
+	return nftnl_expr_block_parse(NULL, attr);
+}
+
+/* Room needed in a block for the expression encoded in this attribute. */
+uint32_t nftnl_expr_block_len(struct nlattr *attr)
+{
+	struct expr_ops *ops;
+	struct nlattr *pos;
+
+	mnl_attr_for_each_nested(pos, attr) {
+		if (mnl_attr_get_type(pos) != NFTA_EXPR_NAME)
+			continue;
+		if (mnl_attr_validate(pos, MNL_TYPE_STRING) < 0)
+			abi_breakage();
+
+		ops = nftnl_expr_ops_lookup(mnl_attr_get_str(pos));
+		if (ops == NULL)
+			return 0;
+
+		return nftnl_expr_size(ops);
+	}
+	return 0;
+}
+
 EXPORT_SYMBOL(nftnl_expr_snprintf);
 int nftnl_expr_snprintf(char *buf, size_t remain, const struct nftnl_expr *expr,
 			uint32_t type, uint32_t flags)
@@ -274,10 +274,59 @@ nftnl_expr_bitwise_snprintf(char *buf, size_t size,
 	return err;
 }
 
+static bool nftnl_expr_bitwise_cmp(const struct nftnl_expr *e1,
+				   const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_bitwise *b1 = nftnl_expr_data(e1);
+	struct nftnl_expr_bitwise *b2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_SREG))
+		eq &= (b1->sreg == b2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_DREG))
+		eq &= (b1->dreg == b2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_OP))
+		eq &= (b1->op == b2->op);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_LEN))
+		eq &= (b1->len == b2->len);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_MASK))
+		eq &= nftnl_data_reg_cmp(&b1->mask, &b2->mask, DATA_VALUE);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_XOR))
+		eq &= nftnl_data_reg_cmp(&b1->xor, &b2->xor, DATA_VALUE);
+	if (e1->flags & (1 << NFTNL_EXPR_BITWISE_DATA))
+		eq &= nftnl_data_reg_cmp(&b1->data, &b2->data, DATA_VALUE);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_bitwise_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_bitwise *bitwise = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_SREG))
+		h = nftnl_hash_u32(h, bitwise->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_DREG))
+		h = nftnl_hash_u32(h, bitwise->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_OP))
+		h = nftnl_hash_u32(h, bitwise->op);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_LEN))
+		h = nftnl_hash_u32(h, bitwise->len);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_MASK))
+		h = nftnl_data_reg_hash(h, &bitwise->mask, DATA_VALUE);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_XOR))
+		h = nftnl_data_reg_hash(h, &bitwise->xor, DATA_VALUE);
+	if (e->flags & (1 << NFTNL_EXPR_BITWISE_DATA))
+		h = nftnl_data_reg_hash(h, &bitwise->data, DATA_VALUE);
+
+	return h;
+}
+
 struct expr_ops expr_ops_bitwise = {
 	.name		= "bitwise",
 	.alloc_len	= sizeof(struct nftnl_expr_bitwise),
 	.max_attr	= NFTA_BITWISE_MAX,
+	.cmp		= nftnl_expr_bitwise_cmp,
+	.hash		= nftnl_expr_bitwise_hash,
 	.set		= nftnl_expr_bitwise_set,
 	.get		= nftnl_expr_bitwise_get,
 	.parse		= nftnl_expr_bitwise_parse,
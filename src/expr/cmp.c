@@ -194,10 +194,43 @@ nftnl_expr_cmp_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_cmp_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_cmp *c1 = nftnl_expr_data(e1);
+	struct nftnl_expr_cmp *c2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_CMP_SREG))
+		eq &= (c1->sreg == c2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_CMP_OP))
+		eq &= (c1->op == c2->op);
+	if (e1->flags & (1 << NFTNL_EXPR_CMP_DATA))
+		eq &= nftnl_data_reg_cmp(&c1->data, &c2->data, DATA_VALUE);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_cmp_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_cmp *cmp = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_CMP_SREG))
+		h = nftnl_hash_u32(h, cmp->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_CMP_OP))
+		h = nftnl_hash_u32(h, cmp->op);
+	if (e->flags & (1 << NFTNL_EXPR_CMP_DATA))
+		h = nftnl_data_reg_hash(h, &cmp->data, DATA_VALUE);
+
+	return h;
+}
+
 struct expr_ops expr_ops_cmp = {
 	.name		= "cmp",
 	.alloc_len	= sizeof(struct nftnl_expr_cmp),
 	.max_attr	= NFTA_CMP_MAX,
+	.cmp		= nftnl_expr_cmp_cmp,
+	.hash		= nftnl_expr_cmp_hash,
 	.set		= nftnl_expr_cmp_set,
 	.get		= nftnl_expr_cmp_get,
 	.parse		= nftnl_expr_cmp_parse,
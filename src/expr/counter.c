@@ -129,6 +129,8 @@ struct expr_ops expr_ops_counter = {
 	.name		= "counter",
 	.alloc_len	= sizeof(struct nftnl_expr_counter),
 	.max_attr	= NFTA_COUNTER_MAX,
+	.state_attrs	= (1 << NFTNL_EXPR_CTR_PACKETS) |
+			  (1 << NFTNL_EXPR_CTR_BYTES),
 	.set		= nftnl_expr_counter_set,
 	.get		= nftnl_expr_counter_get,
 	.parse		= nftnl_expr_counter_parse,
@@ -250,10 +250,47 @@ nftnl_expr_ct_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_ct_cmp(const struct nftnl_expr *e1,
+			      const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_ct *c1 = nftnl_expr_data(e1);
+	struct nftnl_expr_ct *c2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_CT_KEY))
+		eq &= (c1->key == c2->key);
+	if (e1->flags & (1 << NFTNL_EXPR_CT_DIR))
+		eq &= (c1->dir == c2->dir);
+	if (e1->flags & (1 << NFTNL_EXPR_CT_DREG))
+		eq &= (c1->dreg == c2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_CT_SREG))
+		eq &= (c1->sreg == c2->sreg);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_ct_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_ct *ct = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_CT_KEY))
+		h = nftnl_hash_u32(h, ct->key);
+	if (e->flags & (1 << NFTNL_EXPR_CT_DIR))
+		h = nftnl_hash_u32(h, ct->dir);
+	if (e->flags & (1 << NFTNL_EXPR_CT_DREG))
+		h = nftnl_hash_u32(h, ct->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_CT_SREG))
+		h = nftnl_hash_u32(h, ct->sreg);
+
+	return h;
+}
+
 struct expr_ops expr_ops_ct = {
 	.name		= "ct",
 	.alloc_len	= sizeof(struct nftnl_expr_ct),
 	.max_attr	= NFTA_CT_MAX,
+	.cmp		= nftnl_expr_ct_cmp,
+	.hash		= nftnl_expr_ct_hash,
 	.set		= nftnl_expr_ct_set,
 	.get		= nftnl_expr_ct_get,
 	.parse		= nftnl_expr_ct_parse,
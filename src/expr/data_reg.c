@@ -206,6 +206,43 @@ int nftnl_parse_data(union nftnl_data_reg *data, struct nlattr *attr, int *type)
 	return ret;
 }
 
+bool nftnl_data_reg_cmp(const union nftnl_data_reg *r1,
+			const union nftnl_data_reg *r2, int reg_type)
+{
+	switch (reg_type) {
+	case DATA_VALUE:
+		return r1->len == r2->len &&
+		       !memcmp(r1->val, r2->val, r1->len);
+	case DATA_VERDICT:
+	case DATA_CHAIN:
+		if (r1->verdict != r2->verdict)
+			return false;
+		if (r1->verdict != NFT_JUMP && r1->verdict != NFT_GOTO)
+			return true;
+		if (!r1->chain || !r2->chain)
+			return r1->chain == r2->chain;
+		return !strcmp(r1->chain, r2->chain);
+	}
+	return false;
+}
+
+uint32_t nftnl_data_reg_hash(uint32_t h, const union nftnl_data_reg *reg,
+			     int reg_type)
+{
+	switch (reg_type) {
+	case DATA_VALUE:
+		return nftnl_hash_mem(h, reg->val, reg->len);
+	case DATA_VERDICT:
+	case DATA_CHAIN:
+		h = nftnl_hash_u32(h, reg->verdict);
+		if ((reg->verdict == NFT_JUMP || reg->verdict == NFT_GOTO) &&
+		    reg->chain)
+			h = nftnl_hash_str(h, reg->chain);
+		return h;
+	}
+	return h;
+}
+
 void nftnl_free_verdict(const union nftnl_data_reg *data)
 {
 	switch(data->verdict) {
@@ -217,3 +254,20 @@ void nftnl_free_verdict(const union nftnl_data_reg *data)
 		break;
 	}
 }
+
+int nftnl_clone_verdict(union nftnl_data_reg *data)
+{
+	switch(data->verdict) {
+	case NFT_JUMP:
+	case NFT_GOTO:
+		if (!data->chain)
+			break;
+		data->chain = strdup(data->chain);
+		if (!data->chain)
+			return -1;
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
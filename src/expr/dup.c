@@ -130,10 +130,39 @@ static int nftnl_expr_dup_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_dup_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_dup *d1 = nftnl_expr_data(e1);
+	struct nftnl_expr_dup *d2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_DUP_SREG_ADDR))
+		eq &= (d1->sreg_addr == d2->sreg_addr);
+	if (e1->flags & (1 << NFTNL_EXPR_DUP_SREG_DEV))
+		eq &= (d1->sreg_dev == d2->sreg_dev);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_dup_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_dup *dup = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_DUP_SREG_ADDR))
+		h = nftnl_hash_u32(h, dup->sreg_addr);
+	if (e->flags & (1 << NFTNL_EXPR_DUP_SREG_DEV))
+		h = nftnl_hash_u32(h, dup->sreg_dev);
+
+	return h;
+}
+
 struct expr_ops expr_ops_dup = {
 	.name		= "dup",
 	.alloc_len	= sizeof(struct nftnl_expr_dup),
 	.max_attr	= NFTA_DUP_MAX,
+	.cmp		= nftnl_expr_dup_cmp,
+	.hash		= nftnl_expr_dup_hash,
 	.set		= nftnl_expr_dup_set,
 	.get		= nftnl_expr_dup_get,
 	.parse		= nftnl_expr_dup_parse,
@@ -65,6 +65,7 @@ nftnl_expr_dynset_set(struct nftnl_expr *e, uint16_t type,
 			nftnl_expr_free(expr);
 
 		expr = (void *)data;
+		expr->parent = e;
 		list_add(&expr->head, &dynset->expr_list);
 		break;
 	case NFTNL_EXPR_DYNSET_FLAGS:
@@ -201,7 +202,9 @@ void nftnl_expr_add_expr(struct nftnl_expr *e, uint32_t type,
 {
 	struct nftnl_expr_dynset *dynset = nftnl_expr_data(e);
 
+	expr->parent = e;
 	list_add_tail(&expr->head, &dynset->expr_list);
+	nftnl_expr_wire_invalidate(e);
 }
 
 EXPORT_SYMBOL(nftnl_expr_expr_foreach);
@@ -264,6 +267,7 @@ nftnl_expr_dynset_parse(struct nftnl_expr *e, struct nlattr *attr)
 		if (expr == NULL)
 			return -1;
 
+		expr->parent = e;
 		list_add(&expr->head, &dynset->expr_list);
 		e->flags |= (1 << NFTNL_EXPR_DYNSET_EXPR);
 	} else if (tb[NFTA_DYNSET_EXPRESSIONS]) {
@@ -277,6 +281,7 @@ nftnl_expr_dynset_parse(struct nftnl_expr *e, struct nlattr *attr)
 			if (!expr)
 				goto out_dynset_expr;
 
+			expr->parent = e;
 			list_add_tail(&expr->head, &dynset->expr_list);
 		}
 		e->flags |= (1 << NFTNL_EXPR_DYNSET_EXPRESSIONS);
@@ -363,12 +368,95 @@ static void nftnl_expr_dynset_free(const struct nftnl_expr *e)
 		nftnl_expr_free(expr);
 }
 
+static int nftnl_expr_dynset_clone(struct nftnl_expr *e,
+				   const struct nftnl_expr *src)
+{
+	const struct nftnl_expr_dynset *orig = nftnl_expr_data(src);
+	struct nftnl_expr_dynset *dynset = nftnl_expr_data(e);
+	struct nftnl_expr *expr, *clone;
+
+	INIT_LIST_HEAD(&dynset->expr_list);
+
+	if (dynset->set_name) {
+		dynset->set_name = strdup(dynset->set_name);
+		if (!dynset->set_name) {
+			e->flags &= ~(1 << NFTNL_EXPR_DYNSET_SET_NAME);
+			return -1;
+		}
+	}
+
+	list_for_each_entry(expr, &orig->expr_list, head) {
+		clone = nftnl_expr_clone(expr, 0);
+		if (!clone)
+			return -1;
+
+		clone->parent = e;
+		list_add_tail(&clone->head, &dynset->expr_list);
+	}
+	return 0;
+}
+
+static bool nftnl_expr_dynset_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_dynset *d1 = nftnl_expr_data(e1);
+	struct nftnl_expr_dynset *d2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_SREG_KEY))
+		eq &= (d1->sreg_key == d2->sreg_key);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_SREG_DATA))
+		eq &= (d1->sreg_data == d2->sreg_data);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_OP))
+		eq &= (d1->op == d2->op);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_TIMEOUT))
+		eq &= (d1->timeout == d2->timeout);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_SET_NAME))
+		eq &= !strcmp(d1->set_name, d2->set_name);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_SET_ID))
+		eq &= (d1->set_id == d2->set_id);
+	if (e1->flags & (1 << NFTNL_EXPR_DYNSET_FLAGS))
+		eq &= (d1->dynset_flags == d2->dynset_flags);
+
+	return eq && nftnl_expr_list_cmp(&d1->expr_list, &d2->expr_list);
+}
+
+static uint32_t nftnl_expr_dynset_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_dynset *dynset = nftnl_expr_data(e);
+	struct nftnl_expr *expr;
+
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_SREG_KEY))
+		h = nftnl_hash_u32(h, dynset->sreg_key);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_SREG_DATA))
+		h = nftnl_hash_u32(h, dynset->sreg_data);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_OP))
+		h = nftnl_hash_u32(h, dynset->op);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_TIMEOUT))
+		h = nftnl_hash_u64(h, dynset->timeout);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_SET_NAME))
+		h = nftnl_hash_str(h, dynset->set_name);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_SET_ID))
+		h = nftnl_hash_u32(h, dynset->set_id);
+	if (e->flags & (1 << NFTNL_EXPR_DYNSET_FLAGS))
+		h = nftnl_hash_u32(h, dynset->dynset_flags);
+
+	list_for_each_entry(expr, &dynset->expr_list, head)
+		h = nftnl_expr_hash(expr, h);
+
+	return h;
+}
+
 struct expr_ops expr_ops_dynset = {
 	.name		= "dynset",
 	.alloc_len	= sizeof(struct nftnl_expr_dynset),
 	.max_attr	= NFTA_DYNSET_MAX,
+	.nested		= true,
 	.init		= nftnl_expr_dynset_init,
 	.free		= nftnl_expr_dynset_free,
+	.clone		= nftnl_expr_dynset_clone,
+	.cmp		= nftnl_expr_dynset_cmp,
+	.hash		= nftnl_expr_dynset_hash,
 	.set		= nftnl_expr_dynset_set,
 	.get		= nftnl_expr_dynset_get,
 	.parse		= nftnl_expr_dynset_parse,
@@ -259,10 +259,59 @@ nftnl_expr_exthdr_snprintf(char *buf, size_t len,
 
 }
 
+static bool nftnl_expr_exthdr_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_exthdr *h1 = nftnl_expr_data(e1);
+	struct nftnl_expr_exthdr *h2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_DREG))
+		eq &= (h1->dreg == h2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_SREG))
+		eq &= (h1->sreg == h2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_TYPE))
+		eq &= (h1->type == h2->type);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_OFFSET))
+		eq &= (h1->offset == h2->offset);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_LEN))
+		eq &= (h1->len == h2->len);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_OP))
+		eq &= (h1->op == h2->op);
+	if (e1->flags & (1 << NFTNL_EXPR_EXTHDR_FLAGS))
+		eq &= (h1->flags == h2->flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_exthdr_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_exthdr *exthdr = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_DREG))
+		h = nftnl_hash_u32(h, exthdr->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_SREG))
+		h = nftnl_hash_u32(h, exthdr->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_TYPE))
+		h = nftnl_hash_u32(h, exthdr->type);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_OFFSET))
+		h = nftnl_hash_u32(h, exthdr->offset);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_LEN))
+		h = nftnl_hash_u32(h, exthdr->len);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_OP))
+		h = nftnl_hash_u32(h, exthdr->op);
+	if (e->flags & (1 << NFTNL_EXPR_EXTHDR_FLAGS))
+		h = nftnl_hash_u32(h, exthdr->flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_exthdr = {
 	.name		= "exthdr",
 	.alloc_len	= sizeof(struct nftnl_expr_exthdr),
 	.max_attr	= NFTA_EXTHDR_MAX,
+	.cmp		= nftnl_expr_exthdr_cmp,
+	.hash		= nftnl_expr_exthdr_hash,
 	.set		= nftnl_expr_exthdr_set,
 	.get		= nftnl_expr_exthdr_get,
 	.parse		= nftnl_expr_exthdr_parse,
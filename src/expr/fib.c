@@ -190,10 +190,43 @@ nftnl_expr_fib_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_fib_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_fib *f1 = nftnl_expr_data(e1);
+	struct nftnl_expr_fib *f2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_FIB_RESULT))
+		eq &= (f1->result == f2->result);
+	if (e1->flags & (1 << NFTNL_EXPR_FIB_DREG))
+		eq &= (f1->dreg == f2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_FIB_FLAGS))
+		eq &= (f1->flags == f2->flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_fib_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_fib *fib = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_FIB_RESULT))
+		h = nftnl_hash_u32(h, fib->result);
+	if (e->flags & (1 << NFTNL_EXPR_FIB_DREG))
+		h = nftnl_hash_u32(h, fib->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_FIB_FLAGS))
+		h = nftnl_hash_u32(h, fib->flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_fib = {
 	.name		= "fib",
 	.alloc_len	= sizeof(struct nftnl_expr_fib),
 	.max_attr	= NFTA_FIB_MAX,
+	.cmp		= nftnl_expr_fib_cmp,
+	.hash		= nftnl_expr_fib_hash,
 	.set		= nftnl_expr_fib_set,
 	.get		= nftnl_expr_fib_get,
 	.parse		= nftnl_expr_fib_parse,
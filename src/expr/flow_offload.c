@@ -111,11 +111,52 @@ static void nftnl_expr_flow_free(const struct nftnl_expr *e)
 	xfree(flow->table_name);
 }
 
+static int nftnl_expr_flow_clone(struct nftnl_expr *e,
+				 const struct nftnl_expr *src)
+{
+	struct nftnl_expr_flow *flow = nftnl_expr_data(e);
+
+	if (flow->table_name) {
+		flow->table_name = strdup(flow->table_name);
+		if (!flow->table_name) {
+			e->flags &= ~(1 << NFTNL_EXPR_FLOW_TABLE_NAME);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static bool nftnl_expr_flow_cmp(const struct nftnl_expr *e1,
+				const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_flow *f1 = nftnl_expr_data(e1);
+	struct nftnl_expr_flow *f2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_FLOW_TABLE_NAME))
+		eq &= !strcmp(f1->table_name, f2->table_name);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_flow_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_flow *flow = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_FLOW_TABLE_NAME))
+		h = nftnl_hash_str(h, flow->table_name);
+
+	return h;
+}
+
 struct expr_ops expr_ops_flow = {
 	.name		= "flow_offload",
 	.alloc_len	= sizeof(struct nftnl_expr_flow),
 	.max_attr	= NFTA_FLOW_MAX,
 	.free		= nftnl_expr_flow_free,
+	.clone		= nftnl_expr_flow_clone,
+	.cmp		= nftnl_expr_flow_cmp,
+	.hash		= nftnl_expr_flow_hash,
 	.set		= nftnl_expr_flow_set,
 	.get		= nftnl_expr_flow_get,
 	.parse		= nftnl_expr_flow_parse,
@@ -155,10 +155,43 @@ static int nftnl_expr_fullcone_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_fullcone_cmp(const struct nftnl_expr *e1,
+				    const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_fullcone *f1 = nftnl_expr_data(e1);
+	struct nftnl_expr_fullcone *f2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_FULLCONE_FLAGS))
+		eq &= (f1->flags == f2->flags);
+	if (e1->flags & (1 << NFTNL_EXPR_FULLCONE_REG_PROTO_MIN))
+		eq &= (f1->sreg_proto_min == f2->sreg_proto_min);
+	if (e1->flags & (1 << NFTNL_EXPR_FULLCONE_REG_PROTO_MAX))
+		eq &= (f1->sreg_proto_max == f2->sreg_proto_max);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_fullcone_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_fullcone *fullcone = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_FULLCONE_FLAGS))
+		h = nftnl_hash_u32(h, fullcone->flags);
+	if (e->flags & (1 << NFTNL_EXPR_FULLCONE_REG_PROTO_MIN))
+		h = nftnl_hash_u32(h, fullcone->sreg_proto_min);
+	if (e->flags & (1 << NFTNL_EXPR_FULLCONE_REG_PROTO_MAX))
+		h = nftnl_hash_u32(h, fullcone->sreg_proto_max);
+
+	return h;
+}
+
 struct expr_ops expr_ops_fullcone = {
 	.name		= "fullcone",
 	.alloc_len	= sizeof(struct nftnl_expr_fullcone),
 	.max_attr	= NFTA_FULLCONE_MAX,
+	.cmp		= nftnl_expr_fullcone_cmp,
+	.hash		= nftnl_expr_fullcone_hash,
 	.set		= nftnl_expr_fullcone_set,
 	.get		= nftnl_expr_fullcone_get,
 	.parse		= nftnl_expr_fullcone_parse,
@@ -150,10 +150,43 @@ static int nftnl_expr_fwd_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_fwd_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_fwd *f1 = nftnl_expr_data(e1);
+	struct nftnl_expr_fwd *f2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_FWD_SREG_DEV))
+		eq &= (f1->sreg_dev == f2->sreg_dev);
+	if (e1->flags & (1 << NFTNL_EXPR_FWD_SREG_ADDR))
+		eq &= (f1->sreg_addr == f2->sreg_addr);
+	if (e1->flags & (1 << NFTNL_EXPR_FWD_NFPROTO))
+		eq &= (f1->nfproto == f2->nfproto);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_fwd_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_fwd *fwd = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_FWD_SREG_DEV))
+		h = nftnl_hash_u32(h, fwd->sreg_dev);
+	if (e->flags & (1 << NFTNL_EXPR_FWD_SREG_ADDR))
+		h = nftnl_hash_u32(h, fwd->sreg_addr);
+	if (e->flags & (1 << NFTNL_EXPR_FWD_NFPROTO))
+		h = nftnl_hash_u32(h, fwd->nfproto);
+
+	return h;
+}
+
 struct expr_ops expr_ops_fwd = {
 	.name		= "fwd",
 	.alloc_len	= sizeof(struct nftnl_expr_fwd),
 	.max_attr	= NFTA_FWD_MAX,
+	.cmp		= nftnl_expr_fwd_cmp,
+	.hash		= nftnl_expr_fwd_hash,
 	.set		= nftnl_expr_fwd_set,
 	.get		= nftnl_expr_fwd_get,
 	.parse		= nftnl_expr_fwd_parse,
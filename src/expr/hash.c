@@ -218,10 +218,59 @@ nftnl_expr_hash_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_hash_cmp(const struct nftnl_expr *e1,
+				const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_hash *h1 = nftnl_expr_data(e1);
+	struct nftnl_expr_hash *h2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_SREG))
+		eq &= (h1->sreg == h2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_DREG))
+		eq &= (h1->dreg == h2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_LEN))
+		eq &= (h1->len == h2->len);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_MODULUS))
+		eq &= (h1->modulus == h2->modulus);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_SEED))
+		eq &= (h1->seed == h2->seed);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_OFFSET))
+		eq &= (h1->offset == h2->offset);
+	if (e1->flags & (1 << NFTNL_EXPR_HASH_TYPE))
+		eq &= (h1->type == h2->type);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_hash_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_hash *hash = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_HASH_SREG))
+		h = nftnl_hash_u32(h, hash->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_DREG))
+		h = nftnl_hash_u32(h, hash->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_LEN))
+		h = nftnl_hash_u32(h, hash->len);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_MODULUS))
+		h = nftnl_hash_u32(h, hash->modulus);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_SEED))
+		h = nftnl_hash_u32(h, hash->seed);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_OFFSET))
+		h = nftnl_hash_u32(h, hash->offset);
+	if (e->flags & (1 << NFTNL_EXPR_HASH_TYPE))
+		h = nftnl_hash_u32(h, hash->type);
+
+	return h;
+}
+
 struct expr_ops expr_ops_hash = {
 	.name		= "hash",
 	.alloc_len	= sizeof(struct nftnl_expr_hash),
 	.max_attr	= NFTA_HASH_MAX,
+	.cmp		= nftnl_expr_hash_cmp,
+	.hash		= nftnl_expr_hash_hash,
 	.set		= nftnl_expr_hash_set,
 	.get		= nftnl_expr_hash_get,
 	.parse		= nftnl_expr_hash_parse,
@@ -220,11 +220,70 @@ static void nftnl_expr_immediate_free(const struct nftnl_expr *e)
 		nftnl_free_verdict(&imm->data);
 }
 
+static int nftnl_expr_immediate_clone(struct nftnl_expr *e,
+				      const struct nftnl_expr *src)
+{
+	struct nftnl_expr_immediate *imm = nftnl_expr_data(e);
+
+	if (!(e->flags & (1 << NFTNL_EXPR_IMM_VERDICT)))
+		return 0;
+
+	if (nftnl_clone_verdict(&imm->data) < 0) {
+		e->flags &= ~(1 << NFTNL_EXPR_IMM_VERDICT);
+		e->flags &= ~(1 << NFTNL_EXPR_IMM_CHAIN);
+		return -1;
+	}
+	return 0;
+}
+
+static bool nftnl_expr_immediate_cmp(const struct nftnl_expr *e1,
+				     const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_immediate *i1 = nftnl_expr_data(e1);
+	struct nftnl_expr_immediate *i2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_IMM_DREG))
+		eq &= (i1->dreg == i2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_IMM_DATA))
+		eq &= nftnl_data_reg_cmp(&i1->data, &i2->data, DATA_VALUE);
+	if (e1->flags & (1 << NFTNL_EXPR_IMM_VERDICT))
+		eq &= (i1->data.verdict == i2->data.verdict);
+	if (e1->flags & (1 << NFTNL_EXPR_IMM_CHAIN))
+		eq &= !strcmp(i1->data.chain, i2->data.chain);
+	if (e1->flags & (1 << NFTNL_EXPR_IMM_CHAIN_ID))
+		eq &= (i1->data.chain_id == i2->data.chain_id);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_immediate_hash(const struct nftnl_expr *e,
+					  uint32_t h)
+{
+	struct nftnl_expr_immediate *imm = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_IMM_DREG))
+		h = nftnl_hash_u32(h, imm->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_IMM_DATA))
+		h = nftnl_data_reg_hash(h, &imm->data, DATA_VALUE);
+	if (e->flags & (1 << NFTNL_EXPR_IMM_VERDICT))
+		h = nftnl_hash_u32(h, imm->data.verdict);
+	if (e->flags & (1 << NFTNL_EXPR_IMM_CHAIN))
+		h = nftnl_hash_str(h, imm->data.chain);
+	if (e->flags & (1 << NFTNL_EXPR_IMM_CHAIN_ID))
+		h = nftnl_hash_u32(h, imm->data.chain_id);
+
+	return h;
+}
+
 struct expr_ops expr_ops_immediate = {
 	.name		= "immediate",
 	.alloc_len	= sizeof(struct nftnl_expr_immediate),
 	.max_attr	= NFTA_IMMEDIATE_MAX,
 	.free		= nftnl_expr_immediate_free,
+	.clone		= nftnl_expr_immediate_clone,
+	.cmp		= nftnl_expr_immediate_cmp,
+	.hash		= nftnl_expr_immediate_hash,
 	.set		= nftnl_expr_immediate_set,
 	.get		= nftnl_expr_immediate_get,
 	.parse		= nftnl_expr_immediate_parse,
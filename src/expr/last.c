@@ -130,6 +130,8 @@ struct expr_ops expr_ops_last = {
 	.name		= "last",
 	.alloc_len	= sizeof(struct nftnl_expr_last),
 	.max_attr	= NFTA_LAST_MAX,
+	.state_attrs	= (1 << NFTNL_EXPR_LAST_MSECS) |
+			  (1 << NFTNL_EXPR_LAST_SET),
 	.set		= nftnl_expr_last_set,
 	.get		= nftnl_expr_last_get,
 	.parse		= nftnl_expr_last_parse,
@@ -38,7 +38,7 @@ static int nftnl_expr_log_set(struct nftnl_expr *e, uint16_t type,
 
 	switch(type) {
 	case NFTNL_EXPR_LOG_PREFIX:
-		if (log->flags & (1 << NFTNL_EXPR_LOG_PREFIX))
+		if (e->flags & (1 << NFTNL_EXPR_LOG_PREFIX))
 			xfree(log->prefix);
 
 		log->prefix = strdup(data);
@@ -244,11 +244,72 @@ static void nftnl_expr_log_free(const struct nftnl_expr *e)
 	xfree(log->prefix);
 }
 
+static int nftnl_expr_log_clone(struct nftnl_expr *e,
+				const struct nftnl_expr *src)
+{
+	struct nftnl_expr_log *log = nftnl_expr_data(e);
+
+	if (log->prefix) {
+		log->prefix = strdup(log->prefix);
+		if (!log->prefix) {
+			e->flags &= ~(1 << NFTNL_EXPR_LOG_PREFIX);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static bool nftnl_expr_log_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_log *l1 = nftnl_expr_data(e1);
+	struct nftnl_expr_log *l2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_SNAPLEN))
+		eq &= (l1->snaplen == l2->snaplen);
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_GROUP))
+		eq &= (l1->group == l2->group);
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_QTHRESHOLD))
+		eq &= (l1->qthreshold == l2->qthreshold);
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_LEVEL))
+		eq &= (l1->level == l2->level);
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_FLAGS))
+		eq &= (l1->flags == l2->flags);
+	if (e1->flags & (1 << NFTNL_EXPR_LOG_PREFIX))
+		eq &= !strcmp(l1->prefix, l2->prefix);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_log_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_log *log = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_LOG_SNAPLEN))
+		h = nftnl_hash_u32(h, log->snaplen);
+	if (e->flags & (1 << NFTNL_EXPR_LOG_GROUP))
+		h = nftnl_hash_u32(h, log->group);
+	if (e->flags & (1 << NFTNL_EXPR_LOG_QTHRESHOLD))
+		h = nftnl_hash_u32(h, log->qthreshold);
+	if (e->flags & (1 << NFTNL_EXPR_LOG_LEVEL))
+		h = nftnl_hash_u32(h, log->level);
+	if (e->flags & (1 << NFTNL_EXPR_LOG_FLAGS))
+		h = nftnl_hash_u32(h, log->flags);
+	if (e->flags & (1 << NFTNL_EXPR_LOG_PREFIX))
+		h = nftnl_hash_str(h, log->prefix);
+
+	return h;
+}
+
 struct expr_ops expr_ops_log = {
 	.name		= "log",
 	.alloc_len	= sizeof(struct nftnl_expr_log),
 	.max_attr	= NFTA_LOG_MAX,
 	.free		= nftnl_expr_log_free,
+	.clone		= nftnl_expr_log_clone,
+	.cmp		= nftnl_expr_log_cmp,
+	.hash		= nftnl_expr_log_hash,
 	.set		= nftnl_expr_log_set,
 	.get		= nftnl_expr_log_get,
 	.parse		= nftnl_expr_log_parse,
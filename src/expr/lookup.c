@@ -197,11 +197,68 @@ static void nftnl_expr_lookup_free(const struct nftnl_expr *e)
 	xfree(lookup->set_name);
 }
 
+static int nftnl_expr_lookup_clone(struct nftnl_expr *e,
+				   const struct nftnl_expr *src)
+{
+	struct nftnl_expr_lookup *lookup = nftnl_expr_data(e);
+
+	if (lookup->set_name) {
+		lookup->set_name = strdup(lookup->set_name);
+		if (!lookup->set_name) {
+			e->flags &= ~(1 << NFTNL_EXPR_LOOKUP_SET);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static bool nftnl_expr_lookup_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_lookup *l1 = nftnl_expr_data(e1);
+	struct nftnl_expr_lookup *l2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_LOOKUP_SREG))
+		eq &= (l1->sreg == l2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_LOOKUP_DREG))
+		eq &= (l1->dreg == l2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_LOOKUP_SET))
+		eq &= !strcmp(l1->set_name, l2->set_name);
+	if (e1->flags & (1 << NFTNL_EXPR_LOOKUP_SET_ID))
+		eq &= (l1->set_id == l2->set_id);
+	if (e1->flags & (1 << NFTNL_EXPR_LOOKUP_FLAGS))
+		eq &= (l1->flags == l2->flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_lookup_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_lookup *lookup = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_LOOKUP_SREG))
+		h = nftnl_hash_u32(h, lookup->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_LOOKUP_DREG))
+		h = nftnl_hash_u32(h, lookup->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_LOOKUP_SET))
+		h = nftnl_hash_str(h, lookup->set_name);
+	if (e->flags & (1 << NFTNL_EXPR_LOOKUP_SET_ID))
+		h = nftnl_hash_u32(h, lookup->set_id);
+	if (e->flags & (1 << NFTNL_EXPR_LOOKUP_FLAGS))
+		h = nftnl_hash_u32(h, lookup->flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_lookup = {
 	.name		= "lookup",
 	.alloc_len	= sizeof(struct nftnl_expr_lookup),
 	.max_attr	= NFTA_LOOKUP_MAX,
 	.free		= nftnl_expr_lookup_free,
+	.clone		= nftnl_expr_lookup_clone,
+	.cmp		= nftnl_expr_lookup_cmp,
+	.hash		= nftnl_expr_lookup_hash,
 	.set		= nftnl_expr_lookup_set,
 	.get		= nftnl_expr_lookup_get,
 	.parse		= nftnl_expr_lookup_parse,
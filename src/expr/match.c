@@ -180,11 +180,67 @@ static void nftnl_expr_match_free(const struct nftnl_expr *e)
 	xfree(match->data);
 }
 
+static int nftnl_expr_match_clone(struct nftnl_expr *e,
+				  const struct nftnl_expr *src)
+{
+	struct nftnl_expr_match *match = nftnl_expr_data(e);
+	void *data;
+
+	if (!match->data)
+		return 0;
+
+	data = malloc(match->data_len);
+	if (data == NULL) {
+		match->data = NULL;
+		e->flags &= ~(1 << NFTNL_EXPR_MT_INFO);
+		return -1;
+	}
+	memcpy(data, match->data, match->data_len);
+	match->data = data;
+
+	return 0;
+}
+
+static bool nftnl_expr_match_cmp(const struct nftnl_expr *e1,
+				 const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_match *m1 = nftnl_expr_data(e1);
+	struct nftnl_expr_match *m2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_MT_NAME))
+		eq &= !strcmp(m1->name, m2->name);
+	if (e1->flags & (1 << NFTNL_EXPR_MT_REV))
+		eq &= (m1->rev == m2->rev);
+	if (e1->flags & (1 << NFTNL_EXPR_MT_INFO))
+		eq &= (m1->data_len == m2->data_len &&
+		       !memcmp(m1->data, m2->data, m1->data_len));
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_match_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_match *match = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_MT_NAME))
+		h = nftnl_hash_str(h, match->name);
+	if (e->flags & (1 << NFTNL_EXPR_MT_REV))
+		h = nftnl_hash_u32(h, match->rev);
+	if (e->flags & (1 << NFTNL_EXPR_MT_INFO))
+		h = nftnl_hash_mem(h, match->data, match->data_len);
+
+	return h;
+}
+
 struct expr_ops expr_ops_match = {
 	.name		= "match",
 	.alloc_len	= sizeof(struct nftnl_expr_match),
 	.max_attr	= NFTA_MATCH_MAX,
 	.free		= nftnl_expr_match_free,
+	.clone		= nftnl_expr_match_clone,
+	.cmp		= nftnl_expr_match_cmp,
+	.hash		= nftnl_expr_match_hash,
 	.set		= nftnl_expr_match_set,
 	.get		= nftnl_expr_match_get,
 	.parse		= nftnl_expr_match_parse,
@@ -208,10 +208,43 @@ nftnl_expr_meta_snprintf(char *buf, size_t len,
 	return 0;
 }
 
+static bool nftnl_expr_meta_cmp(const struct nftnl_expr *e1,
+				const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_meta *m1 = nftnl_expr_data(e1);
+	struct nftnl_expr_meta *m2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_META_KEY))
+		eq &= (m1->key == m2->key);
+	if (e1->flags & (1 << NFTNL_EXPR_META_DREG))
+		eq &= (m1->dreg == m2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_META_SREG))
+		eq &= (m1->sreg == m2->sreg);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_meta_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_meta *meta = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_META_KEY))
+		h = nftnl_hash_u32(h, meta->key);
+	if (e->flags & (1 << NFTNL_EXPR_META_DREG))
+		h = nftnl_hash_u32(h, meta->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_META_SREG))
+		h = nftnl_hash_u32(h, meta->sreg);
+
+	return h;
+}
+
 struct expr_ops expr_ops_meta = {
 	.name		= "meta",
 	.alloc_len	= sizeof(struct nftnl_expr_meta),
 	.max_attr	= NFTA_META_MAX,
+	.cmp		= nftnl_expr_meta_cmp,
+	.hash		= nftnl_expr_meta_hash,
 	.set		= nftnl_expr_meta_set,
 	.get		= nftnl_expr_meta_get,
 	.parse		= nftnl_expr_meta_parse,
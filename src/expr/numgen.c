@@ -172,10 +172,47 @@ nftnl_expr_ng_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_ng_cmp(const struct nftnl_expr *e1,
+			      const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_ng *n1 = nftnl_expr_data(e1);
+	struct nftnl_expr_ng *n2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_NG_DREG))
+		eq &= (n1->dreg == n2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_NG_MODULUS))
+		eq &= (n1->modulus == n2->modulus);
+	if (e1->flags & (1 << NFTNL_EXPR_NG_TYPE))
+		eq &= (n1->type == n2->type);
+	if (e1->flags & (1 << NFTNL_EXPR_NG_OFFSET))
+		eq &= (n1->offset == n2->offset);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_ng_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_ng *ng = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_NG_DREG))
+		h = nftnl_hash_u32(h, ng->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_NG_MODULUS))
+		h = nftnl_hash_u32(h, ng->modulus);
+	if (e->flags & (1 << NFTNL_EXPR_NG_TYPE))
+		h = nftnl_hash_u32(h, ng->type);
+	if (e->flags & (1 << NFTNL_EXPR_NG_OFFSET))
+		h = nftnl_hash_u32(h, ng->offset);
+
+	return h;
+}
+
 struct expr_ops expr_ops_ng = {
 	.name		= "numgen",
 	.alloc_len	= sizeof(struct nftnl_expr_ng),
 	.max_attr	= NFTA_NG_MAX,
+	.cmp		= nftnl_expr_ng_cmp,
+	.hash		= nftnl_expr_ng_hash,
 	.set		= nftnl_expr_ng_set,
 	.get		= nftnl_expr_ng_get,
 	.parse		= nftnl_expr_ng_parse,
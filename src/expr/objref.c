@@ -196,11 +196,77 @@ static void nftnl_expr_objref_free(const struct nftnl_expr *e)
 	xfree(objref->set.name);
 }
 
+static int nftnl_expr_objref_clone(struct nftnl_expr *e,
+				   const struct nftnl_expr *src)
+{
+	struct nftnl_expr_objref *objref = nftnl_expr_data(e);
+
+	if (objref->imm.name) {
+		objref->imm.name = strdup(objref->imm.name);
+		if (!objref->imm.name) {
+			e->flags &= ~(1 << NFTNL_EXPR_OBJREF_IMM_NAME);
+			e->flags &= ~(1 << NFTNL_EXPR_OBJREF_SET_NAME);
+			objref->set.name = NULL;
+			return -1;
+		}
+	}
+	if (objref->set.name) {
+		objref->set.name = strdup(objref->set.name);
+		if (!objref->set.name) {
+			e->flags &= ~(1 << NFTNL_EXPR_OBJREF_SET_NAME);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static bool nftnl_expr_objref_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_objref *o1 = nftnl_expr_data(e1);
+	struct nftnl_expr_objref *o2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_OBJREF_IMM_TYPE))
+		eq &= (o1->imm.type == o2->imm.type);
+	if (e1->flags & (1 << NFTNL_EXPR_OBJREF_IMM_NAME))
+		eq &= !strcmp(o1->imm.name, o2->imm.name);
+	if (e1->flags & (1 << NFTNL_EXPR_OBJREF_SET_SREG))
+		eq &= (o1->set.sreg == o2->set.sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_OBJREF_SET_NAME))
+		eq &= !strcmp(o1->set.name, o2->set.name);
+	if (e1->flags & (1 << NFTNL_EXPR_OBJREF_SET_ID))
+		eq &= (o1->set.id == o2->set.id);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_objref_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_objref *objref = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_OBJREF_IMM_TYPE))
+		h = nftnl_hash_u32(h, objref->imm.type);
+	if (e->flags & (1 << NFTNL_EXPR_OBJREF_IMM_NAME))
+		h = nftnl_hash_str(h, objref->imm.name);
+	if (e->flags & (1 << NFTNL_EXPR_OBJREF_SET_SREG))
+		h = nftnl_hash_u32(h, objref->set.sreg);
+	if (e->flags & (1 << NFTNL_EXPR_OBJREF_SET_NAME))
+		h = nftnl_hash_str(h, objref->set.name);
+	if (e->flags & (1 << NFTNL_EXPR_OBJREF_SET_ID))
+		h = nftnl_hash_u32(h, objref->set.id);
+
+	return h;
+}
+
 struct expr_ops expr_ops_objref = {
 	.name		= "objref",
 	.alloc_len	= sizeof(struct nftnl_expr_objref),
 	.max_attr	= NFTA_OBJREF_MAX,
 	.free		= nftnl_expr_objref_free,
+	.clone		= nftnl_expr_objref_clone,
+	.cmp		= nftnl_expr_objref_cmp,
+	.hash		= nftnl_expr_objref_hash,
 	.set		= nftnl_expr_objref_set,
 	.get		= nftnl_expr_objref_get,
 	.parse		= nftnl_expr_objref_parse,
@@ -139,10 +139,43 @@ nftnl_expr_osf_snprintf(char *buf, size_t len,
 	return offset;
 }
 
+static bool nftnl_expr_osf_cmp(const struct nftnl_expr *e1,
+			       const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_osf *o1 = nftnl_expr_data(e1);
+	struct nftnl_expr_osf *o2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_OSF_DREG))
+		eq &= (o1->dreg == o2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_OSF_TTL))
+		eq &= (o1->ttl == o2->ttl);
+	if (e1->flags & (1 << NFTNL_EXPR_OSF_FLAGS))
+		eq &= (o1->flags == o2->flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_osf_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_osf *osf = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_OSF_DREG))
+		h = nftnl_hash_u32(h, osf->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_OSF_TTL))
+		h = nftnl_hash_u32(h, osf->ttl);
+	if (e->flags & (1 << NFTNL_EXPR_OSF_FLAGS))
+		h = nftnl_hash_u32(h, osf->flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_osf = {
 	.name		= "osf",
 	.alloc_len	= sizeof(struct nftnl_expr_osf),
 	.max_attr	= NFTA_OSF_MAX,
+	.cmp		= nftnl_expr_osf_cmp,
+	.hash		= nftnl_expr_osf_hash,
 	.set		= nftnl_expr_osf_set,
 	.get		= nftnl_expr_osf_get,
 	.parse		= nftnl_expr_osf_parse,
@@ -237,10 +237,63 @@ nftnl_expr_payload_snprintf(char *buf, size_t len,
 				payload->offset, payload->dreg);
 }
 
+static bool nftnl_expr_payload_cmp(const struct nftnl_expr *e1,
+				   const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_payload *p1 = nftnl_expr_data(e1);
+	struct nftnl_expr_payload *p2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_SREG))
+		eq &= (p1->sreg == p2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_DREG))
+		eq &= (p1->dreg == p2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_BASE))
+		eq &= (p1->base == p2->base);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_OFFSET))
+		eq &= (p1->offset == p2->offset);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_LEN))
+		eq &= (p1->len == p2->len);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_CSUM_TYPE))
+		eq &= (p1->csum_type == p2->csum_type);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_CSUM_OFFSET))
+		eq &= (p1->csum_offset == p2->csum_offset);
+	if (e1->flags & (1 << NFTNL_EXPR_PAYLOAD_FLAGS))
+		eq &= (p1->csum_flags == p2->csum_flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_payload_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_payload *payload = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_SREG))
+		h = nftnl_hash_u32(h, payload->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_DREG))
+		h = nftnl_hash_u32(h, payload->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_BASE))
+		h = nftnl_hash_u32(h, payload->base);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_OFFSET))
+		h = nftnl_hash_u32(h, payload->offset);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_LEN))
+		h = nftnl_hash_u32(h, payload->len);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_CSUM_TYPE))
+		h = nftnl_hash_u32(h, payload->csum_type);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_CSUM_OFFSET))
+		h = nftnl_hash_u32(h, payload->csum_offset);
+	if (e->flags & (1 << NFTNL_EXPR_PAYLOAD_FLAGS))
+		h = nftnl_hash_u32(h, payload->csum_flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_payload = {
 	.name		= "payload",
 	.alloc_len	= sizeof(struct nftnl_expr_payload),
 	.max_attr	= NFTA_PAYLOAD_MAX,
+	.cmp		= nftnl_expr_payload_cmp,
+	.hash		= nftnl_expr_payload_hash,
 	.set		= nftnl_expr_payload_set,
 	.get		= nftnl_expr_payload_get,
 	.parse		= nftnl_expr_payload_parse,
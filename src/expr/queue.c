@@ -185,10 +185,47 @@ nftnl_expr_queue_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_queue_cmp(const struct nftnl_expr *e1,
+				 const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_queue *q1 = nftnl_expr_data(e1);
+	struct nftnl_expr_queue *q2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_QUEUE_NUM))
+		eq &= (q1->queuenum == q2->queuenum);
+	if (e1->flags & (1 << NFTNL_EXPR_QUEUE_TOTAL))
+		eq &= (q1->queues_total == q2->queues_total);
+	if (e1->flags & (1 << NFTNL_EXPR_QUEUE_FLAGS))
+		eq &= (q1->flags == q2->flags);
+	if (e1->flags & (1 << NFTNL_EXPR_QUEUE_SREG_QNUM))
+		eq &= (q1->sreg_qnum == q2->sreg_qnum);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_queue_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_queue *queue = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_QUEUE_NUM))
+		h = nftnl_hash_u32(h, queue->queuenum);
+	if (e->flags & (1 << NFTNL_EXPR_QUEUE_TOTAL))
+		h = nftnl_hash_u32(h, queue->queues_total);
+	if (e->flags & (1 << NFTNL_EXPR_QUEUE_FLAGS))
+		h = nftnl_hash_u32(h, queue->flags);
+	if (e->flags & (1 << NFTNL_EXPR_QUEUE_SREG_QNUM))
+		h = nftnl_hash_u32(h, queue->sreg_qnum);
+
+	return h;
+}
+
 struct expr_ops expr_ops_queue = {
 	.name		= "queue",
 	.alloc_len	= sizeof(struct nftnl_expr_queue),
 	.max_attr	= NFTA_QUEUE_MAX,
+	.cmp		= nftnl_expr_queue_cmp,
+	.hash		= nftnl_expr_queue_hash,
 	.set		= nftnl_expr_queue_set,
 	.get		= nftnl_expr_queue_get,
 	.parse		= nftnl_expr_queue_parse,
@@ -205,10 +205,49 @@ static int nftnl_expr_range_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_range_cmp(const struct nftnl_expr *e1,
+				 const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_range *r1 = nftnl_expr_data(e1);
+	struct nftnl_expr_range *r2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_RANGE_SREG))
+		eq &= (r1->sreg == r2->sreg);
+	if (e1->flags & (1 << NFTNL_EXPR_RANGE_OP))
+		eq &= (r1->op == r2->op);
+	if (e1->flags & (1 << NFTNL_EXPR_RANGE_FROM_DATA))
+		eq &= nftnl_data_reg_cmp(&r1->data_from,
+		      &r2->data_from, DATA_VALUE);
+	if (e1->flags & (1 << NFTNL_EXPR_RANGE_TO_DATA))
+		eq &= nftnl_data_reg_cmp(&r1->data_to,
+		      &r2->data_to, DATA_VALUE);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_range_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_range *range = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_RANGE_SREG))
+		h = nftnl_hash_u32(h, range->sreg);
+	if (e->flags & (1 << NFTNL_EXPR_RANGE_OP))
+		h = nftnl_hash_u32(h, range->op);
+	if (e->flags & (1 << NFTNL_EXPR_RANGE_FROM_DATA))
+		h = nftnl_data_reg_hash(h, &range->data_from, DATA_VALUE);
+	if (e->flags & (1 << NFTNL_EXPR_RANGE_TO_DATA))
+		h = nftnl_data_reg_hash(h, &range->data_to, DATA_VALUE);
+
+	return h;
+}
+
 struct expr_ops expr_ops_range = {
 	.name		= "range",
 	.alloc_len	= sizeof(struct nftnl_expr_range),
 	.max_attr	= NFTA_RANGE_MAX,
+	.cmp		= nftnl_expr_range_cmp,
+	.hash		= nftnl_expr_range_hash,
 	.set		= nftnl_expr_range_set,
 	.get		= nftnl_expr_range_get,
 	.parse		= nftnl_expr_range_parse,
@@ -126,10 +126,39 @@ nftnl_expr_reject_snprintf(char *buf, size_t len,
 			reject->type, reject->icmp_code);
 }
 
+static bool nftnl_expr_reject_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_reject *r1 = nftnl_expr_data(e1);
+	struct nftnl_expr_reject *r2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_REJECT_TYPE))
+		eq &= (r1->type == r2->type);
+	if (e1->flags & (1 << NFTNL_EXPR_REJECT_CODE))
+		eq &= (r1->icmp_code == r2->icmp_code);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_reject_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_reject *reject = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_REJECT_TYPE))
+		h = nftnl_hash_u32(h, reject->type);
+	if (e->flags & (1 << NFTNL_EXPR_REJECT_CODE))
+		h = nftnl_hash_u32(h, reject->icmp_code);
+
+	return h;
+}
+
 struct expr_ops expr_ops_reject = {
 	.name		= "reject",
 	.alloc_len	= sizeof(struct nftnl_expr_reject),
 	.max_attr	= NFTA_REJECT_MAX,
+	.cmp		= nftnl_expr_reject_cmp,
+	.hash		= nftnl_expr_reject_hash,
 	.set		= nftnl_expr_reject_set,
 	.get		= nftnl_expr_reject_get,
 	.parse		= nftnl_expr_reject_parse,
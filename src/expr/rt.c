@@ -154,10 +154,39 @@ nftnl_expr_rt_snprintf(char *buf, size_t len,
 	return 0;
 }
 
+static bool nftnl_expr_rt_cmp(const struct nftnl_expr *e1,
+			      const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_rt *r1 = nftnl_expr_data(e1);
+	struct nftnl_expr_rt *r2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_RT_KEY))
+		eq &= (r1->key == r2->key);
+	if (e1->flags & (1 << NFTNL_EXPR_RT_DREG))
+		eq &= (r1->dreg == r2->dreg);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_rt_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_rt *rt = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_RT_KEY))
+		h = nftnl_hash_u32(h, rt->key);
+	if (e->flags & (1 << NFTNL_EXPR_RT_DREG))
+		h = nftnl_hash_u32(h, rt->dreg);
+
+	return h;
+}
+
 struct expr_ops expr_ops_rt = {
 	.name		= "rt",
 	.alloc_len	= sizeof(struct nftnl_expr_rt),
 	.max_attr	= NFTA_RT_MAX,
+	.cmp		= nftnl_expr_rt_cmp,
+	.hash		= nftnl_expr_rt_hash,
 	.set		= nftnl_expr_rt_set,
 	.get		= nftnl_expr_rt_get,
 	.parse		= nftnl_expr_rt_parse,
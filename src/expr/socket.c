@@ -157,10 +157,43 @@ nftnl_expr_socket_snprintf(char *buf, size_t len,
 	return 0;
 }
 
+static bool nftnl_expr_socket_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_socket *s1 = nftnl_expr_data(e1);
+	struct nftnl_expr_socket *s2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_SOCKET_KEY))
+		eq &= (s1->key == s2->key);
+	if (e1->flags & (1 << NFTNL_EXPR_SOCKET_DREG))
+		eq &= (s1->dreg == s2->dreg);
+	if (e1->flags & (1 << NFTNL_EXPR_SOCKET_LEVEL))
+		eq &= (s1->level == s2->level);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_socket_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_socket *socket = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_SOCKET_KEY))
+		h = nftnl_hash_u32(h, socket->key);
+	if (e->flags & (1 << NFTNL_EXPR_SOCKET_DREG))
+		h = nftnl_hash_u32(h, socket->dreg);
+	if (e->flags & (1 << NFTNL_EXPR_SOCKET_LEVEL))
+		h = nftnl_hash_u32(h, socket->level);
+
+	return h;
+}
+
 struct expr_ops expr_ops_socket = {
 	.name		= "socket",
 	.alloc_len	= sizeof(struct nftnl_expr_socket),
 	.max_attr	= NFTA_SOCKET_MAX,
+	.cmp		= nftnl_expr_socket_cmp,
+	.hash		= nftnl_expr_socket_hash,
 	.set		= nftnl_expr_socket_set,
 	.get		= nftnl_expr_socket_get,
 	.parse		= nftnl_expr_socket_parse,
@@ -144,10 +144,43 @@ nftnl_expr_synproxy_snprintf(char *buf, size_t len,
 	return offset;
 }
 
+static bool nftnl_expr_synproxy_cmp(const struct nftnl_expr *e1,
+				    const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_synproxy *s1 = nftnl_expr_data(e1);
+	struct nftnl_expr_synproxy *s2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_SYNPROXY_MSS))
+		eq &= (s1->mss == s2->mss);
+	if (e1->flags & (1 << NFTNL_EXPR_SYNPROXY_WSCALE))
+		eq &= (s1->wscale == s2->wscale);
+	if (e1->flags & (1 << NFTNL_EXPR_SYNPROXY_FLAGS))
+		eq &= (s1->flags == s2->flags);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_synproxy_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_synproxy *synproxy = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_SYNPROXY_MSS))
+		h = nftnl_hash_u32(h, synproxy->mss);
+	if (e->flags & (1 << NFTNL_EXPR_SYNPROXY_WSCALE))
+		h = nftnl_hash_u32(h, synproxy->wscale);
+	if (e->flags & (1 << NFTNL_EXPR_SYNPROXY_FLAGS))
+		h = nftnl_hash_u32(h, synproxy->flags);
+
+	return h;
+}
+
 struct expr_ops expr_ops_synproxy = {
 	.name		= "synproxy",
 	.alloc_len	= sizeof(struct nftnl_expr_synproxy),
 	.max_attr	= NFTA_SYNPROXY_MAX,
+	.cmp		= nftnl_expr_synproxy_cmp,
+	.hash		= nftnl_expr_synproxy_hash,
 	.set		= nftnl_expr_synproxy_set,
 	.get		= nftnl_expr_synproxy_get,
 	.parse		= nftnl_expr_synproxy_parse,
@@ -180,11 +180,67 @@ static void nftnl_expr_target_free(const struct nftnl_expr *e)
 	xfree(target->data);
 }
 
+static int nftnl_expr_target_clone(struct nftnl_expr *e,
+				  const struct nftnl_expr *src)
+{
+	struct nftnl_expr_target *target = nftnl_expr_data(e);
+	void *data;
+
+	if (!target->data)
+		return 0;
+
+	data = malloc(target->data_len);
+	if (data == NULL) {
+		target->data = NULL;
+		e->flags &= ~(1 << NFTNL_EXPR_TG_INFO);
+		return -1;
+	}
+	memcpy(data, target->data, target->data_len);
+	target->data = data;
+
+	return 0;
+}
+
+static bool nftnl_expr_target_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_target *t1 = nftnl_expr_data(e1);
+	struct nftnl_expr_target *t2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_TG_NAME))
+		eq &= !strcmp(t1->name, t2->name);
+	if (e1->flags & (1 << NFTNL_EXPR_TG_REV))
+		eq &= (t1->rev == t2->rev);
+	if (e1->flags & (1 << NFTNL_EXPR_TG_INFO))
+		eq &= (t1->data_len == t2->data_len &&
+		       !memcmp(t1->data, t2->data, t1->data_len));
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_target_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_target *target = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_TG_NAME))
+		h = nftnl_hash_str(h, target->name);
+	if (e->flags & (1 << NFTNL_EXPR_TG_REV))
+		h = nftnl_hash_u32(h, target->rev);
+	if (e->flags & (1 << NFTNL_EXPR_TG_INFO))
+		h = nftnl_hash_mem(h, target->data, target->data_len);
+
+	return h;
+}
+
 struct expr_ops expr_ops_target = {
 	.name		= "target",
 	.alloc_len	= sizeof(struct nftnl_expr_target),
 	.max_attr	= NFTA_TARGET_MAX,
 	.free		= nftnl_expr_target_free,
+	.clone		= nftnl_expr_target_clone,
+	.cmp		= nftnl_expr_target_cmp,
+	.hash		= nftnl_expr_target_hash,
 	.set		= nftnl_expr_target_set,
 	.get		= nftnl_expr_target_get,
 	.parse		= nftnl_expr_target_parse,
@@ -162,10 +162,43 @@ nftnl_expr_tproxy_snprintf(char *buf, size_t remain,
 	return offset;
 }
 
+static bool nftnl_expr_tproxy_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_tproxy *t1 = nftnl_expr_data(e1);
+	struct nftnl_expr_tproxy *t2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_TPROXY_FAMILY))
+		eq &= (t1->family == t2->family);
+	if (e1->flags & (1 << NFTNL_EXPR_TPROXY_REG_ADDR))
+		eq &= (t1->sreg_addr == t2->sreg_addr);
+	if (e1->flags & (1 << NFTNL_EXPR_TPROXY_REG_PORT))
+		eq &= (t1->sreg_port == t2->sreg_port);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_tproxy_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_tproxy *tproxy = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_TPROXY_FAMILY))
+		h = nftnl_hash_u32(h, tproxy->family);
+	if (e->flags & (1 << NFTNL_EXPR_TPROXY_REG_ADDR))
+		h = nftnl_hash_u32(h, tproxy->sreg_addr);
+	if (e->flags & (1 << NFTNL_EXPR_TPROXY_REG_PORT))
+		h = nftnl_hash_u32(h, tproxy->sreg_port);
+
+	return h;
+}
+
 struct expr_ops expr_ops_tproxy = {
 	.name		= "tproxy",
 	.alloc_len	= sizeof(struct nftnl_expr_tproxy),
 	.max_attr	= NFTA_TPROXY_MAX,
+	.cmp		= nftnl_expr_tproxy_cmp,
+	.hash		= nftnl_expr_tproxy_hash,
 	.set		= nftnl_expr_tproxy_set,
 	.get		= nftnl_expr_tproxy_get,
 	.parse		= nftnl_expr_tproxy_parse,
@@ -137,10 +137,39 @@ nftnl_expr_tunnel_snprintf(char *buf, size_t len,
 	return 0;
 }
 
+static bool nftnl_expr_tunnel_cmp(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	struct nftnl_expr_tunnel *t1 = nftnl_expr_data(e1);
+	struct nftnl_expr_tunnel *t2 = nftnl_expr_data(e2);
+	bool eq = true;
+
+	if (e1->flags & (1 << NFTNL_EXPR_TUNNEL_KEY))
+		eq &= (t1->key == t2->key);
+	if (e1->flags & (1 << NFTNL_EXPR_TUNNEL_DREG))
+		eq &= (t1->dreg == t2->dreg);
+
+	return eq;
+}
+
+static uint32_t nftnl_expr_tunnel_hash(const struct nftnl_expr *e, uint32_t h)
+{
+	struct nftnl_expr_tunnel *tunnel = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_TUNNEL_KEY))
+		h = nftnl_hash_u32(h, tunnel->key);
+	if (e->flags & (1 << NFTNL_EXPR_TUNNEL_DREG))
+		h = nftnl_hash_u32(h, tunnel->dreg);
+
+	return h;
+}
+
 struct expr_ops expr_ops_tunnel = {
 	.name		= "tunnel",
 	.alloc_len	= sizeof(struct nftnl_expr_tunnel),
 	.max_attr	= NFTA_TUNNEL_MAX,
+	.cmp		= nftnl_expr_tunnel_cmp,
+	.hash		= nftnl_expr_tunnel_hash,
 	.set		= nftnl_expr_tunnel_set,
 	.get		= nftnl_expr_tunnel_get,
 	.parse		= nftnl_expr_tunnel_parse,
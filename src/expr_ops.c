@@ -92,15 +92,26 @@ static struct expr_ops *expr_ops[] = {
 	NULL,
 };
 
-struct expr_ops *nftnl_expr_ops_lookup(const char *name)
+_Static_assert(sizeof(expr_ops) / sizeof(expr_ops[0]) <= EXPR_OPS_MAX,
+	       "too many expression types, bump EXPR_OPS_MAX");
+
+struct expr_ops *nftnl_expr_ops_lookup_id(const char *name, uint32_t *id)
 {
 	int i = 0;
 
 	while (expr_ops[i] != NULL) {
-		if (strcmp(expr_ops[i]->name, name) == 0)
+		if (strcmp(expr_ops[i]->name, name) == 0) {
+			*id = i;
 			return expr_ops[i];
-
+		}
 		i++;
 	}
 	return NULL;
 }
+
+struct expr_ops *nftnl_expr_ops_lookup(const char *name)
+{
+	uint32_t id;
+
+	return nftnl_expr_ops_lookup_id(name, &id);
+}
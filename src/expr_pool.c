@@ -0,0 +1,205 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <libnftnl/expr.h>
+
+/*
+ * Expression pool: expressions of a given type always have the same size,
+ * so they are carved out of per-type slabs and recycled through free lists
+ * instead of going back to the heap. Each thread keeps its own free list per
+ * type, which is refilled from and drained to a shared per-type depot in
+ * batches. Slab memory is kept for the lifetime of the process.
+ */
+
+#define EXPR_POOL_BATCH		64	/* objects moved per depot transfer */
+#define EXPR_POOL_CACHE_MAX	(4 * EXPR_POOL_BATCH)
+
+struct expr_pool_obj {
+	struct expr_pool_obj	*next;
+};
+
+struct expr_pool_depot {
+	pthread_mutex_t		lock;
+	struct expr_pool_obj	*head;
+};
+
+struct expr_pool_cache {
+	struct expr_pool_obj	*head;
+	uint32_t		count;
+};
+
+static struct expr_pool_depot expr_pool_depot[EXPR_OPS_MAX];
+static pthread_mutex_t expr_pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t expr_pool_key;
+static bool expr_pool_enabled;
+
+static __thread struct expr_pool_cache expr_pool_cache[EXPR_OPS_MAX];
+static __thread bool expr_pool_thread_init;
+
+bool nftnl_expr_pool_enabled(void)
+{
+	return __atomic_load_n(&expr_pool_enabled, __ATOMIC_RELAXED);
+}
+
+static void expr_pool_depot_push(uint32_t id, struct expr_pool_obj *first,
+				 struct expr_pool_obj *last)
+{
+	struct expr_pool_depot *depot = &expr_pool_depot[id];
+
+	pthread_mutex_lock(&depot->lock);
+	last->next = depot->head;
+	depot->head = first;
+	pthread_mutex_unlock(&depot->lock);
+}
+
+/* Give back the cached objects of an exiting thread. */
+static void expr_pool_thread_exit(void *data)
+{
+	struct expr_pool_cache *cache;
+	struct expr_pool_obj *last;
+	uint32_t id;
+
+	for (id = 0; id < EXPR_OPS_MAX; id++) {
+		cache = &expr_pool_cache[id];
+		if (cache->head == NULL)
+			continue;
+
+		for (last = cache->head; last->next; last = last->next)
+			;
+
+		expr_pool_depot_push(id, cache->head, last);
+		cache->head = NULL;
+		cache->count = 0;
+	}
+}
+
+static void expr_pool_thread_register(void)
+{
+	if (expr_pool_thread_init)
+		return;
+
+	pthread_setspecific(expr_pool_key, expr_pool_cache);
+	expr_pool_thread_init = true;
+}
+
+static int expr_pool_refill(struct expr_pool_cache *cache,
+			    const struct expr_ops *ops, uint32_t id)
+{
+	struct expr_pool_depot *depot = &expr_pool_depot[id];
+	uint32_t size = nftnl_expr_size(ops);
+	struct expr_pool_obj *obj;
+	char *slab;
+	int i;
+
+	expr_pool_thread_register();
+
+	pthread_mutex_lock(&depot->lock);
+	for (i = 0; i < EXPR_POOL_BATCH && depot->head; i++) {
+		obj = depot->head;
+		depot->head = obj->next;
+		obj->next = cache->head;
+		cache->head = obj;
+		cache->count++;
+	}
+	pthread_mutex_unlock(&depot->lock);
+
+	if (cache->head)
+		return 0;
+
+	slab = malloc(size * EXPR_POOL_BATCH);
+	if (slab == NULL)
+		return -1;
+
+	for (i = 0; i < EXPR_POOL_BATCH; i++) {
+		obj = (struct expr_pool_obj *)(slab + i * size);
+		obj->next = cache->head;
+		cache->head = obj;
+	}
+	cache->count += EXPR_POOL_BATCH;
+
+	return 0;
+}
+
+struct nftnl_expr *nftnl_expr_pool_get(const struct expr_ops *ops, uint32_t id)
+{
+	struct expr_pool_cache *cache = &expr_pool_cache[id];
+	struct nftnl_expr *expr;
+
+	if (cache->head == NULL && expr_pool_refill(cache, ops, id) < 0)
+		return NULL;
+
+	expr = (struct nftnl_expr *)cache->head;
+	cache->head = cache->head->next;
+	cache->count--;
+
+	memset(expr, 0, nftnl_expr_size(ops));
+	expr->pool = id + 1;
+
+	return expr;
+}
+
+void nftnl_expr_pool_put(struct nftnl_expr *expr)
+{
+	uint32_t id = expr->pool - 1;
+	struct expr_pool_cache *cache = &expr_pool_cache[id];
+	struct expr_pool_obj *obj = (struct expr_pool_obj *)expr;
+	struct expr_pool_obj *first, *last;
+	uint32_t i;
+
+	expr_pool_thread_register();
+
+	obj->next = cache->head;
+	cache->head = obj;
+	cache->count++;
+
+	if (cache->count <= EXPR_POOL_CACHE_MAX)
+		return;
+
+	/* Too many cached objects in this thread, hand a batch back. */
+	first = last = cache->head;
+	for (i = 1; i < EXPR_POOL_BATCH; i++)
+		last = last->next;
+
+	cache->head = last->next;
+	cache->count -= EXPR_POOL_BATCH;
+	expr_pool_depot_push(id, first, last);
+}
+
+EXPORT_SYMBOL(nftnl_expr_pool_enable);
+int nftnl_expr_pool_enable(void)
+{
+	static bool init;
+	int i;
+
+	pthread_mutex_lock(&expr_pool_init_lock);
+	if (!init) {
+		if (pthread_key_create(&expr_pool_key,
+				       expr_pool_thread_exit) != 0) {
+			pthread_mutex_unlock(&expr_pool_init_lock);
+			return -1;
+		}
+		for (i = 0; i < EXPR_OPS_MAX; i++)
+			pthread_mutex_init(&expr_pool_depot[i].lock, NULL);
+
+		init = true;
+	}
+	__atomic_store_n(&expr_pool_enabled, true, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&expr_pool_init_lock);
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_expr_pool_disable);
+void nftnl_expr_pool_disable(void)
+{
+	__atomic_store_n(&expr_pool_enabled, false, __ATOMIC_RELEASE);
+}
@@ -1,4 +1,5 @@
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -309,6 +310,17 @@ const char *const *nftnl_flowtable_get_array(const struct nftnl_flowtable *c, ui
 	return val;
 }
 
+EXPORT_SYMBOL(nftnl_flowtable_nlmsg_build_dump_filter);
+void nftnl_flowtable_nlmsg_build_dump_filter(struct nlmsghdr *nlh,
+					     uint32_t family, const char *table)
+{
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+
+	nfg->nfgen_family = family;
+	if (table)
+		mnl_attr_put_strz(nlh, NFTA_FLOWTABLE_TABLE, table);
+}
+
 EXPORT_SYMBOL(nftnl_flowtable_nlmsg_build_payload);
 void nftnl_flowtable_nlmsg_build_payload(struct nlmsghdr *nlh,
 					 const struct nftnl_flowtable *c)
@@ -719,6 +731,61 @@ void nftnl_flowtable_list_del(struct nftnl_flowtable *s)
 	list_del(&s->head);
 }
 
+static int nftnl_flowtable_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_flowtable_list *list = data;
+	struct nftnl_flowtable *f;
+
+	f = nftnl_flowtable_alloc();
+	if (f == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_flowtable_nlmsg_parse(nlh, f) < 0) {
+		nftnl_flowtable_free(f);
+		return MNL_CB_ERROR;
+	}
+	nftnl_flowtable_list_add_tail(f, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_flowtable_dump_reset(void *data)
+{
+	struct nftnl_flowtable_list *list = data;
+	struct nftnl_flowtable *f, *tmp;
+
+	list_for_each_entry_safe(f, tmp, &list->list, head) {
+		nftnl_flowtable_list_del(f);
+		nftnl_flowtable_free(f);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_flowtable_list_dump);
+int nftnl_flowtable_list_dump(struct nftnl_flowtable_list *list,
+			      struct mnl_socket *nl, uint32_t family,
+			      const char *table)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_flowtable_list *dump;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_flowtable_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETFLOWTABLE, family,
+				    NLM_F_DUMP, time(NULL));
+	nftnl_flowtable_nlmsg_build_dump_filter(nlh, family, table);
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_flowtable_dump_cb,
+			       nftnl_flowtable_dump_reset, dump);
+	if (ret == 0)
+		list_splice_init(&dump->list, list->list.prev);
+	nftnl_flowtable_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_flowtable_list_foreach);
 int nftnl_flowtable_list_foreach(struct nftnl_flowtable_list *flowtable_list,
 				 int (*cb)(struct nftnl_flowtable *t, void *data), void *data)
@@ -733,3 +800,54 @@ int nftnl_flowtable_list_foreach(struct nftnl_flowtable_list *flowtable_list,
 	}
 	return 0;
 }
+
+EXPORT_SYMBOL(nftnl_flowtable_list_iter_init);
+void nftnl_flowtable_list_iter_init(struct nftnl_flowtable_list_iter *iter,
+				    const struct nftnl_flowtable_list *l)
+{
+	iter->list = l;
+	if (nftnl_flowtable_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_flowtable,
+				       head);
+}
+
+EXPORT_SYMBOL(nftnl_flowtable_list_iter_create);
+struct nftnl_flowtable_list_iter *
+nftnl_flowtable_list_iter_create(const struct nftnl_flowtable_list *l)
+{
+	struct nftnl_flowtable_list_iter *iter;
+
+	iter = calloc(1, sizeof(struct nftnl_flowtable_list_iter));
+	if (iter == NULL)
+		return NULL;
+
+	nftnl_flowtable_list_iter_init(iter, l);
+
+	return iter;
+}
+
+EXPORT_SYMBOL(nftnl_flowtable_list_iter_next);
+struct nftnl_flowtable *
+nftnl_flowtable_list_iter_next(struct nftnl_flowtable_list_iter *iter)
+{
+	struct nftnl_flowtable *f = iter->cur;
+
+	if (f == NULL)
+		return NULL;
+
+	/* get next flowtable, if any */
+	iter->cur = list_entry(iter->cur->head.next, struct nftnl_flowtable,
+			       head);
+	if (&iter->cur->head == iter->list->list.next)
+		return NULL;
+
+	return f;
+}
+
+EXPORT_SYMBOL(nftnl_flowtable_list_iter_destroy);
+void nftnl_flowtable_list_iter_destroy(struct nftnl_flowtable_list_iter *iter)
+{
+	xfree(iter);
+}
@@ -0,0 +1,279 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/interval.h>
+#include <libnftnl/set.h>
+
+/* Large enough for IPv6 addresses. */
+#define INTERVAL_KEY_MAXLEN	16
+
+struct interval_range {
+	uint8_t			from[INTERVAL_KEY_MAXLEN];
+	uint8_t			to[INTERVAL_KEY_MAXLEN];
+};
+
+struct nftnl_interval {
+	uint32_t		key_len;
+	uint32_t		num;
+	uint32_t		size;
+	/* ranges are sorted, merged and no longer overlap */
+	bool			normal;
+	struct interval_range	*ranges;
+};
+
+EXPORT_SYMBOL(nftnl_interval_alloc);
+struct nftnl_interval *nftnl_interval_alloc(uint32_t key_len)
+{
+	struct nftnl_interval *iv;
+
+	if (key_len == 0 || key_len > INTERVAL_KEY_MAXLEN) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	iv = calloc(1, sizeof(struct nftnl_interval));
+	if (iv == NULL)
+		return NULL;
+
+	iv->key_len = key_len;
+	iv->normal = true;
+
+	return iv;
+}
+
+EXPORT_SYMBOL(nftnl_interval_free);
+void nftnl_interval_free(struct nftnl_interval *iv)
+{
+	xfree(iv->ranges);
+	xfree(iv);
+}
+
+static struct interval_range *interval_range_add(struct nftnl_interval *iv)
+{
+	struct interval_range *ranges;
+	uint32_t size;
+
+	if (iv->num == iv->size) {
+		size = iv->size ? iv->size * 2 : 64;
+		ranges = realloc(iv->ranges, size * sizeof(*ranges));
+		if (ranges == NULL)
+			return NULL;
+
+		iv->ranges = ranges;
+		iv->size = size;
+	}
+
+	iv->normal = false;
+	return &iv->ranges[iv->num++];
+}
+
+EXPORT_SYMBOL(nftnl_interval_add_range);
+int nftnl_interval_add_range(struct nftnl_interval *iv, const void *from,
+			     const void *to)
+{
+	struct interval_range *r;
+
+	if (memcmp(from, to, iv->key_len) > 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	r = interval_range_add(iv);
+	if (r == NULL)
+		return -1;
+
+	memcpy(r->from, from, iv->key_len);
+	memcpy(r->to, to, iv->key_len);
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_interval_add_prefix);
+int nftnl_interval_add_prefix(struct nftnl_interval *iv, const void *addr,
+			      uint32_t prefix_len)
+{
+	const uint8_t *key = addr;
+	struct interval_range *r;
+	uint8_t mask;
+	uint32_t i;
+
+	if (prefix_len > iv->key_len * 8) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	r = interval_range_add(iv);
+	if (r == NULL)
+		return -1;
+
+	for (i = 0; i < iv->key_len; i++) {
+		if (prefix_len >= 8)
+			mask = 0xff;
+		else
+			mask = ~(0xff >> prefix_len);
+
+		r->from[i] = key[i] & mask;
+		r->to[i] = key[i] | ~mask;
+		prefix_len = prefix_len >= 8 ? prefix_len - 8 : 0;
+	}
+
+	return 0;
+}
+
+/*
+ * LSD radix sort on the first key of each range, one byte per pass. Passes
+ * over bytes that are the same in all keys, such as the high bytes of
+ * addresses from a few networks, are skipped.
+ */
+static int interval_sort(struct nftnl_interval *iv)
+{
+	struct interval_range *src = iv->ranges, *dst, *tmp;
+	uint32_t count[256], i, pos, sum;
+	int byte;
+
+	/* keep the capacity, ranges may be added after the sort */
+	dst = malloc(iv->size * sizeof(*dst));
+	if (dst == NULL)
+		return -1;
+
+	for (byte = iv->key_len - 1; byte >= 0; byte--) {
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < iv->num; i++)
+			count[src[i].from[byte]]++;
+
+		if (count[src[0].from[byte]] == iv->num)
+			continue;
+
+		for (i = 0, sum = 0; i < 256; i++) {
+			pos = count[i];
+			count[i] = sum;
+			sum += pos;
+		}
+		for (i = 0; i < iv->num; i++)
+			dst[count[src[i].from[byte]]++] = src[i];
+
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	iv->ranges = src;
+	xfree(dst);
+	return 0;
+}
+
+/* Set @key to @key + 1, returns false if it wraps around. */
+static bool interval_key_inc(uint8_t *key, uint32_t len)
+{
+	while (len-- > 0) {
+		if (++key[len] != 0)
+			return true;
+	}
+	return false;
+}
+
+/* Merge sorted ranges that overlap or are adjacent. */
+static void interval_merge(struct nftnl_interval *iv)
+{
+	struct interval_range *cur = iv->ranges, *r;
+	uint8_t next[INTERVAL_KEY_MAXLEN];
+	uint32_t len = iv->key_len, i;
+
+	for (i = 1; i < iv->num; i++) {
+		r = &iv->ranges[i];
+
+		memcpy(next, cur->to, len);
+		if (!interval_key_inc(next, len) ||
+		    memcmp(r->from, next, len) <= 0) {
+			if (memcmp(r->to, cur->to, len) > 0)
+				memcpy(cur->to, r->to, len);
+			continue;
+		}
+		*(++cur) = *r;
+	}
+
+	iv->num = cur - iv->ranges + 1;
+}
+
+static int interval_normalize(struct nftnl_interval *iv)
+{
+	if (iv->normal)
+		return 0;
+
+	if (interval_sort(iv) < 0)
+		return -1;
+
+	interval_merge(iv);
+	iv->normal = true;
+
+	return 0;
+}
+
+static int interval_elem_add(struct nftnl_set *s, const void *key,
+			     uint32_t key_len, const void *key_end,
+			     uint32_t flags)
+{
+	struct nftnl_set_elem *e;
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return -1;
+
+	nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, key, key_len);
+	if (key_end)
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY_END, key_end, key_len);
+	if (flags)
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_FLAGS, flags);
+
+	nftnl_set_elem_add(s, e);
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_interval_set_elems);
+int nftnl_interval_set_elems(struct nftnl_interval *iv, struct nftnl_set *s,
+			     uint32_t flags)
+{
+	uint8_t end[INTERVAL_KEY_MAXLEN];
+	struct interval_range *r;
+	uint32_t i;
+
+	if (iv->num == 0)
+		return 0;
+
+	if (interval_normalize(iv) < 0)
+		return -1;
+
+	for (i = 0; i < iv->num; i++) {
+		r = &iv->ranges[i];
+
+		if (flags & NFTNL_INTERVAL_F_KEY_END) {
+			if (interval_elem_add(s, r->from, iv->key_len,
+					      r->to, 0) < 0)
+				return -1;
+			continue;
+		}
+
+		/* The interval is closed by the first key past its end. */
+		if (interval_elem_add(s, r->from, iv->key_len, NULL, 0) < 0)
+			return -1;
+
+		memcpy(end, r->to, iv->key_len);
+		if (interval_key_inc(end, iv->key_len) &&
+		    interval_elem_add(s, end, iv->key_len, NULL,
+				      NFT_SET_ELEM_INTERVAL_END) < 0)
+			return -1;
+	}
+
+	return iv->num;
+}
@@ -0,0 +1,801 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#define _GNU_SOURCE
+#include "internal.h"
+#include "cache.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/monitor.h>
+#include <libnftnl/cache.h>
+#include <libnftnl/set.h>
+
+/* Large enough for the datagrams the kernel sends events in. */
+#define MON_SLOT_SIZE		8192
+/*
+ * Events lost to an overflow outside of a transaction, one that did not bump
+ * the generation: elements the packet path added, objects reset.
+ */
+#define MON_LOST_TYPES		(NFTNL_CACHE_SETELEM | NFTNL_CACHE_OBJ)
+/* Elements with larger attributes are delivered right away. */
+#define MON_ELEM_MAXLEN		512
+#define MON_SETS_SIZE		64
+
+struct nftnl_monitor_event {
+	uint16_t			type;
+	uint32_t			family;
+	const struct nlmsghdr		*nlh;
+	/* set elements */
+	const char			*table;
+	const char			*set;
+	const struct nlattr		*elem;
+	const void			*key;
+	uint32_t			key_len;
+	const void			*key_end;
+	uint32_t			key_end_len;
+	uint32_t			elem_flags;
+};
+
+/* Names of the sets with held elements, held elements point to them. */
+struct mon_set {
+	struct mon_set			*next;
+	uint32_t			hash;
+	uint32_t			family;
+	char				*table;
+	char				*name;
+};
+
+struct mon_held {
+	struct list_head		head;
+	struct mon_held			*next;
+	uint32_t			hash;
+	uint64_t			due;
+	/* in the kernel before the first event held for it */
+	bool				existed;
+	const struct mon_set		*set;
+	struct nftnl_monitor_event	ev;
+	uint32_t			elem[MON_ELEM_MAXLEN / sizeof(uint32_t)];
+};
+
+struct nftnl_monitor {
+	struct mnl_socket		*nl;
+	nftnl_monitor_cb_t		cb;
+	void				*data;
+
+	char				*buf;
+	uint32_t			num_slots;
+	struct mmsghdr			*msgs;
+	struct iovec			*iovs;
+	struct sockaddr_nl		*addrs;
+
+	uint32_t			window;
+	/* held elements, oldest first, and unused ones */
+	struct list_head		held;
+	struct list_head		unused;
+	struct mon_held			**buckets;
+	uint32_t			num_buckets;
+	uint32_t			num_held;
+	struct mon_set			*sets[MON_SETS_SIZE];
+
+	/* kept up to date from events, dumped again over dump_nl */
+	struct nftnl_cache		*cache;
+	struct mnl_socket		*dump_nl;
+
+	uint64_t			events;
+	uint64_t			delivered;
+	uint64_t			coalesced;
+	uint64_t			drops;
+	uint64_t			resyncs;
+};
+
+static uint64_t mon_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_alloc);
+struct nftnl_monitor *nftnl_monitor_alloc(struct mnl_socket *nl, size_t size,
+					  nftnl_monitor_cb_t cb, void *data)
+{
+	struct nftnl_monitor *mon;
+	uint32_t i;
+
+	if (size < MON_SLOT_SIZE) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	mon = calloc(1, sizeof(struct nftnl_monitor));
+	if (mon == NULL)
+		return NULL;
+
+	mon->nl = nl;
+	mon->cb = cb;
+	mon->data = data;
+	mon->num_slots = size / MON_SLOT_SIZE;
+	INIT_LIST_HEAD(&mon->held);
+	INIT_LIST_HEAD(&mon->unused);
+
+	mon->num_buckets = 64;
+	mon->buckets = calloc(mon->num_buckets, sizeof(struct mon_held *));
+	mon->buf = malloc(mon->num_slots * MON_SLOT_SIZE);
+	mon->msgs = calloc(mon->num_slots, sizeof(struct mmsghdr));
+	mon->iovs = calloc(mon->num_slots, sizeof(struct iovec));
+	mon->addrs = calloc(mon->num_slots, sizeof(struct sockaddr_nl));
+	if (!mon->buckets || !mon->buf || !mon->msgs || !mon->iovs ||
+	    !mon->addrs) {
+		nftnl_monitor_free(mon);
+		return NULL;
+	}
+
+	for (i = 0; i < mon->num_slots; i++) {
+		mon->iovs[i].iov_base = mon->buf + i * MON_SLOT_SIZE;
+		mon->iovs[i].iov_len = MON_SLOT_SIZE;
+		mon->msgs[i].msg_hdr.msg_iov = &mon->iovs[i];
+		mon->msgs[i].msg_hdr.msg_iovlen = 1;
+		mon->msgs[i].msg_hdr.msg_name = &mon->addrs[i];
+		mon->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_nl);
+	}
+
+	return mon;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_free);
+void nftnl_monitor_free(struct nftnl_monitor *mon)
+{
+	struct mon_held *h, *next;
+	struct mon_set *s, *snext;
+	uint32_t i;
+
+	list_splice_init(&mon->unused, &mon->held);
+	list_for_each_entry_safe(h, next, &mon->held, head)
+		xfree(h);
+
+	for (i = 0; i < MON_SETS_SIZE; i++) {
+		for (s = mon->sets[i]; s; s = snext) {
+			snext = s->next;
+			xfree(s->table);
+			xfree(s->name);
+			xfree(s);
+		}
+	}
+
+	xfree(mon->buckets);
+	xfree(mon->buf);
+	xfree(mon->msgs);
+	xfree(mon->iovs);
+	xfree(mon->addrs);
+	xfree(mon);
+}
+
+EXPORT_SYMBOL(nftnl_monitor_set_u32);
+void nftnl_monitor_set_u32(struct nftnl_monitor *mon, uint16_t attr,
+			   uint32_t val)
+{
+	switch (attr) {
+	case NFTNL_MONITOR_WINDOW:
+		mon->window = val;
+		break;
+	}
+}
+
+EXPORT_SYMBOL(nftnl_monitor_get_u32);
+uint32_t nftnl_monitor_get_u32(const struct nftnl_monitor *mon, uint16_t attr)
+{
+	switch (attr) {
+	case NFTNL_MONITOR_WINDOW:
+		return mon->window;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_get_u64);
+uint64_t nftnl_monitor_get_u64(const struct nftnl_monitor *mon, uint16_t attr)
+{
+	switch (attr) {
+	case NFTNL_MONITOR_EVENTS:
+		return mon->events;
+	case NFTNL_MONITOR_DELIVERED:
+		return mon->delivered;
+	case NFTNL_MONITOR_COALESCED:
+		return mon->coalesced;
+	case NFTNL_MONITOR_DROPS:
+		return mon->drops;
+	case NFTNL_MONITOR_RESYNCS:
+		return mon->resyncs;
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_set_cache);
+void nftnl_monitor_set_cache(struct nftnl_monitor *mon,
+			     struct nftnl_cache *cache,
+			     struct mnl_socket *dump_nl)
+{
+	mon->cache = cache;
+	mon->dump_nl = dump_nl;
+}
+
+/* Events the cache could not apply leave it stale, for mon_resync(). */
+static int mon_apply(struct nftnl_monitor *mon,
+		     const struct nftnl_monitor_event *ev)
+{
+	int ret;
+
+	if (ev->nlh)
+		ret = nftnl_cache_apply(mon->cache, ev->nlh);
+	else
+		ret = nftnl_cache_apply_elem(mon->cache, ev->type, ev->family,
+					     ev->table, ev->set, ev->elem);
+
+	return ret < 0 && errno != ESTALE ? -1 : 0;
+}
+
+static int mon_deliver(struct nftnl_monitor *mon,
+		       const struct nftnl_monitor_event *ev)
+{
+	if (mon->cache && mon_apply(mon, ev) < 0)
+		return -1;
+
+	mon->delivered++;
+	if (mon->cb(ev, mon->data) < 0) {
+		errno = ECANCELED;
+		return -1;
+	}
+	return 0;
+}
+
+static void mon_unhold(struct nftnl_monitor *mon, struct mon_held *h)
+{
+	struct mon_held **p;
+
+	for (p = &mon->buckets[h->hash & (mon->num_buckets - 1)]; *p;
+	     p = &(*p)->next) {
+		if (*p == h) {
+			*p = h->next;
+			break;
+		}
+	}
+	list_move(&h->head, &mon->unused);
+	mon->num_held--;
+}
+
+/* Deliver held elements due by @now, all of them if @now is UINT64_MAX. */
+static int mon_release(struct nftnl_monitor *mon, uint64_t now)
+{
+	struct mon_held *h, *next;
+
+	list_for_each_entry_safe(h, next, &mon->held, head) {
+		if (h->due > now)
+			break;
+
+		mon_unhold(mon, h);
+		if (mon_deliver(mon, &h->ev) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static const void *mon_data_value(const struct nlattr *nest, uint32_t *len)
+{
+	struct nlattr *attr;
+
+	mnl_attr_for_each_nested(attr, nest) {
+		if (mnl_attr_get_type(attr) == NFTA_DATA_VALUE) {
+			*len = mnl_attr_get_payload_len(attr);
+			return mnl_attr_get_payload(attr);
+		}
+	}
+	*len = 0;
+	return NULL;
+}
+
+/* Point the key of @ev into its element attribute, and get its flags. */
+static void mon_elem_keys(struct nftnl_monitor_event *ev)
+{
+	struct nlattr *attr;
+
+	ev->key = ev->key_end = NULL;
+	ev->key_len = ev->key_end_len = 0;
+	ev->elem_flags = 0;
+
+	mnl_attr_for_each_nested(attr, ev->elem) {
+		switch (mnl_attr_get_type(attr)) {
+		case NFTA_SET_ELEM_KEY:
+			ev->key = mon_data_value(attr, &ev->key_len);
+			break;
+		case NFTA_SET_ELEM_KEY_END:
+			ev->key_end = mon_data_value(attr, &ev->key_end_len);
+			break;
+		case NFTA_SET_ELEM_FLAGS:
+			if (mnl_attr_get_payload_len(attr) == sizeof(uint32_t))
+				ev->elem_flags = ntohl(mnl_attr_get_u32(attr));
+			break;
+		}
+	}
+}
+
+static uint32_t mon_set_hash(uint32_t family, const char *table,
+			     const char *name)
+{
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, family);
+	h = nftnl_hash_str(h, table);
+	h = nftnl_hash_str(h, name);
+	return nftnl_hash_final(h);
+}
+
+static const struct mon_set *mon_set_get(struct nftnl_monitor *mon,
+					 uint32_t family, const char *table,
+					 const char *name)
+{
+	uint32_t hash = mon_set_hash(family, table, name);
+	struct mon_set *s;
+
+	for (s = mon->sets[hash % MON_SETS_SIZE]; s; s = s->next) {
+		if (s->hash == hash && s->family == family &&
+		    !strcmp(s->table, table) && !strcmp(s->name, name))
+			return s;
+	}
+
+	s = calloc(1, sizeof(struct mon_set));
+	if (s == NULL)
+		return NULL;
+
+	s->hash = hash;
+	s->family = family;
+	s->table = strdup(table);
+	s->name = strdup(name);
+	if (!s->table || !s->name) {
+		xfree(s->table);
+		xfree(s->name);
+		xfree(s);
+		return NULL;
+	}
+
+	s->next = mon->sets[hash % MON_SETS_SIZE];
+	mon->sets[hash % MON_SETS_SIZE] = s;
+	return s;
+}
+
+static uint32_t mon_held_hash(const struct mon_set *set,
+			      const struct nftnl_monitor_event *ev)
+{
+	uint32_t h;
+
+	/* the end of an interval is not the same element as its start */
+	h = nftnl_hash_u64(0, (uintptr_t)set);
+	h = nftnl_hash_u32(h, ev->elem_flags & NFT_SET_ELEM_INTERVAL_END);
+	h = nftnl_hash_mem(h, ev->key, ev->key_len);
+	h = nftnl_hash_mem(h, ev->key_end, ev->key_end_len);
+	return nftnl_hash_final(h);
+}
+
+static struct mon_held *mon_held_find(const struct nftnl_monitor *mon,
+				      const struct mon_set *set, uint32_t hash,
+				      const struct nftnl_monitor_event *ev)
+{
+	struct mon_held *h;
+
+	for (h = mon->buckets[hash & (mon->num_buckets - 1)]; h; h = h->next) {
+		if (h->hash == hash && h->set == set &&
+		    (h->ev.elem_flags & NFT_SET_ELEM_INTERVAL_END) ==
+		    (ev->elem_flags & NFT_SET_ELEM_INTERVAL_END) &&
+		    h->ev.key_len == ev->key_len &&
+		    h->ev.key_end_len == ev->key_end_len &&
+		    !memcmp(h->ev.key, ev->key, ev->key_len) &&
+		    !memcmp(h->ev.key_end, ev->key_end, ev->key_end_len))
+			return h;
+	}
+	return NULL;
+}
+
+static int mon_grow(struct nftnl_monitor *mon)
+{
+	uint32_t size = mon->num_buckets * 2, i;
+	struct mon_held **buckets, *h, *next;
+
+	buckets = calloc(size, sizeof(struct mon_held *));
+	if (buckets == NULL)
+		return -1;
+
+	for (i = 0; i < mon->num_buckets; i++) {
+		for (h = mon->buckets[i]; h; h = next) {
+			next = h->next;
+			h->next = buckets[h->hash & (size - 1)];
+			buckets[h->hash & (size - 1)] = h;
+		}
+	}
+
+	xfree(mon->buckets);
+	mon->buckets = buckets;
+	mon->num_buckets = size;
+	return 0;
+}
+
+static void mon_held_set(struct mon_held *h, const struct mon_set *set,
+			 const struct nftnl_monitor_event *ev)
+{
+	memcpy(h->elem, ev->elem, ev->elem->nla_len);
+	h->ev = *ev;
+	h->ev.table = set->table;
+	h->ev.set = set->name;
+	h->ev.elem = (const struct nlattr *)h->elem;
+	mon_elem_keys(&h->ev);
+}
+
+static int mon_hold(struct nftnl_monitor *mon, const struct mon_set *set,
+		    uint32_t hash, const struct nftnl_monitor_event *ev,
+		    uint64_t now)
+{
+	struct mon_held *h;
+
+	if (mon->num_held >= mon->num_buckets && mon_grow(mon) < 0)
+		return -1;
+
+	if (list_empty(&mon->unused)) {
+		h = malloc(sizeof(struct mon_held));
+		if (h == NULL)
+			return -1;
+	} else {
+		h = list_entry(mon->unused.next, struct mon_held, head);
+		list_del(&h->head);
+	}
+
+	mon_held_set(h, set, ev);
+	h->set = set;
+	h->hash = hash;
+	h->due = now + mon->window;
+
+	/*
+	 * A new element may have been there already, only the cache can tell.
+	 * Without one, it is taken to be new.
+	 */
+	if (ev->type == NFT_MSG_DELSETELEM)
+		h->existed = true;
+	else
+		h->existed = mon->cache &&
+			     nftnl_cache_has_elem(mon->cache, ev->family,
+						  ev->table, ev->set,
+						  ev->elem);
+
+	h->next = mon->buckets[hash & (mon->num_buckets - 1)];
+	mon->buckets[hash & (mon->num_buckets - 1)] = h;
+	list_add_tail(&h->head, &mon->held);
+	mon->num_held++;
+	return 0;
+}
+
+/*
+ * An element added and deleted again within the window cancels out, unless
+ * it was there before. Otherwise the last event of an element replaces the
+ * earlier one, which is delivered when the first one would have been.
+ */
+static int mon_elem(struct nftnl_monitor *mon, struct nftnl_monitor_event *ev,
+		    uint64_t now)
+{
+	const struct mon_set *set;
+	struct mon_held *h;
+	uint32_t hash;
+
+	mon->events++;
+	mon_elem_keys(ev);
+
+	if (mon->window == 0 || ev->elem->nla_len > MON_ELEM_MAXLEN) {
+		if (mon_release(mon, UINT64_MAX) < 0)
+			return -1;
+		return mon_deliver(mon, ev);
+	}
+
+	set = mon_set_get(mon, ev->family, ev->table, ev->set);
+	if (set == NULL)
+		return -1;
+
+	hash = mon_held_hash(set, ev);
+	h = mon_held_find(mon, set, hash, ev);
+	if (h == NULL)
+		return mon_hold(mon, set, hash, ev, now);
+
+	mon->coalesced++;
+	if (!h->existed && ev->type == NFT_MSG_DELSETELEM) {
+		mon_unhold(mon, h);
+		mon->coalesced++;
+		return 0;
+	}
+
+	mon_held_set(h, set, ev);
+	return 0;
+}
+
+static int mon_elems_attr_cb(const struct nlattr *attr, void *data)
+{
+	const struct nlattr **tb = data;
+	int type = mnl_attr_get_type(attr);
+
+	if (mnl_attr_type_valid(attr, NFTA_SET_ELEM_LIST_MAX) < 0)
+		return MNL_CB_OK;
+
+	switch (type) {
+	case NFTA_SET_ELEM_LIST_TABLE:
+	case NFTA_SET_ELEM_LIST_SET:
+		if (mnl_attr_validate(attr, MNL_TYPE_STRING) < 0)
+			return MNL_CB_OK;
+		break;
+	case NFTA_SET_ELEM_LIST_ELEMENTS:
+		if (mnl_attr_validate(attr, MNL_TYPE_NESTED) < 0)
+			return MNL_CB_OK;
+		break;
+	}
+
+	tb[type] = attr;
+	return MNL_CB_OK;
+}
+
+static int mon_elems(struct nftnl_monitor *mon, const struct nlmsghdr *nlh,
+		     uint64_t now)
+{
+	struct nlattr *tb[NFTA_SET_ELEM_LIST_MAX + 1] = {};
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+	struct nftnl_monitor_event ev = {
+		.type	= NFNL_MSG_TYPE(nlh->nlmsg_type),
+		.family	= nfg->nfgen_family,
+	};
+	struct nlattr *attr;
+
+	if (mnl_attr_parse(nlh, sizeof(*nfg), mon_elems_attr_cb, tb) < 0)
+		return -1;
+
+	if (!tb[NFTA_SET_ELEM_LIST_TABLE] || !tb[NFTA_SET_ELEM_LIST_SET] ||
+	    !tb[NFTA_SET_ELEM_LIST_ELEMENTS]) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ev.table = mnl_attr_get_str(tb[NFTA_SET_ELEM_LIST_TABLE]);
+	ev.set = mnl_attr_get_str(tb[NFTA_SET_ELEM_LIST_SET]);
+
+	mnl_attr_for_each_nested(attr, tb[NFTA_SET_ELEM_LIST_ELEMENTS]) {
+		if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM)
+			continue;
+
+		ev.elem = attr;
+		if (mon_elem(mon, &ev, now) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int mon_msg(struct nftnl_monitor *mon, const struct nlmsghdr *nlh,
+		   uint64_t now)
+{
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+	struct nftnl_monitor_event ev = {
+		.type	= NFNL_MSG_TYPE(nlh->nlmsg_type),
+		.family	= nfg->nfgen_family,
+		.nlh	= nlh,
+	};
+
+	if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES)
+		return 0;
+
+	switch (ev.type) {
+	case NFT_MSG_NEWSETELEM:
+	case NFT_MSG_DELSETELEM:
+		return mon_elems(mon, nlh, now);
+	}
+
+	/* elements held so far come first */
+	mon->events++;
+	if (mon_release(mon, UINT64_MAX) < 0)
+		return -1;
+
+	return mon_deliver(mon, &ev);
+}
+
+static int mon_process(struct nftnl_monitor *mon, const void *buf, int len,
+		       uint64_t now)
+{
+	const struct nlmsghdr *nlh = buf;
+
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (nlh->nlmsg_type >= NLMSG_MIN_TYPE &&
+		    mon_msg(mon, nlh, now) < 0)
+			return -1;
+
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+	return 0;
+}
+
+static int mon_resync(struct nftnl_monitor *mon)
+{
+	if (!mon->cache || !mon->dump_nl || !nftnl_cache_is_stale(mon->cache))
+		return 0;
+
+	if (nftnl_cache_validate(mon->cache, mon->dump_nl) < 0)
+		return -1;
+
+	mon->resyncs++;
+	return 0;
+}
+
+/*
+ * The socket dropped events. What was read before still holds, what is
+ * queued since may depend on what was lost, so it goes too. Without a cache
+ * to dump again, the caller has to.
+ */
+static int mon_overflow(struct nftnl_monitor *mon)
+{
+	int fd = mnl_socket_get_fd(mon->nl);
+
+	mon->drops++;
+	if (mon_release(mon, UINT64_MAX) < 0)
+		return -1;
+
+	while (recvmmsg(fd, mon->msgs, mon->num_slots, MSG_DONTWAIT, NULL) > 0)
+		;
+
+	if (mon->cache == NULL) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	nftnl_cache_set_stale(mon->cache, MON_LOST_TYPES);
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_read);
+int nftnl_monitor_read(struct nftnl_monitor *mon)
+{
+	uint64_t delivered = mon->delivered, now;
+	int fd = mnl_socket_get_fd(mon->nl);
+	int i, n;
+
+	n = recvmmsg(fd, mon->msgs, mon->num_slots, MSG_WAITFORONE, NULL);
+	if (n < 0) {
+		if (errno != ENOBUFS || mon_overflow(mon) < 0 ||
+		    mon_resync(mon) < 0)
+			return -1;
+
+		return mon->delivered - delivered;
+	}
+
+	now = mon_now();
+	for (i = 0; i < n; i++) {
+		/* not from the kernel */
+		if (mon->addrs[i].nl_pid != 0)
+			continue;
+
+		/* events past the slot are lost */
+		if (mon->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+			mon->drops++;
+			if (mon->cache)
+				nftnl_cache_set_stale(mon->cache,
+						      MON_LOST_TYPES);
+		}
+
+		if (mon_process(mon, mon->iovs[i].iov_base,
+				mon->msgs[i].msg_len, now) < 0)
+			return -1;
+	}
+
+	if (mon_release(mon, now) < 0 || mon_resync(mon) < 0)
+		return -1;
+
+	return mon->delivered - delivered;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_process);
+int nftnl_monitor_process(struct nftnl_monitor *mon, const void *buf,
+			  size_t len)
+{
+	uint64_t delivered = mon->delivered, now = mon_now();
+
+	if (mon_process(mon, buf, len, now) < 0 ||
+	    mon_release(mon, now) < 0 || mon_resync(mon) < 0)
+		return -1;
+
+	return mon->delivered - delivered;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_flush);
+int nftnl_monitor_flush(struct nftnl_monitor *mon)
+{
+	uint64_t delivered = mon->delivered;
+
+	if (mon_release(mon, UINT64_MAX) < 0)
+		return -1;
+
+	return mon->delivered - delivered;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_timeout);
+int nftnl_monitor_timeout(const struct nftnl_monitor *mon)
+{
+	const struct mon_held *h;
+	uint64_t now = mon_now();
+
+	if (list_empty(&mon->held))
+		return -1;
+
+	h = list_entry(mon->held.next, struct mon_held, head);
+	return h->due > now ? h->due - now : 0;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_type);
+uint16_t nftnl_monitor_event_type(const struct nftnl_monitor_event *ev)
+{
+	return ev->type;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_family);
+uint32_t nftnl_monitor_event_family(const struct nftnl_monitor_event *ev)
+{
+	return ev->family;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_nlmsg);
+const struct nlmsghdr *
+nftnl_monitor_event_nlmsg(const struct nftnl_monitor_event *ev)
+{
+	return ev->nlh;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_table);
+const char *nftnl_monitor_event_table(const struct nftnl_monitor_event *ev)
+{
+	return ev->table;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_set);
+const char *nftnl_monitor_event_set(const struct nftnl_monitor_event *ev)
+{
+	return ev->set;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_key);
+const void *nftnl_monitor_event_key(const struct nftnl_monitor_event *ev,
+				    uint32_t *len)
+{
+	*len = ev->key_len;
+	return ev->key;
+}
+
+EXPORT_SYMBOL(nftnl_monitor_event_elem);
+struct nftnl_set_elem *
+nftnl_monitor_event_elem(const struct nftnl_monitor_event *ev)
+{
+	struct nftnl_set_elem *e;
+
+	if (ev->elem == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return NULL;
+
+	if (nftnl_set_elem_nlattr_parse(e, ev->elem) < 0) {
+		nftnl_set_elem_free(e);
+		return NULL;
+	}
+	return e;
+}
@@ -7,6 +7,7 @@
  * (at your option) any later version.
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -63,6 +64,50 @@ void nftnl_obj_free(const struct nftnl_obj *obj)
 	xfree(obj);
 }
 
+EXPORT_SYMBOL(nftnl_obj_clone);
+struct nftnl_obj *nftnl_obj_clone(const struct nftnl_obj *obj)
+{
+	struct nftnl_obj *newobj;
+
+	newobj = nftnl_obj_alloc();
+	if (newobj == NULL)
+		return NULL;
+
+	/* type specific data holds no pointers, copy it as is */
+	memcpy(newobj, obj, sizeof(*obj));
+	INIT_LIST_HEAD(&newobj->head);
+	newobj->flags &= ~((1 << NFTNL_OBJ_TABLE) | (1 << NFTNL_OBJ_NAME) |
+			   (1 << NFTNL_OBJ_USERDATA));
+	newobj->table = NULL;
+	newobj->name = NULL;
+	newobj->user.data = NULL;
+
+	if (obj->flags & (1 << NFTNL_OBJ_TABLE)) {
+		newobj->table = strdup(obj->table);
+		if (!newobj->table)
+			goto err;
+		newobj->flags |= (1 << NFTNL_OBJ_TABLE);
+	}
+	if (obj->flags & (1 << NFTNL_OBJ_NAME)) {
+		newobj->name = strdup(obj->name);
+		if (!newobj->name)
+			goto err;
+		newobj->flags |= (1 << NFTNL_OBJ_NAME);
+	}
+	if (obj->flags & (1 << NFTNL_OBJ_USERDATA)) {
+		newobj->user.data = malloc(obj->user.len);
+		if (!newobj->user.data)
+			goto err;
+		memcpy(newobj->user.data, obj->user.data, obj->user.len);
+		newobj->flags |= (1 << NFTNL_OBJ_USERDATA);
+	}
+
+	return newobj;
+err:
+	nftnl_obj_free(newobj);
+	return NULL;
+}
+
 EXPORT_SYMBOL(nftnl_obj_is_set);
 bool nftnl_obj_is_set(const struct nftnl_obj *obj, uint16_t attr)
 {
@@ -238,6 +283,19 @@ const char *nftnl_obj_get_str(struct nftnl_obj *obj, uint16_t attr)
 	return nftnl_obj_get(obj, attr);
 }
 
+EXPORT_SYMBOL(nftnl_obj_nlmsg_build_dump_filter);
+void nftnl_obj_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+				       const char *table, uint32_t type)
+{
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+
+	nfg->nfgen_family = family;
+	if (table)
+		mnl_attr_put_strz(nlh, NFTA_OBJ_TABLE, table);
+	if (type != NFT_OBJECT_UNSPEC)
+		mnl_attr_put_u32(nlh, NFTA_OBJ_TYPE, htonl(type));
+}
+
 EXPORT_SYMBOL(nftnl_obj_nlmsg_build_payload);
 void nftnl_obj_nlmsg_build_payload(struct nlmsghdr *nlh,
 				   const struct nftnl_obj *obj)
@@ -475,7 +533,7 @@ void nftnl_obj_list_free(struct nftnl_obj_list *list)
 }
 
 EXPORT_SYMBOL(nftnl_obj_list_is_empty);
-int nftnl_obj_list_is_empty(struct nftnl_obj_list *list)
+int nftnl_obj_list_is_empty(const struct nftnl_obj_list *list)
 {
 	return list_empty(&list->list);
 }
@@ -499,6 +557,60 @@ void nftnl_obj_list_del(struct nftnl_obj *t)
 	list_del(&t->head);
 }
 
+static int nftnl_obj_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_obj_list *list = data;
+	struct nftnl_obj *o;
+
+	o = nftnl_obj_alloc();
+	if (o == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_obj_nlmsg_parse(nlh, o) < 0) {
+		nftnl_obj_free(o);
+		return MNL_CB_ERROR;
+	}
+	nftnl_obj_list_add_tail(o, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_obj_dump_reset(void *data)
+{
+	struct nftnl_obj_list *list = data;
+	struct nftnl_obj *o, *tmp;
+
+	list_for_each_entry_safe(o, tmp, &list->list, head) {
+		nftnl_obj_list_del(o);
+		nftnl_obj_free(o);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_obj_list_dump);
+int nftnl_obj_list_dump(struct nftnl_obj_list *list, struct mnl_socket *nl,
+			uint32_t family, const char *table, uint32_t type)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_obj_list *dump;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_obj_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETOBJ, family, NLM_F_DUMP,
+				    time(NULL));
+	nftnl_obj_nlmsg_build_dump_filter(nlh, family, table, type);
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_obj_dump_cb,
+			       nftnl_obj_dump_reset, dump);
+	if (ret == 0)
+		list_splice_init(&dump->list, list->list.prev);
+	nftnl_obj_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_obj_list_foreach);
 int nftnl_obj_list_foreach(struct nftnl_obj_list *table_list,
 			     int (*cb)(struct nftnl_obj *t, void *data),
@@ -515,10 +627,16 @@ int nftnl_obj_list_foreach(struct nftnl_obj_list *table_list,
 	return 0;
 }
 
-struct nftnl_obj_list_iter {
-	struct nftnl_obj_list	*list;
-	struct nftnl_obj	*cur;
-};
+EXPORT_SYMBOL(nftnl_obj_list_iter_init);
+void nftnl_obj_list_iter_init(struct nftnl_obj_list_iter *iter,
+			      const struct nftnl_obj_list *l)
+{
+	iter->list = l;
+	if (nftnl_obj_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_obj, head);
+}
 
 EXPORT_SYMBOL(nftnl_obj_list_iter_create);
 struct nftnl_obj_list_iter *
@@ -530,11 +648,7 @@ nftnl_obj_list_iter_create(struct nftnl_obj_list *l)
 	if (iter == NULL)
 		return NULL;
 
-	iter->list = l;
-	if (nftnl_obj_list_is_empty(l))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(l->list.next, struct nftnl_obj, head);
+	nftnl_obj_list_iter_init(iter, l);
 
 	return iter;
 }
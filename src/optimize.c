@@ -0,0 +1,1295 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "eval.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/optimize.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+
+/* Shorter runs are cheaper to walk than to look up. */
+#define OPT_MIN_RUN	4
+
+/* Rule that loads a field, compares it with a constant and issues a verdict. */
+struct opt_match {
+	struct nftnl_rule	*rule;
+	uint32_t		pos;
+	struct nftnl_expr	*load;
+	struct nftnl_expr	*imm;
+	const void		*key;
+	uint32_t		key_len;
+	int32_t			verdict;
+	const char		*chain;
+};
+
+static bool opt_expr_is(const struct nftnl_expr *e, const char *name)
+{
+	return !strcmp(e->ops->name, name);
+}
+
+static bool opt_match_rule(struct opt_match *m, struct nftnl_rule *r)
+{
+	struct nftnl_expr *expr, *e[3];
+	uint32_t num = 0, reg;
+
+	list_for_each_entry(expr, &r->expr_list, head) {
+		if (num == array_size(e))
+			return false;
+		e[num++] = expr;
+	}
+	if (num != array_size(e))
+		return false;
+
+	if (opt_expr_is(e[0], "payload")) {
+		if (nftnl_expr_is_set(e[0], NFTNL_EXPR_PAYLOAD_SREG) ||
+		    !nftnl_expr_is_set(e[0], NFTNL_EXPR_PAYLOAD_DREG))
+			return false;
+		reg = nftnl_expr_get_u32(e[0], NFTNL_EXPR_PAYLOAD_DREG);
+	} else if (opt_expr_is(e[0], "meta")) {
+		if (!nftnl_expr_is_set(e[0], NFTNL_EXPR_META_DREG))
+			return false;
+		reg = nftnl_expr_get_u32(e[0], NFTNL_EXPR_META_DREG);
+	} else {
+		return false;
+	}
+
+	if (!opt_expr_is(e[1], "cmp") ||
+	    nftnl_expr_get_u32(e[1], NFTNL_EXPR_CMP_SREG) != reg ||
+	    nftnl_expr_get_u32(e[1], NFTNL_EXPR_CMP_OP) != NFT_CMP_EQ)
+		return false;
+
+	if (!opt_expr_is(e[2], "immediate") ||
+	    !nftnl_expr_is_set(e[2], NFTNL_EXPR_IMM_VERDICT))
+		return false;
+
+	m->verdict = nftnl_expr_get_u32(e[2], NFTNL_EXPR_IMM_VERDICT);
+	if (m->verdict == NFT_CONTINUE || m->verdict == NFT_BREAK)
+		return false;
+
+	m->rule = r;
+	m->load = e[0];
+	m->imm = e[2];
+	m->key = nftnl_expr_get(e[1], NFTNL_EXPR_CMP_DATA, &m->key_len);
+	m->chain = nftnl_expr_is_set(e[2], NFTNL_EXPR_IMM_CHAIN) ?
+		   nftnl_expr_get_str(e[2], NFTNL_EXPR_IMM_CHAIN) : NULL;
+
+	return m->key != NULL;
+}
+
+static bool opt_same_field(const struct opt_match *m1,
+			   const struct opt_match *m2)
+{
+	return m1->key_len == m2->key_len && nftnl_expr_cmp(m1->load, m2->load);
+}
+
+static bool opt_same_verdict(const struct opt_match *m1,
+			     const struct opt_match *m2)
+{
+	if (m1->verdict != m2->verdict)
+		return false;
+	if (!m1->chain || !m2->chain)
+		return m1->chain == m2->chain;
+
+	return !strcmp(m1->chain, m2->chain);
+}
+
+/* By key, the first rule matching a key comes first. */
+static int opt_match_cmp(const void *a, const void *b)
+{
+	const struct opt_match *m1 = *(struct opt_match **)a;
+	const struct opt_match *m2 = *(struct opt_match **)b;
+	int ret;
+
+	ret = memcmp(m1->key, m2->key, m1->key_len);
+	if (ret)
+		return ret;
+
+	return m1->pos < m2->pos ? -1 : m1->pos > m2->pos;
+}
+
+static struct nftnl_set *opt_set_alloc(const struct nftnl_chain *c,
+				       uint32_t id, uint32_t key_len, bool map)
+{
+	struct nftnl_set *s;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return NULL;
+
+	/* the kernel picks the name, rules refer to the set by its id */
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY,
+			  nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY));
+	if (nftnl_set_set_str(s, NFTNL_SET_TABLE,
+			      nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE)) < 0 ||
+	    nftnl_set_set_str(s, NFTNL_SET_NAME,
+			      map ? "__map%d" : "__set%d") < 0) {
+		nftnl_set_free(s);
+		return NULL;
+	}
+	nftnl_set_set_u32(s, NFTNL_SET_ID, id);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, key_len);
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS, NFT_SET_ANONYMOUS |
+			  NFT_SET_CONSTANT | (map ? NFT_SET_MAP : 0));
+	if (map)
+		nftnl_set_set_u32(s, NFTNL_SET_DATA_TYPE, NFT_DATA_VERDICT);
+
+	return s;
+}
+
+static int opt_set_elems(struct nftnl_set *s, struct opt_match *run,
+			 uint32_t num, bool map)
+{
+	struct opt_match **sorted, *m;
+	struct nftnl_set_elem *e;
+	uint32_t i;
+	int ret = -1;
+
+	sorted = calloc(num, sizeof(struct opt_match *));
+	if (sorted == NULL)
+		return -1;
+
+	for (i = 0; i < num; i++)
+		sorted[i] = &run[i];
+	qsort(sorted, num, sizeof(struct opt_match *), opt_match_cmp);
+
+	for (i = 0; i < num; i++) {
+		m = sorted[i];
+		/* later rules for the same key are never reached */
+		if (i > 0 && !memcmp(sorted[i - 1]->key, m->key, m->key_len))
+			continue;
+
+		e = nftnl_set_elem_alloc();
+		if (e == NULL)
+			goto out;
+
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, m->key, m->key_len);
+		if (map) {
+			nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_VERDICT,
+					       m->verdict);
+			if (m->chain &&
+			    nftnl_set_elem_set_str(e, NFTNL_SET_ELEM_CHAIN,
+						   m->chain) < 0) {
+				nftnl_set_elem_free(e);
+				goto out;
+			}
+		}
+		nftnl_set_elem_add(s, e);
+	}
+	ret = 0;
+out:
+	xfree(sorted);
+	return ret;
+}
+
+static struct nftnl_rule *opt_lookup_rule(const struct nftnl_chain *c,
+					  const struct opt_match *m,
+					  const struct nftnl_set *s, bool map)
+{
+	struct nftnl_expr *load, *lookup, *imm = NULL;
+	struct nftnl_rule *r;
+	uint32_t reg;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return NULL;
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY,
+			   nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY));
+	if (nftnl_rule_set_str(r, NFTNL_RULE_TABLE,
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE)) < 0 ||
+	    nftnl_rule_set_str(r, NFTNL_RULE_CHAIN,
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_NAME)) < 0)
+		goto err;
+
+	load = nftnl_expr_clone(m->load, 0);
+	if (load == NULL)
+		goto err;
+	nftnl_rule_add_expr(r, load);
+
+	reg = opt_expr_is(m->load, "payload") ?
+	      nftnl_expr_get_u32(m->load, NFTNL_EXPR_PAYLOAD_DREG) :
+	      nftnl_expr_get_u32(m->load, NFTNL_EXPR_META_DREG);
+
+	lookup = nftnl_expr_alloc("lookup");
+	if (lookup == NULL)
+		goto err;
+	nftnl_rule_add_expr(r, lookup);
+
+	nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_SREG, reg);
+	if (nftnl_expr_set_str(lookup, NFTNL_EXPR_LOOKUP_SET,
+			       nftnl_set_get_str(s, NFTNL_SET_NAME)) < 0)
+		goto err;
+	nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_SET_ID,
+			   nftnl_set_get_u32(s, NFTNL_SET_ID));
+	if (map) {
+		nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_DREG,
+				   NFT_REG_VERDICT);
+		return r;
+	}
+
+	imm = nftnl_expr_clone(m->imm, 0);
+	if (imm == NULL)
+		goto err;
+	nftnl_rule_add_expr(r, imm);
+
+	return r;
+err:
+	nftnl_rule_free(r);
+	return NULL;
+}
+
+static int opt_replace_run(struct nftnl_chain *c, struct opt_match *run,
+			   uint32_t num, struct nftnl_set_list *sets,
+			   uint32_t *set_id, struct nftnl_rule_list *replaced)
+{
+	struct nftnl_set *s;
+	struct nftnl_rule *r;
+	bool map = false;
+	uint32_t i;
+
+	for (i = 1; i < num; i++) {
+		if (!opt_same_verdict(&run[0], &run[i]))
+			map = true;
+	}
+
+	s = opt_set_alloc(c, *set_id, run[0].key_len, map);
+	if (s == NULL)
+		return -1;
+
+	if (opt_set_elems(s, run, num, map) < 0)
+		goto err;
+
+	r = opt_lookup_rule(c, &run[0], s, map);
+	if (r == NULL)
+		goto err;
+
+	nftnl_chain_rule_insert_at(r, run[0].rule);
+	for (i = 0; i < num; i++) {
+		nftnl_chain_rule_del(run[i].rule);
+		nftnl_rule_list_add_tail(run[i].rule, replaced);
+	}
+
+	nftnl_set_list_add_tail(s, sets);
+	(*set_id)++;
+	return 0;
+err:
+	nftnl_set_free(s);
+	return -1;
+}
+
+EXPORT_SYMBOL(nftnl_chain_optimize_lookups);
+int nftnl_chain_optimize_lookups(struct nftnl_chain *c,
+				 struct nftnl_set_list *sets,
+				 uint32_t *set_id,
+				 struct nftnl_rule_list *replaced)
+{
+	struct nftnl_rule_iter iter;
+	struct opt_match *matches;
+	uint32_t num = 0, i, start;
+	struct nftnl_rule *r;
+	int removed = 0;
+
+	nftnl_rule_iter_init(&iter, c);
+	while (nftnl_rule_iter_next(&iter))
+		num++;
+
+	matches = calloc(num ? num : 1, sizeof(struct opt_match));
+	if (matches == NULL)
+		return -1;
+
+	/* rules that do not fit break runs, they have no load */
+	i = 0;
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter))) {
+		if (!opt_match_rule(&matches[i], r))
+			memset(&matches[i], 0, sizeof(matches[i]));
+		matches[i].pos = i;
+		i++;
+	}
+
+	for (start = 0; start < num; start = i) {
+		for (i = start + 1; i < num && matches[start].load &&
+		     matches[i].load &&
+		     opt_same_field(&matches[start], &matches[i]); i++)
+			;
+
+		if (i - start < OPT_MIN_RUN)
+			continue;
+
+		if (opt_replace_run(c, &matches[start], i - start, sets,
+				    set_id, replaced) < 0) {
+			removed = -1;
+			break;
+		}
+		removed += i - start - 1;
+	}
+
+	xfree(matches);
+	return removed;
+}
+
+/*
+ * Prefix partitioning: rules that match the same address field against a
+ * prefix are spread over a tree of chains, one level per address byte. Each
+ * level loads one byte and jumps through a verdict map to the chain holding
+ * the rules for that byte value, so a packet walks a handful of short
+ * chains instead of the whole run.
+ */
+
+/* Runs shorter than this stay linear. */
+#define PART_MIN_RUN	16
+/* Levels of the tree, each one adds a jump to the nesting depth. */
+#define PART_MAX_DEPTH	4
+#define PART_KEY_MAXLEN	16
+
+struct part_rule {
+	struct nftnl_rule	*rule;
+	uint8_t			key[PART_KEY_MAXLEN];
+	/* prefix length in bits, 0 if the rule does not match the field */
+	uint32_t		plen;
+	/* position in the chain before partitioning */
+	uint32_t		index;
+	/* back in a chain, and the name of that chain if it is a new one */
+	bool			placed;
+	char			*chain;
+};
+
+struct part_ctx {
+	struct nftnl_chain	*chain;
+	struct nftnl_chain_list	*chains;
+	struct nftnl_set_list	*sets;
+	uint32_t		*set_id;
+	int			num_chains;
+
+	/* field all partitioned rules match on */
+	struct nftnl_expr	*load;
+	uint32_t		base;
+	uint32_t		offset;
+	uint32_t		len;
+	uint32_t		reg;
+};
+
+static bool part_load_field(const struct nftnl_expr *e, uint32_t *base,
+			    uint32_t *offset, uint32_t *len, uint32_t *reg)
+{
+	if (!opt_expr_is(e, "payload") ||
+	    nftnl_expr_is_set(e, NFTNL_EXPR_PAYLOAD_SREG) ||
+	    !nftnl_expr_is_set(e, NFTNL_EXPR_PAYLOAD_DREG))
+		return false;
+
+	*base = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_BASE);
+	*offset = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET);
+	*len = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_LEN);
+	*reg = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_DREG);
+
+	return *len > 0 && *len <= PART_KEY_MAXLEN;
+}
+
+/* Length in bits of @mask if it is a prefix mask, -1 otherwise. */
+static int part_mask_len(const uint8_t *mask, uint32_t len)
+{
+	uint32_t i, plen = 0;
+	uint8_t byte;
+
+	for (i = 0; i < len && mask[i] == 0xff; i++)
+		plen += 8;
+	if (i == len)
+		return plen;
+
+	byte = mask[i++];
+	while (byte & 0x80) {
+		byte <<= 1;
+		plen++;
+	}
+	if (byte)
+		return -1;
+
+	for (; i < len; i++) {
+		if (mask[i])
+			return -1;
+	}
+	return plen;
+}
+
+/*
+ * A verdict that leaves the chain other than by jumping would leave the
+ * chain the rule is moved to instead.
+ */
+static bool part_expr_movable(const struct nftnl_expr *e)
+{
+	uint32_t verdict;
+
+	if (opt_expr_is(e, "immediate") &&
+	    nftnl_expr_is_set(e, NFTNL_EXPR_IMM_VERDICT)) {
+		verdict = nftnl_expr_get_u32(e, NFTNL_EXPR_IMM_VERDICT);
+		return verdict != NFT_GOTO && verdict != NFT_RETURN;
+	}
+
+	return !opt_expr_is(e, "lookup") ||
+	       !nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_DREG) ||
+	       nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_DREG) != NFT_REG_VERDICT;
+}
+
+/* Rule that starts with a load of the field and a match on a prefix of it. */
+static void part_match_rule(struct part_ctx *ctx, struct part_rule *pr)
+{
+	uint32_t base, offset, len, reg, data_len, xor_len, i;
+	struct nftnl_expr *e[3] = {}, *expr;
+	const uint8_t *data, *xor, *mask;
+	uint32_t num = 0;
+	int plen;
+
+	pr->plen = 0;
+
+	list_for_each_entry(expr, &pr->rule->expr_list, head) {
+		if (!part_expr_movable(expr))
+			return;
+		if (num < array_size(e))
+			e[num++] = expr;
+	}
+
+	if (e[0] == NULL || e[1] == NULL ||
+	    !part_load_field(e[0], &base, &offset, &len, &reg))
+		return;
+
+	if (ctx->load == NULL) {
+		ctx->load = e[0];
+		ctx->base = base;
+		ctx->offset = offset;
+		ctx->len = len;
+		ctx->reg = reg;
+	} else if (!nftnl_expr_cmp(ctx->load, e[0])) {
+		return;
+	}
+
+	plen = len * 8;
+	if (opt_expr_is(e[1], "bitwise")) {
+		if (nftnl_expr_get_u32(e[1], NFTNL_EXPR_BITWISE_OP) !=
+		    NFT_BITWISE_BOOL ||
+		    nftnl_expr_get_u32(e[1], NFTNL_EXPR_BITWISE_SREG) != reg ||
+		    nftnl_expr_get_u32(e[1], NFTNL_EXPR_BITWISE_DREG) != reg ||
+		    nftnl_expr_get_u32(e[1], NFTNL_EXPR_BITWISE_LEN) != len)
+			return;
+
+		mask = nftnl_expr_get(e[1], NFTNL_EXPR_BITWISE_MASK, &data_len);
+		xor = nftnl_expr_get(e[1], NFTNL_EXPR_BITWISE_XOR, &xor_len);
+		if (mask == NULL || data_len < len || xor == NULL)
+			return;
+		for (i = 0; i < xor_len; i++) {
+			if (xor[i])
+				return;
+		}
+
+		plen = part_mask_len(mask, len);
+		if (plen < 0)
+			return;
+		e[1] = e[2];
+	}
+
+	if (e[1] == NULL || !opt_expr_is(e[1], "cmp") ||
+	    nftnl_expr_get_u32(e[1], NFTNL_EXPR_CMP_SREG) != reg ||
+	    nftnl_expr_get_u32(e[1], NFTNL_EXPR_CMP_OP) != NFT_CMP_EQ)
+		return;
+
+	data = nftnl_expr_get(e[1], NFTNL_EXPR_CMP_DATA, &data_len);
+	if (data == NULL || data_len != len)
+		return;
+
+	memcpy(pr->key, data, len);
+	pr->plen = plen;
+}
+
+static bool part_keyed(const struct part_ctx *ctx, const struct part_rule *pr,
+		       uint32_t depth)
+{
+	return depth < PART_MAX_DEPTH && depth < ctx->len &&
+	       pr->plen >= (depth + 1) * 8;
+}
+
+/*
+ * Rules only get the name of the chain they are moved to once the whole tree
+ * is built, so that they can go back to where they were until then.
+ */
+static int part_move_rule(struct nftnl_chain *c, struct part_rule *pr)
+{
+	const char *name = nftnl_chain_get_str(c, NFTNL_CHAIN_NAME);
+
+	if (strcmp(nftnl_rule_get_str(pr->rule, NFTNL_RULE_CHAIN), name)) {
+		pr->chain = strdup(name);
+		if (pr->chain == NULL)
+			return -1;
+	}
+	nftnl_chain_rule_add_tail(pr->rule, c);
+	pr->placed = true;
+	return 0;
+}
+
+static struct nftnl_chain *part_chain_alloc(struct part_ctx *ctx,
+					    const struct part_rule *pr,
+					    uint32_t depth, uint32_t map_id)
+{
+	char name[NFT_CHAIN_MAXNAMELEN];
+	int ret, remain = sizeof(name), offset = 0;
+	struct nftnl_chain *c;
+	uint32_t i;
+
+	/*
+	 * The base chain name, the id of the map that jumps to the chain and
+	 * the address bytes matched so far. Runs in the same chain may share
+	 * their leading bytes, but not their maps.
+	 */
+	ret = snprintf(name, remain, "%s_p%u_",
+		       nftnl_chain_get_str(ctx->chain, NFTNL_CHAIN_NAME),
+		       map_id);
+	SNPRINTF_BUFFER_SIZE(ret, remain, offset);
+	for (i = 0; i <= depth; i++) {
+		ret = snprintf(name + offset, remain, "%02x", pr->key[i]);
+		SNPRINTF_BUFFER_SIZE(ret, remain, offset);
+	}
+	if (remain == 0) {
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	c = nftnl_chain_alloc();
+	if (c == NULL)
+		return NULL;
+
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY,
+			    nftnl_chain_get_u32(ctx->chain, NFTNL_CHAIN_FAMILY));
+	if (nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE,
+				nftnl_chain_get_str(ctx->chain,
+						    NFTNL_CHAIN_TABLE)) < 0 ||
+	    nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name) < 0) {
+		nftnl_chain_free(c);
+		return NULL;
+	}
+
+	nftnl_chain_list_add_tail(c, ctx->chains);
+	ctx->num_chains++;
+	return c;
+}
+
+static struct nftnl_rule *part_dispatch_rule(struct part_ctx *ctx,
+					     struct nftnl_chain *c,
+					     const struct nftnl_set *s,
+					     uint32_t depth)
+{
+	struct nftnl_expr *load, *lookup;
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return NULL;
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY,
+			   nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY));
+	if (nftnl_rule_set_str(r, NFTNL_RULE_TABLE,
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE)) < 0 ||
+	    nftnl_rule_set_str(r, NFTNL_RULE_CHAIN,
+			       nftnl_chain_get_str(c, NFTNL_CHAIN_NAME)) < 0)
+		goto err;
+
+	load = nftnl_expr_alloc("payload");
+	if (load == NULL)
+		goto err;
+	nftnl_rule_add_expr(r, load);
+	nftnl_expr_set_u32(load, NFTNL_EXPR_PAYLOAD_DREG, ctx->reg);
+	nftnl_expr_set_u32(load, NFTNL_EXPR_PAYLOAD_BASE, ctx->base);
+	nftnl_expr_set_u32(load, NFTNL_EXPR_PAYLOAD_OFFSET, ctx->offset + depth);
+	nftnl_expr_set_u32(load, NFTNL_EXPR_PAYLOAD_LEN, 1);
+
+	lookup = nftnl_expr_alloc("lookup");
+	if (lookup == NULL)
+		goto err;
+	nftnl_rule_add_expr(r, lookup);
+	nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_SREG, ctx->reg);
+	nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_DREG, NFT_REG_VERDICT);
+	if (nftnl_expr_set_str(lookup, NFTNL_EXPR_LOOKUP_SET,
+			       nftnl_set_get_str(s, NFTNL_SET_NAME)) < 0)
+		goto err;
+	nftnl_expr_set_u32(lookup, NFTNL_EXPR_LOOKUP_SET_ID,
+			   nftnl_set_get_u32(s, NFTNL_SET_ID));
+
+	return r;
+err:
+	nftnl_rule_free(r);
+	return NULL;
+}
+
+static bool part_same_byte(const struct part_rule *rules, uint32_t num,
+			   uint32_t depth)
+{
+	uint32_t i;
+
+	for (i = 1; i < num; i++) {
+		if (rules[i].key[depth] != rules[0].key[depth])
+			return false;
+	}
+	return true;
+}
+
+static int part_emit(struct part_ctx *ctx, struct nftnl_chain *c,
+		     struct part_rule *rules, uint32_t num, uint32_t depth);
+
+static int part_dispatch(struct part_ctx *ctx, struct nftnl_chain *c,
+			 struct part_rule *rules, uint32_t num, uint32_t depth)
+{
+	uint32_t count[256] = {}, start[256], i, sum;
+	struct part_rule *sorted = NULL;
+	struct nftnl_set_elem *e;
+	struct nftnl_chain *child;
+	struct nftnl_set *s;
+	struct nftnl_rule *r;
+	uint8_t byte;
+
+	s = opt_set_alloc(ctx->chain, *ctx->set_id, 1, true);
+	if (s == NULL)
+		return -1;
+
+	r = part_dispatch_rule(ctx, c, s, depth);
+	if (r == NULL)
+		goto err;
+	nftnl_chain_rule_add_tail(r, c);
+	nftnl_set_list_add_tail(s, ctx->sets);
+	(*ctx->set_id)++;
+
+	/* stable counting sort by the byte of this level */
+	sorted = calloc(num, sizeof(struct part_rule));
+	if (sorted == NULL)
+		return -1;
+
+	for (i = 0; i < num; i++)
+		count[rules[i].key[depth]]++;
+	for (i = 0, sum = 0; i < 256; i++) {
+		start[i] = sum;
+		sum += count[i];
+	}
+	for (i = 0; i < num; i++)
+		sorted[start[rules[i].key[depth]]++] = rules[i];
+	/* in place, moved rules are tracked in the caller's array */
+	memcpy(rules, sorted, num * sizeof(struct part_rule));
+	xfree(sorted);
+
+	for (i = 0, sum = 0; i < 256; sum += count[i], i++) {
+		if (count[i] == 0)
+			continue;
+
+		byte = i;
+		child = part_chain_alloc(ctx, &rules[sum], depth,
+					 nftnl_set_get_u32(s, NFTNL_SET_ID));
+		if (child == NULL)
+			return -1;
+
+		e = nftnl_set_elem_alloc();
+		if (e == NULL)
+			return -1;
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &byte, sizeof(byte));
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_VERDICT, NFT_JUMP);
+		nftnl_set_elem_add(s, e);
+		if (nftnl_set_elem_set_str(e, NFTNL_SET_ELEM_CHAIN,
+				nftnl_chain_get_str(child,
+						    NFTNL_CHAIN_NAME)) < 0)
+			return -1;
+
+		if (part_emit(ctx, child, &rules[sum], count[i],
+			      depth + 1) < 0)
+			return -1;
+	}
+
+	return 0;
+err:
+	nftnl_set_free(s);
+	return -1;
+}
+
+static int part_emit(struct part_ctx *ctx, struct nftnl_chain *c,
+		     struct part_rule *rules, uint32_t num, uint32_t depth)
+{
+	uint32_t i = 0, j;
+	int ret;
+
+	while (i < num) {
+		for (j = i; j < num && part_keyed(ctx, &rules[j], depth); j++)
+			;
+
+		if (j - i >= PART_MIN_RUN) {
+			/* a byte all rules agree on does not narrow anything */
+			ret = part_same_byte(&rules[i], j - i, depth) ?
+			      part_emit(ctx, c, &rules[i], j - i, depth + 1) :
+			      part_dispatch(ctx, c, &rules[i], j - i, depth);
+			if (ret < 0)
+				return -1;
+			i = j;
+			continue;
+		}
+
+		/* the unkeyed rule ends the run and stays in place, too */
+		if (j == i)
+			j++;
+		for (; i < j; i++) {
+			if (part_move_rule(c, &rules[i]) < 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+/* Give moved rules the name of their chain, they are new rules there. */
+static void part_commit(struct part_rule *rules, uint32_t num)
+{
+	struct nftnl_rule *r;
+	uint32_t i;
+
+	for (i = 0; i < num; i++) {
+		if (rules[i].chain == NULL)
+			continue;
+
+		r = rules[i].rule;
+		xfree(r->chain);
+		r->chain = rules[i].chain;
+		rules[i].chain = NULL;
+		nftnl_rule_unset(r, NFTNL_RULE_HANDLE);
+		nftnl_rule_unset(r, NFTNL_RULE_POSITION);
+	}
+}
+
+static int part_index_cmp(const void *a, const void *b)
+{
+	const struct part_rule *pa = a, *pb = b;
+
+	return (pa->index > pb->index) - (pa->index < pb->index);
+}
+
+/*
+ * Copies of the rules about to move, still with their chain and handle, for
+ * the caller to delete. In the order they had in @c.
+ */
+static int part_replaced(struct part_rule *rules, uint32_t num,
+			 struct nftnl_rule_list *replaced)
+{
+	struct nftnl_rule *r;
+	uint32_t i;
+
+	qsort(rules, num, sizeof(struct part_rule), part_index_cmp);
+	for (i = 0; i < num; i++) {
+		if (rules[i].chain == NULL)
+			continue;
+
+		r = nftnl_rule_clone(rules[i].rule, 0);
+		if (r == NULL)
+			return -1;
+		nftnl_rule_list_add_tail(r, replaced);
+	}
+	return 0;
+}
+
+/* Put all rules back into @c, in their order, and drop the dispatch rules. */
+static void part_undo(struct nftnl_chain *c, struct part_rule *rules,
+		      uint32_t num)
+{
+	struct nftnl_rule_iter iter;
+	struct nftnl_rule *r;
+	uint32_t i;
+
+	for (i = 0; i < num; i++) {
+		if (rules[i].placed)
+			nftnl_chain_rule_del(rules[i].rule);
+		xfree(rules[i].chain);
+	}
+
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter))) {
+		nftnl_chain_rule_del(r);
+		nftnl_rule_free(r);
+		nftnl_rule_iter_init(&iter, c);
+	}
+
+	qsort(rules, num, sizeof(struct part_rule), part_index_cmp);
+	for (i = 0; i < num; i++)
+		nftnl_chain_rule_add_tail(rules[i].rule, c);
+}
+
+static int part_chain_splice(struct nftnl_chain *c, void *data)
+{
+	nftnl_chain_list_del(c);
+	nftnl_chain_list_add_tail(c, data);
+	return 0;
+}
+
+static int part_set_splice(struct nftnl_set *s, void *data)
+{
+	nftnl_set_list_del(s);
+	nftnl_set_list_add_tail(s, data);
+	return 0;
+}
+
+static int part_rule_splice(struct nftnl_rule *r, void *data)
+{
+	nftnl_rule_list_del(r);
+	nftnl_rule_list_add_tail(r, data);
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_chain_partition);
+int nftnl_chain_partition(struct nftnl_chain *c,
+			  struct nftnl_chain_list *chains,
+			  struct nftnl_set_list *sets, uint32_t *set_id,
+			  struct nftnl_rule_list *replaced)
+{
+	struct part_ctx ctx = {
+		.chain	= c,
+		.set_id	= set_id,
+	};
+	uint32_t num = 0, i, first_id = *set_id;
+	struct nftnl_rule_list *moved;
+	struct part_rule *rules = NULL;
+	struct nftnl_rule_iter iter;
+	struct nftnl_rule *r;
+	int ret = -1;
+
+	/* new chains, maps and moved rules only reach the caller on success */
+	ctx.chains = nftnl_chain_list_alloc();
+	ctx.sets = nftnl_set_list_alloc();
+	moved = nftnl_rule_list_alloc();
+	if (ctx.chains == NULL || ctx.sets == NULL || moved == NULL)
+		goto out;
+
+	nftnl_rule_iter_init(&iter, c);
+	while (nftnl_rule_iter_next(&iter))
+		num++;
+
+	rules = calloc(num ? num : 1, sizeof(struct part_rule));
+	if (rules == NULL)
+		goto out;
+
+	i = 0;
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter))) {
+		rules[i].rule = r;
+		rules[i].index = i;
+		part_match_rule(&ctx, &rules[i]);
+		i++;
+	}
+
+	/* rules go back into the chain or into new ones, in order */
+	for (i = 0; i < num; i++)
+		nftnl_chain_rule_del(rules[i].rule);
+
+	if (part_emit(&ctx, c, rules, num, 0) < 0 ||
+	    part_replaced(rules, num, moved) < 0) {
+		part_undo(c, rules, num);
+		*set_id = first_id;
+		goto out;
+	}
+
+	part_commit(rules, num);
+	nftnl_chain_list_foreach(ctx.chains, part_chain_splice, chains);
+	nftnl_set_list_foreach(ctx.sets, part_set_splice, sets);
+	nftnl_rule_list_foreach(moved, part_rule_splice, replaced);
+	ret = ctx.num_chains;
+out:
+	xfree(rules);
+	if (moved)
+		nftnl_rule_list_free(moved);
+	if (ctx.chains)
+		nftnl_chain_list_free(ctx.chains);
+	if (ctx.sets)
+		nftnl_set_list_free(ctx.sets);
+	return ret;
+}
+
+/*
+ * Peephole pass over the expressions of a rule. Walking the rule, each word
+ * of the register file remembers the payload load it holds and the range
+ * its value is known to be in, any write to the word forgets both.
+ */
+
+struct peep_word {
+	struct nftnl_expr	*load;
+	struct nftnl_expr	*range;
+};
+
+struct peep_ctx {
+	struct peep_word	regs[EVAL_REGS];
+	int			removed;
+};
+
+/* Largest value a meta or ct key loads, the register word count is not known */
+#define PEEP_KEY_MAXLEN		16
+
+static void peep_forget_all(struct peep_ctx *ctx)
+{
+	memset(ctx->regs, 0, sizeof(ctx->regs));
+}
+
+/*
+ * Dropping or narrowing a range after a counter, log, limit or quota would
+ * change the packets those see, the loads they leave alone still hold.
+ */
+static void peep_forget_ranges(struct peep_ctx *ctx)
+{
+	uint32_t w;
+
+	for (w = 0; w < EVAL_REGS; w++)
+		ctx->regs[w].range = NULL;
+}
+
+static void peep_forget_expr(struct peep_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t w;
+
+	for (w = 0; w < EVAL_REGS; w++) {
+		if (ctx->regs[w].load == e)
+			ctx->regs[w].load = NULL;
+		if (ctx->regs[w].range == e)
+			ctx->regs[w].range = NULL;
+	}
+}
+
+static void peep_remove(struct peep_ctx *ctx, struct nftnl_expr *e)
+{
+	peep_forget_expr(ctx, e);
+	nftnl_rule_del_expr(e);
+	nftnl_expr_free(e);
+	ctx->removed++;
+}
+
+/* First register word of @attr holding @len bytes, -1 if it makes no sense. */
+static int peep_reg(const struct nftnl_expr *e, uint16_t attr, uint32_t len)
+{
+	if (!nftnl_expr_is_set(e, attr))
+		return -1;
+
+	return eval_reg(nftnl_expr_get_u32(e, attr), len);
+}
+
+/* Register words written by @e, which expressions further on still see. */
+static void peep_write(struct peep_ctx *ctx, const struct nftnl_expr *e,
+		       uint16_t attr, uint32_t len)
+{
+	uint32_t w, words;
+	int word;
+
+	word = peep_reg(e, attr, len);
+	if (word < 0) {
+		peep_forget_all(ctx);
+		return;
+	}
+
+	words = div_round_up(len, NFT_REG32_SIZE);
+	for (w = word; w < word + words; w++) {
+		/* a value spanning this word is gone as a whole */
+		peep_forget_expr(ctx, ctx->regs[w].load);
+		peep_forget_expr(ctx, ctx->regs[w].range);
+	}
+}
+
+/* Mark words @word onwards, @len bytes, as holding what @e says about them. */
+static void peep_track(struct peep_ctx *ctx, struct nftnl_expr *e,
+		       uint32_t word, uint32_t len, bool range)
+{
+	uint32_t w, words = div_round_up(len, NFT_REG32_SIZE);
+
+	for (w = word; w < word + words; w++) {
+		if (range)
+			ctx->regs[w].range = e;
+		else
+			ctx->regs[w].load = e;
+	}
+}
+
+/* Words @word onwards, @len bytes, all hold what @e says about them. */
+static bool peep_holds(const struct peep_ctx *ctx, const struct nftnl_expr *e,
+		       uint32_t word, uint32_t len, bool range)
+{
+	uint32_t w, words = div_round_up(len, NFT_REG32_SIZE);
+
+	if (e == NULL)
+		return false;
+
+	for (w = word; w < word + words; w++) {
+		if ((range ? ctx->regs[w].range : ctx->regs[w].load) != e)
+			return false;
+	}
+	return true;
+}
+
+static void peep_payload(struct peep_ctx *ctx, struct nftnl_expr *e)
+{
+	uint32_t len = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_LEN);
+	struct nftnl_expr *prev;
+	int word;
+
+	/* writing to the packet changes what loads would see */
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_PAYLOAD_SREG)) {
+		peep_forget_all(ctx);
+		return;
+	}
+
+	word = peep_reg(e, NFTNL_EXPR_PAYLOAD_DREG, len);
+	if (word < 0) {
+		peep_forget_all(ctx);
+		return;
+	}
+
+	prev = ctx->regs[word].load;
+	if (peep_holds(ctx, prev, word, len, false) &&
+	    nftnl_expr_cmp(prev, e)) {
+		peep_remove(ctx, e);
+		return;
+	}
+
+	peep_write(ctx, e, NFTNL_EXPR_PAYLOAD_DREG, len);
+	peep_track(ctx, e, word, len, false);
+}
+
+static bool peep_all_bytes(const uint8_t *data, uint32_t len, uint8_t byte)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		if (data[i] != byte)
+			return false;
+	}
+	return true;
+}
+
+/* Bitwise operation that leaves its register as it is. */
+static bool peep_bitwise_nop(const struct nftnl_expr *e)
+{
+	uint32_t len = nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_LEN);
+	const uint8_t *mask, *xor, *data;
+	uint32_t mask_len, xor_len, data_len;
+
+	if (!nftnl_expr_is_set(e, NFTNL_EXPR_BITWISE_SREG) ||
+	    !nftnl_expr_is_set(e, NFTNL_EXPR_BITWISE_DREG) ||
+	    nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_SREG) !=
+	    nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_DREG))
+		return false;
+
+	switch (nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_OP)) {
+	case NFT_BITWISE_BOOL:
+		mask = nftnl_expr_get(e, NFTNL_EXPR_BITWISE_MASK, &mask_len);
+		xor = nftnl_expr_get(e, NFTNL_EXPR_BITWISE_XOR, &xor_len);
+		return mask && xor && mask_len >= len && xor_len >= len &&
+		       peep_all_bytes(mask, len, 0xff) &&
+		       peep_all_bytes(xor, len, 0);
+	case NFT_BITWISE_LSHIFT:
+	case NFT_BITWISE_RSHIFT:
+		data = nftnl_expr_get(e, NFTNL_EXPR_BITWISE_DATA, &data_len);
+		return data && peep_all_bytes(data, data_len, 0);
+	}
+	return false;
+}
+
+static void peep_bitwise(struct peep_ctx *ctx, struct nftnl_expr *e)
+{
+	if (peep_bitwise_nop(e)) {
+		peep_remove(ctx, e);
+		return;
+	}
+
+	peep_write(ctx, e, NFTNL_EXPR_BITWISE_DREG,
+		   nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_LEN));
+}
+
+/* @e2 turns the register @e1 just converted back into what it was. */
+static bool peep_byteorder_undone(const struct nftnl_expr *e1,
+				  const struct nftnl_expr *e2)
+{
+	static const uint16_t attrs[] = {
+		NFTNL_EXPR_BYTEORDER_SREG, NFTNL_EXPR_BYTEORDER_DREG,
+	};
+	uint32_t reg, i;
+
+	if (!opt_expr_is(e2, "byteorder") ||
+	    nftnl_expr_get_u32(e1, NFTNL_EXPR_BYTEORDER_OP) ==
+	    nftnl_expr_get_u32(e2, NFTNL_EXPR_BYTEORDER_OP) ||
+	    nftnl_expr_get_u32(e1, NFTNL_EXPR_BYTEORDER_LEN) !=
+	    nftnl_expr_get_u32(e2, NFTNL_EXPR_BYTEORDER_LEN) ||
+	    nftnl_expr_get_u32(e1, NFTNL_EXPR_BYTEORDER_SIZE) !=
+	    nftnl_expr_get_u32(e2, NFTNL_EXPR_BYTEORDER_SIZE))
+		return false;
+
+	reg = nftnl_expr_get_u32(e1, NFTNL_EXPR_BYTEORDER_SREG);
+	for (i = 0; i < array_size(attrs); i++) {
+		if (nftnl_expr_get_u32(e1, attrs[i]) != reg ||
+		    nftnl_expr_get_u32(e2, attrs[i]) != reg)
+			return false;
+	}
+	return true;
+}
+
+/* Returns true if @next went away together with @e. */
+static bool peep_byteorder(struct peep_ctx *ctx, struct nftnl_expr *e,
+			   struct nftnl_expr *next)
+{
+	if (next && peep_byteorder_undone(e, next)) {
+		peep_remove(ctx, e);
+		peep_remove(ctx, next);
+		return true;
+	}
+
+	peep_write(ctx, e, NFTNL_EXPR_BYTEORDER_DREG,
+		   nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_LEN));
+	return false;
+}
+
+static void peep_range(struct peep_ctx *ctx, struct nftnl_expr *e)
+{
+	uint32_t len;
+	int word;
+
+	if (nftnl_expr_get_u32(e, NFTNL_EXPR_RANGE_OP) != NFT_RANGE_EQ)
+		return;
+
+	nftnl_expr_get(e, NFTNL_EXPR_RANGE_FROM_DATA, &len);
+	word = peep_reg(e, NFTNL_EXPR_RANGE_SREG, len);
+	if (word >= 0)
+		peep_track(ctx, e, word, len, true);
+}
+
+/*
+ * Compare on a register whose value is known to be within [from, to]. Both
+ * compare bytes in network order, the way memcmp() does. Returns true if
+ * the compare can go, possibly after narrowing the range.
+ */
+static bool peep_cmp_range(struct nftnl_expr *range, uint32_t op,
+			   const void *data, uint32_t len)
+{
+	const void *from, *to;
+	uint32_t from_len, to_len;
+	int lo, hi;
+
+	from = nftnl_expr_get(range, NFTNL_EXPR_RANGE_FROM_DATA, &from_len);
+	to = nftnl_expr_get(range, NFTNL_EXPR_RANGE_TO_DATA, &to_len);
+	if (from_len != len || to_len != len)
+		return false;
+
+	/* data against from, and against to */
+	lo = memcmp(data, from, len);
+	hi = memcmp(data, to, len);
+
+	switch (op) {
+	case NFT_CMP_NEQ:
+		return lo < 0 || hi > 0;
+	case NFT_CMP_LT:
+		return hi > 0;
+	case NFT_CMP_GT:
+		return lo < 0;
+	case NFT_CMP_LTE:
+		if (hi >= 0)
+			return true;
+		if (lo < 0)
+			return false;
+		return nftnl_expr_set(range, NFTNL_EXPR_RANGE_TO_DATA,
+				      data, len) == 0;
+	case NFT_CMP_GTE:
+		if (lo <= 0)
+			return true;
+		if (hi > 0)
+			return false;
+		return nftnl_expr_set(range, NFTNL_EXPR_RANGE_FROM_DATA,
+				      data, len) == 0;
+	}
+	return false;
+}
+
+static void peep_cmp(struct peep_ctx *ctx, struct nftnl_expr *e)
+{
+	struct nftnl_expr *range;
+	uint32_t op, len;
+	const void *data;
+	int word;
+
+	data = nftnl_expr_get(e, NFTNL_EXPR_CMP_DATA, &len);
+	if (data == NULL)
+		return;
+
+	word = peep_reg(e, NFTNL_EXPR_CMP_SREG, len);
+	if (word < 0)
+		return;
+
+	range = ctx->regs[word].range;
+	if (!peep_holds(ctx, range, word, len, true))
+		return;
+
+	op = nftnl_expr_get_u32(e, NFTNL_EXPR_CMP_OP);
+	if (op != NFT_CMP_EQ) {
+		if (peep_cmp_range(range, op, data, len))
+			peep_remove(ctx, e);
+		return;
+	}
+
+	/* a value within the range makes the range redundant */
+	if (!peep_cmp_range(range, NFT_CMP_NEQ, data, len))
+		peep_remove(ctx, range);
+}
+
+EXPORT_SYMBOL(nftnl_rule_optimize_exprs);
+int nftnl_rule_optimize_exprs(struct nftnl_rule *r)
+{
+	struct nftnl_expr *e, *next, *after;
+	struct peep_ctx ctx = {};
+	uint32_t len;
+
+	list_for_each_entry_safe(e, next, &r->expr_list, head) {
+		if (opt_expr_is(e, "payload")) {
+			peep_payload(&ctx, e);
+		} else if (opt_expr_is(e, "cmp")) {
+			peep_cmp(&ctx, e);
+		} else if (opt_expr_is(e, "range")) {
+			peep_range(&ctx, e);
+		} else if (opt_expr_is(e, "bitwise")) {
+			peep_bitwise(&ctx, e);
+		} else if (opt_expr_is(e, "byteorder")) {
+			if (&next->head == &r->expr_list) {
+				peep_byteorder(&ctx, e, NULL);
+				continue;
+			}
+			/* the next expression may go as well */
+			after = list_entry(next->head.next, struct nftnl_expr,
+					   head);
+			if (peep_byteorder(&ctx, e, next))
+				next = after;
+		} else if (opt_expr_is(e, "immediate")) {
+			if (nftnl_expr_is_set(e, NFTNL_EXPR_IMM_DATA)) {
+				nftnl_expr_get(e, NFTNL_EXPR_IMM_DATA, &len);
+				peep_write(&ctx, e, NFTNL_EXPR_IMM_DREG, len);
+			}
+		} else if (opt_expr_is(e, "meta")) {
+			/* keys without a destination set packet meta data */
+			if (nftnl_expr_is_set(e, NFTNL_EXPR_META_DREG))
+				peep_write(&ctx, e, NFTNL_EXPR_META_DREG,
+					   PEEP_KEY_MAXLEN);
+		} else if (opt_expr_is(e, "ct")) {
+			if (nftnl_expr_is_set(e, NFTNL_EXPR_CT_DREG))
+				peep_write(&ctx, e, NFTNL_EXPR_CT_DREG,
+					   PEEP_KEY_MAXLEN);
+		} else if (opt_expr_is(e, "counter") ||
+			   opt_expr_is(e, "log") ||
+			   opt_expr_is(e, "limit") ||
+			   opt_expr_is(e, "quota")) {
+			peep_forget_ranges(&ctx);
+		} else {
+			/* no idea what it writes */
+			peep_forget_all(&ctx);
+		}
+	}
+
+	return ctx.removed;
+}
@@ -9,6 +9,7 @@
  * This code has been sponsored by Sophos Astaro <http://www.sophos.com>
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -58,9 +59,170 @@ void nftnl_rule_free(const struct nftnl_rule *r)
 	if (r->flags & (1 << (NFTNL_RULE_USERDATA)))
 		xfree(r->user.data);
 
+	xfree(r->wire.data);
 	xfree(r);
 }
 
+EXPORT_SYMBOL(nftnl_rule_clone);
+struct nftnl_rule *nftnl_rule_clone(const struct nftnl_rule *r, uint32_t flags)
+{
+	struct nftnl_rule *newr;
+	struct nftnl_expr *e, *newe;
+
+	newr = nftnl_rule_alloc();
+	if (newr == NULL)
+		return NULL;
+
+	/* attributes owning memory are flagged once they have been copied */
+	newr->flags = r->flags & ~((1 << NFTNL_RULE_TABLE) |
+				   (1 << NFTNL_RULE_CHAIN) |
+				   (1 << NFTNL_RULE_USERDATA));
+	newr->family = r->family;
+	newr->handle = r->handle;
+	newr->position = r->position;
+	newr->id = r->id;
+	newr->position_id = r->position_id;
+	newr->compat = r->compat;
+
+	if (r->flags & (1 << NFTNL_RULE_TABLE)) {
+		newr->table = strdup(r->table);
+		if (!newr->table)
+			goto err;
+		newr->flags |= (1 << NFTNL_RULE_TABLE);
+	}
+	if (r->flags & (1 << NFTNL_RULE_CHAIN)) {
+		newr->chain = strdup(r->chain);
+		if (!newr->chain)
+			goto err;
+		newr->flags |= (1 << NFTNL_RULE_CHAIN);
+	}
+	if (r->flags & (1 << NFTNL_RULE_USERDATA)) {
+		newr->user.data = malloc(r->user.len);
+		if (!newr->user.data)
+			goto err;
+		memcpy(newr->user.data, r->user.data, r->user.len);
+		newr->user.len = r->user.len;
+		newr->flags |= (1 << NFTNL_RULE_USERDATA);
+	}
+
+	list_for_each_entry(e, &r->expr_list, head) {
+		newe = nftnl_expr_clone(e, flags);
+		if (!newe)
+			goto err;
+		nftnl_rule_add_expr(newr, newe);
+	}
+
+	newr->wire_cache = r->wire_cache;
+	if (r->wire.data)
+		nftnl_wire_save(&newr->wire, r->wire.data, r->wire.len);
+
+	return newr;
+err:
+	nftnl_rule_free(newr);
+	return NULL;
+}
+
+/* Attributes identifying what a rule does, as opposed to where it is. */
+#define NFTNL_RULE_CMP_ATTRS	((1 << NFTNL_RULE_FAMILY) |		\
+				 (1 << NFTNL_RULE_TABLE) |		\
+				 (1 << NFTNL_RULE_CHAIN) |		\
+				 (1 << NFTNL_RULE_COMPAT_PROTO) |	\
+				 (1 << NFTNL_RULE_COMPAT_FLAGS) |	\
+				 (1 << NFTNL_RULE_USERDATA))
+
+bool __nftnl_rule_equal(const struct nftnl_rule *r1,
+			const struct nftnl_rule *r2,
+			bool (*cmp)(const struct nftnl_expr *e1,
+				    const struct nftnl_expr *e2, void *data),
+			void *data)
+{
+	uint32_t flags = r1->flags & NFTNL_RULE_CMP_ATTRS;
+	const struct list_head *p1, *p2;
+
+	if (flags != (r2->flags & NFTNL_RULE_CMP_ATTRS))
+		return false;
+
+	if (flags & (1 << NFTNL_RULE_FAMILY) && r1->family != r2->family)
+		return false;
+	if (flags & (1 << NFTNL_RULE_TABLE) && strcmp(r1->table, r2->table))
+		return false;
+	if (flags & (1 << NFTNL_RULE_CHAIN) && strcmp(r1->chain, r2->chain))
+		return false;
+	if (flags & (1 << NFTNL_RULE_COMPAT_PROTO) &&
+	    r1->compat.proto != r2->compat.proto)
+		return false;
+	if (flags & (1 << NFTNL_RULE_COMPAT_FLAGS) &&
+	    r1->compat.flags != r2->compat.flags)
+		return false;
+	if (flags & (1 << NFTNL_RULE_USERDATA) &&
+	    (r1->user.len != r2->user.len ||
+	     memcmp(r1->user.data, r2->user.data, r1->user.len)))
+		return false;
+
+	for (p1 = r1->expr_list.next, p2 = r2->expr_list.next;
+	     p1 != &r1->expr_list && p2 != &r2->expr_list;
+	     p1 = p1->next, p2 = p2->next) {
+		if (!cmp(list_entry(p1, const struct nftnl_expr, head),
+			 list_entry(p2, const struct nftnl_expr, head), data))
+			return false;
+	}
+
+	return p1 == &r1->expr_list && p2 == &r2->expr_list;
+}
+
+static bool rule_expr_cmp(const struct nftnl_expr *e1,
+			  const struct nftnl_expr *e2, void *data)
+{
+	return nftnl_expr_cmp(e1, e2);
+}
+
+EXPORT_SYMBOL(nftnl_rule_equal);
+bool nftnl_rule_equal(const struct nftnl_rule *r1, const struct nftnl_rule *r2)
+{
+	return __nftnl_rule_equal(r1, r2, rule_expr_cmp, NULL);
+}
+
+uint32_t __nftnl_rule_hash(const struct nftnl_rule *r,
+			   uint32_t (*hash)(const struct nftnl_expr *e,
+					    uint32_t seed, void *data),
+			   void *data)
+{
+	uint32_t flags = r->flags & NFTNL_RULE_CMP_ATTRS;
+	struct nftnl_expr *expr;
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, flags);
+	if (flags & (1 << NFTNL_RULE_FAMILY))
+		h = nftnl_hash_u32(h, r->family);
+	if (flags & (1 << NFTNL_RULE_TABLE))
+		h = nftnl_hash_str(h, r->table);
+	if (flags & (1 << NFTNL_RULE_CHAIN))
+		h = nftnl_hash_str(h, r->chain);
+	if (flags & (1 << NFTNL_RULE_COMPAT_PROTO))
+		h = nftnl_hash_u32(h, r->compat.proto);
+	if (flags & (1 << NFTNL_RULE_COMPAT_FLAGS))
+		h = nftnl_hash_u32(h, r->compat.flags);
+	if (flags & (1 << NFTNL_RULE_USERDATA))
+		h = nftnl_hash_mem(h, r->user.data, r->user.len);
+
+	list_for_each_entry(expr, &r->expr_list, head)
+		h = hash(expr, h, data);
+
+	return nftnl_hash_final(h);
+}
+
+static uint32_t rule_expr_hash(const struct nftnl_expr *e, uint32_t seed,
+			       void *data)
+{
+	return nftnl_expr_hash(e, seed);
+}
+
+EXPORT_SYMBOL(nftnl_rule_hash);
+uint32_t nftnl_rule_hash(const struct nftnl_rule *r)
+{
+	return __nftnl_rule_hash(r, rule_expr_hash, NULL);
+}
+
 EXPORT_SYMBOL(nftnl_rule_is_set);
 bool nftnl_rule_is_set(const struct nftnl_rule *r, uint16_t attr)
 {
@@ -279,26 +441,42 @@ uint8_t nftnl_rule_get_u8(const struct nftnl_rule *r, uint16_t attr)
 	return val ? *val : 0;
 }
 
-EXPORT_SYMBOL(nftnl_rule_nlmsg_build_payload);
-void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
+EXPORT_SYMBOL(nftnl_rule_nlmsg_build_dump_filter);
+void nftnl_rule_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+					const char *table, const char *chain)
 {
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+
+	nfg->nfgen_family = family;
+	if (table)
+		mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, table);
+	if (table && chain)
+		mnl_attr_put_strz(nlh, NFTA_RULE_CHAIN, chain);
+}
+
+void nftnl_rule_nlmsg_build_attrs(struct nlmsghdr *nlh, struct nftnl_rule *r,
+				  uint32_t attrs)
+{
+	uint32_t flags = r->flags & attrs;
 	struct nftnl_expr *expr;
 	struct nlattr *nest, *nest2;
 
-	if (r->flags & (1 << NFTNL_RULE_TABLE))
+	if (flags & (1 << NFTNL_RULE_TABLE))
 		mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, r->table);
-	if (r->flags & (1 << NFTNL_RULE_CHAIN))
+	if (flags & (1 << NFTNL_RULE_CHAIN))
 		mnl_attr_put_strz(nlh, NFTA_RULE_CHAIN, r->chain);
-	if (r->flags & (1 << NFTNL_RULE_HANDLE))
+	if (flags & (1 << NFTNL_RULE_HANDLE))
 		mnl_attr_put_u64(nlh, NFTA_RULE_HANDLE, htobe64(r->handle));
-	if (r->flags & (1 << NFTNL_RULE_POSITION))
+	if (flags & (1 << NFTNL_RULE_POSITION))
 		mnl_attr_put_u64(nlh, NFTA_RULE_POSITION, htobe64(r->position));
-	if (r->flags & (1 << NFTNL_RULE_USERDATA)) {
+	if (flags & (1 << NFTNL_RULE_USERDATA)) {
 		mnl_attr_put(nlh, NFTA_RULE_USERDATA, r->user.len,
 			     r->user.data);
 	}
 
-	if (!list_empty(&r->expr_list)) {
+	if (r->wire.data) {
+		nftnl_wire_put(nlh, &r->wire);
+	} else if (!list_empty(&r->expr_list)) {
 		nest = mnl_attr_nest_start(nlh, NFTA_RULE_EXPRESSIONS);
 		list_for_each_entry(expr, &r->expr_list, head) {
 			nest2 = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
@@ -306,10 +484,13 @@ void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
 			mnl_attr_nest_end(nlh, nest2);
 		}
 		mnl_attr_nest_end(nlh, nest);
+
+		if (r->wire_cache)
+			nftnl_wire_save(&r->wire, nest, nest->nla_len);
 	}
 
-	if (r->flags & (1 << NFTNL_RULE_COMPAT_PROTO) &&
-	    r->flags & (1 << NFTNL_RULE_COMPAT_FLAGS)) {
+	if (flags & (1 << NFTNL_RULE_COMPAT_PROTO) &&
+	    flags & (1 << NFTNL_RULE_COMPAT_FLAGS)) {
 
 		nest = mnl_attr_nest_start(nlh, NFTA_RULE_COMPAT);
 		mnl_attr_put_u32(nlh, NFTA_RULE_COMPAT_PROTO,
@@ -318,24 +499,49 @@ void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
 				 htonl(r->compat.flags));
 		mnl_attr_nest_end(nlh, nest);
 	}
-	if (r->flags & (1 << NFTNL_RULE_ID))
+	if (flags & (1 << NFTNL_RULE_ID))
 		mnl_attr_put_u32(nlh, NFTA_RULE_ID, htonl(r->id));
-	if (r->flags & (1 << NFTNL_RULE_POSITION_ID))
+	if (flags & (1 << NFTNL_RULE_POSITION_ID))
 		mnl_attr_put_u32(nlh, NFTA_RULE_POSITION_ID, htonl(r->position_id));
 }
 
+EXPORT_SYMBOL(nftnl_rule_nlmsg_build_payload);
+void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
+{
+	nftnl_rule_nlmsg_build_attrs(nlh, r, r->flags);
+}
+
 EXPORT_SYMBOL(nftnl_rule_add_expr);
 void nftnl_rule_add_expr(struct nftnl_rule *r, struct nftnl_expr *expr)
 {
+	expr->rule = r;
 	list_add_tail(&expr->head, &r->expr_list);
+	nftnl_rule_wire_invalidate(r);
 }
 
 EXPORT_SYMBOL(nftnl_rule_del_expr);
 void nftnl_rule_del_expr(struct nftnl_expr *expr)
 {
+	if (expr->rule)
+		nftnl_rule_wire_invalidate(expr->rule);
+
+	expr->rule = NULL;
 	list_del(&expr->head);
 }
 
+EXPORT_SYMBOL(nftnl_rule_cache_wire);
+void nftnl_rule_cache_wire(struct nftnl_rule *r, bool enable)
+{
+	r->wire_cache = enable;
+	if (!enable)
+		nftnl_wire_reset(&r->wire);
+}
+
+void nftnl_rule_wire_invalidate(struct nftnl_rule *r)
+{
+	nftnl_wire_reset(&r->wire);
+}
+
 static int nftnl_rule_parse_attr_cb(const struct nlattr *attr, void *data)
 {
 	const struct nlattr **tb = data;
@@ -377,22 +583,46 @@ static int nftnl_rule_parse_attr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
+/*
+ * All expressions of the rule are placed in one block so that walking them
+ * touches contiguous memory. The first pass sizes the block.
+ */
 static int nftnl_rule_parse_expr(struct nlattr *nest, struct nftnl_rule *r)
 {
+	struct nftnl_expr_block *block;
 	struct nftnl_expr *expr;
 	struct nlattr *attr;
+	uint32_t size = 0, len;
+	int ret = 0;
 
 	mnl_attr_for_each_nested(attr, nest) {
 		if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM)
 			return -1;
 
-		expr = nftnl_expr_parse(attr);
-		if (expr == NULL)
+		len = nftnl_expr_block_len(attr);
+		if (len == 0)
 			return -1;
 
+		size += len;
+	}
+
+	block = nftnl_expr_block_alloc(size);
+	if (block == NULL)
+		return -1;
+
+	mnl_attr_for_each_nested(attr, nest) {
+		expr = nftnl_expr_block_parse(block, attr);
+		if (expr == NULL) {
+			ret = -1;
+			break;
+		}
+
+		expr->rule = r;
 		list_add_tail(&expr->head, &r->expr_list);
 	}
-	return 0;
+	nftnl_expr_block_put(block);
+
+	return ret;
 }
 
 static int nftnl_rule_parse_compat_cb(const struct nlattr *attr, void *data)
@@ -466,6 +696,7 @@ int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
 		r->flags |= (1 << NFTNL_RULE_HANDLE);
 	}
 	if (tb[NFTA_RULE_EXPRESSIONS]) {
+		nftnl_rule_wire_invalidate(r);
 		ret = nftnl_rule_parse_expr(tb[NFTA_RULE_EXPRESSIONS], r);
 		if (ret < 0)
 			return ret;
@@ -695,13 +926,9 @@ int nftnl_expr_foreach(struct nftnl_rule *r,
        return 0;
 }
 
-struct nftnl_expr_iter {
-	const struct nftnl_rule	*r;
-	struct nftnl_expr	*cur;
-};
-
-static void nftnl_expr_iter_init(const struct nftnl_rule *r,
-				 struct nftnl_expr_iter *iter)
+EXPORT_SYMBOL(nftnl_expr_iter_init);
+void nftnl_expr_iter_init(struct nftnl_expr_iter *iter,
+			  const struct nftnl_rule *r)
 {
 	iter->r = r;
 	if (list_empty(&r->expr_list))
@@ -720,7 +947,7 @@ struct nftnl_expr_iter *nftnl_expr_iter_create(const struct nftnl_rule *r)
 	if (iter == NULL)
 		return NULL;
 
-	nftnl_expr_iter_init(r, iter);
+	nftnl_expr_iter_init(iter, r);
 
 	return iter;
 }
@@ -807,6 +1034,60 @@ void nftnl_rule_list_del(struct nftnl_rule *r)
 	list_del(&r->head);
 }
 
+static int nftnl_rule_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_rule_list *list = data;
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0) {
+		nftnl_rule_free(r);
+		return MNL_CB_ERROR;
+	}
+	nftnl_rule_list_add_tail(r, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_rule_dump_reset(void *data)
+{
+	struct nftnl_rule_list *list = data;
+	struct nftnl_rule *r, *tmp;
+
+	list_for_each_entry_safe(r, tmp, &list->list, head) {
+		nftnl_rule_list_del(r);
+		nftnl_rule_free(r);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_rule_list_dump);
+int nftnl_rule_list_dump(struct nftnl_rule_list *list, struct mnl_socket *nl,
+			 uint32_t family, const char *table, const char *chain)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_rule_list *dump;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_rule_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETRULE, family, NLM_F_DUMP,
+				    time(NULL));
+	nftnl_rule_nlmsg_build_dump_filter(nlh, family, table, chain);
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_rule_dump_cb,
+			       nftnl_rule_dump_reset, dump);
+	if (ret == 0)
+		list_splice_init(&dump->list, list->list.prev);
+	nftnl_rule_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_rule_list_foreach);
 int nftnl_rule_list_foreach(struct nftnl_rule_list *rule_list,
 			  int (*cb)(struct nftnl_rule *r, void *data),
@@ -823,10 +1104,16 @@ int nftnl_rule_list_foreach(struct nftnl_rule_list *rule_list,
 	return 0;
 }
 
-struct nftnl_rule_list_iter {
-	const struct nftnl_rule_list	*list;
-	struct nftnl_rule		*cur;
-};
+EXPORT_SYMBOL(nftnl_rule_list_iter_init);
+void nftnl_rule_list_iter_init(struct nftnl_rule_list_iter *iter,
+			       const struct nftnl_rule_list *l)
+{
+	iter->list = l;
+	if (nftnl_rule_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_rule, head);
+}
 
 EXPORT_SYMBOL(nftnl_rule_list_iter_create);
 struct nftnl_rule_list_iter *
@@ -838,11 +1125,7 @@ nftnl_rule_list_iter_create(const struct nftnl_rule_list *l)
 	if (iter == NULL)
 		return NULL;
 
-	iter->list = l;
-	if (nftnl_rule_list_is_empty(l))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(l->list.next, struct nftnl_rule, head);
+	nftnl_rule_list_iter_init(iter, l);
 
 	return iter;
 }
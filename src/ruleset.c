@@ -22,12 +22,16 @@
 #include <libnftnl/chain.h>
 #include <libnftnl/set.h>
 #include <libnftnl/rule.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
 
 struct nftnl_ruleset {
 	struct nftnl_table_list	*table_list;
 	struct nftnl_chain_list	*chain_list;
 	struct nftnl_set_list	*set_list;
 	struct nftnl_rule_list	*rule_list;
+	struct nftnl_obj_list	*obj_list;
+	struct nftnl_flowtable_list	*flowtable_list;
 
 	uint16_t		flags;
 };
@@ -70,6 +74,10 @@ void nftnl_ruleset_free(const struct nftnl_ruleset *r)
 		nftnl_set_list_free(r->set_list);
 	if (r->flags & (1 << NFTNL_RULESET_RULELIST))
 		nftnl_rule_list_free(r->rule_list);
+	if (r->flags & (1 << NFTNL_RULESET_OBJLIST))
+		nftnl_obj_list_free(r->obj_list);
+	if (r->flags & (1 << NFTNL_RULESET_FLOWTABLELIST))
+		nftnl_flowtable_list_free(r->flowtable_list);
 	xfree(r);
 }
 
@@ -98,6 +106,12 @@ void nftnl_ruleset_unset(struct nftnl_ruleset *r, uint16_t attr)
 	case NFTNL_RULESET_RULELIST:
 		nftnl_rule_list_free(r->rule_list);
 		break;
+	case NFTNL_RULESET_OBJLIST:
+		nftnl_obj_list_free(r->obj_list);
+		break;
+	case NFTNL_RULESET_FLOWTABLELIST:
+		nftnl_flowtable_list_free(r->flowtable_list);
+		break;
 	}
 	r->flags &= ~(1 << attr);
 }
@@ -122,6 +136,14 @@ void nftnl_ruleset_set(struct nftnl_ruleset *r, uint16_t attr, void *data)
 		nftnl_ruleset_unset(r, NFTNL_RULESET_RULELIST);
 		r->rule_list = data;
 		break;
+	case NFTNL_RULESET_OBJLIST:
+		nftnl_ruleset_unset(r, NFTNL_RULESET_OBJLIST);
+		r->obj_list = data;
+		break;
+	case NFTNL_RULESET_FLOWTABLELIST:
+		nftnl_ruleset_unset(r, NFTNL_RULESET_FLOWTABLELIST);
+		r->flowtable_list = data;
+		break;
 	default:
 		return;
 	}
@@ -143,6 +165,10 @@ void *nftnl_ruleset_get(const struct nftnl_ruleset *r, uint16_t attr)
 		return r->set_list;
 	case NFTNL_RULESET_RULELIST:
 		return r->rule_list;
+	case NFTNL_RULESET_OBJLIST:
+		return r->obj_list;
+	case NFTNL_RULESET_FLOWTABLELIST:
+		return r->flowtable_list;
 	default:
 		return NULL;
 	}
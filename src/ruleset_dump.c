@@ -0,0 +1,506 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "dump.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
+
+/*
+ * One dump runs on each socket at a time, the next one is sent as soon as
+ * the socket is done with it. Sets go first: their elements are dumped set
+ * by set, on any socket that is free, once all sets are there. Parts of all
+ * dumps must be of the same generation, or all of them are done again. A
+ * set deleted before its elements are dumped is such a change, too.
+ */
+static const uint16_t ruleset_dump_types[] = {
+	NFT_MSG_GETSET,
+	NFT_MSG_GETRULE,
+	NFT_MSG_GETCHAIN,
+	NFT_MSG_GETTABLE,
+	NFT_MSG_GETOBJ,
+	NFT_MSG_GETFLOWTABLE,
+};
+
+struct ruleset_dump {
+	uint32_t			family;
+	uint32_t			seq;
+	struct nftnl_dump_check		check;
+	/* dumps sent and not done yet */
+	unsigned int			running;
+	/* index of the next of ruleset_dump_types to send */
+	unsigned int			next_type;
+
+	/* sets to dump the elements of, once sets_done */
+	struct nftnl_set		**sets;
+	unsigned int			num_sets;
+	unsigned int			size_sets;
+	unsigned int			next_set;
+	bool				sets_done;
+
+	struct nftnl_table_list		*tables;
+	struct nftnl_chain_list		*chains;
+	struct nftnl_set_list		*set_list;
+	struct nftnl_rule_list		*rules;
+	struct nftnl_obj_list		*objs;
+	struct nftnl_flowtable_list	*flowtables;
+};
+
+struct ruleset_dump_sock {
+	struct ruleset_dump	*dump;
+	struct mnl_socket	*nl;
+	uint32_t		portid;
+	/* the dump running on it, if any */
+	bool			busy;
+	uint32_t		seq;
+	uint16_t		type;
+	struct nftnl_set	*set;
+};
+
+static int ruleset_dump_init(struct ruleset_dump *d)
+{
+	memset(&d->check, 0, sizeof(d->check));
+	d->running = 0;
+	d->next_type = 0;
+	d->sets = NULL;
+	d->num_sets = d->size_sets = d->next_set = 0;
+	d->sets_done = false;
+
+	d->tables = nftnl_table_list_alloc();
+	d->chains = nftnl_chain_list_alloc();
+	d->set_list = nftnl_set_list_alloc();
+	d->rules = nftnl_rule_list_alloc();
+	d->objs = nftnl_obj_list_alloc();
+	d->flowtables = nftnl_flowtable_list_alloc();
+	if (d->tables == NULL || d->chains == NULL || d->set_list == NULL ||
+	    d->rules == NULL || d->objs == NULL || d->flowtables == NULL)
+		return -1;
+
+	return 0;
+}
+
+static void ruleset_dump_fini(struct ruleset_dump *d)
+{
+	if (d->tables)
+		nftnl_table_list_free(d->tables);
+	if (d->chains)
+		nftnl_chain_list_free(d->chains);
+	if (d->set_list)
+		nftnl_set_list_free(d->set_list);
+	if (d->rules)
+		nftnl_rule_list_free(d->rules);
+	if (d->objs)
+		nftnl_obj_list_free(d->objs);
+	if (d->flowtables)
+		nftnl_flowtable_list_free(d->flowtables);
+	xfree(d->sets);
+}
+
+static void ruleset_dump_commit(struct ruleset_dump *d,
+				struct nftnl_ruleset *rs)
+{
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, d->tables);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, d->chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, d->set_list);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, d->rules);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_OBJLIST, d->objs);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_FLOWTABLELIST, d->flowtables);
+	xfree(d->sets);
+}
+
+static int ruleset_dump_table(struct ruleset_dump *d,
+			      const struct nlmsghdr *nlh)
+{
+	struct nftnl_table *t;
+
+	t = nftnl_table_alloc();
+	if (t == NULL)
+		return -1;
+
+	if (nftnl_table_nlmsg_parse(nlh, t) < 0) {
+		nftnl_table_free(t);
+		return -1;
+	}
+	nftnl_table_list_add_tail(t, d->tables);
+
+	return 0;
+}
+
+static int ruleset_dump_chain(struct ruleset_dump *d,
+			      const struct nlmsghdr *nlh)
+{
+	struct nftnl_chain *c;
+
+	c = nftnl_chain_alloc();
+	if (c == NULL)
+		return -1;
+
+	if (nftnl_chain_nlmsg_parse(nlh, c) < 0) {
+		nftnl_chain_free(c);
+		return -1;
+	}
+	nftnl_chain_list_add_tail(c, d->chains);
+
+	return 0;
+}
+
+static int ruleset_dump_rule(struct ruleset_dump *d,
+			     const struct nlmsghdr *nlh)
+{
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		return -1;
+
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0) {
+		nftnl_rule_free(r);
+		return -1;
+	}
+	nftnl_rule_list_add_tail(r, d->rules);
+
+	return 0;
+}
+
+static int ruleset_dump_set(struct ruleset_dump *d,
+			    const struct nlmsghdr *nlh)
+{
+	struct nftnl_set **sets;
+	struct nftnl_set *s;
+
+	if (d->num_sets == d->size_sets) {
+		d->size_sets = d->size_sets ? d->size_sets * 2 : 64;
+		sets = realloc(d->sets, d->size_sets * sizeof(*sets));
+		if (sets == NULL)
+			return -1;
+		d->sets = sets;
+	}
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return -1;
+
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0) {
+		nftnl_set_free(s);
+		return -1;
+	}
+	nftnl_set_list_add_tail(s, d->set_list);
+	d->sets[d->num_sets++] = s;
+
+	return 0;
+}
+
+static int ruleset_dump_obj(struct ruleset_dump *d,
+			    const struct nlmsghdr *nlh)
+{
+	struct nftnl_obj *o;
+
+	o = nftnl_obj_alloc();
+	if (o == NULL)
+		return -1;
+
+	if (nftnl_obj_nlmsg_parse(nlh, o) < 0) {
+		nftnl_obj_free(o);
+		return -1;
+	}
+	nftnl_obj_list_add_tail(o, d->objs);
+
+	return 0;
+}
+
+static int ruleset_dump_flowtable(struct ruleset_dump *d,
+				  const struct nlmsghdr *nlh)
+{
+	struct nftnl_flowtable *f;
+
+	f = nftnl_flowtable_alloc();
+	if (f == NULL)
+		return -1;
+
+	if (nftnl_flowtable_nlmsg_parse(nlh, f) < 0) {
+		nftnl_flowtable_free(f);
+		return -1;
+	}
+	nftnl_flowtable_list_add_tail(f, d->flowtables);
+
+	return 0;
+}
+
+static int ruleset_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct ruleset_dump_sock *sock = data;
+	struct ruleset_dump *d = sock->dump;
+	int ret;
+
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWTABLE:
+		ret = ruleset_dump_table(d, nlh);
+		break;
+	case NFT_MSG_NEWCHAIN:
+		ret = ruleset_dump_chain(d, nlh);
+		break;
+	case NFT_MSG_NEWRULE:
+		ret = ruleset_dump_rule(d, nlh);
+		break;
+	case NFT_MSG_NEWSET:
+		ret = ruleset_dump_set(d, nlh);
+		break;
+	case NFT_MSG_NEWSETELEM:
+		ret = nftnl_set_elems_nlmsg_parse(nlh, sock->set);
+		break;
+	case NFT_MSG_NEWOBJ:
+		ret = ruleset_dump_obj(d, nlh);
+		break;
+	case NFT_MSG_NEWFLOWTABLE:
+		ret = ruleset_dump_flowtable(d, nlh);
+		break;
+	default:
+		ret = 0;
+		break;
+	}
+
+	return ret < 0 ? MNL_CB_ERROR : MNL_CB_OK;
+}
+
+/* Whether dumps are left to send, now or once the sets are done. */
+static bool ruleset_dump_pending(const struct ruleset_dump *d)
+{
+	return d->next_type < array_size(ruleset_dump_types) ||
+	       d->next_set < d->num_sets;
+}
+
+/* Send the next dump on @sock, if there is one to send yet. */
+static int ruleset_dump_send(struct ruleset_dump_sock *sock)
+{
+	struct ruleset_dump *d = sock->dump;
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_set *s = NULL;
+	struct nlmsghdr *nlh;
+	uint32_t family;
+	uint16_t type;
+
+	if (d->next_type < array_size(ruleset_dump_types)) {
+		type = ruleset_dump_types[d->next_type++];
+		nlh = nftnl_nlmsg_build_hdr(buf, type, d->family, NLM_F_DUMP,
+					    d->seq);
+	} else if (d->sets_done && d->next_set < d->num_sets) {
+		s = d->sets[d->next_set++];
+		type = NFT_MSG_GETSETELEM;
+		family = nftnl_set_get_u32(s, NFTNL_SET_FAMILY);
+		nlh = nftnl_nlmsg_build_hdr(buf, type, family, NLM_F_DUMP,
+					    d->seq);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE,
+				  nftnl_set_get_str(s, NFTNL_SET_TABLE));
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET,
+				  nftnl_set_get_str(s, NFTNL_SET_NAME));
+	} else {
+		return 0;
+	}
+
+	if (mnl_socket_sendto(sock->nl, nlh, nlh->nlmsg_len) < 0)
+		return -1;
+
+	sock->busy = true;
+	sock->seq = d->seq++;
+	sock->type = type;
+	sock->set = s;
+	d->running++;
+
+	return 0;
+}
+
+/*
+ * Whether the @len bytes of messages in @buf end a dump, with its last part
+ * or with an error. The error, if any, is stored in @error: dumps that fail
+ * once started carry it in their last part, which libmnl does not look at.
+ */
+static void ruleset_dump_done(struct ruleset_dump_sock *sock)
+{
+	sock->busy = false;
+	sock->dump->running--;
+}
+
+/*
+ * Returns 0 once the dump running on @sock is done, 1 if it goes on. On
+ * errors, @sock stays busy if the kernel still sends parts of the dump.
+ */
+static int ruleset_dump_recv(struct ruleset_dump_sock *sock, char *buf,
+			     size_t size)
+{
+	struct ruleset_dump *d = sock->dump;
+	int ret, len, error;
+	bool ended;
+
+	len = mnl_socket_recvfrom(sock->nl, buf, size);
+	if (len < 0) {
+		/* parts may have been lost, the end of the dump among them */
+		ruleset_dump_done(sock);
+		return -1;
+	}
+
+	nftnl_dump_check(&d->check, buf, len);
+	ret = mnl_cb_run(buf, len, sock->seq, sock->portid, ruleset_dump_cb,
+			 sock);
+	if (ret == MNL_CB_OK)
+		return 1;
+	ended = nftnl_dump_ended(buf, len, &error);
+	if (ret < 0 && !ended)
+		return -1;
+
+	ruleset_dump_done(sock);
+	/* the set went away after the sets were dumped */
+	if (sock->type == NFT_MSG_GETSETELEM && error == ENOENT) {
+		d->check.intr = true;
+		return 0;
+	}
+	if (ret < 0)
+		return -1;
+	if (error) {
+		errno = error;
+		return -1;
+	}
+	if (sock->type == NFT_MSG_GETSET)
+		d->sets_done = true;
+
+	return 0;
+}
+
+/*
+ * Read the dumps still running to their end and drop them, for nothing to
+ * be left queued on the sockets. Keeps errno.
+ */
+static void ruleset_dump_drain(struct ruleset_dump_sock *socks,
+			       unsigned int num, char *buf, size_t size)
+{
+	int err = errno, len, error;
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		while (socks[i].busy) {
+			len = mnl_socket_recvfrom(socks[i].nl, buf, size);
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len < 0 || nftnl_dump_ended(buf, len, &error))
+				ruleset_dump_done(&socks[i]);
+		}
+	}
+	errno = err;
+}
+
+static int ruleset_dump_run(struct ruleset_dump_sock *socks,
+			    struct pollfd *pfd, unsigned int num)
+{
+	struct ruleset_dump *d = socks[0].dump;
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	unsigned int i;
+
+	do {
+		/* elements may be ready to dump after the sets are done */
+		for (i = 0; i < num; i++) {
+			if (!socks[i].busy && ruleset_dump_send(&socks[i]) < 0)
+				goto err;
+		}
+
+		for (i = 0; i < num; i++) {
+			pfd[i].fd = socks[i].busy ?
+				    mnl_socket_get_fd(socks[i].nl) : -1;
+			pfd[i].events = POLLIN;
+			pfd[i].revents = 0;
+		}
+		if (d->running > 0 && poll(pfd, num, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			goto err;
+		}
+
+		for (i = 0; i < num; i++) {
+			if (pfd[i].revents &&
+			    ruleset_dump_recv(&socks[i], buf, sizeof(buf)) < 0)
+				goto err;
+		}
+	} while (d->running > 0 || ruleset_dump_pending(d));
+
+	if (d->check.intr) {
+		errno = EINTR;
+		return -1;
+	}
+	return 0;
+err:
+	ruleset_dump_drain(socks, num, buf, sizeof(buf));
+	return -1;
+}
+
+EXPORT_SYMBOL(nftnl_ruleset_dump);
+int nftnl_ruleset_dump(struct nftnl_ruleset *rs, struct mnl_socket **nl,
+		       unsigned int num, uint32_t family)
+{
+	struct ruleset_dump d = {
+		.family	= family,
+		.seq	= time(NULL),
+	};
+	struct ruleset_dump_sock *socks;
+	struct pollfd *pfd;
+	unsigned int i;
+	int ret = -1;
+
+	if (num == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	socks = calloc(num, sizeof(*socks));
+	pfd = calloc(num, sizeof(*pfd));
+	if (socks == NULL || pfd == NULL)
+		goto out;
+
+	for (i = 0; i < num; i++) {
+		socks[i].dump = &d;
+		socks[i].nl = nl[i];
+		socks[i].portid = mnl_socket_get_portid(nl[i]);
+	}
+
+	for (i = 0; i < NFTNL_DUMP_TRIES; i++) {
+		if (i > 0)
+			nftnl_dump_backoff(i);
+
+		if (ruleset_dump_init(&d) < 0) {
+			ruleset_dump_fini(&d);
+			goto out;
+		}
+
+		if (ruleset_dump_run(socks, pfd, num) == 0) {
+			ruleset_dump_commit(&d, rs);
+			ret = 0;
+			goto out;
+		}
+		ruleset_dump_fini(&d);
+
+		if (errno != EINTR)
+			goto out;
+	}
+	errno = EAGAIN;
+out:
+	xfree(socks);
+	xfree(pfd);
+	return ret;
+}
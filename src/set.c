@@ -9,6 +9,7 @@
  * This code has been sponsored by Sophos Astaro <http://www.sophos.com>
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -349,29 +350,55 @@ uint64_t nftnl_set_get_u64(const struct nftnl_set *s, uint16_t attr)
 	return val ? *val : 0;
 }
 
+EXPORT_SYMBOL(nftnl_set_clone);
 struct nftnl_set *nftnl_set_clone(const struct nftnl_set *set)
 {
 	struct nftnl_set *newset;
 	struct nftnl_set_elem *elem, *newelem;
+	struct nftnl_expr *expr, *newexpr;
 
 	newset = nftnl_set_alloc();
 	if (newset == NULL)
 		return NULL;
 
 	memcpy(newset, set, sizeof(*set));
+	INIT_LIST_HEAD(&newset->head);
+	INIT_HLIST_NODE(&newset->hnode);
+	INIT_LIST_HEAD(&newset->element_list);
+	INIT_LIST_HEAD(&newset->expr_list);
+
+	/* attributes owning memory are flagged once they have been copied */
+	newset->flags &= ~((1 << NFTNL_SET_TABLE) | (1 << NFTNL_SET_NAME) |
+			   (1 << NFTNL_SET_USERDATA));
 
 	if (set->flags & (1 << NFTNL_SET_TABLE)) {
 		newset->table = strdup(set->table);
 		if (!newset->table)
 			goto err;
+		newset->flags |= (1 << NFTNL_SET_TABLE);
 	}
 	if (set->flags & (1 << NFTNL_SET_NAME)) {
 		newset->name = strdup(set->name);
 		if (!newset->name)
 			goto err;
+		newset->flags |= (1 << NFTNL_SET_NAME);
+	}
+	if (set->flags & (1 << NFTNL_SET_USERDATA)) {
+		newset->user.data = malloc(set->user.len);
+		if (!newset->user.data)
+			goto err;
+		memcpy(newset->user.data, set->user.data, set->user.len);
+		newset->flags |= (1 << NFTNL_SET_USERDATA);
+	}
+
+	list_for_each_entry(expr, &set->expr_list, head) {
+		newexpr = nftnl_expr_clone(expr, 0);
+		if (newexpr == NULL)
+			goto err;
+
+		list_add_tail(&newexpr->head, &newset->expr_list);
 	}
 
-	INIT_LIST_HEAD(&newset->element_list);
 	list_for_each_entry(elem, &set->element_list, head) {
 		newelem = nftnl_set_elem_clone(elem);
 		if (newelem == NULL)
@@ -425,6 +452,17 @@ nftnl_set_nlmsg_build_desc_payload(struct nlmsghdr *nlh, struct nftnl_set *s)
 	mnl_attr_nest_end(nlh, nest);
 }
 
+EXPORT_SYMBOL(nftnl_set_nlmsg_build_dump_filter);
+void nftnl_set_nlmsg_build_dump_filter(struct nlmsghdr *nlh, uint32_t family,
+				       const char *table)
+{
+	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+
+	nfg->nfgen_family = family;
+	if (table)
+		mnl_attr_put_strz(nlh, NFTA_SET_TABLE, table);
+}
+
 EXPORT_SYMBOL(nftnl_set_nlmsg_build_payload);
 void nftnl_set_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_set *s)
 {
@@ -964,6 +1002,65 @@ void nftnl_set_list_del(struct nftnl_set *s)
 	hlist_del(&s->hnode);
 }
 
+static int nftnl_set_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_set_list *list = data;
+	struct nftnl_set *s;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0) {
+		nftnl_set_free(s);
+		return MNL_CB_ERROR;
+	}
+	nftnl_set_list_add_tail(s, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_set_dump_reset(void *data)
+{
+	struct nftnl_set_list *list = data;
+	struct nftnl_set *s, *tmp;
+
+	list_for_each_entry_safe(s, tmp, &list->list, head) {
+		nftnl_set_list_del(s);
+		nftnl_set_free(s);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_set_list_dump);
+int nftnl_set_list_dump(struct nftnl_set_list *list, struct mnl_socket *nl,
+			uint32_t family, const char *table)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_set_list *dump;
+	struct nftnl_set *s, *tmp;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_set_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETSET, family, NLM_F_DUMP,
+				    time(NULL));
+	nftnl_set_nlmsg_build_dump_filter(nlh, family, table);
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_set_dump_cb,
+			       nftnl_set_dump_reset, dump);
+	if (ret == 0) {
+		list_for_each_entry_safe(s, tmp, &dump->list, head) {
+			nftnl_set_list_del(s);
+			nftnl_set_list_add_tail(s, list);
+		}
+	}
+	nftnl_set_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_set_list_foreach);
 int nftnl_set_list_foreach(struct nftnl_set_list *set_list,
 			 int (*cb)(struct nftnl_set *t, void *data), void *data)
@@ -979,10 +1076,16 @@ int nftnl_set_list_foreach(struct nftnl_set_list *set_list,
 	return 0;
 }
 
-struct nftnl_set_list_iter {
-	const struct nftnl_set_list	*list;
-	struct nftnl_set		*cur;
-};
+EXPORT_SYMBOL(nftnl_set_list_iter_init);
+void nftnl_set_list_iter_init(struct nftnl_set_list_iter *iter,
+			      const struct nftnl_set_list *l)
+{
+	iter->list = l;
+	if (nftnl_set_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_set, head);
+}
 
 EXPORT_SYMBOL(nftnl_set_list_iter_create);
 struct nftnl_set_list_iter *
@@ -994,11 +1097,7 @@ nftnl_set_list_iter_create(const struct nftnl_set_list *l)
 	if (iter == NULL)
 		return NULL;
 
-	iter->list = l;
-	if (nftnl_set_list_is_empty(l))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(l->list.next, struct nftnl_set, head);
+	nftnl_set_list_iter_init(iter, l);
 
 	return iter;
 }
@@ -0,0 +1,358 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/set.h>
+
+/*
+ * Element delta between two sets. Elements are identified by their key, their
+ * key end and whether they close an interval. Elements whose key is only
+ * found on one side are added or deleted, elements whose data differs are
+ * deleted and added again.
+ */
+
+struct elem_node {
+	struct elem_node	*next;
+	uint32_t		hash;
+	struct nftnl_set_elem	*elem;
+	bool			used;
+};
+
+uint32_t nftnl_set_elem_key_hash(const struct nftnl_set_elem *e)
+{
+	uint32_t h;
+
+	h = nftnl_hash_u32(0, e->set_elem_flags & NFT_SET_ELEM_INTERVAL_END);
+	h = nftnl_hash_mem(h, e->key.val, e->key.len);
+	if (e->flags & (1 << NFTNL_SET_ELEM_KEY_END))
+		h = nftnl_hash_mem(h, e->key_end.val, e->key_end.len);
+
+	return nftnl_hash_final(h);
+}
+
+bool nftnl_set_elem_key_eq(const struct nftnl_set_elem *e1,
+			   const struct nftnl_set_elem *e2)
+{
+	if ((e1->set_elem_flags & NFT_SET_ELEM_INTERVAL_END) !=
+	    (e2->set_elem_flags & NFT_SET_ELEM_INTERVAL_END))
+		return false;
+	if ((e1->flags & (1 << NFTNL_SET_ELEM_KEY_END)) !=
+	    (e2->flags & (1 << NFTNL_SET_ELEM_KEY_END)))
+		return false;
+	if (!nftnl_data_reg_cmp(&e1->key, &e2->key, DATA_VALUE))
+		return false;
+	if (e1->flags & (1 << NFTNL_SET_ELEM_KEY_END) &&
+	    !nftnl_data_reg_cmp(&e1->key_end, &e2->key_end, DATA_VALUE))
+		return false;
+
+	return true;
+}
+
+/* Element attributes compared when set in the desired element. */
+#define ELEM_DATA_ATTRS	((1 << NFTNL_SET_ELEM_FLAGS) |		\
+			 (1 << NFTNL_SET_ELEM_VERDICT) |	\
+			 (1 << NFTNL_SET_ELEM_CHAIN) |		\
+			 (1 << NFTNL_SET_ELEM_DATA) |		\
+			 (1 << NFTNL_SET_ELEM_TIMEOUT) |	\
+			 (1 << NFTNL_SET_ELEM_USERDATA) |	\
+			 (1 << NFTNL_SET_ELEM_OBJREF))
+
+static bool elem_data_eq(const struct nftnl_set_elem *cur,
+			 const struct nftnl_set_elem *want)
+{
+	uint32_t flags = want->flags & ELEM_DATA_ATTRS;
+
+	if ((cur->flags & flags) != flags)
+		return false;
+
+	if (flags & (1 << NFTNL_SET_ELEM_FLAGS) &&
+	    cur->set_elem_flags != want->set_elem_flags)
+		return false;
+	if (flags & (1 << NFTNL_SET_ELEM_VERDICT) &&
+	    !nftnl_data_reg_cmp(&cur->data, &want->data, DATA_VERDICT))
+		return false;
+	if (flags & (1 << NFTNL_SET_ELEM_DATA) &&
+	    !nftnl_data_reg_cmp(&cur->data, &want->data, DATA_VALUE))
+		return false;
+	if (flags & (1 << NFTNL_SET_ELEM_TIMEOUT) &&
+	    cur->timeout != want->timeout)
+		return false;
+	if (flags & (1 << NFTNL_SET_ELEM_USERDATA) &&
+	    (cur->user.len != want->user.len ||
+	     memcmp(cur->user.data, want->user.data, cur->user.len)))
+		return false;
+	if (flags & (1 << NFTNL_SET_ELEM_OBJREF) &&
+	    strcmp(cur->objref, want->objref))
+		return false;
+
+	if (!list_empty(&want->expr_list) &&
+	    !nftnl_expr_list_cmp(&cur->expr_list, &want->expr_list))
+		return false;
+
+	return true;
+}
+
+static uint32_t elem_count(const struct nftnl_set *s)
+{
+	struct nftnl_set_elem *e;
+	uint32_t num = 0;
+
+	list_for_each_entry(e, &s->element_list, head)
+		num++;
+
+	return num;
+}
+
+/* Hash join of the current elements with the desired ones. */
+int nftnl_set_elems_delta(struct nftnl_set_elems_delta *d,
+			  const struct nftnl_set *cur,
+			  const struct nftnl_set *want)
+{
+	uint32_t num_cur = elem_count(cur), num_want = elem_count(want);
+	struct elem_node *nodes, **buckets, *n;
+	uint32_t size = 1, hash, i;
+	struct nftnl_set_elem *e;
+
+	memset(d, 0, sizeof(*d));
+
+	while (size < num_cur)
+		size <<= 1;
+
+	nodes = calloc(num_cur ? num_cur : 1, sizeof(*nodes));
+	buckets = calloc(size, sizeof(*buckets));
+	d->del = calloc(num_cur ? num_cur : 1, sizeof(struct nftnl_set_elem *));
+	d->add = calloc(num_want ? num_want : 1,
+			sizeof(struct nftnl_set_elem *));
+	if (nodes == NULL || buckets == NULL || d->del == NULL ||
+	    d->add == NULL)
+		goto err;
+
+	i = 0;
+	list_for_each_entry(e, &cur->element_list, head) {
+		n = &nodes[i++];
+		n->hash = nftnl_set_elem_key_hash(e);
+		n->elem = e;
+		n->next = buckets[n->hash & (size - 1)];
+		buckets[n->hash & (size - 1)] = n;
+	}
+
+	list_for_each_entry(e, &want->element_list, head) {
+		hash = nftnl_set_elem_key_hash(e);
+		for (n = buckets[hash & (size - 1)]; n; n = n->next) {
+			if (!n->used && n->hash == hash &&
+			    nftnl_set_elem_key_eq(n->elem, e))
+				break;
+		}
+		if (n) {
+			n->used = true;
+			if (elem_data_eq(n->elem, e))
+				continue;
+
+			d->del[d->num_del++] = n->elem;
+		}
+		d->add[d->num_add++] = e;
+	}
+
+	for (i = 0; i < num_cur; i++) {
+		if (!nodes[i].used)
+			d->del[d->num_del++] = nodes[i].elem;
+	}
+
+	xfree(nodes);
+	xfree(buckets);
+	return 0;
+err:
+	xfree(nodes);
+	xfree(buckets);
+	nftnl_set_elems_delta_release(d);
+	errno = ENOMEM;
+	return -1;
+}
+
+void nftnl_set_elems_delta_release(struct nftnl_set_elems_delta *d)
+{
+	xfree(d->del);
+	xfree(d->add);
+	memset(d, 0, sizeof(*d));
+}
+
+/* What it takes to delete @e: its key, key end and flags. */
+static struct nftnl_set_elem *elem_key_clone(const struct nftnl_set_elem *e)
+{
+	struct nftnl_set_elem *newelem;
+
+	newelem = nftnl_set_elem_alloc();
+	if (newelem == NULL)
+		return NULL;
+
+	newelem->flags = e->flags & ((1 << NFTNL_SET_ELEM_KEY) |
+				     (1 << NFTNL_SET_ELEM_KEY_END) |
+				     (1 << NFTNL_SET_ELEM_FLAGS));
+	newelem->key = e->key;
+	newelem->key_end = e->key_end;
+	newelem->set_elem_flags = e->set_elem_flags;
+
+	return newelem;
+}
+
+static int elems_copy(struct nftnl_set *s, struct nftnl_set_elem **elems,
+		      uint32_t num, bool key_only)
+{
+	struct nftnl_set_elem *e;
+	uint32_t i;
+
+	if (s == NULL)
+		return 0;
+
+	for (i = 0; i < num; i++) {
+		e = key_only ? elem_key_clone(elems[i]) :
+			       nftnl_set_elem_clone(elems[i]);
+		if (e == NULL)
+			return -1;
+
+		list_add_tail(&e->head, &s->element_list);
+	}
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_set_elems_diff);
+int nftnl_set_elems_diff(const struct nftnl_set *cur,
+			 const struct nftnl_set *want,
+			 struct nftnl_set *add, struct nftnl_set *del)
+{
+	struct nftnl_set_elems_delta d;
+	int ret;
+
+	if (nftnl_set_elems_delta(&d, cur, want) < 0)
+		return -1;
+
+	ret = elems_copy(add, d.add, d.num_add, false);
+	if (ret == 0)
+		ret = elems_copy(del, d.del, d.num_del, true);
+
+	nftnl_set_elems_delta_release(&d);
+	return ret;
+}
+
+static int elem_key_cmp(const void *k1, uint32_t len1,
+			const void *k2, uint32_t len2)
+{
+	int ret;
+
+	ret = memcmp(k1, k2, len1 < len2 ? len1 : len2);
+	if (ret)
+		return ret;
+
+	return len1 < len2 ? -1 : len1 > len2;
+}
+
+static int elem_sort_cmp(const void *a, const void *b)
+{
+	const struct nftnl_set_elem *e1 = *(struct nftnl_set_elem **)a;
+	const struct nftnl_set_elem *e2 = *(struct nftnl_set_elem **)b;
+
+	return elem_key_cmp(e1->key.val, e1->key.len,
+			    e2->key.val, e2->key.len);
+}
+
+/* Current elements that a plain key can stand for. */
+static bool elem_is_key(const struct nftnl_set_elem *e)
+{
+	return !(e->flags & (1 << NFTNL_SET_ELEM_KEY_END)) &&
+	       !(e->set_elem_flags & NFT_SET_ELEM_INTERVAL_END);
+}
+
+static int elem_key_add(struct nftnl_set *s, const void *key,
+			uint32_t key_len)
+{
+	struct nftnl_set_elem *e;
+
+	if (s == NULL)
+		return 0;
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return -1;
+
+	if (nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, key, key_len) < 0) {
+		nftnl_set_elem_free(e);
+		return -1;
+	}
+	list_add_tail(&e->head, &s->element_list);
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_set_elems_diff_keys);
+int nftnl_set_elems_diff_keys(const struct nftnl_set *cur, const void *keys,
+			      uint32_t key_len, uint32_t num,
+			      struct nftnl_set *add, struct nftnl_set *del)
+{
+	uint32_t num_cur = elem_count(cur), i = 0, j = 0;
+	const uint8_t *key = keys, *prev = NULL;
+	struct nftnl_set_elem **elems, *e;
+	int cmp, ret = -1;
+
+	if (key_len == 0 || key_len > NFT_DATA_VALUE_MAXLEN) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	elems = calloc(num_cur ? num_cur : 1, sizeof(struct nftnl_set_elem *));
+	if (elems == NULL)
+		return -1;
+
+	list_for_each_entry(e, &cur->element_list, head)
+		elems[i++] = e;
+
+	qsort(elems, num_cur, sizeof(struct nftnl_set_elem *), elem_sort_cmp);
+
+	/* Sort-merge of the current elements with the sorted keys. */
+	for (i = 0; i < num_cur || j < num;) {
+		if (j < num && prev) {
+			cmp = memcmp(prev, key + j * key_len, key_len);
+			if (cmp > 0) {
+				errno = EINVAL;
+				goto out;
+			}
+			if (cmp == 0) {
+				j++;
+				continue;
+			}
+		}
+
+		if (i == num_cur)
+			cmp = 1;
+		else if (j == num)
+			cmp = -1;
+		else
+			cmp = elem_key_cmp(elems[i]->key.val, elems[i]->key.len,
+					   key + j * key_len, key_len);
+
+		if (cmp < 0 || (cmp == 0 && !elem_is_key(elems[i]))) {
+			if (elems_copy(del, &elems[i], 1, true) < 0)
+				goto out;
+			i++;
+		} else if (cmp > 0) {
+			if (elem_key_add(add, key + j * key_len, key_len) < 0)
+				goto out;
+			prev = key + j++ * key_len;
+		} else {
+			i++;
+			prev = key + j++ * key_len;
+		}
+	}
+	ret = 0;
+out:
+	xfree(elems);
+	return ret;
+}
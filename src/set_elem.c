@@ -9,6 +9,7 @@
  * This code has been sponsored by Sophos Astaro <http://www.sophos.com>
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -278,20 +279,51 @@ uint64_t nftnl_set_elem_get_u64(struct nftnl_set_elem *s, uint16_t attr)
 	return val;
 }
 
+EXPORT_SYMBOL(nftnl_set_elem_clone);
 struct nftnl_set_elem *nftnl_set_elem_clone(struct nftnl_set_elem *elem)
 {
 	struct nftnl_set_elem *newelem;
+	struct nftnl_expr *expr, *newexpr;
 
 	newelem = nftnl_set_elem_alloc();
 	if (newelem == NULL)
 		return NULL;
 
 	memcpy(newelem, elem, sizeof(*elem));
+	INIT_LIST_HEAD(&newelem->head);
+	INIT_LIST_HEAD(&newelem->expr_list);
+
+	/* attributes owning memory are flagged once they have been copied */
+	newelem->flags &= ~((1 << NFTNL_SET_ELEM_CHAIN) |
+			    (1 << NFTNL_SET_ELEM_USERDATA) |
+			    (1 << NFTNL_SET_ELEM_OBJREF));
 
 	if (elem->flags & (1 << NFTNL_SET_ELEM_CHAIN)) {
 		newelem->data.chain = strdup(elem->data.chain);
 		if (!newelem->data.chain)
 			goto err;
+		newelem->flags |= (1 << NFTNL_SET_ELEM_CHAIN);
+	}
+	if (elem->flags & (1 << NFTNL_SET_ELEM_USERDATA)) {
+		newelem->user.data = malloc(elem->user.len);
+		if (!newelem->user.data)
+			goto err;
+		memcpy(newelem->user.data, elem->user.data, elem->user.len);
+		newelem->flags |= (1 << NFTNL_SET_ELEM_USERDATA);
+	}
+	if (elem->flags & (1 << NFTNL_SET_ELEM_OBJREF)) {
+		newelem->objref = strdup(elem->objref);
+		if (!newelem->objref)
+			goto err;
+		newelem->flags |= (1 << NFTNL_SET_ELEM_OBJREF);
+	}
+
+	list_for_each_entry(expr, &elem->expr_list, head) {
+		newexpr = nftnl_expr_clone(expr, 0);
+		if (newexpr == NULL)
+			goto err;
+
+		list_add_tail(&newexpr->head, &newelem->expr_list);
 	}
 
 	return newelem;
@@ -479,19 +511,15 @@ static int nftnl_set_elem_parse_attr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
-static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest)
+int nftnl_set_elem_nlattr_parse(struct nftnl_set_elem *e,
+				const struct nlattr *nest)
 {
 	struct nlattr *tb[NFTA_SET_ELEM_MAX+1] = {};
-	struct nftnl_set_elem *e;
 	int ret, type;
 
-	e = nftnl_set_elem_alloc();
-	if (e == NULL)
-		return -1;
-
 	ret = mnl_attr_parse_nested(nest, nftnl_set_elem_parse_attr_cb, tb);
 	if (ret < 0)
-		goto out_set_elem;
+		return ret;
 
 	if (tb[NFTA_SET_ELEM_FLAGS]) {
 		e->set_elem_flags =
@@ -509,20 +537,20 @@ static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest
         if (tb[NFTA_SET_ELEM_KEY]) {
 		ret = nftnl_parse_data(&e->key, tb[NFTA_SET_ELEM_KEY], &type);
 		if (ret < 0)
-			goto out_set_elem;
+			return ret;
 		e->flags |= (1 << NFTNL_SET_ELEM_KEY);
         }
 	if (tb[NFTA_SET_ELEM_KEY_END]) {
 		ret = nftnl_parse_data(&e->key_end, tb[NFTA_SET_ELEM_KEY_END],
 				       &type);
 		if (ret < 0)
-			goto out_set_elem;
+			return ret;
 		e->flags |= (1 << NFTNL_SET_ELEM_KEY_END);
 	}
         if (tb[NFTA_SET_ELEM_DATA]) {
 		ret = nftnl_parse_data(&e->data, tb[NFTA_SET_ELEM_DATA], &type);
 		if (ret < 0)
-			goto out_set_elem;
+			return ret;
 		switch(type) {
 		case DATA_VERDICT:
 			e->flags |= (1 << NFTNL_SET_ELEM_VERDICT);
@@ -540,10 +568,8 @@ static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest
 		struct nftnl_expr *expr;
 
 		expr = nftnl_expr_parse(tb[NFTA_SET_ELEM_EXPR]);
-		if (expr == NULL) {
-			ret = -1;
-			goto out_set_elem;
-		}
+		if (expr == NULL)
+			return -1;
 		list_add_tail(&expr->head, &e->expr_list);
 		e->flags |= (1 << NFTNL_SET_ELEM_EXPR);
 	} else if (tb[NFTA_SET_ELEM_EXPRESSIONS]) {
@@ -551,15 +577,11 @@ static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest
 		struct nlattr *attr;
 
 		mnl_attr_for_each_nested(attr, tb[NFTA_SET_ELEM_EXPRESSIONS]) {
-			if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM) {
-				ret = -1;
-				goto out_set_elem;
-			}
+			if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM)
+				return -1;
 			expr = nftnl_expr_parse(attr);
-			if (expr == NULL) {
-				ret = -1;
-				goto out_set_elem;
-			}
+			if (expr == NULL)
+				return -1;
 			list_add_tail(&expr->head, &e->expr_list);
 		}
 		e->flags |= (1 << NFTNL_SET_ELEM_EXPRESSIONS);
@@ -573,29 +595,38 @@ static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest
 
 		e->user.len  = mnl_attr_get_payload_len(tb[NFTA_SET_ELEM_USERDATA]);
 		e->user.data = malloc(e->user.len);
-		if (e->user.data == NULL) {
-			ret = -1;
-			goto out_set_elem;
-		}
+		if (e->user.data == NULL)
+			return -1;
 		memcpy(e->user.data, udata, e->user.len);
 		e->flags |= (1 << NFTNL_RULE_USERDATA);
 	}
 	if (tb[NFTA_SET_ELEM_OBJREF]) {
 		e->objref = strdup(mnl_attr_get_str(tb[NFTA_SET_ELEM_OBJREF]));
-		if (e->objref == NULL) {
-			ret = -1;
-			goto out_set_elem;
-		}
+		if (e->objref == NULL)
+			return -1;
 		e->flags |= (1 << NFTNL_SET_ELEM_OBJREF);
 	}
 
+	return 0;
+}
+
+static int nftnl_set_elems_parse2(struct nftnl_set *s, const struct nlattr *nest)
+{
+	struct nftnl_set_elem *e;
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		return -1;
+
+	if (nftnl_set_elem_nlattr_parse(e, nest) < 0) {
+		nftnl_set_elem_free(e);
+		return -1;
+	}
+
 	/* Add this new element to this set */
 	list_add_tail(&e->head, &s->element_list);
 
 	return 0;
-out_set_elem:
-	nftnl_set_elem_free(e);
-	return ret;
 }
 
 static int
@@ -684,6 +715,57 @@ int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
 	return 0;
 }
 
+static int nftnl_set_elems_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	if (nftnl_set_elems_nlmsg_parse(nlh, data) < 0)
+		return MNL_CB_ERROR;
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_set_elems_dump_reset(void *data)
+{
+	struct nftnl_set_elem *e, *tmp;
+	struct nftnl_set *s = data;
+
+	list_for_each_entry_safe(e, tmp, &s->element_list, head) {
+		list_del(&e->head);
+		nftnl_set_elem_free(e);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_set_elems_dump);
+int nftnl_set_elems_dump(struct nftnl_set *s, struct mnl_socket *nl)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_set *dump;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	if (!(s->flags & (1 << NFTNL_SET_TABLE)) ||
+	    !(s->flags & (1 << NFTNL_SET_NAME))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	dump = nftnl_set_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETSETELEM, s->family,
+				    NLM_F_DUMP, time(NULL));
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, s->table);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, s->name);
+
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_set_elems_dump_cb,
+			       nftnl_set_elems_dump_reset, dump);
+	if (ret == 0)
+		list_splice_init(&dump->element_list, s->element_list.prev);
+	nftnl_set_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_set_elem_parse);
 int nftnl_set_elem_parse(struct nftnl_set_elem *e, enum nftnl_parse_type type,
 		       const char *data, struct nftnl_parse_err *err)
@@ -813,11 +895,18 @@ int nftnl_set_elem_foreach(struct nftnl_set *s,
 	return 0;
 }
 
-struct nftnl_set_elems_iter {
-	const struct nftnl_set		*set;
-	const struct list_head		*list;
-	struct nftnl_set_elem		*cur;
-};
+EXPORT_SYMBOL(nftnl_set_elems_iter_init);
+void nftnl_set_elems_iter_init(struct nftnl_set_elems_iter *iter,
+			       const struct nftnl_set *s)
+{
+	iter->set = s;
+	iter->list = &s->element_list;
+	if (list_empty(&s->element_list))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(s->element_list.next,
+				       struct nftnl_set_elem, head);
+}
 
 EXPORT_SYMBOL(nftnl_set_elems_iter_create);
 struct nftnl_set_elems_iter *
@@ -829,13 +918,7 @@ nftnl_set_elems_iter_create(const struct nftnl_set *s)
 	if (iter == NULL)
 		return NULL;
 
-	iter->set = s;
-	iter->list = &s->element_list;
-	if (list_empty(&s->element_list))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(s->element_list.next,
-				       struct nftnl_set_elem, head);
+	nftnl_set_elems_iter_init(iter, s);
 
 	return iter;
 }
@@ -868,23 +951,6 @@ void nftnl_set_elems_iter_destroy(struct nftnl_set_elems_iter *iter)
 	xfree(iter);
 }
 
-static bool nftnl_attr_nest_overflow(struct nlmsghdr *nlh,
-				   const struct nlattr *from,
-				   const struct nlattr *to)
-{
-	int len = (void *)to + to->nla_len - (void *)from;
-
-	/* The attribute length field is 16 bits long, thus the maximum payload
-	 * that an attribute can convey is UINT16_MAX. In case of overflow,
-	 * discard the last that did not fit into the attribute.
-	 */
-	if (len > UINT16_MAX) {
-		nlh->nlmsg_len -= to->nla_len;
-		return true;
-	}
-	return false;
-}
-
 EXPORT_SYMBOL(nftnl_set_elems_nlmsg_build_payload_iter);
 int nftnl_set_elems_nlmsg_build_payload_iter(struct nlmsghdr *nlh,
 					   struct nftnl_set_elems_iter *iter)
@@ -9,6 +9,7 @@
  * This code has been sponsored by Sophos Astaro <http://www.sophos.com>
  */
 #include "internal.h"
+#include "dump.h"
 
 #include <time.h>
 #include <endian.h>
@@ -460,6 +461,59 @@ void nftnl_table_list_del(struct nftnl_table *t)
 	list_del(&t->head);
 }
 
+static int nftnl_table_dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_table_list *list = data;
+	struct nftnl_table *t;
+
+	t = nftnl_table_alloc();
+	if (t == NULL)
+		return MNL_CB_ERROR;
+
+	if (nftnl_table_nlmsg_parse(nlh, t) < 0) {
+		nftnl_table_free(t);
+		return MNL_CB_ERROR;
+	}
+	nftnl_table_list_add_tail(t, list);
+
+	return MNL_CB_OK;
+}
+
+static void nftnl_table_dump_reset(void *data)
+{
+	struct nftnl_table_list *list = data;
+	struct nftnl_table *t, *tmp;
+
+	list_for_each_entry_safe(t, tmp, &list->list, head) {
+		nftnl_table_list_del(t);
+		nftnl_table_free(t);
+	}
+}
+
+EXPORT_SYMBOL(nftnl_table_list_dump);
+int nftnl_table_list_dump(struct nftnl_table_list *list,
+			  struct mnl_socket *nl, uint32_t family)
+{
+	char buf[NLMSG_HDRLEN + sizeof(struct nfgenmsg)];
+	struct nftnl_table_list *dump;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	dump = nftnl_table_list_alloc();
+	if (dump == NULL)
+		return -1;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETTABLE, family, NLM_F_DUMP,
+				    time(NULL));
+	ret = nftnl_nlmsg_dump(nl, nlh, nftnl_table_dump_cb,
+			       nftnl_table_dump_reset, dump);
+	if (ret == 0)
+		list_splice_init(&dump->list, list->list.prev);
+	nftnl_table_list_free(dump);
+
+	return ret;
+}
+
 EXPORT_SYMBOL(nftnl_table_list_foreach);
 int nftnl_table_list_foreach(struct nftnl_table_list *table_list,
 			   int (*cb)(struct nftnl_table *t, void *data),
@@ -476,10 +530,16 @@ int nftnl_table_list_foreach(struct nftnl_table_list *table_list,
 	return 0;
 }
 
-struct nftnl_table_list_iter {
-	const struct nftnl_table_list	*list;
-	struct nftnl_table		*cur;
-};
+EXPORT_SYMBOL(nftnl_table_list_iter_init);
+void nftnl_table_list_iter_init(struct nftnl_table_list_iter *iter,
+				const struct nftnl_table_list *l)
+{
+	iter->list = l;
+	if (nftnl_table_list_is_empty(l))
+		iter->cur = NULL;
+	else
+		iter->cur = list_entry(l->list.next, struct nftnl_table, head);
+}
 
 EXPORT_SYMBOL(nftnl_table_list_iter_create);
 struct nftnl_table_list_iter *
@@ -491,11 +551,7 @@ nftnl_table_list_iter_create(const struct nftnl_table_list *l)
 	if (iter == NULL)
 		return NULL;
 
-	iter->list = l;
-	if (nftnl_table_list_is_empty(l))
-		iter->cur = NULL;
-	else
-		iter->cur = list_entry(l->list.next, struct nftnl_table, head);
+	nftnl_table_list_iter_init(iter, l);
 
 	return iter;
 }
@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <inttypes.h>
 
+#include <libmnl/libmnl.h>
 #include <libnftnl/common.h>
 
 #include <linux/netfilter.h>
@@ -309,6 +310,103 @@ out:
 	return ret;
 }
 
+void nftnl_wire_reset(struct nftnl_wire *wire)
+{
+	xfree(wire->data);
+	wire->data = NULL;
+	wire->len = 0;
+}
+
+void nftnl_wire_save(struct nftnl_wire *wire, const void *data, uint32_t len)
+{
+	nftnl_wire_reset(wire);
+
+	/* On allocation failure the object is simply encoded again next time. */
+	wire->data = malloc(len);
+	if (!wire->data)
+		return;
+
+	memcpy(wire->data, data, len);
+	wire->len = len;
+}
+
+void nftnl_wire_put(struct nlmsghdr *nlh, const struct nftnl_wire *wire)
+{
+	char *tail = mnl_nlmsg_get_payload_tail(nlh);
+
+	memcpy(tail, wire->data, wire->len);
+	memset(tail + wire->len, 0, MNL_ALIGN(wire->len) - wire->len);
+	nlh->nlmsg_len += MNL_ALIGN(wire->len);
+}
+
+bool nftnl_attr_nest_overflow(struct nlmsghdr *nlh, const struct nlattr *from,
+			      const struct nlattr *to)
+{
+	int len = (void *)to + to->nla_len - (void *)from;
+
+	/* The attribute length field is 16 bits long, thus the maximum payload
+	 * that an attribute can convey is UINT16_MAX. In case of overflow,
+	 * discard the last that did not fit into the attribute.
+	 */
+	if (len > UINT16_MAX) {
+		nlh->nlmsg_len -= to->nla_len;
+		return true;
+	}
+	return false;
+}
+
+/* MurmurHash3 block mixing, one 32-bit word at a time. */
+uint32_t nftnl_hash_u32(uint32_t h, uint32_t val)
+{
+	val *= 0xcc9e2d51;
+	val = (val << 15) | (val >> 17);
+	val *= 0x1b873593;
+
+	h ^= val;
+	h = (h << 13) | (h >> 19);
+
+	return h * 5 + 0xe6546b64;
+}
+
+uint32_t nftnl_hash_u64(uint32_t h, uint64_t val)
+{
+	h = nftnl_hash_u32(h, (uint32_t)val);
+	return nftnl_hash_u32(h, (uint32_t)(val >> 32));
+}
+
+uint32_t nftnl_hash_mem(uint32_t h, const void *data, uint32_t len)
+{
+	const uint8_t *ptr = data;
+	uint32_t val, i;
+
+	for (i = 0; i + sizeof(val) <= len; i += sizeof(val)) {
+		memcpy(&val, ptr + i, sizeof(val));
+		h = nftnl_hash_u32(h, val);
+	}
+
+	val = 0;
+	memcpy(&val, ptr + i, len - i);
+	h = nftnl_hash_u32(h, val);
+
+	return nftnl_hash_u32(h, len);
+}
+
+uint32_t nftnl_hash_str(uint32_t h, const char *str)
+{
+	return nftnl_hash_mem(h, str, strlen(str));
+}
+
+uint32_t nftnl_hash_final(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
 void __nftnl_assert_attr_exists(uint16_t attr, uint16_t attr_max,
 				const char *filename, int line)
 {
@@ -0,0 +1,496 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include "eval.h"
+
+#include <errno.h>
+#include <string.h>
+#include <net/if.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/validate.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+
+/* State of each word of the register file while walking a rule. */
+struct val_word {
+	bool		live;
+	/* first word and length in bytes of the value the word is part of */
+	uint8_t		start;
+	/* 0 if the length of the value is not known */
+	uint8_t		len;
+};
+
+struct val_ctx {
+	const struct nftnl_rule		*rule;
+	const struct nftnl_set_list	*sets;
+	struct val_word			regs[EVAL_REGS];
+};
+
+static bool val_expr_is(const struct nftnl_expr *e, const char *name)
+{
+	return !strcmp(e->ops->name, name);
+}
+
+static int val_reg(const struct nftnl_expr *e, uint16_t attr, uint32_t len)
+{
+	if (!nftnl_expr_is_set(e, attr)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return eval_reg(nftnl_expr_get_u32(e, attr), len);
+}
+
+static int val_read(struct val_ctx *ctx, const struct nftnl_expr *e,
+		    uint16_t attr, uint32_t len)
+{
+	uint32_t w, words = div_round_up(len, NFT_REG32_SIZE);
+	int word;
+
+	word = val_reg(e, attr, len);
+	if (word < 0)
+		return -1;
+
+	for (w = word; w < word + words; w++) {
+		if (!ctx->regs[w].live) {
+			errno = ENODATA;
+			return -1;
+		}
+	}
+	return word;
+}
+
+/* @len is the length of the value written, @known if it is exact. */
+static int val_write(struct val_ctx *ctx, const struct nftnl_expr *e,
+		     uint16_t attr, uint32_t len, bool known)
+{
+	uint32_t w, words = div_round_up(len, NFT_REG32_SIZE);
+	int word;
+
+	word = val_reg(e, attr, len);
+	if (word < 0)
+		return -1;
+
+	for (w = word; w < word + words; w++) {
+		ctx->regs[w].live = true;
+		ctx->regs[w].start = word;
+		ctx->regs[w].len = known ? len : 0;
+	}
+	return 0;
+}
+
+/*
+ * Set keys are one value, or several concatenated ones each padded to a
+ * register word. Either way the key must end where a value ends, and a
+ * single value must be exactly as long as the key.
+ */
+static int val_read_key(struct val_ctx *ctx, const struct nftnl_expr *e,
+			uint16_t attr, uint32_t len)
+{
+	uint32_t words = div_round_up(len, NFT_REG32_SIZE), end;
+	const struct val_word *last;
+	int word;
+
+	word = val_read(ctx, e, attr, len);
+	if (word < 0)
+		return -1;
+
+	last = &ctx->regs[word + words - 1];
+	if (last->len == 0)
+		return 0;
+
+	end = last->start + div_round_up(last->len, NFT_REG32_SIZE);
+	if (end != word + words ||
+	    (last->start == word && last->len != len)) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+static uint32_t val_meta_len(uint32_t key)
+{
+	switch (key) {
+	case NFT_META_IIFNAME:
+	case NFT_META_OIFNAME:
+	case NFT_META_BRI_IIFNAME:
+	case NFT_META_BRI_OIFNAME:
+	case NFT_META_IIFKIND:
+	case NFT_META_OIFKIND:
+	case NFT_META_SDIFNAME:
+		return IFNAMSIZ;
+	case NFT_META_TIME_NS:
+		return sizeof(uint64_t);
+	case NFT_META_PROTOCOL:
+	case NFT_META_IIFTYPE:
+	case NFT_META_OIFTYPE:
+	case NFT_META_BRI_IIFPVID:
+	case NFT_META_BRI_IIFVPROTO:
+		return sizeof(uint16_t);
+	case NFT_META_NFPROTO:
+	case NFT_META_L4PROTO:
+	case NFT_META_PKTTYPE:
+	case NFT_META_SECPATH:
+	case NFT_META_TIME_DAY:
+	case NFT_META_NFTRACE:
+		return sizeof(uint8_t);
+	}
+	return sizeof(uint32_t);
+}
+
+/* 0 if the length depends on the family of the connection. */
+static uint32_t val_ct_len(uint32_t key)
+{
+	switch (key) {
+	case NFT_CT_SRC:
+	case NFT_CT_DST:
+		return 0;
+	case NFT_CT_HELPER:
+	case NFT_CT_LABELS:
+	case NFT_CT_SRC_IP6:
+	case NFT_CT_DST_IP6:
+		return 16;
+	case NFT_CT_PKTS:
+	case NFT_CT_BYTES:
+	case NFT_CT_AVGPKT:
+		return sizeof(uint64_t);
+	case NFT_CT_PROTO_SRC:
+	case NFT_CT_PROTO_DST:
+	case NFT_CT_ZONE:
+		return sizeof(uint16_t);
+	case NFT_CT_DIRECTION:
+	case NFT_CT_L3PROTOCOL:
+	case NFT_CT_PROTOCOL:
+		return sizeof(uint8_t);
+	}
+	return sizeof(uint32_t);
+}
+
+static int val_payload(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t len = nftnl_expr_get_u32(e, NFTNL_EXPR_PAYLOAD_LEN);
+
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_PAYLOAD_SREG))
+		return val_read(ctx, e, NFTNL_EXPR_PAYLOAD_SREG, len) < 0 ?
+		       -1 : 0;
+
+	return val_write(ctx, e, NFTNL_EXPR_PAYLOAD_DREG, len, true);
+}
+
+static int val_meta(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t len = val_meta_len(nftnl_expr_get_u32(e, NFTNL_EXPR_META_KEY));
+
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_META_SREG))
+		return val_read(ctx, e, NFTNL_EXPR_META_SREG, len) < 0 ? -1 : 0;
+
+	return val_write(ctx, e, NFTNL_EXPR_META_DREG, len, true);
+}
+
+static int val_ct(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t len = val_ct_len(nftnl_expr_get_u32(e, NFTNL_EXPR_CT_KEY));
+	uint32_t family = nftnl_rule_get_u32(ctx->rule, NFTNL_RULE_FAMILY);
+	bool known = true;
+
+	if (len == 0) {
+		/* inet leaves the address family open */
+		len = family == NFPROTO_IPV4 ? sizeof(uint32_t) : 16;
+		known = family == NFPROTO_IPV4 || family == NFPROTO_IPV6;
+	}
+
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_CT_SREG))
+		return val_read(ctx, e, NFTNL_EXPR_CT_SREG, len) < 0 ? -1 : 0;
+
+	return val_write(ctx, e, NFTNL_EXPR_CT_DREG, len, known);
+}
+
+static int val_data_len(const struct nftnl_expr *e, uint16_t attr,
+			uint32_t *len)
+{
+	if (nftnl_expr_get(e, attr, len) == NULL || *len == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+static int val_cmp(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t len;
+
+	if (val_data_len(e, NFTNL_EXPR_CMP_DATA, &len) < 0)
+		return -1;
+
+	return val_read(ctx, e, NFTNL_EXPR_CMP_SREG, len) < 0 ? -1 : 0;
+}
+
+static int val_range(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t from_len, to_len;
+
+	if (val_data_len(e, NFTNL_EXPR_RANGE_FROM_DATA, &from_len) < 0 ||
+	    val_data_len(e, NFTNL_EXPR_RANGE_TO_DATA, &to_len) < 0)
+		return -1;
+
+	if (from_len != to_len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return val_read(ctx, e, NFTNL_EXPR_RANGE_SREG, from_len) < 0 ? -1 : 0;
+}
+
+static int val_bitwise(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t len = nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_LEN);
+	uint32_t mask_len, xor_len;
+
+	if (nftnl_expr_get_u32(e, NFTNL_EXPR_BITWISE_OP) == NFT_BITWISE_BOOL) {
+		if (val_data_len(e, NFTNL_EXPR_BITWISE_MASK, &mask_len) < 0 ||
+		    val_data_len(e, NFTNL_EXPR_BITWISE_XOR, &xor_len) < 0)
+			return -1;
+		if (mask_len != len || xor_len != len) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	if (val_read(ctx, e, NFTNL_EXPR_BITWISE_SREG, len) < 0)
+		return -1;
+
+	return val_write(ctx, e, NFTNL_EXPR_BITWISE_DREG, len, true);
+}
+
+static int val_byteorder(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t size = nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_SIZE);
+	uint32_t len = nftnl_expr_get_u32(e, NFTNL_EXPR_BYTEORDER_LEN);
+
+	if ((size != 2 && size != 4 && size != 8) || len % size) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (val_read(ctx, e, NFTNL_EXPR_BYTEORDER_SREG, len) < 0)
+		return -1;
+
+	return val_write(ctx, e, NFTNL_EXPR_BYTEORDER_DREG, len, true);
+}
+
+static int val_immediate(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	uint32_t dreg = nftnl_expr_get_u32(e, NFTNL_EXPR_IMM_DREG);
+	uint32_t len;
+
+	/* verdicts go to the verdict register, data anywhere else */
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_IMM_VERDICT)) {
+		if (dreg != NFT_REG_VERDICT) {
+			errno = EINVAL;
+			return -1;
+		}
+		return 0;
+	}
+
+	if (val_data_len(e, NFTNL_EXPR_IMM_DATA, &len) < 0)
+		return -1;
+
+	return val_write(ctx, e, NFTNL_EXPR_IMM_DREG, len, true);
+}
+
+static const struct nftnl_set *val_set_lookup(const struct val_ctx *ctx,
+					      const char *name, bool has_id,
+					      uint32_t id)
+{
+	const char *table = nftnl_rule_get_str(ctx->rule, NFTNL_RULE_TABLE);
+	struct nftnl_set_list_iter iter;
+	struct nftnl_set *s;
+
+	nftnl_set_list_iter_init(&iter, ctx->sets);
+	while ((s = nftnl_set_list_iter_next(&iter))) {
+		/* sets added in the same batch are known by their id */
+		if (has_id && nftnl_set_is_set(s, NFTNL_SET_ID) &&
+		    nftnl_set_get_u32(s, NFTNL_SET_ID) == id)
+			return s;
+
+		if (name == NULL || !nftnl_set_is_set(s, NFTNL_SET_NAME) ||
+		    strcmp(nftnl_set_get_str(s, NFTNL_SET_NAME), name))
+			continue;
+		if (table && nftnl_set_is_set(s, NFTNL_SET_TABLE) &&
+		    strcmp(nftnl_set_get_str(s, NFTNL_SET_TABLE), table))
+			continue;
+
+		return s;
+	}
+
+	errno = ENOENT;
+	return NULL;
+}
+
+/* Map data goes to a data register, verdicts to the verdict register. */
+static int val_set_data(struct val_ctx *ctx, const struct nftnl_expr *e,
+			uint16_t attr, const struct nftnl_set *s, bool write)
+{
+	uint32_t reg = nftnl_expr_get_u32(e, attr), len;
+	bool verdict;
+
+	if (!(nftnl_set_get_u32(s, NFTNL_SET_FLAGS) & NFT_SET_MAP))
+		goto err;
+
+	verdict = nftnl_set_get_u32(s, NFTNL_SET_DATA_TYPE) == NFT_DATA_VERDICT;
+	if (verdict != (reg == NFT_REG_VERDICT))
+		goto err;
+	if (verdict)
+		return 0;
+
+	len = nftnl_set_get_u32(s, NFTNL_SET_DATA_LEN);
+	if (write)
+		return val_write(ctx, e, attr, len, true);
+
+	return val_read(ctx, e, attr, len) < 0 ? -1 : 0;
+err:
+	errno = EINVAL;
+	return -1;
+}
+
+static int val_lookup(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	const struct nftnl_set *s;
+
+	if (ctx->sets == NULL)
+		goto unknown;
+
+	s = val_set_lookup(ctx, nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_SET) ?
+			   nftnl_expr_get_str(e, NFTNL_EXPR_LOOKUP_SET) : NULL,
+			   nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_SET_ID),
+			   nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_SET_ID));
+	if (s == NULL)
+		return -1;
+
+	if (val_read_key(ctx, e, NFTNL_EXPR_LOOKUP_SREG,
+			 nftnl_set_get_u32(s, NFTNL_SET_KEY_LEN)) < 0)
+		return -1;
+
+	if (!nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_DREG))
+		return 0;
+
+	return val_set_data(ctx, e, NFTNL_EXPR_LOOKUP_DREG, s, true);
+unknown:
+	/* without the set, the key is at least one register word */
+	if (val_read(ctx, e, NFTNL_EXPR_LOOKUP_SREG, NFT_REG32_SIZE) < 0)
+		return -1;
+	if (nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_DREG) &&
+	    nftnl_expr_get_u32(e, NFTNL_EXPR_LOOKUP_DREG) != NFT_REG_VERDICT)
+		return val_write(ctx, e, NFTNL_EXPR_LOOKUP_DREG,
+				 NFT_REG32_SIZE, false);
+	return 0;
+}
+
+static int val_dynset(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	const struct nftnl_set *s;
+
+	if (ctx->sets == NULL)
+		return val_read(ctx, e, NFTNL_EXPR_DYNSET_SREG_KEY,
+				NFT_REG32_SIZE) < 0 ? -1 : 0;
+
+	s = val_set_lookup(ctx,
+			   nftnl_expr_is_set(e, NFTNL_EXPR_DYNSET_SET_NAME) ?
+			   nftnl_expr_get_str(e, NFTNL_EXPR_DYNSET_SET_NAME) :
+			   NULL,
+			   nftnl_expr_is_set(e, NFTNL_EXPR_DYNSET_SET_ID),
+			   nftnl_expr_get_u32(e, NFTNL_EXPR_DYNSET_SET_ID));
+	if (s == NULL)
+		return -1;
+
+	if (val_read_key(ctx, e, NFTNL_EXPR_DYNSET_SREG_KEY,
+			 nftnl_set_get_u32(s, NFTNL_SET_KEY_LEN)) < 0)
+		return -1;
+
+	if (!nftnl_expr_is_set(e, NFTNL_EXPR_DYNSET_SREG_DATA))
+		return 0;
+
+	return val_set_data(ctx, e, NFTNL_EXPR_DYNSET_SREG_DATA, s, false);
+}
+
+static int val_none(struct val_ctx *ctx, const struct nftnl_expr *e)
+{
+	return 0;
+}
+
+static const struct {
+	const char	*name;
+	int		(*check)(struct val_ctx *ctx,
+				 const struct nftnl_expr *e);
+} val_exprs[] = {
+	{ "payload",	val_payload },
+	{ "meta",	val_meta },
+	{ "ct",		val_ct },
+	{ "cmp",	val_cmp },
+	{ "range",	val_range },
+	{ "bitwise",	val_bitwise },
+	{ "byteorder",	val_byteorder },
+	{ "immediate",	val_immediate },
+	{ "lookup",	val_lookup },
+	{ "dynset",	val_dynset },
+	{ "counter",	val_none },
+	{ "log",	val_none },
+	{ "limit",	val_none },
+	{ "quota",	val_none },
+	{ "last",	val_none },
+	{ "notrack",	val_none },
+	{ "connlimit",	val_none },
+	{ "reject",	val_none },
+};
+
+EXPORT_SYMBOL(nftnl_rule_validate);
+int nftnl_rule_validate(const struct nftnl_rule *r,
+			const struct nftnl_set_list *sets,
+			const struct nftnl_expr **bad)
+{
+	struct val_ctx ctx = {
+		.rule	= r,
+		.sets	= sets,
+	};
+	struct nftnl_expr *e;
+	uint32_t i, w;
+
+	list_for_each_entry(e, &r->expr_list, head) {
+		for (i = 0; i < array_size(val_exprs); i++) {
+			if (val_expr_is(e, val_exprs[i].name))
+				break;
+		}
+
+		if (i < array_size(val_exprs)) {
+			if (val_exprs[i].check(&ctx, e) < 0)
+				goto err;
+			continue;
+		}
+
+		/*
+		 * Nothing is known about the registers other expressions
+		 * use, they may have written any of them.
+		 */
+		for (w = 0; w < EVAL_REGS; w++) {
+			if (!ctx.regs[w].live) {
+				ctx.regs[w].live = true;
+				ctx.regs[w].start = w;
+				ctx.regs[w].len = 0;
+			}
+		}
+	}
+	return 0;
+err:
+	if (bad)
+		*bad = e;
+	return -1;
+}
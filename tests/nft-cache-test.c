@@ -0,0 +1,345 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/cache.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/gen.h>
+
+static int test_ok = 1;
+static char buf[4096];
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static int apply_table(struct nftnl_cache *cache, uint16_t type,
+		       const char *name)
+{
+	struct nftnl_table *t = nftnl_table_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, NFPROTO_IPV4);
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, name);
+	nlh = nftnl_table_nlmsg_build_hdr(buf, type, NFPROTO_IPV4, 0, 1);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	nftnl_table_free(t);
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+static int apply_chain(struct nftnl_cache *cache, uint16_t type,
+		       const char *name, uint64_t handle)
+{
+	struct nftnl_chain *c = nftnl_chain_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name);
+	nftnl_chain_set_u64(c, NFTNL_CHAIN_HANDLE, handle);
+	nlh = nftnl_chain_nlmsg_build_hdr(buf, type, NFPROTO_IPV4, 0, 1);
+	nftnl_chain_nlmsg_build_payload(nlh, c);
+	nftnl_chain_free(c);
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+/*
+ * @pos of zero places the rule first in its chain, or last with @flags
+ * NLM_F_APPEND.
+ */
+static int apply_rule(struct nftnl_cache *cache, uint16_t type,
+		      const char *chain, uint64_t handle, uint64_t pos,
+		      uint16_t flags)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, handle);
+	if (pos)
+		nftnl_rule_set_u64(r, NFTNL_RULE_POSITION, pos);
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, type, NFPROTO_IPV4, flags, 1);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	nftnl_rule_free(r);
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+static int apply_set(struct nftnl_cache *cache)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "addrs");
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(uint32_t));
+	nlh = nftnl_set_nlmsg_build_hdr(buf, NFT_MSG_NEWSET, NFPROTO_IPV4,
+					0, 1);
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	nftnl_set_free(s);
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+/* Built the way the kernel does, all elements are NFTA_LIST_ELEM. */
+static int apply_elems(struct nftnl_cache *cache, uint16_t type,
+		       const uint32_t *keys, int num_keys)
+{
+	struct nftnl_set_elem *e;
+	struct nlmsghdr *nlh;
+	struct nlattr *nest;
+	int i;
+
+	nlh = nftnl_set_elem_nlmsg_build_hdr(buf, type, NFPROTO_IPV4, 0, 1);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, "addrs");
+	nest = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+	for (i = 0; i < num_keys; i++) {
+		e = nftnl_set_elem_alloc();
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &keys[i],
+				   sizeof(keys[i]));
+		nftnl_set_elem_nlmsg_build(nlh, e, NFTA_LIST_ELEM);
+		nftnl_set_elem_free(e);
+	}
+	mnl_attr_nest_end(nlh, nest);
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+static int apply_gen(struct nftnl_cache *cache, uint32_t genid)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_gen_nlmsg_build_hdr(buf, NFT_MSG_NEWGEN, AF_UNSPEC, 0, 1);
+	mnl_attr_put_u32(nlh, NFTA_GEN_ID, htonl(genid));
+
+	return nftnl_cache_apply(cache, nlh);
+}
+
+static void check_rules(struct nftnl_chain *c, const uint64_t *handles,
+			int num_handles)
+{
+	struct nftnl_rule_iter iter;
+	struct nftnl_rule *r;
+	int i = 0;
+
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter))) {
+		if (i == num_handles ||
+		    nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE) != handles[i] ||
+		    nftnl_rule_is_set(r, NFTNL_RULE_POSITION))
+			break;
+		i++;
+	}
+	if (r || i != num_handles)
+		print_err("Rules out of order");
+}
+
+static int count_elems(const struct nftnl_set *s)
+{
+	struct nftnl_set_elems_iter *iter;
+	int n = 0;
+
+	iter = nftnl_set_elems_iter_create((struct nftnl_set *)s);
+	while (nftnl_set_elems_iter_next(iter))
+		n++;
+	nftnl_set_elems_iter_destroy(iter);
+	return n;
+}
+
+static void test_events(void)
+{
+	static const uint32_t keys[] = { 1, 2, 3, 4 };
+	static const uint64_t order1[] = { 3, 1, 4, 2 };
+	static const uint64_t order2[] = { 3, 1, 5, 2, 6 };
+	struct nftnl_cache *cache = nftnl_cache_alloc();
+	struct nftnl_chain *c;
+	struct nftnl_rule *r;
+	struct nftnl_set *s;
+
+	if (nftnl_cache_stale_types(cache) != NFTNL_CACHE_ALL)
+		print_err("New cache not stale");
+	nftnl_cache_set_genid(cache, 10);
+
+	if (apply_chain(cache, NFT_MSG_NEWCHAIN, "input", 1) != -1 ||
+	    errno != ESTALE ||
+	    nftnl_cache_stale_types(cache) != NFTNL_CACHE_ALL)
+		print_err("Chain without table accepted");
+	nftnl_cache_set_genid(cache, 10);
+
+	if (apply_table(cache, NFT_MSG_NEWTABLE, "filter") < 0 ||
+	    apply_chain(cache, NFT_MSG_NEWCHAIN, "input", 1) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 1, 0, 0) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 2, 1, 0) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 3, 0, 0) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 4, 1, 0) < 0 ||
+	    apply_set(cache) < 0 ||
+	    apply_elems(cache, NFT_MSG_NEWSETELEM, keys, 4) < 0 ||
+	    apply_gen(cache, 11) < 0)
+		print_err("Event not applied");
+
+	c = nftnl_cache_chain_lookup(cache, NFPROTO_IPV4, "filter", "input");
+	if (c == NULL)
+		print_err("Chain not found");
+	else
+		check_rules(c, order1, 4);
+
+	/* rule 5 takes the place of rule 4, then the chain is renamed */
+	if (apply_rule(cache, NFT_MSG_DELRULE, "input", 4, 0, 0) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 5, 1, 0) < 0 ||
+	    apply_rule(cache, NFT_MSG_NEWRULE, "input", 6, 0,
+		       NLM_F_APPEND) < 0 ||
+	    apply_elems(cache, NFT_MSG_DELSETELEM, keys + 1, 2) < 0 ||
+	    apply_chain(cache, NFT_MSG_NEWCHAIN, "in", 1) < 0 ||
+	    apply_gen(cache, 12) < 0)
+		print_err("Update not applied");
+
+	if (nftnl_cache_chain_lookup(cache, NFPROTO_IPV4, "filter", "input"))
+		print_err("Renamed chain found by old name");
+	c = nftnl_cache_chain_lookup(cache, NFPROTO_IPV4, "filter", "in");
+	if (c == NULL)
+		print_err("Renamed chain not found");
+	else
+		check_rules(c, order2, 5);
+
+	r = nftnl_cache_rule_lookup(cache, NFPROTO_IPV4, "filter", 5);
+	if (r == NULL || strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), "in"))
+		print_err("Rule not found by handle");
+	if (nftnl_cache_rule_lookup(cache, NFPROTO_IPV4, "filter", 4))
+		print_err("Deleted rule found");
+
+	s = nftnl_cache_set_lookup(cache, NFPROTO_IPV4, "filter", "addrs");
+	if (s == NULL || count_elems(s) != 2)
+		print_err("Set elements not updated");
+
+	if (apply_elems(cache, NFT_MSG_DELSETELEM, keys + 1, 1) != -1 ||
+	    errno != ESTALE ||
+	    nftnl_cache_stale_types(cache) != NFTNL_CACHE_SETELEM)
+		print_err("Deleting a missing element accepted");
+	nftnl_cache_set_genid(cache, 12);
+
+	/* older generations come again after the cache was dumped */
+	if (apply_gen(cache, 11) < 0 || nftnl_cache_is_stale(cache))
+		print_err("Older generation not ignored");
+
+	if (apply_gen(cache, 14) != -1 || errno != ESTALE ||
+	    !nftnl_cache_is_stale(cache) || nftnl_cache_get_genid(cache) != 12)
+		print_err("Generation gap not detected");
+
+	nftnl_cache_set_genid(cache, 12);
+	nftnl_cache_set_stale(cache, NFTNL_CACHE_SET);
+	if (nftnl_cache_stale_types(cache) !=
+	    (NFTNL_CACHE_SET | NFTNL_CACHE_SETELEM))
+		print_err("Elements not stale along with their sets");
+
+	if (apply_table(cache, NFT_MSG_DELTABLE, "filter") < 0)
+		print_err("Table not deleted");
+	if (nftnl_cache_chain_lookup(cache, NFPROTO_IPV4, "filter", "in") ||
+	    nftnl_cache_set_lookup(cache, NFPROTO_IPV4, "filter", "addrs") ||
+	    nftnl_cache_rule_lookup(cache, NFPROTO_IPV4, "filter", 5) ||
+	    !nftnl_chain_list_is_empty(nftnl_cache_chains(cache)))
+		print_err("Table contents left behind");
+
+	nftnl_cache_free(cache);
+}
+
+static void test_flush(void)
+{
+	static const uint32_t keys[] = { 1, 2 };
+	struct nftnl_cache *cache = nftnl_cache_alloc();
+
+	apply_table(cache, NFT_MSG_NEWTABLE, "filter");
+	apply_chain(cache, NFT_MSG_NEWCHAIN, "input", 1);
+	apply_rule(cache, NFT_MSG_NEWRULE, "input", 1, 0, 0);
+	apply_set(cache);
+	apply_elems(cache, NFT_MSG_NEWSETELEM, keys, 2);
+
+	nftnl_cache_flush(cache, NFTNL_CACHE_CHAIN);
+	if (nftnl_cache_rule_lookup(cache, NFPROTO_IPV4, "filter", 1) ||
+	    !nftnl_chain_list_is_empty(nftnl_cache_chains(cache)))
+		print_err("Chains not flushed");
+	if (!nftnl_cache_set_lookup(cache, NFPROTO_IPV4, "filter", "addrs"))
+		print_err("Set flushed along with chains");
+
+	/* rules come back once their chain does */
+	nftnl_cache_set_genid(cache, 1);
+	if (apply_rule(cache, NFT_MSG_NEWRULE, "input", 1, 0, 0) != -1 ||
+	    errno != ESTALE || nftnl_cache_stale_types(cache) !=
+			       (NFTNL_CACHE_CHAIN | NFTNL_CACHE_RULE))
+		print_err("Rule without chain accepted");
+
+	nftnl_cache_flush(cache, NFTNL_CACHE_ALL);
+	if (!nftnl_table_list_is_empty(nftnl_cache_tables(cache)) ||
+	    !nftnl_set_list_is_empty(nftnl_cache_sets(cache)))
+		print_err("Cache not flushed");
+
+	nftnl_cache_free(cache);
+}
+
+/*
+ * A set deleted between the dump of sets and that of its elements makes the
+ * kernel fail the element dump with ENOENT. The cache is dumped again.
+ */
+static void test_vanished_set(void)
+{
+	struct nftnl_cache *cache;
+	struct mnl_socket *nl;
+
+	/* no nf_tables to talk to, or no permission, nothing to test */
+	nl = mnl_socket_open(NETLINK_NETFILTER);
+	if (nl == NULL)
+		return;
+	if (mnl_socket_bind(nl, 0, MNL_SOCKET_AUTOPID) < 0) {
+		mnl_socket_close(nl);
+		return;
+	}
+
+	cache = nftnl_cache_alloc();
+	if (nftnl_cache_validate(cache, nl) < 0)
+		goto out;
+
+	/* a set the kernel does not have, as if it went away meanwhile */
+	apply_table(cache, NFT_MSG_NEWTABLE, "filter");
+	apply_set(cache);
+	nftnl_cache_set_stale(cache, NFTNL_CACHE_SETELEM);
+
+	if (nftnl_cache_validate(cache, nl) != 1)
+		print_err("Cache not dumped again after a set went away");
+	if (nftnl_cache_set_lookup(cache, NFPROTO_IPV4, "filter", "addrs"))
+		print_err("Set that went away still cached");
+out:
+	nftnl_cache_free(cache);
+	mnl_socket_close(nl);
+}
+
+int main(int argc, char *argv[])
+{
+	test_events();
+	test_flush();
+	test_vanished_set();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
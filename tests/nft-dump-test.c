@@ -0,0 +1,361 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/inet_diag.h>
+#include <linux/sock_diag.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
+#include <libnftnl/dump.h>
+
+#include "dump.h"
+
+static int test_ok = 1;
+static char buf[4096];
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nlmsghdr *build_hdr(uint16_t type)
+{
+	return nftnl_nlmsg_build_hdr(buf, type, NFPROTO_UNSPEC, NLM_F_DUMP, 1);
+}
+
+static void check_family(const struct nlmsghdr *nlh, uint32_t family)
+{
+	const struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
+
+	if (nfg->nfgen_family != family)
+		print_err("Family not set");
+}
+
+static void test_rule(void)
+{
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	nlh = build_hdr(NFT_MSG_GETRULE);
+	nftnl_rule_nlmsg_build_dump_filter(nlh, NFPROTO_IPV4, "filter",
+					   "input");
+	check_family(nlh, NFPROTO_IPV4);
+
+	r = nftnl_rule_alloc();
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0 ||
+	    strcmp(nftnl_rule_get_str(r, NFTNL_RULE_TABLE), "filter") ||
+	    strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), "input"))
+		print_err("Rule filter mismatches");
+	nftnl_rule_free(r);
+
+	/* a chain alone is no filter */
+	nlh = build_hdr(NFT_MSG_GETRULE);
+	nftnl_rule_nlmsg_build_dump_filter(nlh, NFPROTO_IPV6, NULL, "input");
+	if (mnl_nlmsg_get_payload_len(nlh) != sizeof(struct nfgenmsg))
+		print_err("Rule filter without table");
+}
+
+static void test_set(void)
+{
+	struct nlmsghdr *nlh;
+	struct nftnl_set *s;
+
+	nlh = build_hdr(NFT_MSG_GETSET);
+	nftnl_set_nlmsg_build_dump_filter(nlh, NFPROTO_INET, "filter");
+	check_family(nlh, NFPROTO_INET);
+
+	s = nftnl_set_alloc();
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0 ||
+	    strcmp(nftnl_set_get_str(s, NFTNL_SET_TABLE), "filter") ||
+	    nftnl_set_is_set(s, NFTNL_SET_NAME))
+		print_err("Set filter mismatches");
+	nftnl_set_free(s);
+}
+
+static void test_obj(void)
+{
+	struct nlmsghdr *nlh;
+	struct nftnl_obj *o;
+
+	nlh = build_hdr(NFT_MSG_GETOBJ);
+	nftnl_obj_nlmsg_build_dump_filter(nlh, NFPROTO_IPV4, "filter",
+					  NFT_OBJECT_COUNTER);
+	check_family(nlh, NFPROTO_IPV4);
+
+	o = nftnl_obj_alloc();
+	if (nftnl_obj_nlmsg_parse(nlh, o) < 0 ||
+	    strcmp(nftnl_obj_get_str(o, NFTNL_OBJ_TABLE), "filter") ||
+	    nftnl_obj_get_u32(o, NFTNL_OBJ_TYPE) != NFT_OBJECT_COUNTER)
+		print_err("Object filter mismatches");
+	nftnl_obj_free(o);
+
+	nlh = build_hdr(NFT_MSG_GETOBJ);
+	nftnl_obj_nlmsg_build_dump_filter(nlh, NFPROTO_IPV4, NULL,
+					  NFT_OBJECT_UNSPEC);
+	if (mnl_nlmsg_get_payload_len(nlh) != sizeof(struct nfgenmsg))
+		print_err("Object filter without table and type");
+}
+
+static void test_flowtable(void)
+{
+	struct nftnl_flowtable *f;
+	struct nlmsghdr *nlh;
+
+	nlh = build_hdr(NFT_MSG_GETFLOWTABLE);
+	nftnl_flowtable_nlmsg_build_dump_filter(nlh, NFPROTO_NETDEV, "filter");
+	check_family(nlh, NFPROTO_NETDEV);
+
+	f = nftnl_flowtable_alloc();
+	if (nftnl_flowtable_nlmsg_parse(nlh, f) < 0 ||
+	    strcmp(nftnl_flowtable_get_str(f, NFTNL_FLOWTABLE_TABLE),
+		   "filter"))
+		print_err("Flowtable filter mismatches");
+	nftnl_flowtable_free(f);
+}
+
+static void test_pipeline(void)
+{
+	struct nftnl_dump_pipeline *p;
+	struct nftnl_rule_list *list;
+	struct nlmsghdr *nlh;
+
+	if (nftnl_dump_pipeline_alloc(0) != NULL)
+		print_err("Pipeline without workers");
+
+	p = nftnl_dump_pipeline_alloc(4);
+	if (p == NULL) {
+		print_err("Pipeline not allocated");
+		return;
+	}
+
+	/* requests that are no dumps are refused before they are sent */
+	list = nftnl_rule_list_alloc();
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_GETRULE, NFPROTO_IPV4, 0, 1);
+	if (nftnl_dump_pipeline_run(p, NULL, nlh, list) != -1)
+		print_err("Pipeline ran a request that is no dump");
+	nlh = build_hdr(NFT_MSG_GETGEN);
+	if (nftnl_dump_pipeline_run(p, NULL, nlh, list) != -1)
+		print_err("Pipeline ran a dump of an unknown type");
+	nftnl_rule_list_free(list);
+
+	nftnl_dump_pipeline_free(p);
+}
+
+#define PARTS		100
+#define PART_RULES	10
+
+static char parts[PARTS + 1][2048];
+static struct iovec iov[PARTS + 1];
+
+/* Part @i of a rule dump, with rules numbered on from the previous part. */
+static void put_part(int i, bool bad)
+{
+	uint64_t handle = i * PART_RULES;
+	struct nlmsghdr *nlh;
+	struct nftnl_rule *r;
+	struct nlattr *nest;
+	size_t len = 0;
+	int j;
+
+	for (j = 0; j < PART_RULES; j++) {
+		r = nftnl_rule_alloc();
+		nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+		nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, ++handle);
+		nlh = nftnl_rule_nlmsg_build_hdr(parts[i] + len,
+						 NFT_MSG_NEWRULE, NFPROTO_IPV4,
+						 NLM_F_MULTI, 0);
+		nftnl_rule_nlmsg_build_payload(nlh, r);
+		nftnl_rule_free(r);
+		len += nlh->nlmsg_len;
+	}
+
+	/* expressions must be list elements */
+	if (bad) {
+		nlh = nftnl_rule_nlmsg_build_hdr(parts[i] + len,
+						 NFT_MSG_NEWRULE, NFPROTO_IPV4,
+						 NLM_F_MULTI, 0);
+		nest = mnl_attr_nest_start(nlh, NFTA_RULE_EXPRESSIONS);
+		mnl_attr_put_u32(nlh, NFTA_LIST_UNSPEC, 0);
+		mnl_attr_nest_end(nlh, nest);
+		len += nlh->nlmsg_len;
+	}
+
+	iov[i].iov_base = parts[i];
+	iov[i].iov_len = len;
+}
+
+static void put_parts(int bad)
+{
+	struct nlmsghdr *nlh;
+	int i;
+
+	for (i = 0; i < PARTS; i++)
+		put_part(i, i == bad);
+
+	nlh = mnl_nlmsg_put_header(parts[PARTS]);
+	nlh->nlmsg_type = NLMSG_DONE;
+	nlh->nlmsg_flags = NLM_F_MULTI;
+	mnl_nlmsg_put_extra_header(nlh, sizeof(int));
+	iov[PARTS].iov_base = parts[PARTS];
+	iov[PARTS].iov_len = nlh->nlmsg_len;
+}
+
+/* Parts parsed by several workers end up in the order of the dump. */
+static void test_pipeline_parse(void)
+{
+	struct nftnl_rule_list_iter *iter;
+	struct nftnl_dump_pipeline *p;
+	struct nftnl_rule_list *list;
+	unsigned int num;
+	struct nftnl_rule *r;
+	uint64_t handle = 0;
+
+	p = nftnl_dump_pipeline_alloc(4);
+	if (p == NULL) {
+		print_err("Pipeline not allocated");
+		return;
+	}
+
+	put_parts(-1);
+	list = nftnl_rule_list_alloc();
+	num = PARTS + 1;
+	if (nftnl_dump_pipeline_parse(p, NFT_MSG_GETRULE, iov, &num,
+				      list) < 0 || num != PARTS + 1)
+		print_err("Pipeline did not parse the dump");
+
+	iter = nftnl_rule_list_iter_create(list);
+	while ((r = nftnl_rule_list_iter_next(iter))) {
+		if (nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE) != ++handle) {
+			print_err("Pipeline mixed up the order of rules");
+			break;
+		}
+	}
+	nftnl_rule_list_iter_destroy(iter);
+	if (handle != PARTS * PART_RULES)
+		print_err("Pipeline lost rules");
+	nftnl_rule_list_free(list);
+
+	/* the rest of the dump is read after a part fails to parse */
+	put_parts(3);
+	list = nftnl_rule_list_alloc();
+	num = PARTS + 1;
+	if (nftnl_dump_pipeline_parse(p, NFT_MSG_GETRULE, iov, &num,
+				      list) != -1)
+		print_err("Pipeline parsed a bad rule");
+	if (num != PARTS + 1)
+		print_err("Pipeline left parts of the dump unread");
+	if (!nftnl_rule_list_is_empty(list))
+		print_err("Pipeline kept rules of a failed dump");
+	nftnl_rule_list_free(list);
+
+	nftnl_dump_pipeline_free(p);
+}
+
+#define DIAG_SOCKS	256
+
+/* Fails on the first message if *@data is negative, counts them if not. */
+static int diag_cb(const struct nlmsghdr *nlh, void *data)
+{
+	int *num = data;
+
+	if (*num < 0)
+		return MNL_CB_ERROR;
+	(*num)++;
+	return MNL_CB_OK;
+}
+
+static struct nlmsghdr *build_diag(uint32_t seq)
+{
+	struct inet_diag_req_v2 *req;
+	struct nlmsghdr *nlh;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	nlh->nlmsg_seq = seq;
+	req = mnl_nlmsg_put_extra_header(nlh, sizeof(*req));
+	req->sdiag_family = AF_INET;
+	req->sdiag_protocol = IPPROTO_UDP;
+	req->idiag_states = ~0U;
+	return nlh;
+}
+
+/*
+ * A dump of many sockets takes several reads. What is left of it once a
+ * callback fails must not reach the next request on the socket.
+ */
+static void test_request_drain(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= htonl(INADDR_LOOPBACK),
+	};
+	int fds[DIAG_SOCKS], i, num;
+	struct mnl_socket *nl;
+
+	/* no sock_diag, nothing to test */
+	nl = mnl_socket_open(NETLINK_SOCK_DIAG);
+	if (nl == NULL)
+		return;
+	if (mnl_socket_bind(nl, 0, MNL_SOCKET_AUTOPID) < 0) {
+		mnl_socket_close(nl);
+		return;
+	}
+
+	for (i = 0; i < DIAG_SOCKS; i++) {
+		fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fds[i] >= 0)
+			bind(fds[i], (struct sockaddr *)&addr, sizeof(addr));
+	}
+
+	num = -1;
+	if (nftnl_nlmsg_request(nl, build_diag(1), diag_cb, &num) != -1)
+		print_err("Request did not fail with its callback");
+
+	num = 0;
+	if (nftnl_nlmsg_request(nl, build_diag(2), diag_cb, &num) < 0 ||
+	    num < DIAG_SOCKS)
+		print_err("Request found the rest of a failed dump");
+
+	for (i = 0; i < DIAG_SOCKS; i++) {
+		if (fds[i] >= 0)
+			close(fds[i]);
+	}
+	mnl_socket_close(nl);
+}
+
+int main(int argc, char *argv[])
+{
+	test_rule();
+	test_set();
+	test_obj();
+	test_flowtable();
+	test_pipeline();
+	test_pipeline_parse();
+	test_request_drain();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,578 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/eval.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_chain *build_chain(const char *name, bool base)
+{
+	struct nftnl_chain *c = nftnl_chain_alloc();
+
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, NFPROTO_IPV4);
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name);
+	if (base) {
+		nftnl_chain_set_u32(c, NFTNL_CHAIN_HOOKNUM, NF_INET_LOCAL_IN);
+		nftnl_chain_set_u32(c, NFTNL_CHAIN_POLICY, NF_DROP);
+	}
+	return c;
+}
+
+static struct nftnl_rule *build_rule(const char *chain, uint64_t handle)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, handle);
+	return r;
+}
+
+static void add_payload(struct nftnl_rule *r, uint32_t base, uint32_t offset,
+			uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("payload");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_BASE, base);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET, offset);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_LEN, len);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_meta(struct nftnl_rule *r, uint32_t key, uint16_t attr)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("meta");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_META_KEY, key);
+	nftnl_expr_set_u32(e, attr, NFT_REG_1);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_cmp(struct nftnl_rule *r, const void *data, uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("cmp");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, data, len);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_lookup(struct nftnl_rule *r, const char *set)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("lookup");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_LOOKUP_SREG, NFT_REG_1);
+	nftnl_expr_set_str(e, NFTNL_EXPR_LOOKUP_SET, set);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_verdict(struct nftnl_rule *r, int verdict, const char *chain)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("immediate");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, verdict);
+	if (chain)
+		nftnl_expr_set_str(e, NFTNL_EXPR_IMM_CHAIN, chain);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_elem(struct nftnl_set *s, const void *key, uint32_t len,
+		     uint32_t flags)
+{
+	struct nftnl_set_elem *e = nftnl_set_elem_alloc();
+
+	nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, key, len);
+	if (flags)
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_FLAGS, flags);
+	nftnl_set_elem_add(s, e);
+}
+
+static struct nftnl_set *build_set(const char *name, uint32_t flags,
+				   uint32_t key_len)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, NFPROTO_IPV4);
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, name);
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS, flags);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, key_len);
+	return s;
+}
+
+/*
+ * input, policy drop:
+ *   10: ip saddr @blocked drop
+ *   11: meta l4proto tcp jump tcp_ports
+ *   12: meta mark 1 accept
+ * tcp_ports:
+ *   20: tcp dport @ports accept
+ *   21: tcp dport 443 meta mark set 2 return
+ *   22: tcp dport 8080 goto loop
+ * loop:
+ *   30: jump loop
+ */
+static struct nftnl_ruleset *build_ruleset(void)
+{
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+	uint32_t addr, mark;
+	uint16_t port;
+	uint8_t proto = IPPROTO_TCP;
+	struct nftnl_expr *e;
+	struct nftnl_rule *r;
+	struct nftnl_set *s;
+
+	nftnl_chain_list_add_tail(build_chain("input", true), chains);
+	nftnl_chain_list_add_tail(build_chain("tcp_ports", false), chains);
+	nftnl_chain_list_add_tail(build_chain("loop", false), chains);
+
+	s = build_set("blocked", NFT_SET_INTERVAL, sizeof(uint32_t));
+	addr = htonl(0x0a000000);
+	add_elem(s, &addr, sizeof(addr), 0);
+	addr = htonl(0x0b000000);
+	add_elem(s, &addr, sizeof(addr), NFT_SET_ELEM_INTERVAL_END);
+	nftnl_set_list_add_tail(s, sets);
+
+	s = build_set("ports", 0, sizeof(uint16_t));
+	port = htons(22);
+	add_elem(s, &port, sizeof(port), 0);
+	port = htons(80);
+	add_elem(s, &port, sizeof(port), 0);
+	nftnl_set_list_add_tail(s, sets);
+
+	r = build_rule("input", 10);
+	add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, sizeof(uint32_t));
+	add_lookup(r, "blocked");
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+	add_verdict(r, NF_DROP, NULL);
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("input", 11);
+	add_meta(r, NFT_META_L4PROTO, NFTNL_EXPR_META_DREG);
+	add_cmp(r, &proto, sizeof(proto));
+	add_verdict(r, NFT_JUMP, "tcp_ports");
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("input", 12);
+	add_meta(r, NFT_META_MARK, NFTNL_EXPR_META_DREG);
+	mark = 1;
+	add_cmp(r, &mark, sizeof(mark));
+	add_verdict(r, NF_ACCEPT, NULL);
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("tcp_ports", 20);
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(uint16_t));
+	add_lookup(r, "ports");
+	add_verdict(r, NF_ACCEPT, NULL);
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("tcp_ports", 21);
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(uint16_t));
+	port = htons(443);
+	add_cmp(r, &port, sizeof(port));
+	e = nftnl_expr_alloc("immediate");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_1);
+	mark = 2;
+	nftnl_expr_set(e, NFTNL_EXPR_IMM_DATA, &mark, sizeof(mark));
+	nftnl_rule_add_expr(r, e);
+	add_meta(r, NFT_META_MARK, NFTNL_EXPR_META_SREG);
+	add_verdict(r, NFT_RETURN, NULL);
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("tcp_ports", 22);
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(uint16_t));
+	port = htons(8080);
+	add_cmp(r, &port, sizeof(port));
+	add_verdict(r, NFT_GOTO, "loop");
+	nftnl_rule_list_add_tail(r, rules);
+
+	r = build_rule("loop", 30);
+	add_verdict(r, NFT_JUMP, "loop");
+	nftnl_rule_list_add_tail(r, rules);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+	return rs;
+}
+
+/* IPv4 header followed by the ports of a TCP or UDP header. */
+static void build_pkt(uint8_t *buf, uint32_t saddr, uint8_t proto,
+		      uint16_t dport)
+{
+	memset(buf, 0, 24);
+	buf[0] = 0x45;
+	buf[9] = proto;
+	saddr = htonl(saddr);
+	memcpy(buf + 12, &saddr, sizeof(saddr));
+	dport = htons(dport);
+	memcpy(buf + 22, &dport, sizeof(dport));
+}
+
+static void check_run(const struct nftnl_eval *ev,
+		      const struct nftnl_eval_chain *chain, uint32_t saddr,
+		      uint8_t proto, uint16_t dport, uint32_t mark,
+		      uint32_t verdict, uint64_t handle, uint32_t mark_out)
+{
+	struct nftnl_eval_result res;
+	struct nftnl_eval_pkt pkt = {};
+	uint8_t buf[24];
+
+	build_pkt(buf, saddr, proto, dport);
+	pkt.data = buf;
+	pkt.len = sizeof(buf);
+	pkt.mark = mark;
+
+	if (nftnl_eval_run(ev, chain, &pkt, &res) < 0) {
+		print_err("evaluation failed");
+		return;
+	}
+	if (res.verdict != verdict)
+		print_err("verdict mismatches");
+	if (res.handle != handle)
+		print_err("rule handle mismatches");
+	if (res.mark != mark_out)
+		print_err("mark mismatches");
+}
+
+static void test_eval(void)
+{
+	struct nftnl_ruleset *rs = build_ruleset();
+	struct nftnl_eval_result res;
+	struct nftnl_eval_chain *input;
+	struct nftnl_eval_pkt pkt = {};
+	struct nftnl_rule_list *rules;
+	struct nftnl_eval *ev;
+	struct nftnl_rule *r;
+	uint8_t buf[24];
+
+	ev = nftnl_eval_alloc(rs);
+	if (ev == NULL) {
+		print_err("compiling the ruleset failed");
+		nftnl_ruleset_free(rs);
+		return;
+	}
+
+	input = nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter", "input");
+	if (input == NULL ||
+	    nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter", "output")) {
+		print_err("chain lookup mismatches");
+		goto out;
+	}
+
+	check_run(ev, input, 0x0a010203, IPPROTO_TCP, 80, 0, NF_DROP, 10, 0);
+	/* 11.0.0.0 closes the blocked interval */
+	check_run(ev, input, 0x0b000000, IPPROTO_TCP, 22, 0, NF_ACCEPT, 20, 0);
+	check_run(ev, input, 0xc0a80001, IPPROTO_TCP, 443, 1, NF_DROP, 0, 2);
+	check_run(ev, input, 0xc0a80001, IPPROTO_UDP, 53, 1, NF_ACCEPT, 12, 1);
+	check_run(ev, input, 0xc0a80001, IPPROTO_UDP, 53, 0, NF_DROP, 0, 0);
+
+	build_pkt(buf, 0xc0a80001, IPPROTO_TCP, 8080);
+	pkt.data = buf;
+	pkt.len = sizeof(buf);
+	if (nftnl_eval_run(ev, input, &pkt, &res) == 0 || errno != ELOOP)
+		print_err("jump loop not detected");
+
+	/* no transport header to match on */
+	pkt.len = 20;
+	if (nftnl_eval_run(ev, input, &pkt, &res) < 0 ||
+	    res.verdict != NF_DROP || res.handle != 0)
+		print_err("truncated packet mismatches");
+out:
+	nftnl_eval_free(ev);
+
+	/* expressions that need state not available here */
+	r = build_rule("input", 40);
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("masq"));
+	rules = nftnl_ruleset_get(rs, NFTNL_RULESET_RULELIST);
+	nftnl_rule_list_add_tail(r, rules);
+	ev = nftnl_eval_alloc(rs);
+	if (ev != NULL || errno != EOPNOTSUPP)
+		print_err("unsupported expression accepted");
+	nftnl_ruleset_free(rs);
+}
+
+/* Same results as packet at a time, over several blocks of packets. */
+static void test_batch(void)
+{
+	static const uint32_t saddrs[] = { 0x0a010203, 0x0b000000, 0xc0a80001 };
+	static const uint16_t dports[] = { 22, 80, 443, 53, 25 };
+	struct nftnl_ruleset *rs = build_ruleset();
+	struct nftnl_eval_result res[150], one;
+	struct nftnl_eval_pkt pkts[150] = {};
+	struct nftnl_eval_chain *input;
+	uint8_t bufs[150][24];
+	struct nftnl_rule_list *rules;
+	struct nftnl_eval *ev;
+	struct nftnl_expr *e;
+	struct nftnl_rule *r;
+	uint32_t mark = 3;
+	int i;
+
+	/* continue goes on with the rule, break goes on with the next one */
+	rules = nftnl_ruleset_get(rs, NFTNL_RULESET_RULELIST);
+	r = build_rule("input", 13);
+	add_verdict(r, NFT_CONTINUE, NULL);
+	e = nftnl_expr_alloc("immediate");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_1);
+	nftnl_expr_set(e, NFTNL_EXPR_IMM_DATA, &mark, sizeof(mark));
+	nftnl_rule_add_expr(r, e);
+	add_meta(r, NFT_META_MARK, NFTNL_EXPR_META_SREG);
+	nftnl_rule_list_add_tail(r, rules);
+	r = build_rule("input", 14);
+	add_verdict(r, NFT_BREAK, NULL);
+	add_verdict(r, NF_ACCEPT, NULL);
+	nftnl_rule_list_add_tail(r, rules);
+
+	ev = nftnl_eval_alloc(rs);
+	if (ev == NULL) {
+		print_err("compiling the ruleset failed");
+		nftnl_ruleset_free(rs);
+		return;
+	}
+	input = nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter", "input");
+	check_run(ev, input, 0xc0a80001, IPPROTO_UDP, 53, 0, NF_DROP, 0, 3);
+
+	for (i = 0; i < 150; i++) {
+		build_pkt(bufs[i], saddrs[i % 3],
+			  i % 7 ? IPPROTO_TCP : IPPROTO_UDP, dports[i % 5]);
+		pkts[i].data = bufs[i];
+		pkts[i].len = i % 11 ? sizeof(bufs[i]) : 20;
+		pkts[i].mark = i % 4 == 0;
+	}
+
+	if (nftnl_eval_run_batch(ev, input, pkts, 150, res) < 0)
+		print_err("batch evaluation failed");
+
+	for (i = 0; i < 150; i++) {
+		if (nftnl_eval_run(ev, input, &pkts[i], &one) < 0 ||
+		    one.verdict != res[i].verdict ||
+		    one.handle != res[i].handle ||
+		    one.mark != res[i].mark ||
+		    strcmp(one.chain, res[i].chain)) {
+			print_err("batch result mismatches");
+			break;
+		}
+	}
+
+	build_pkt(bufs[100], 0xc0a80001, IPPROTO_TCP, 8080);
+	if (nftnl_eval_run_batch(ev, input, pkts, 150, res) == 0 ||
+	    errno != ELOOP)
+		print_err("jump loop not detected in batch");
+
+	nftnl_eval_free(ev);
+	nftnl_ruleset_free(rs);
+}
+
+static int count_hot_late(const struct nftnl_eval_rule_stats *st, void *data)
+{
+	int *hot = data;
+
+	if (st->flags & NFTNL_EVAL_RULE_F_HOT_LATE) {
+		if (st->handle != 118 || st->hits != 90 || st->evals != 90)
+			print_err("hot rule stats mismatch");
+		(*hot)++;
+	}
+	return 0;
+}
+
+/* One chain of 20 rules, most of the traffic matches the 19th. */
+static void test_profile(void)
+{
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+	struct nftnl_eval_pkt pkts[100] = {};
+	struct nftnl_eval_chain *input;
+	struct nftnl_eval_profile *prof;
+	struct nftnl_eval_cost cost;
+	struct nftnl_eval *ev;
+	uint8_t bufs[100][24];
+	struct nftnl_rule *r;
+	char buf[4096];
+	uint16_t port;
+	int i, hot = 0;
+
+	nftnl_chain_list_add_tail(build_chain("input", true), chains);
+	for (i = 0; i < 20; i++) {
+		r = build_rule("input", 100 + i);
+		add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(port));
+		port = htons(1000 + i);
+		add_cmp(r, &port, sizeof(port));
+		add_verdict(r, NF_ACCEPT, NULL);
+		nftnl_rule_list_add_tail(r, rules);
+	}
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+
+	ev = nftnl_eval_alloc(rs);
+	input = ev ? nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter",
+					     "input") : NULL;
+	if (input == NULL) {
+		print_err("compiling the ruleset failed");
+		goto out;
+	}
+
+	if (nftnl_eval_chain_cost(input, &cost) < 0 || cost.rules != 20 ||
+	    cost.exprs != 60 || cost.lookups != 0 || cost.jumps != 0)
+		print_err("static chain cost mismatches");
+
+	for (i = 0; i < 100; i++) {
+		build_pkt(bufs[i], 0xc0a80001, IPPROTO_TCP,
+			  i < 90 ? 1018 : 1000);
+		pkts[i].data = bufs[i];
+		pkts[i].len = sizeof(bufs[i]);
+	}
+
+	prof = nftnl_eval_profile_alloc(ev);
+	if (nftnl_eval_profile_run(prof, input, pkts, 100) < 0)
+		print_err("profiling failed");
+
+	if (nftnl_eval_profile_cost(prof, &cost) != 100 ||
+	    cost.rules != 90 * 19 + 10 || cost.exprs != 90 * 39 + 10 * 3)
+		print_err("sampled cost mismatches");
+
+	nftnl_eval_profile_foreach(prof, count_hot_late, &hot);
+	if (hot != 1)
+		print_err("unexpected number of hot rules");
+
+	nftnl_eval_profile_snprintf(buf, sizeof(buf), prof);
+	if (strstr(buf, "handle 118 position 18 evals 90 hits 90 hot-late\n") ==
+	    NULL || strstr(buf, "handle 100 position 0 evals 100 hits 10\n") ==
+	    NULL)
+		print_err("profile report mismatches");
+
+	nftnl_eval_profile_free(prof);
+out:
+	if (ev)
+		nftnl_eval_free(ev);
+	nftnl_ruleset_free(rs);
+}
+
+#define COST_CHAINS	16
+#define COST_JUMPS	4
+
+/*
+ * Chains c0 to c15 jump four times each to the next one, so c15 is reached
+ * over 4^15 paths, "deep" jumps to c0 and "deeper" to "deep".
+ */
+static void test_cost(void)
+{
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+	struct nftnl_eval_cost cost, want = {};
+	struct nftnl_eval_chain *c0, *deep, *deeper;
+	char name[16], next[16];
+	struct nftnl_eval *ev;
+	struct nftnl_rule *r;
+	uint64_t handle = 1;
+	int i, j;
+
+	for (i = 0; i < COST_CHAINS; i++) {
+		snprintf(name, sizeof(name), "c%d", i);
+		snprintf(next, sizeof(next), "c%d", i + 1);
+		nftnl_chain_list_add_tail(build_chain(name, false), chains);
+		for (j = 0; j < COST_JUMPS; j++) {
+			r = build_rule(name, handle++);
+			if (i < COST_CHAINS - 1)
+				add_verdict(r, NFT_JUMP, next);
+			else
+				add_verdict(r, NF_ACCEPT, NULL);
+			nftnl_rule_list_add_tail(r, rules);
+		}
+	}
+	nftnl_chain_list_add_tail(build_chain("deep", false), chains);
+	r = build_rule("deep", handle++);
+	add_verdict(r, NFT_JUMP, "c0");
+	nftnl_rule_list_add_tail(r, rules);
+	nftnl_chain_list_add_tail(build_chain("deeper", false), chains);
+	r = build_rule("deeper", handle++);
+	add_verdict(r, NFT_JUMP, "deep");
+	nftnl_rule_list_add_tail(r, rules);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+
+	ev = nftnl_eval_alloc(rs);
+	c0 = ev ? nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter",
+					  "c0") : NULL;
+	deep = ev ? nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter",
+					    "deep") : NULL;
+	deeper = ev ? nftnl_eval_chain_lookup(ev, NFPROTO_IPV4, "filter",
+					      "deeper") : NULL;
+	if (c0 == NULL || deep == NULL || deeper == NULL) {
+		print_err("compiling the ruleset failed");
+		goto out;
+	}
+
+	/* the cost of each path through the jumps adds up */
+	want.rules = COST_JUMPS;
+	want.exprs = COST_JUMPS;
+	for (i = 0; i < COST_CHAINS - 1; i++) {
+		want.jumps = COST_JUMPS + COST_JUMPS * want.jumps;
+		want.rules = COST_JUMPS + COST_JUMPS * want.rules;
+		want.exprs = want.rules;
+	}
+	if (nftnl_eval_chain_cost(c0, &cost) < 0 ||
+	    cost.rules != want.rules || cost.exprs != want.exprs ||
+	    cost.lookups != 0 || cost.jumps != want.jumps)
+		print_err("cost of nested jumps mismatches");
+
+	/* sixteen jumps nest as deep as they may */
+	if (nftnl_eval_chain_cost(deep, &cost) < 0 ||
+	    cost.rules != want.rules + 1 || cost.jumps != want.jumps + 1)
+		print_err("cost of the deepest jumps mismatches");
+
+	if (nftnl_eval_chain_cost(deeper, &cost) == 0 || errno != ELOOP)
+		print_err("jumps nest too deep");
+out:
+	if (ev)
+		nftnl_eval_free(ev);
+	nftnl_ruleset_free(rs);
+}
+
+int main(int argc, char *argv[])
+{
+	test_eval();
+	test_batch();
+	test_profile();
+	test_cost();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
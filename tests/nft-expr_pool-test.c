@@ -0,0 +1,82 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include <libnftnl/expr.h>
+
+#define NUM_THREADS	4
+#define NUM_EXPRS	1000
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static void *worker(void *data)
+{
+	static const char *names[] = { "counter", "cmp", "payload" };
+	struct nftnl_expr *e[NUM_EXPRS];
+	uintptr_t seed = (uintptr_t)data;
+	int i, round;
+
+	for (round = 0; round < 10; round++) {
+		for (i = 0; i < NUM_EXPRS; i++) {
+			e[i] = nftnl_expr_alloc(names[(i + seed) % 3]);
+			if (e[i] == NULL) {
+				print_err("OOM");
+				return NULL;
+			}
+			if (strcmp(names[(i + seed) % 3], "counter"))
+				continue;
+			if (nftnl_expr_is_set(e[i], NFTNL_EXPR_CTR_PACKETS))
+				print_err("recycled expression not cleared");
+			nftnl_expr_set_u64(e[i], NFTNL_EXPR_CTR_PACKETS, i);
+		}
+		for (i = 0; i < NUM_EXPRS; i++) {
+			if (!strcmp(names[(i + seed) % 3], "counter") &&
+			    nftnl_expr_get_u64(e[i], NFTNL_EXPR_CTR_PACKETS) != i)
+				print_err("pooled expressions overlap");
+			nftnl_expr_free(e[i]);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t threads[NUM_THREADS];
+	uintptr_t i;
+
+	if (nftnl_expr_pool_enable() < 0)
+		print_err("cannot enable expression pool");
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], NULL, worker, (void *)i);
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	/* Expressions taken from the pool can be freed after disabling it. */
+	worker((void *)0);
+	nftnl_expr_pool_disable();
+	worker((void *)1);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
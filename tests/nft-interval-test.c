@@ -0,0 +1,191 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/interval.h>
+#include <libnftnl/set.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static void add_prefix(struct nftnl_interval *iv, uint32_t addr, uint32_t len)
+{
+	addr = htonl(addr);
+	if (nftnl_interval_add_prefix(iv, &addr, len) < 0)
+		print_err("adding prefix failed");
+}
+
+static void add_range(struct nftnl_interval *iv, uint32_t from, uint32_t to)
+{
+	from = htonl(from);
+	to = htonl(to);
+	if (nftnl_interval_add_range(iv, &from, &to) < 0)
+		print_err("adding range failed");
+}
+
+static void check_elem(struct nftnl_set_elems_iter *iter, uint32_t key,
+		       uint32_t key_end, uint32_t flags)
+{
+	struct nftnl_set_elem *e = nftnl_set_elems_iter_next(iter);
+
+	if (e == NULL) {
+		print_err("missing element");
+		return;
+	}
+	if (ntohl(nftnl_set_elem_get_u32(e, NFTNL_SET_ELEM_KEY)) != key)
+		print_err("element key mismatches");
+	if (nftnl_set_elem_is_set(e, NFTNL_SET_ELEM_KEY_END) != !!key_end ||
+	    (key_end &&
+	     ntohl(nftnl_set_elem_get_u32(e, NFTNL_SET_ELEM_KEY_END)) != key_end))
+		print_err("element key end mismatches");
+	if (nftnl_set_elem_is_set(e, NFTNL_SET_ELEM_FLAGS) != !!flags ||
+	    (flags && nftnl_set_elem_get_u32(e, NFTNL_SET_ELEM_FLAGS) != flags))
+		print_err("element flags mismatch");
+}
+
+static void test_ipv4(void)
+{
+	struct nftnl_interval *iv = nftnl_interval_alloc(sizeof(uint32_t));
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set *s;
+
+	/* 10.0.0.0/24 and 10.0.1.0/24 are adjacent, the range overlaps. */
+	add_prefix(iv, 0x0a000100, 24);
+	add_prefix(iv, 0xc0a80000, 16);
+	add_prefix(iv, 0x0a000000, 24);
+	add_range(iv, 0x0a000180, 0x0a000210);
+	add_prefix(iv, 0xc0a80101, 32);
+	add_prefix(iv, 0xffffff00, 24);
+
+	s = nftnl_set_alloc();
+	if (nftnl_interval_set_elems(iv, s, 0) != 3)
+		print_err("unexpected number of ranges");
+
+	nftnl_set_elems_iter_init(&iter, s);
+	check_elem(&iter, 0x0a000000, 0, 0);
+	check_elem(&iter, 0x0a000211, 0, NFT_SET_ELEM_INTERVAL_END);
+	check_elem(&iter, 0xc0a80000, 0, 0);
+	check_elem(&iter, 0xc0a90000, 0, NFT_SET_ELEM_INTERVAL_END);
+	/* nothing closes a range that ends at the last key */
+	check_elem(&iter, 0xffffff00, 0, 0);
+	if (nftnl_set_elems_iter_next(&iter))
+		print_err("too many elements");
+	nftnl_set_free(s);
+
+	s = nftnl_set_alloc();
+	if (nftnl_interval_set_elems(iv, s, NFTNL_INTERVAL_F_KEY_END) != 3)
+		print_err("unexpected number of ranges");
+
+	nftnl_set_elems_iter_init(&iter, s);
+	check_elem(&iter, 0x0a000000, 0x0a000210, 0);
+	check_elem(&iter, 0xc0a80000, 0xc0a8ffff, 0);
+	check_elem(&iter, 0xffffff00, 0xffffffff, 0);
+	nftnl_set_free(s);
+
+	nftnl_interval_free(iv);
+}
+
+static void test_ipv6(void)
+{
+	struct nftnl_interval *iv = nftnl_interval_alloc(16);
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set_elem *e;
+	struct in6_addr a, end;
+	struct nftnl_set *s;
+	const void *key;
+	uint32_t len;
+
+	memset(&a, 0, sizeof(a));
+	a.s6_addr[0] = 0x20;
+	a.s6_addr[1] = 0x01;
+	a.s6_addr[2] = 0x0d;
+	a.s6_addr[3] = 0xb8;
+	nftnl_interval_add_prefix(iv, &a, 32);
+	a.s6_addr[15] = 1;
+	nftnl_interval_add_prefix(iv, &a, 128);
+	if (nftnl_interval_add_prefix(iv, &a, 129) == 0)
+		print_err("invalid prefix length accepted");
+
+	s = nftnl_set_alloc();
+	if (nftnl_interval_set_elems(iv, s, 0) != 1)
+		print_err("unexpected number of IPv6 ranges");
+
+	memset(&end, 0, sizeof(end));
+	end.s6_addr[0] = 0x20;
+	end.s6_addr[1] = 0x01;
+	end.s6_addr[2] = 0x0d;
+	end.s6_addr[3] = 0xb9;
+
+	nftnl_set_elems_iter_init(&iter, s);
+	nftnl_set_elems_iter_next(&iter);
+	e = nftnl_set_elems_iter_next(&iter);
+	key = e ? nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY, &len) : NULL;
+	if (key == NULL || len != 16 || memcmp(key, &end, 16))
+		print_err("IPv6 interval end mismatches");
+
+	nftnl_set_free(s);
+	nftnl_interval_free(iv);
+}
+
+static void test_add_after_elems(void)
+{
+	struct nftnl_interval *iv = nftnl_interval_alloc(sizeof(uint32_t));
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set *s;
+	uint32_t i;
+
+	/* fill more than half of the ranges allocated, none are merged */
+	for (i = 0; i < 100; i++)
+		add_prefix(iv, 0x0a000000 + (i << 9), 24);
+
+	s = nftnl_set_alloc();
+	if (nftnl_interval_set_elems(iv, s, NFTNL_INTERVAL_F_KEY_END) != 100)
+		print_err("unexpected number of ranges");
+	nftnl_set_free(s);
+
+	/* up to the capacity before the sort, and past it */
+	for (i = 0; i < 100; i++)
+		add_prefix(iv, 0xc0a80000 + (i << 9), 24);
+
+	s = nftnl_set_alloc();
+	if (nftnl_interval_set_elems(iv, s, NFTNL_INTERVAL_F_KEY_END) != 200)
+		print_err("unexpected number of ranges after adding more");
+
+	nftnl_set_elems_iter_init(&iter, s);
+	for (i = 0; i < 100; i++)
+		check_elem(&iter, 0x0a000000 + (i << 9),
+			   0x0a0000ff + (i << 9), 0);
+	for (i = 0; i < 100; i++)
+		check_elem(&iter, 0xc0a80000 + (i << 9),
+			   0xc0a800ff + (i << 9), 0);
+	nftnl_set_free(s);
+
+	nftnl_interval_free(iv);
+}
+
+int main(int argc, char *argv[])
+{
+	test_ipv4();
+	test_ipv6();
+	test_add_after_elems();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/monitor.h>
+#include <libnftnl/cache.h>
+#include <libnftnl/table.h>
+#include <libnftnl/set.h>
+
+static int test_ok = 1;
+static char buf[8192];
+static size_t buf_len;
+
+/* What was delivered: message type and element key, zero if none. */
+static struct {
+	uint16_t	type;
+	uint32_t	key;
+} seen[16];
+static int num_seen;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static int event_cb(const struct nftnl_monitor_event *ev, void *data)
+{
+	struct nftnl_set_elem *e;
+	const uint32_t *key;
+	uint32_t len;
+
+	if (num_seen == 16)
+		return -1;
+
+	seen[num_seen].type = nftnl_monitor_event_type(ev);
+	key = nftnl_monitor_event_key(ev, &len);
+	if (key) {
+		if (len != sizeof(*key) ||
+		    strcmp(nftnl_monitor_event_table(ev), "filter") ||
+		    strcmp(nftnl_monitor_event_set(ev), "addrs"))
+			print_err("Bad element event");
+
+		e = nftnl_monitor_event_elem(ev);
+		if (e == NULL ||
+		    nftnl_set_elem_get_u32(e, NFTNL_SET_ELEM_KEY) != *key)
+			print_err("Element does not parse");
+		nftnl_set_elem_free(e);
+
+		seen[num_seen].key = *key;
+	} else if (nftnl_monitor_event_nlmsg(ev) == NULL) {
+		print_err("Event without message");
+	}
+	num_seen++;
+
+	return 0;
+}
+
+static void put_elems_flags(uint16_t type, const uint32_t *keys,
+			    int num_keys, uint32_t flags)
+{
+	struct nftnl_set_elem *e;
+	struct nlmsghdr *nlh;
+	struct nlattr *nest;
+	int i;
+
+	nlh = nftnl_set_elem_nlmsg_build_hdr(buf + buf_len, type,
+					     NFPROTO_IPV4, 0, 1);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, "addrs");
+	nest = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+	for (i = 0; i < num_keys; i++) {
+		e = nftnl_set_elem_alloc();
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_KEY, keys[i]);
+		if (flags)
+			nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_FLAGS, flags);
+		nftnl_set_elem_nlmsg_build(nlh, e, NFTA_LIST_ELEM);
+		nftnl_set_elem_free(e);
+	}
+	mnl_attr_nest_end(nlh, nest);
+
+	buf_len += MNL_ALIGN(nlh->nlmsg_len);
+}
+
+static void put_elems(uint16_t type, const uint32_t *keys, int num_keys)
+{
+	put_elems_flags(type, keys, num_keys, 0);
+}
+
+static void put_table(void)
+{
+	struct nftnl_table *t = nftnl_table_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, NFPROTO_IPV4);
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nlh = nftnl_table_nlmsg_build_hdr(buf + buf_len, NFT_MSG_NEWTABLE,
+					  NFPROTO_IPV4, 0, 1);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	nftnl_table_free(t);
+
+	buf_len += MNL_ALIGN(nlh->nlmsg_len);
+}
+
+static void put_set(void)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+	struct nlmsghdr *nlh;
+
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "addrs");
+	nlh = nftnl_set_nlmsg_build_hdr(buf + buf_len, NFT_MSG_NEWSET,
+					NFPROTO_IPV4, 0, 1);
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	nftnl_set_free(s);
+
+	buf_len += MNL_ALIGN(nlh->nlmsg_len);
+}
+
+static int process(struct nftnl_monitor *mon)
+{
+	int ret;
+
+	ret = nftnl_monitor_process(mon, buf, buf_len);
+	buf_len = 0;
+	return ret;
+}
+
+static void check_seen(int from, uint16_t type, uint32_t key)
+{
+	if (from >= num_seen || seen[from].type != type ||
+	    seen[from].key != key)
+		print_err("Wrong event delivered");
+}
+
+static void test_coalesce(void)
+{
+	static const uint32_t keys[] = { 1, 2, 3, 4 };
+	struct nftnl_monitor *mon;
+
+	mon = nftnl_monitor_alloc(NULL, sizeof(buf), event_cb, NULL);
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 60000);
+
+	/* 1 comes and goes, 3 goes and comes back */
+	put_elems(NFT_MSG_NEWSETELEM, keys, 2);
+	put_elems(NFT_MSG_DELSETELEM, keys, 1);
+	put_elems(NFT_MSG_DELSETELEM, keys + 2, 1);
+	put_elems(NFT_MSG_NEWSETELEM, keys + 2, 1);
+	if (process(mon) != 0 || num_seen != 0)
+		print_err("Element events not held");
+	if (nftnl_monitor_timeout(mon) <= 0)
+		print_err("No timeout for held events");
+
+	put_table();
+	if (process(mon) != 3 || num_seen != 3)
+		print_err("Held events not delivered before table");
+	check_seen(0, NFT_MSG_NEWSETELEM, 2);
+	check_seen(1, NFT_MSG_NEWSETELEM, 3);
+	check_seen(2, NFT_MSG_NEWTABLE, 0);
+
+	if (nftnl_monitor_get_u64(mon, NFTNL_MONITOR_EVENTS) != 6 ||
+	    nftnl_monitor_get_u64(mon, NFTNL_MONITOR_DELIVERED) != 3 ||
+	    nftnl_monitor_get_u64(mon, NFTNL_MONITOR_COALESCED) != 3)
+		print_err("Wrong counters");
+
+	put_elems(NFT_MSG_NEWSETELEM, keys + 3, 1);
+	if (process(mon) != 0 || nftnl_monitor_flush(mon) != 1)
+		print_err("Held event not flushed");
+	check_seen(3, NFT_MSG_NEWSETELEM, 4);
+	if (nftnl_monitor_timeout(mon) != -1)
+		print_err("Timeout without held events");
+
+	/* nothing is held without a window */
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 0);
+	put_elems(NFT_MSG_DELSETELEM, keys + 3, 1);
+	if (process(mon) != 1)
+		print_err("Event held without window");
+	check_seen(4, NFT_MSG_DELSETELEM, 4);
+
+	/* 2 was there before the window, so it is still deleted at its end */
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 60000);
+	put_elems(NFT_MSG_DELSETELEM, keys + 1, 1);
+	put_elems(NFT_MSG_NEWSETELEM, keys + 1, 1);
+	put_elems(NFT_MSG_DELSETELEM, keys + 1, 1);
+	if (process(mon) != 0 || nftnl_monitor_flush(mon) != 1)
+		print_err("Delete of an element lost");
+	check_seen(5, NFT_MSG_DELSETELEM, 2);
+
+	nftnl_monitor_free(mon);
+}
+
+/* An element updated more often than the window is still delivered. */
+static void test_flapping(void)
+{
+	static const uint32_t keys[] = { 7 };
+	struct timespec ts = { .tv_nsec = 10 * 1000000 };
+	struct nftnl_monitor *mon;
+	int i, ret = 0;
+
+	num_seen = 0;
+	mon = nftnl_monitor_alloc(NULL, sizeof(buf), event_cb, NULL);
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 30);
+
+	for (i = 0; i < 10 && ret == 0; i++) {
+		put_elems(NFT_MSG_NEWSETELEM, keys, 1);
+		ret = process(mon);
+		nanosleep(&ts, NULL);
+	}
+	if (ret != 1)
+		print_err("Flapping element never delivered");
+	check_seen(0, NFT_MSG_NEWSETELEM, 7);
+
+	nftnl_monitor_free(mon);
+}
+
+/* The end of an interval shares its key with the start of the next one. */
+static void test_interval_end(void)
+{
+	static const uint32_t keys[] = { 5 };
+	struct nftnl_monitor *mon;
+
+	num_seen = 0;
+	mon = nftnl_monitor_alloc(NULL, sizeof(buf), event_cb, NULL);
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 60000);
+
+	put_elems_flags(NFT_MSG_NEWSETELEM, keys, 1,
+			NFT_SET_ELEM_INTERVAL_END);
+	put_elems(NFT_MSG_NEWSETELEM, keys, 1);
+	put_elems_flags(NFT_MSG_DELSETELEM, keys, 1,
+			NFT_SET_ELEM_INTERVAL_END);
+	if (process(mon) != 0 || nftnl_monitor_flush(mon) != 1)
+		print_err("Interval end coalesced with a start");
+	check_seen(0, NFT_MSG_NEWSETELEM, 5);
+	if (nftnl_monitor_get_u64(mon, NFTNL_MONITOR_COALESCED) != 2)
+		print_err("Wrong counters");
+
+	nftnl_monitor_free(mon);
+}
+
+static int count_elems(struct nftnl_set *s)
+{
+	struct nftnl_set_elems_iter *iter;
+	int n = 0;
+
+	iter = nftnl_set_elems_iter_create(s);
+	while (nftnl_set_elems_iter_next(iter))
+		n++;
+	nftnl_set_elems_iter_destroy(iter);
+	return n;
+}
+
+static void test_cache(void)
+{
+	static const uint32_t keys[] = { 1, 2, 3 };
+	struct nftnl_monitor *mon;
+	struct nftnl_cache *cache;
+	struct nftnl_set *s;
+
+	num_seen = 0;
+	cache = nftnl_cache_alloc();
+	nftnl_cache_set_genid(cache, 1);
+	mon = nftnl_monitor_alloc(NULL, sizeof(buf), event_cb, NULL);
+	nftnl_monitor_set_u32(mon, NFTNL_MONITOR_WINDOW, 60000);
+	nftnl_monitor_set_cache(mon, cache, NULL);
+
+	/* 2 never reaches the cache */
+	put_table();
+	put_set();
+	put_elems(NFT_MSG_NEWSETELEM, keys, 3);
+	put_elems(NFT_MSG_DELSETELEM, keys + 1, 1);
+	if (process(mon) != 2 || nftnl_monitor_flush(mon) != 2)
+		print_err("Events not delivered");
+
+	s = nftnl_cache_set_lookup(cache, NFPROTO_IPV4, "filter", "addrs");
+	if (s == NULL || count_elems(s) != 2 || nftnl_cache_is_stale(cache))
+		print_err("Events not applied to cache");
+
+	/* 1 is in the cache, so updating and deleting it is a delete */
+	put_elems(NFT_MSG_NEWSETELEM, keys, 1);
+	put_elems(NFT_MSG_DELSETELEM, keys, 1);
+	if (process(mon) != 0 || nftnl_monitor_flush(mon) != 1)
+		print_err("Delete of a cached element lost");
+	check_seen(4, NFT_MSG_DELSETELEM, 1);
+	if (count_elems(s) != 1 || nftnl_cache_is_stale(cache))
+		print_err("Delete not applied to cache");
+
+	/* deleting an element the cache does not hold makes it stale */
+	put_elems(NFT_MSG_DELSETELEM, keys + 1, 1);
+	process(mon);
+	nftnl_monitor_flush(mon);
+	if (nftnl_cache_stale_types(cache) != NFTNL_CACHE_SETELEM)
+		print_err("Cache not stale");
+
+	nftnl_monitor_free(mon);
+	nftnl_cache_free(cache);
+}
+
+int main(int argc, char *argv[])
+{
+	test_coalesce();
+	test_interval_end();
+	test_flapping();
+	test_cache();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,737 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/optimize.h>
+#include <libnftnl/eval.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_chain *build_chain(void)
+{
+	struct nftnl_chain *c = nftnl_chain_alloc();
+
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, NFPROTO_IPV4);
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, "input");
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_HOOKNUM, NF_INET_LOCAL_IN);
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_POLICY, NF_ACCEPT);
+	return c;
+}
+
+static struct nftnl_rule *build_rule(void)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	return r;
+}
+
+static void add_payload(struct nftnl_rule *r, uint32_t base, uint32_t offset,
+			uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("payload");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_BASE, base);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET, offset);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_LEN, len);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_cmp(struct nftnl_rule *r, const void *data, uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("cmp");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, data, len);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_verdict(struct nftnl_rule *r, int verdict)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("immediate");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, verdict);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_port_rule(struct nftnl_chain *c, uint16_t port, int verdict)
+{
+	struct nftnl_rule *r = build_rule();
+
+	port = htons(port);
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(port));
+	add_cmp(r, &port, sizeof(port));
+	add_verdict(r, verdict);
+	nftnl_chain_rule_add_tail(r, c);
+}
+
+static void add_addr_rule(struct nftnl_chain *c, uint32_t addr, int verdict)
+{
+	struct nftnl_rule *r = build_rule();
+
+	addr = htonl(addr);
+	add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, sizeof(addr));
+	add_cmp(r, &addr, sizeof(addr));
+	add_verdict(r, verdict);
+	nftnl_chain_rule_add_tail(r, c);
+}
+
+/*
+ *   counter
+ *   tcp dport { 22, 80, 22, 443, 8080 } drop, one rule each
+ *   ip saddr 10.0.0.1 accept, 10.0.0.2 drop, 10.0.0.3 accept, 10.0.0.1 drop
+ *   tcp dport { 25, 53 } drop, one rule each
+ */
+static struct nftnl_chain *build_rules(void)
+{
+	struct nftnl_chain *c = build_chain();
+	struct nftnl_rule *r;
+
+	r = build_rule();
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+	nftnl_chain_rule_add_tail(r, c);
+
+	add_port_rule(c, 22, NF_DROP);
+	add_port_rule(c, 80, NF_DROP);
+	add_port_rule(c, 22, NF_DROP);
+	add_port_rule(c, 443, NF_DROP);
+	add_port_rule(c, 8080, NF_DROP);
+
+	add_addr_rule(c, 0x0a000001, NF_ACCEPT);
+	add_addr_rule(c, 0x0a000002, NF_DROP);
+	add_addr_rule(c, 0x0a000003, NF_ACCEPT);
+	add_addr_rule(c, 0x0a000001, NF_DROP);
+
+	add_port_rule(c, 25, NF_DROP);
+	add_port_rule(c, 53, NF_DROP);
+	return c;
+}
+
+static void add_rules(struct nftnl_rule_list *rules,
+		      const struct nftnl_chain *c)
+{
+	struct nftnl_rule_iter riter;
+	struct nftnl_rule *r;
+
+	nftnl_rule_iter_init(&riter, c);
+	while ((r = nftnl_rule_iter_next(&riter)))
+		nftnl_rule_list_add_tail(nftnl_rule_clone(r, 0), rules);
+}
+
+static struct nftnl_ruleset *build_ruleset(const struct nftnl_chain *c,
+					   const struct nftnl_chain_list *extra,
+					   const struct nftnl_set_list *sets)
+{
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *set_copy = nftnl_set_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_chain_list_iter citer;
+	struct nftnl_set_list_iter siter;
+	struct nftnl_chain *chain;
+	struct nftnl_set *s;
+
+	nftnl_chain_list_add_tail(build_chain(), chains);
+	add_rules(rules, c);
+
+	if (extra) {
+		nftnl_chain_list_iter_init(&citer, extra);
+		while ((chain = nftnl_chain_list_iter_next(&citer))) {
+			nftnl_chain_list_add_tail(nftnl_chain_clone(chain, 0),
+						  chains);
+			add_rules(rules, chain);
+		}
+	}
+
+	if (sets) {
+		nftnl_set_list_iter_init(&siter, sets);
+		while ((s = nftnl_set_list_iter_next(&siter)))
+			nftnl_set_list_add_tail(nftnl_set_clone(s), set_copy);
+	}
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, set_copy);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+	return rs;
+}
+
+static int count_rules(const struct nftnl_chain *c)
+{
+	struct nftnl_rule_iter iter;
+	int num = 0;
+
+	nftnl_rule_iter_init(&iter, c);
+	while (nftnl_rule_iter_next(&iter))
+		num++;
+
+	return num;
+}
+
+static int count_list_rules(struct nftnl_rule_list *rules)
+{
+	struct nftnl_rule_list_iter *iter = nftnl_rule_list_iter_create(rules);
+	int num = 0;
+
+	while (nftnl_rule_list_iter_next(iter))
+		num++;
+	nftnl_rule_list_iter_destroy(iter);
+
+	return num;
+}
+
+static int count_elems(const struct nftnl_set *s)
+{
+	struct nftnl_set_elems_iter *iter = nftnl_set_elems_iter_create(s);
+	int num = 0;
+
+	while (nftnl_set_elems_iter_next(iter))
+		num++;
+	nftnl_set_elems_iter_destroy(iter);
+
+	return num;
+}
+
+static void build_pkt(uint8_t *buf, uint32_t saddr, uint16_t dport)
+{
+	memset(buf, 0, 24);
+	buf[0] = 0x45;
+	buf[9] = IPPROTO_TCP;
+	saddr = htonl(saddr);
+	memcpy(buf + 12, &saddr, sizeof(saddr));
+	dport = htons(dport);
+	memcpy(buf + 22, &dport, sizeof(dport));
+}
+
+/* Every packet gets the same verdict from both rulesets. */
+static void check_same_verdicts(struct nftnl_ruleset *rs1,
+				struct nftnl_ruleset *rs2,
+				const uint32_t *addrs, unsigned int num_addrs)
+{
+	static const uint16_t ports[] = {
+		22, 25, 53, 80, 443, 1000, 1499, 1500, 2999, 3000, 8080,
+	};
+	struct nftnl_eval *ev1 = nftnl_eval_alloc(rs1);
+	struct nftnl_eval *ev2 = nftnl_eval_alloc(rs2);
+	struct nftnl_eval_result res1, res2;
+	struct nftnl_eval_pkt pkt = {};
+	uint8_t buf[24];
+	unsigned int i, j;
+
+	if (ev1 == NULL || ev2 == NULL) {
+		print_err("compiling rulesets failed");
+		goto out;
+	}
+
+	pkt.data = buf;
+	pkt.len = sizeof(buf);
+	for (i = 0; i < sizeof(ports) / sizeof(ports[0]); i++) {
+		for (j = 0; j < num_addrs; j++) {
+			build_pkt(buf, addrs[j], ports[i]);
+			nftnl_eval_run(ev1, nftnl_eval_chain_lookup(ev1,
+					NFPROTO_IPV4, "filter", "input"),
+				       &pkt, &res1);
+			nftnl_eval_run(ev2, nftnl_eval_chain_lookup(ev2,
+					NFPROTO_IPV4, "filter", "input"),
+				       &pkt, &res2);
+			if (res1.verdict != res2.verdict)
+				print_err("optimized chain changes verdicts");
+		}
+	}
+out:
+	if (ev1)
+		nftnl_eval_free(ev1);
+	if (ev2)
+		nftnl_eval_free(ev2);
+}
+
+static void test_lookups(void)
+{
+	static const uint32_t addrs[] = {
+		0x0a000001, 0x0a000002, 0x0a000003, 0x0a000004,
+	};
+	struct nftnl_rule_list *replaced = nftnl_rule_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_chain *c = build_rules();
+	struct nftnl_ruleset *before, *after;
+	struct nftnl_set_list_iter iter;
+	struct nftnl_set *s;
+	uint32_t set_id = 7;
+
+	before = build_ruleset(c, NULL, NULL);
+
+	if (nftnl_chain_optimize_lookups(c, sets, &set_id, replaced) != 7)
+		print_err("unexpected number of rules removed");
+	if (count_rules(c) != 5)
+		print_err("unexpected number of rules left");
+	if (set_id != 9)
+		print_err("set id mismatches");
+	/* two runs, of four and of five rules */
+	if (count_list_rules(replaced) != 9)
+		print_err("replaced rules not handed back");
+
+	nftnl_set_list_iter_init(&iter, sets);
+	s = nftnl_set_list_iter_next(&iter);
+	if (s == NULL || strcmp(nftnl_set_get_str(s, NFTNL_SET_NAME), "__set%d") ||
+	    nftnl_set_get_u32(s, NFTNL_SET_ID) != 7 ||
+	    nftnl_set_get_u32(s, NFTNL_SET_FLAGS) & NFT_SET_MAP ||
+	    count_elems(s) != 4)
+		print_err("port set mismatches");
+
+	s = nftnl_set_list_iter_next(&iter);
+	if (s == NULL || strcmp(nftnl_set_get_str(s, NFTNL_SET_NAME), "__map%d") ||
+	    nftnl_set_get_u32(s, NFTNL_SET_ID) != 8 ||
+	    !(nftnl_set_get_u32(s, NFTNL_SET_FLAGS) & NFT_SET_MAP) ||
+	    count_elems(s) != 3)
+		print_err("address map mismatches");
+
+	after = build_ruleset(c, NULL, sets);
+	check_same_verdicts(before, after, addrs,
+			    sizeof(addrs) / sizeof(addrs[0]));
+
+	/* nothing left to do */
+	if (nftnl_chain_optimize_lookups(c, sets, &set_id, replaced) != 0)
+		print_err("second pass changed the chain");
+
+	nftnl_rule_list_free(replaced);
+	nftnl_ruleset_free(before);
+	nftnl_ruleset_free(after);
+	nftnl_set_list_free(sets);
+	nftnl_chain_free(c);
+}
+
+static void add_prefix_rule(struct nftnl_chain *c, uint32_t addr,
+			    uint32_t mask, int verdict)
+{
+	struct nftnl_rule *r = build_rule();
+	uint32_t xor = 0;
+	struct nftnl_expr *e;
+
+	addr = htonl(addr);
+	mask = htonl(mask);
+	add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, sizeof(addr));
+
+	e = nftnl_expr_alloc("bitwise");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_LEN, sizeof(addr));
+	nftnl_expr_set(e, NFTNL_EXPR_BITWISE_MASK, &mask, sizeof(mask));
+	nftnl_expr_set(e, NFTNL_EXPR_BITWISE_XOR, &xor, sizeof(xor));
+	nftnl_rule_add_expr(r, e);
+
+	add_cmp(r, &addr, sizeof(addr));
+	add_verdict(r, verdict);
+	nftnl_chain_rule_add_tail(r, c);
+}
+
+/*
+ *   ip saddr 10.(i % 2).0.i counter accept or drop, for i in 0..39
+ *   tcp dport 22 drop, after the fifth address rule
+ *   ip saddr 10.0.0.0/8 drop
+ */
+static struct nftnl_chain *build_addr_rules(void)
+{
+	struct nftnl_chain *c = build_chain();
+	struct nftnl_rule *r;
+	uint32_t i, addr;
+
+	for (i = 0; i < 40; i++) {
+		if (i == 5)
+			add_port_rule(c, 22, NF_DROP);
+
+		r = build_rule();
+		addr = htonl(0x0a000000 | (i % 2) << 16 | i);
+		add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, sizeof(addr));
+		add_cmp(r, &addr, sizeof(addr));
+		nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+		add_verdict(r, i % 3 ? NF_ACCEPT : NF_DROP);
+		nftnl_chain_rule_add_tail(r, c);
+	}
+	add_prefix_rule(c, 0x0a000000, 0xff000000, NF_DROP);
+	return c;
+}
+
+static void test_partition(void)
+{
+	struct nftnl_rule_list *replaced = nftnl_rule_list_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_chain *c = build_addr_rules();
+	struct nftnl_ruleset *before, *after;
+	struct nftnl_rule_list_iter *riter;
+	struct nftnl_chain_list_iter iter;
+	struct nftnl_rule_iter rule_iter;
+	struct nftnl_chain *child;
+	uint32_t addrs[90], i, set_id = 1;
+	uint64_t handle = 0, last = 0;
+	struct nftnl_rule *r;
+	int num;
+
+	for (i = 0; i < 44; i++) {
+		addrs[2 * i] = 0x0a000000 | i;
+		addrs[2 * i + 1] = 0x0a010000 | i;
+	}
+	addrs[88] = 0x0b000001;
+	addrs[89] = 0x0a020003;
+
+	nftnl_rule_iter_init(&rule_iter, c);
+	while ((r = nftnl_rule_iter_next(&rule_iter)))
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, ++handle);
+	num = count_rules(c);
+
+	before = build_ruleset(c, NULL, NULL);
+
+	/* 10.0.0.x and 10.1.0.x, then one chain per address */
+	if (nftnl_chain_partition(c, chains, sets, &set_id, replaced) != 37)
+		print_err("unexpected number of chains added");
+	/* five addresses, tcp dport, dispatch, /8 */
+	if (count_rules(c) != 8)
+		print_err("unexpected number of rules left");
+	if (set_id != 4)
+		print_err("set id mismatches");
+
+	/* all but the seven left in input moved, and go in chain order */
+	if (count_list_rules(replaced) != num - 7)
+		print_err("moved rules not handed back");
+	riter = nftnl_rule_list_iter_create(replaced);
+	while ((r = nftnl_rule_list_iter_next(riter))) {
+		handle = nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE);
+		if (handle <= last ||
+		    strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), "input")) {
+			print_err("moved rule handed back without handle");
+			break;
+		}
+		last = handle;
+	}
+	nftnl_rule_list_iter_destroy(riter);
+
+	nftnl_chain_list_iter_init(&iter, chains);
+	child = nftnl_chain_list_iter_next(&iter);
+	if (child == NULL ||
+	    strcmp(nftnl_chain_get_str(child, NFTNL_CHAIN_NAME),
+		   "input_p1_0a00") ||
+	    count_rules(child) != 1)
+		print_err("first sub-chain mismatches");
+
+	/* they are new rules in the sub-chains */
+	nftnl_chain_list_iter_init(&iter, chains);
+	while ((child = nftnl_chain_list_iter_next(&iter))) {
+		nftnl_rule_iter_init(&rule_iter, child);
+		while ((r = nftnl_rule_iter_next(&rule_iter))) {
+			if (nftnl_rule_is_set(r, NFTNL_RULE_HANDLE))
+				print_err("moved rule kept its handle");
+		}
+	}
+
+	after = build_ruleset(c, chains, sets);
+	check_same_verdicts(before, after, addrs,
+			    sizeof(addrs) / sizeof(addrs[0]));
+
+	nftnl_ruleset_free(before);
+	nftnl_ruleset_free(after);
+	nftnl_rule_list_free(replaced);
+	nftnl_chain_list_free(chains);
+	nftnl_set_list_free(sets);
+	nftnl_chain_free(c);
+}
+
+/* Two runs of 10.0.0.x, split by tcp dport 22 */
+static void test_partition_runs(void)
+{
+	struct nftnl_rule_list *replaced = nftnl_rule_list_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_chain *c = build_chain();
+	struct nftnl_chain_list_iter iter, iter2;
+	struct nftnl_ruleset *before, *after;
+	struct nftnl_chain *c1, *c2;
+	uint32_t addrs[20], i, set_id = 1;
+
+	for (i = 0; i < 40; i++) {
+		if (i == 20)
+			add_port_rule(c, 22, NF_DROP);
+		add_addr_rule(c, 0x0a000000 | i % 20, i < 20 ? NF_ACCEPT :
+							       NF_DROP);
+	}
+	for (i = 0; i < 20; i++)
+		addrs[i] = 0x0a000000 | i;
+
+	before = build_ruleset(c, NULL, NULL);
+
+	if (nftnl_chain_partition(c, chains, sets, &set_id, replaced) != 40)
+		print_err("unexpected number of chains added for two runs");
+
+	nftnl_chain_list_iter_init(&iter, chains);
+	while ((c1 = nftnl_chain_list_iter_next(&iter))) {
+		iter2 = iter;
+		while ((c2 = nftnl_chain_list_iter_next(&iter2))) {
+			if (!strcmp(nftnl_chain_get_str(c1, NFTNL_CHAIN_NAME),
+				    nftnl_chain_get_str(c2, NFTNL_CHAIN_NAME)))
+				print_err("sub-chain names clash");
+		}
+	}
+
+	after = build_ruleset(c, chains, sets);
+	check_same_verdicts(before, after, addrs,
+			    sizeof(addrs) / sizeof(addrs[0]));
+
+	nftnl_ruleset_free(before);
+	nftnl_ruleset_free(after);
+	nftnl_rule_list_free(replaced);
+	nftnl_chain_list_free(chains);
+	nftnl_set_list_free(sets);
+	nftnl_chain_free(c);
+}
+
+/* A chain name with no room left for sub-chains leaves all as it was. */
+static void test_partition_fail(void)
+{
+	struct nftnl_rule_list *replaced = nftnl_rule_list_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_chain *c = build_addr_rules();
+	struct nftnl_chain_list_iter citer;
+	struct nftnl_set_list_iter siter;
+	struct nftnl_rule *rules[42], *r;
+	struct nftnl_rule_iter iter;
+	char name[NFT_CHAIN_MAXNAMELEN];
+	uint32_t set_id = 1;
+	int i = 0;
+
+	memset(name, 'x', sizeof(name) - 1);
+	name[sizeof(name) - 1] = '\0';
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name);
+
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter)) && i < 42) {
+		nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, name);
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+		rules[i++] = r;
+	}
+
+	if (nftnl_chain_partition(c, chains, sets, &set_id, replaced) != -1)
+		print_err("partition with a too long chain name succeeded");
+	if (set_id != 1)
+		print_err("set id changed on failure");
+	if (!nftnl_rule_list_is_empty(replaced))
+		print_err("rules handed back on failure");
+
+	nftnl_chain_list_iter_init(&citer, chains);
+	nftnl_set_list_iter_init(&siter, sets);
+	if (nftnl_chain_list_iter_next(&citer) ||
+	    nftnl_set_list_iter_next(&siter))
+		print_err("chains or sets added on failure");
+
+	i = 0;
+	nftnl_rule_iter_init(&iter, c);
+	while ((r = nftnl_rule_iter_next(&iter))) {
+		if (i >= 42 || r != rules[i] ||
+		    nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE) != i + 1 ||
+		    strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), name)) {
+			print_err("rules changed on failure");
+			break;
+		}
+		i++;
+	}
+	if (i != 42)
+		print_err("rules lost on failure");
+
+	nftnl_rule_list_free(replaced);
+	nftnl_chain_list_free(chains);
+	nftnl_set_list_free(sets);
+	nftnl_chain_free(c);
+}
+
+static void add_expr_cmp(struct nftnl_rule *r, uint32_t op, const void *data,
+			 uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("cmp");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, op);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, data, len);
+	nftnl_rule_add_expr(r, e);
+}
+
+static void add_byteorder(struct nftnl_rule *r, uint32_t op)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("byteorder");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BYTEORDER_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BYTEORDER_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BYTEORDER_OP, op);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BYTEORDER_LEN, 2);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BYTEORDER_SIZE, 2);
+	nftnl_rule_add_expr(r, e);
+}
+
+/*
+ *   ip saddr & 255.255.255.255 == 10.0.0.1, ip saddr != 10.0.0.2
+ *   tcp dport, converted to host order and back
+ *   tcp dport 1000-2000, >= 1500, < 3000 drop
+ */
+static struct nftnl_chain *build_peephole_rule(void)
+{
+	uint32_t mask = 0xffffffff, xor = 0, addr1, addr2;
+	uint16_t from = htons(1000), to = htons(2000);
+	uint16_t gte = htons(1500), lt = htons(3000);
+	struct nftnl_chain *c = build_chain();
+	struct nftnl_rule *r = build_rule();
+	struct nftnl_expr *e;
+
+	addr1 = htonl(0x0a000001);
+	addr2 = htonl(0x0a000002);
+
+	add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, 4);
+	e = nftnl_expr_alloc("bitwise");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_BITWISE_LEN, 4);
+	nftnl_expr_set(e, NFTNL_EXPR_BITWISE_MASK, &mask, sizeof(mask));
+	nftnl_expr_set(e, NFTNL_EXPR_BITWISE_XOR, &xor, sizeof(xor));
+	nftnl_rule_add_expr(r, e);
+	add_cmp(r, &addr1, sizeof(addr1));
+	add_payload(r, NFT_PAYLOAD_NETWORK_HEADER, 12, 4);
+	add_expr_cmp(r, NFT_CMP_NEQ, &addr2, sizeof(addr2));
+
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, 2);
+	add_byteorder(r, NFT_BYTEORDER_NTOH);
+	add_byteorder(r, NFT_BYTEORDER_HTON);
+
+	e = nftnl_expr_alloc("range");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_RANGE_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_RANGE_OP, NFT_RANGE_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_RANGE_FROM_DATA, &from, sizeof(from));
+	nftnl_expr_set(e, NFTNL_EXPR_RANGE_TO_DATA, &to, sizeof(to));
+	nftnl_rule_add_expr(r, e);
+	add_expr_cmp(r, NFT_CMP_GTE, &gte, sizeof(gte));
+	add_expr_cmp(r, NFT_CMP_LT, &lt, sizeof(lt));
+
+	add_verdict(r, NF_DROP);
+	nftnl_chain_rule_add_tail(r, c);
+	return c;
+}
+
+static void test_peephole(void)
+{
+	static const uint32_t addrs[] = { 0x0a000001, 0x0a000002 };
+	static const char *names[] = {
+		"payload", "cmp", "cmp", "payload", "range", "immediate",
+	};
+	struct nftnl_chain *c = build_peephole_rule();
+	struct nftnl_ruleset *before, *after;
+	struct nftnl_rule_iter riter;
+	struct nftnl_expr_iter *iter;
+	const uint16_t *from;
+	struct nftnl_rule *r;
+	struct nftnl_expr *e;
+	unsigned int i = 0;
+	uint32_t len;
+
+	before = build_ruleset(c, NULL, NULL);
+
+	nftnl_rule_iter_init(&riter, c);
+	r = nftnl_rule_iter_next(&riter);
+	if (nftnl_rule_optimize_exprs(r) != 6)
+		print_err("unexpected number of expressions removed");
+
+	iter = nftnl_expr_iter_create(r);
+	while ((e = nftnl_expr_iter_next(iter))) {
+		if (i >= sizeof(names) / sizeof(names[0]) ||
+		    strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), names[i]))
+			print_err("unexpected expression left");
+		if (!strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), "range")) {
+			from = nftnl_expr_get(e, NFTNL_EXPR_RANGE_FROM_DATA,
+					      &len);
+			if (*from != htons(1500))
+				print_err("range was not narrowed");
+		}
+		i++;
+	}
+	nftnl_expr_iter_destroy(iter);
+	if (i != sizeof(names) / sizeof(names[0]))
+		print_err("unexpected number of expressions left");
+
+	after = build_ruleset(c, NULL, NULL);
+	check_same_verdicts(before, after, addrs,
+			    sizeof(addrs) / sizeof(addrs[0]));
+
+	/* nothing left to do */
+	if (nftnl_rule_optimize_exprs(r) != 0)
+		print_err("second pass changed the rule");
+
+	nftnl_ruleset_free(before);
+	nftnl_ruleset_free(after);
+	nftnl_chain_free(c);
+}
+
+/* tcp dport 10-20 counter, then @op 15 */
+static void test_peephole_counter(uint32_t op)
+{
+	uint16_t from = htons(10), to = htons(20), val = htons(15);
+	struct nftnl_rule *r = build_rule();
+	struct nftnl_expr *e;
+	uint32_t len;
+
+	add_payload(r, NFT_PAYLOAD_TRANSPORT_HEADER, 2, 2);
+	e = nftnl_expr_alloc("range");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_RANGE_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_RANGE_OP, NFT_RANGE_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_RANGE_FROM_DATA, &from, sizeof(from));
+	nftnl_expr_set(e, NFTNL_EXPR_RANGE_TO_DATA, &to, sizeof(to));
+	nftnl_rule_add_expr(r, e);
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+	add_expr_cmp(r, op, &val, sizeof(val));
+
+	/* the counter sees packets outside the compare */
+	if (nftnl_rule_optimize_exprs(r) != 0)
+		print_err("range folded across a counter");
+	if (memcmp(nftnl_expr_get(e, NFTNL_EXPR_RANGE_TO_DATA, &len), &to,
+		   sizeof(to)))
+		print_err("range narrowed across a counter");
+
+	nftnl_rule_free(r);
+}
+
+int main(int argc, char *argv[])
+{
+	test_lookups();
+	test_partition();
+	test_partition_runs();
+	test_partition_fail();
+	test_peephole();
+	test_peephole_counter(NFT_CMP_EQ);
+	test_peephole_counter(NFT_CMP_LTE);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -13,8 +13,10 @@
 #include <string.h>
 
 #include <netinet/in.h>
+#include <linux/netlink.h>
 #include <linux/netfilter/nf_tables.h>
 #include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
 #include <libnftnl/udata.h>
 
 static int test_ok = 1;
@@ -59,6 +61,323 @@ static void cmp_nftnl_rule(struct nftnl_rule *a, struct nftnl_rule *b)
 		print_err("Rule userdata mismatches");
 }
 
+static struct nlmsghdr *build_rule(char *buf, struct nftnl_rule *r)
+{
+	struct nlmsghdr *nlh;
+
+	memset(buf, 0, 4096);
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, AF_INET, 0, 1234);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+
+	return nlh;
+}
+
+static uint32_t get_cmp_op(struct nftnl_rule *r)
+{
+	struct nftnl_expr_iter iter;
+	struct nftnl_expr *e;
+	uint32_t op = UINT32_MAX;
+
+	nftnl_expr_iter_init(&iter, r);
+	while ((e = nftnl_expr_iter_next(&iter)) != NULL) {
+		if (!strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), "cmp"))
+			op = nftnl_expr_get_u32(e, NFTNL_EXPR_CMP_OP);
+	}
+
+	return op;
+}
+
+static void test_wire_cache(void)
+{
+	char buf1[4096], buf2[4096];
+	struct nlmsghdr *nlh1, *nlh2;
+	struct nftnl_expr *payload, *cmp;
+	struct nftnl_rule *a, *b;
+	uint32_t data = 0x1234;
+
+	a = nftnl_rule_alloc();
+	payload = nftnl_expr_alloc("payload");
+	cmp = nftnl_expr_alloc("cmp");
+	if (a == NULL || payload == NULL || cmp == NULL)
+		print_err("OOM");
+
+	nftnl_rule_set_str(a, NFTNL_RULE_TABLE, "table");
+	nftnl_rule_set_str(a, NFTNL_RULE_CHAIN, "chain");
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_OFFSET, 12);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_LEN, sizeof(data));
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(cmp, NFTNL_EXPR_CMP_DATA, &data, sizeof(data));
+	nftnl_rule_add_expr(a, payload);
+	nftnl_rule_add_expr(a, cmp);
+
+	nftnl_rule_cache_wire(a, true);
+	nftnl_expr_cache_wire(cmp, true);
+
+	nlh1 = build_rule(buf1, a);
+	nlh2 = build_rule(buf2, a);
+	if (nlh1->nlmsg_len != nlh2->nlmsg_len ||
+	    memcmp(nlh1, nlh2, nlh1->nlmsg_len) != 0)
+		print_err("cached rule encoding mismatches");
+
+	/* Updating an expression must drop the cached encoding. */
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_OP, NFT_CMP_NEQ);
+	nlh2 = build_rule(buf2, a);
+
+	b = nftnl_rule_alloc();
+	if (b == NULL)
+		print_err("OOM");
+	if (nftnl_rule_nlmsg_parse(nlh2, b) < 0)
+		print_err("parsing problems");
+	if (get_cmp_op(b) != NFT_CMP_NEQ)
+		print_err("stale cached rule encoding");
+	nftnl_rule_free(b);
+
+	/* So must removing an expression from the rule. */
+	nftnl_rule_del_expr(cmp);
+	nftnl_expr_free(cmp);
+	nlh2 = build_rule(buf2, a);
+
+	b = nftnl_rule_alloc();
+	if (b == NULL)
+		print_err("OOM");
+	if (nftnl_rule_nlmsg_parse(nlh2, b) < 0)
+		print_err("parsing problems");
+	if (get_cmp_op(b) != UINT32_MAX)
+		print_err("stale cached rule encoding");
+	nftnl_rule_free(b);
+
+	nftnl_rule_free(a);
+}
+
+static void test_parse_layout(void)
+{
+	const char *names[] = { "payload", "cmp", "counter" };
+	struct nftnl_expr_iter *iter;
+	struct nftnl_expr *e, *first = NULL;
+	struct nftnl_rule *a, *b;
+	struct nlmsghdr *nlh;
+	char buf[4096];
+	int i;
+
+	a = nftnl_rule_alloc();
+	b = nftnl_rule_alloc();
+	if (a == NULL || b == NULL)
+		print_err("OOM");
+
+	for (i = 0; i < 3; i++) {
+		e = nftnl_expr_alloc(names[i]);
+		if (e == NULL)
+			print_err("OOM");
+		nftnl_rule_add_expr(a, e);
+	}
+
+	nlh = build_rule(buf, a);
+	if (nftnl_rule_nlmsg_parse(nlh, b) < 0)
+		print_err("parsing problems");
+
+	i = 0;
+	iter = nftnl_expr_iter_create(b);
+	while ((e = nftnl_expr_iter_next(iter)) != NULL) {
+		if (i >= 3 ||
+		    strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), names[i]))
+			print_err("parsed expression mismatches");
+		if (first == NULL)
+			first = e;
+		i++;
+	}
+	nftnl_expr_iter_destroy(iter);
+	if (i != 3)
+		print_err("parsed expression count mismatches");
+
+	/* A parsed expression may outlive the rule it was parsed with. */
+	nftnl_rule_del_expr(first);
+	nftnl_rule_free(b);
+	if (strcmp(nftnl_expr_get_str(first, NFTNL_EXPR_NAME), "payload"))
+		print_err("detached expression mismatches");
+	nftnl_expr_free(first);
+
+	nftnl_rule_free(a);
+}
+
+static struct nftnl_expr *get_expr(struct nftnl_rule *r, const char *name)
+{
+	struct nftnl_expr_iter iter;
+	struct nftnl_expr *e;
+
+	nftnl_expr_iter_init(&iter, r);
+	while ((e = nftnl_expr_iter_next(&iter)) != NULL) {
+		if (!strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), name))
+			return e;
+	}
+
+	return NULL;
+}
+
+static void test_clone(void)
+{
+	char buf1[4096], buf2[4096];
+	struct nlmsghdr *nlh1, *nlh2;
+	struct nftnl_expr *log, *imm;
+	struct nftnl_rule *a, *b, *c;
+	const char *str;
+
+	a = nftnl_rule_alloc();
+	log = nftnl_expr_alloc("log");
+	imm = nftnl_expr_alloc("immediate");
+	if (a == NULL || log == NULL || imm == NULL)
+		print_err("OOM");
+
+	nftnl_rule_set_str(a, NFTNL_RULE_TABLE, "table");
+	nftnl_rule_set_str(a, NFTNL_RULE_CHAIN, "chain");
+	nftnl_rule_set_data(a, NFTNL_RULE_USERDATA, "udata", 5);
+	nftnl_expr_set_str(log, NFTNL_EXPR_LOG_PREFIX, "prefix");
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_VERDICT, NFT_JUMP);
+	nftnl_expr_set_str(imm, NFTNL_EXPR_IMM_CHAIN, "target");
+	nftnl_rule_add_expr(a, log);
+	nftnl_rule_add_expr(a, imm);
+
+	b = nftnl_rule_clone(a, 0);
+	c = nftnl_rule_clone(a, NFTNL_CLONE_F_COW);
+	if (b == NULL || c == NULL)
+		print_err("OOM");
+
+	nlh1 = build_rule(buf1, a);
+	nlh2 = build_rule(buf2, b);
+	if (nlh1->nlmsg_len != nlh2->nlmsg_len ||
+	    memcmp(nlh1, nlh2, nlh1->nlmsg_len) != 0)
+		print_err("cloned rule encoding mismatches");
+	nlh2 = build_rule(buf2, c);
+	if (nlh1->nlmsg_len != nlh2->nlmsg_len ||
+	    memcmp(nlh1, nlh2, nlh1->nlmsg_len) != 0)
+		print_err("copy-on-write rule encoding mismatches");
+
+	/* Updating a copy-on-write clone leaves the original alone. */
+	nftnl_expr_set_str(get_expr(c, "log"), NFTNL_EXPR_LOG_PREFIX, "other");
+	str = nftnl_expr_get_str(log, NFTNL_EXPR_LOG_PREFIX);
+	if (str == NULL || strcmp(str, "prefix"))
+		print_err("copy-on-write clone modified the original");
+	str = nftnl_expr_get_str(get_expr(c, "log"), NFTNL_EXPR_LOG_PREFIX);
+	if (str == NULL || strcmp(str, "other"))
+		print_err("copy-on-write clone not updated");
+
+	/* Shared data outlives the original. */
+	nftnl_rule_free(a);
+	str = nftnl_expr_get_str(get_expr(c, "immediate"),
+				 NFTNL_EXPR_IMM_CHAIN);
+	if (str == NULL || strcmp(str, "target"))
+		print_err("copy-on-write clone lost shared data");
+	str = nftnl_expr_get_str(get_expr(b, "immediate"),
+				 NFTNL_EXPR_IMM_CHAIN);
+	if (str == NULL || strcmp(str, "target"))
+		print_err("clone lost its data");
+
+	nftnl_rule_free(c);
+	nftnl_rule_free(b);
+}
+
+static struct nftnl_rule *build_match_rule(uint32_t data)
+{
+	struct nftnl_expr *payload, *cmp, *counter, *imm;
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	payload = nftnl_expr_alloc("payload");
+	cmp = nftnl_expr_alloc("cmp");
+	counter = nftnl_expr_alloc("counter");
+	imm = nftnl_expr_alloc("immediate");
+	if (r == NULL || payload == NULL || cmp == NULL || counter == NULL ||
+	    imm == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, AF_INET);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "table");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "chain");
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_OFFSET, 12);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_LEN, sizeof(data));
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(cmp, NFTNL_EXPR_CMP_DATA, &data, sizeof(data));
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_VERDICT, NFT_JUMP);
+	nftnl_expr_set_str(imm, NFTNL_EXPR_IMM_CHAIN, "target");
+	nftnl_rule_add_expr(r, payload);
+	nftnl_rule_add_expr(r, cmp);
+	nftnl_rule_add_expr(r, counter);
+	nftnl_rule_add_expr(r, imm);
+
+	return r;
+}
+
+static void test_equal(void)
+{
+	struct nftnl_rule *a, *b, *c;
+	struct nftnl_expr *e;
+	struct nlmsghdr *nlh;
+	char buf[4096];
+
+	a = build_match_rule(0x1234);
+	b = nftnl_rule_alloc();
+	if (b == NULL)
+		print_err("OOM");
+
+	/* Handle, position and counter values do not matter. */
+	nlh = build_rule(buf, a);
+	if (nftnl_rule_nlmsg_parse(nlh, b) < 0)
+		print_err("parsing problems");
+	nftnl_rule_set_u64(b, NFTNL_RULE_HANDLE, 10);
+	nftnl_rule_set_u64(b, NFTNL_RULE_POSITION, 5);
+	nftnl_expr_set_u64(get_expr(b, "counter"), NFTNL_EXPR_CTR_PACKETS, 7);
+
+	if (!nftnl_rule_equal(a, b))
+		print_err("equivalent rules mismatch");
+	if (nftnl_rule_hash(a) != nftnl_rule_hash(b))
+		print_err("equivalent rules hash differently");
+
+	c = nftnl_rule_clone(a, NFTNL_CLONE_F_COW);
+	if (c == NULL)
+		print_err("OOM");
+	if (!nftnl_rule_equal(a, c) || nftnl_rule_hash(a) != nftnl_rule_hash(c))
+		print_err("cloned rule mismatches");
+
+	/* Matching on a different value does. */
+	nftnl_expr_set_u32(get_expr(c, "cmp"), NFTNL_EXPR_CMP_DATA, 0x4321);
+	if (nftnl_rule_equal(a, c))
+		print_err("different rules compare equal");
+	if (nftnl_rule_hash(a) == nftnl_rule_hash(c))
+		print_err("different rules hash the same");
+
+	/* So does the jump target. */
+	nftnl_rule_free(c);
+	c = build_match_rule(0x1234);
+	nftnl_expr_set_str(get_expr(c, "immediate"), NFTNL_EXPR_IMM_CHAIN,
+			   "other");
+	if (nftnl_rule_equal(a, c))
+		print_err("different rules compare equal");
+
+	/* And so does the number of expressions. */
+	nftnl_rule_free(c);
+	c = nftnl_rule_clone(a, 0);
+	e = get_expr(c, "counter");
+	nftnl_rule_del_expr(e);
+	nftnl_expr_free(e);
+	if (nftnl_rule_equal(a, c) || nftnl_rule_equal(c, a))
+		print_err("different rules compare equal");
+
+	nftnl_rule_free(a);
+	nftnl_rule_free(b);
+	nftnl_rule_free(c);
+}
+
 int main(int argc, char *argv[])
 {
 	struct nftnl_udata_buf *udata;
@@ -100,6 +419,12 @@ int main(int argc, char *argv[])
 
 	nftnl_rule_free(a);
 	nftnl_rule_free(b);
+
+	test_wire_cache();
+	test_parse_layout();
+	test_clone();
+	test_equal();
+
 	if (!test_ok)
 		exit(EXIT_FAILURE);
 
@@ -0,0 +1,413 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <sys/uio.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libmnl/libmnl.h>
+#include <libnftnl/batch.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/object.h>
+#include <libnftnl/flowtable.h>
+
+#define array_len(a)	(int)(sizeof(a) / sizeof((a)[0]))
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_table *build_table(const char *name)
+{
+	struct nftnl_table *t = nftnl_table_alloc();
+
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, NFPROTO_IPV4);
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, name);
+	return t;
+}
+
+static struct nftnl_chain *build_chain(const char *table, const char *name)
+{
+	struct nftnl_chain *c = nftnl_chain_alloc();
+
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, NFPROTO_IPV4);
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, table);
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name);
+	return c;
+}
+
+static struct nftnl_rule *build_rule(const char *table, const char *chain,
+				     uint32_t val, uint64_t handle)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+	struct nftnl_expr *e = nftnl_expr_alloc("cmp");
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, table);
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	if (handle)
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, handle);
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_DATA, val);
+	nftnl_rule_add_expr(r, e);
+	return r;
+}
+
+static struct nftnl_set *build_set(const uint32_t *keys, int num)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+	struct nftnl_set_elem *e;
+	int i;
+
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, NFPROTO_IPV4);
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "addrs");
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(uint32_t));
+	for (i = 0; i < num; i++) {
+		e = nftnl_set_elem_alloc();
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &keys[i],
+				   sizeof(uint32_t));
+		nftnl_set_elem_add(s, e);
+	}
+	return s;
+}
+
+/* Current ruleset, as if dumped from the kernel. */
+static struct nftnl_ruleset *build_cur(void)
+{
+	static const uint32_t keys[] = { 1, 2, 3 };
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_table_list *tables = nftnl_table_list_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+
+	nftnl_table_list_add_tail(build_table("filter"), tables);
+	nftnl_table_list_add_tail(build_table("old"), tables);
+	nftnl_chain_list_add_tail(build_chain("filter", "input"), chains);
+	nftnl_chain_list_add_tail(build_chain("filter", "gone"), chains);
+	nftnl_chain_list_add_tail(build_chain("old", "output"), chains);
+	nftnl_set_list_add_tail(build_set(keys, 3), sets);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 1, 1), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 2, 2), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 3, 3), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 4, 4), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "gone", 5, 5), rules);
+	nftnl_rule_list_add_tail(build_rule("old", "output", 6, 6), rules);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tables);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+	return rs;
+}
+
+static struct nftnl_ruleset *build_want(void)
+{
+	static const uint32_t keys[] = { 2, 3, 4 };
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_table_list *tables = nftnl_table_list_alloc();
+	struct nftnl_chain_list *chains = nftnl_chain_list_alloc();
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_rule_list *rules = nftnl_rule_list_alloc();
+
+	nftnl_table_list_add_tail(build_table("filter"), tables);
+	nftnl_chain_list_add_tail(build_chain("filter", "input"), chains);
+	nftnl_chain_list_add_tail(build_chain("filter", "new"), chains);
+	nftnl_set_list_add_tail(build_set(keys, 3), sets);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 1, 0), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 3, 0), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 7, 0), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "input", 4, 0), rules);
+	nftnl_rule_list_add_tail(build_rule("filter", "new", 8, 0), rules);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tables);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+	return rs;
+}
+
+static uint32_t elem_key(struct nlmsghdr *nlh)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+	struct nftnl_set_elems_iter *iter;
+	struct nftnl_set_elem *e;
+	uint32_t len, key = 0;
+	int num = 0;
+
+	if (nftnl_set_elems_nlmsg_parse(nlh, s) < 0)
+		print_err("parsing set element message");
+
+	iter = nftnl_set_elems_iter_create(s);
+	while ((e = nftnl_set_elems_iter_next(iter))) {
+		key = *(uint32_t *)nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY,
+						      &len);
+		num++;
+	}
+	nftnl_set_elems_iter_destroy(iter);
+	nftnl_set_free(s);
+
+	if (num != 1)
+		print_err("Expected a single element");
+	return key;
+}
+
+static void check_rule(struct nlmsghdr *nlh, const char *chain,
+		       uint64_t handle, uint64_t position)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0)
+		print_err("parsing rule message");
+	if (strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), chain))
+		print_err("Rule chain mismatches");
+	if (nftnl_rule_is_set(r, NFTNL_RULE_HANDLE) != !!handle ||
+	    (handle && nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE) != handle))
+		print_err("Rule handle mismatches");
+	if (nftnl_rule_is_set(r, NFTNL_RULE_POSITION) != !!position ||
+	    (position && nftnl_rule_get_u64(r, NFTNL_RULE_POSITION) != position))
+		print_err("Rule position mismatches");
+	if (!!(nlh->nlmsg_flags & NLM_F_APPEND) != !position &&
+	    (nlh->nlmsg_type & 0xff) == NFT_MSG_NEWRULE)
+		print_err("Rule append flag mismatches");
+	nftnl_rule_free(r);
+}
+
+static void test_diff(void)
+{
+	static const uint16_t types[] = {
+		NFT_MSG_DELRULE, NFT_MSG_DELSETELEM, NFT_MSG_DELCHAIN,
+		NFT_MSG_DELTABLE, NFT_MSG_NEWCHAIN, NFT_MSG_NEWSETELEM,
+		NFT_MSG_NEWRULE, NFT_MSG_NEWRULE,
+	};
+	struct nftnl_ruleset *cur = build_cur(), *want = build_want();
+	struct nftnl_batch *batch;
+	struct nlmsghdr *nlh;
+	uint32_t seq = 100;
+	struct iovec iov;
+	int i = 0, len;
+
+	batch = nftnl_batch_alloc(4096, 4096);
+	if (nftnl_ruleset_diff(cur, want, batch, &seq) != array_len(types))
+		print_err("Unexpected number of messages");
+	if (seq != 100 + array_len(types))
+		print_err("Sequence number mismatches");
+
+	if (nftnl_batch_iovec_len(batch) != 1)
+		print_err("Unexpected number of batch pages");
+	nftnl_batch_iovec(batch, &iov, 1);
+
+	nlh = iov.iov_base;
+	len = iov.iov_len;
+	for (; mnl_nlmsg_ok(nlh, len); nlh = mnl_nlmsg_next(nlh, &len), i++) {
+		if (i >= array_len(types) ||
+		    (nlh->nlmsg_type & 0xff) != types[i]) {
+			print_err("Unexpected message type");
+			break;
+		}
+
+		switch (i) {
+		case 0:
+			check_rule(nlh, "input", 2, 0);
+			break;
+		case 1:
+			if (elem_key(nlh) != 1)
+				print_err("Deleted element mismatches");
+			break;
+		case 5:
+			if (elem_key(nlh) != 4)
+				print_err("Added element mismatches");
+			break;
+		case 6:
+			check_rule(nlh, "input", 0, 4);
+			break;
+		case 7:
+			check_rule(nlh, "new", 0, 0);
+			break;
+		}
+	}
+	if (i != array_len(types))
+		print_err("Missing messages");
+
+	/* Nothing to do once both rulesets match. */
+	nftnl_batch_free(batch);
+	batch = nftnl_batch_alloc(4096, 4096);
+	if (nftnl_ruleset_diff(cur, cur, batch, &seq) != 0)
+		print_err("Diff of identical rulesets is not empty");
+
+	nftnl_batch_free(batch);
+	nftnl_ruleset_free(cur);
+	nftnl_ruleset_free(want);
+}
+
+static struct nftnl_set *build_anon(const char *name, uint32_t id,
+				    const uint32_t *keys, int num)
+{
+	struct nftnl_set *s = build_set(keys, num);
+
+	nftnl_set_set_str(s, NFTNL_SET_NAME, name);
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS,
+			  NFT_SET_ANONYMOUS | NFT_SET_CONSTANT);
+	if (id)
+		nftnl_set_set_u32(s, NFTNL_SET_ID, id);
+	return s;
+}
+
+static struct nftnl_rule *build_lookup(const char *set, uint32_t id,
+				       uint64_t handle)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+	struct nftnl_expr *e = nftnl_expr_alloc("lookup");
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	if (handle)
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, handle);
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_LOOKUP_SREG, NFT_REG_1);
+	nftnl_expr_set_str(e, NFTNL_EXPR_LOOKUP_SET, set);
+	if (id)
+		nftnl_expr_set_u32(e, NFTNL_EXPR_LOOKUP_SET_ID, id);
+	nftnl_rule_add_expr(r, e);
+	return r;
+}
+
+/* Lookups on anonymous sets match by content, whatever the set name. */
+static void test_diff_anon(void)
+{
+	static const uint16_t types[] = {
+		NFT_MSG_DELRULE, NFT_MSG_NEWSET, NFT_MSG_NEWSETELEM,
+		NFT_MSG_NEWRULE,
+	};
+	static const uint32_t keys[] = { 1, 2, 5, 6, 2, 1, 7 };
+	struct nftnl_ruleset *cur = nftnl_ruleset_alloc();
+	struct nftnl_ruleset *want = nftnl_ruleset_alloc();
+	struct nftnl_set_list *sets;
+	struct nftnl_rule_list *rules;
+	struct nftnl_batch *batch;
+	struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+	uint32_t seq = 100;
+	struct iovec iov;
+	int i = 0, len;
+
+	sets = nftnl_set_list_alloc();
+	rules = nftnl_rule_list_alloc();
+	nftnl_set_list_add_tail(build_anon("__set0", 0, &keys[0], 2), sets);
+	nftnl_set_list_add_tail(build_anon("__set1", 0, &keys[2], 2), sets);
+	nftnl_rule_list_add_tail(build_lookup("__set0", 0, 1), rules);
+	nftnl_rule_list_add_tail(build_lookup("__set1", 0, 2), rules);
+	nftnl_ruleset_set(cur, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(cur, NFTNL_RULESET_RULELIST, rules);
+
+	sets = nftnl_set_list_alloc();
+	rules = nftnl_rule_list_alloc();
+	nftnl_set_list_add_tail(build_anon("__set%d", 1, &keys[4], 2), sets);
+	nftnl_set_list_add_tail(build_anon("__set%d", 2, &keys[6], 1), sets);
+	nftnl_rule_list_add_tail(build_lookup("__set%d", 1, 0), rules);
+	nftnl_rule_list_add_tail(build_lookup("__set%d", 2, 0), rules);
+	nftnl_ruleset_set(want, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(want, NFTNL_RULESET_RULELIST, rules);
+
+	batch = nftnl_batch_alloc(4096, 4096);
+	if (nftnl_ruleset_diff(cur, want, batch, &seq) != array_len(types))
+		print_err("Unexpected number of messages with anonymous sets");
+
+	nftnl_batch_iovec(batch, &iov, 1);
+	nlh = iov.iov_base;
+	len = iov.iov_len;
+	for (; mnl_nlmsg_ok(nlh, len); nlh = mnl_nlmsg_next(nlh, &len), i++) {
+		if (i >= array_len(types) ||
+		    (nlh->nlmsg_type & 0xff) != types[i]) {
+			print_err("Unexpected message type");
+			break;
+		}
+
+		switch (i) {
+		case 0:
+			check_rule(nlh, "input", 2, 0);
+			break;
+		case 1:
+			s = nftnl_set_alloc();
+			if (nftnl_set_nlmsg_parse(nlh, s) < 0 ||
+			    strcmp(nftnl_set_get_str(s, NFTNL_SET_NAME),
+				   "__set%d") ||
+			    nftnl_set_get_u32(s, NFTNL_SET_ID) != 2)
+				print_err("Anonymous set mismatches");
+			nftnl_set_free(s);
+			break;
+		case 2:
+			if (elem_key(nlh) != 7)
+				print_err("Anonymous set element mismatches");
+			break;
+		case 3:
+			check_rule(nlh, "input", 0, 0);
+			break;
+		}
+	}
+	if (i != array_len(types))
+		print_err("Missing messages");
+
+	nftnl_batch_free(batch);
+	nftnl_ruleset_free(cur);
+	nftnl_ruleset_free(want);
+}
+
+static void test_lists(void)
+{
+	struct nftnl_ruleset *rs = nftnl_ruleset_alloc();
+	struct nftnl_flowtable_list *flowtables;
+	struct nftnl_obj_list *objs;
+
+	objs = nftnl_obj_list_alloc();
+	flowtables = nftnl_flowtable_list_alloc();
+	nftnl_obj_list_add_tail(nftnl_obj_alloc(), objs);
+	nftnl_flowtable_list_add_tail(nftnl_flowtable_alloc(), flowtables);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_OBJLIST, objs);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_FLOWTABLELIST, flowtables);
+	if (nftnl_ruleset_get(rs, NFTNL_RULESET_OBJLIST) != objs ||
+	    nftnl_ruleset_get(rs, NFTNL_RULESET_FLOWTABLELIST) != flowtables)
+		print_err("Object and flowtable lists not set");
+
+	nftnl_ruleset_unset(rs, NFTNL_RULESET_OBJLIST);
+	if (nftnl_ruleset_is_set(rs, NFTNL_RULESET_OBJLIST) ||
+	    !nftnl_ruleset_is_set(rs, NFTNL_RULESET_FLOWTABLELIST))
+		print_err("Object list not unset");
+
+	nftnl_ruleset_free(rs);
+}
+
+int main(int argc, char *argv[])
+{
+	test_diff();
+	test_diff_anon();
+	test_lists();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
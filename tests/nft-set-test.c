@@ -15,6 +15,7 @@
 #include <linux/netfilter/nf_tables.h>
 
 #include <libnftnl/set.h>
+#include <libnftnl/expr.h>
 
 static int test_ok = 1;
 
@@ -52,6 +53,201 @@ static void cmp_nftnl_set(struct nftnl_set *a, struct nftnl_set *b)
 		print_err("Set userdata mismatches");
 }
 
+static int count_expr_cb(struct nftnl_expr *e, void *data)
+{
+	(*(int *)data)++;
+	return 0;
+}
+
+static void test_clone(struct nftnl_set *a)
+{
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set_elem *elem;
+	struct nftnl_set *b;
+	const void *udata;
+	uint32_t len;
+	int count = 0;
+
+	elem = nftnl_set_elem_alloc();
+	if (elem == NULL)
+		print_err("OOM");
+	nftnl_set_elem_set_u32(elem, NFTNL_SET_ELEM_KEY, 0x12345678);
+	nftnl_set_elem_set(elem, NFTNL_SET_ELEM_USERDATA, "elem", 4);
+	nftnl_set_elem_add_expr(elem, nftnl_expr_alloc("counter"));
+	nftnl_set_elem_add(a, elem);
+	nftnl_set_add_expr(a, nftnl_expr_alloc("counter"));
+
+	b = nftnl_set_clone(a);
+	if (b == NULL)
+		print_err("OOM");
+
+	/* The clone must not refer to anything owned by the original. */
+	nftnl_set_free(a);
+
+	if (strcmp(nftnl_set_get_str(b, NFTNL_SET_TABLE), "test-table") ||
+	    strcmp(nftnl_set_get_str(b, NFTNL_SET_NAME), "test-name"))
+		print_err("cloned set name mismatches");
+
+	udata = nftnl_set_get_data(b, NFTNL_SET_USERDATA, &len);
+	if (udata == NULL || strcmp(udata, "testing user data"))
+		print_err("cloned set userdata mismatches");
+
+	nftnl_set_expr_foreach(b, count_expr_cb, &count);
+	if (count != 1)
+		print_err("cloned set expressions mismatch");
+
+	nftnl_set_elems_iter_init(&iter, b);
+	elem = nftnl_set_elems_iter_next(&iter);
+	if (elem == NULL ||
+	    nftnl_set_elem_get_u32(elem, NFTNL_SET_ELEM_KEY) != 0x12345678)
+		print_err("cloned set element mismatches");
+
+	udata = elem ? nftnl_set_elem_get(elem, NFTNL_SET_ELEM_USERDATA,
+					  &len) : NULL;
+	if (udata == NULL || len != 4 || memcmp(udata, "elem", 4))
+		print_err("cloned set element userdata mismatches");
+
+	count = 0;
+	if (elem)
+		nftnl_set_elem_expr_foreach(elem, count_expr_cb, &count);
+	if (count != 1)
+		print_err("cloned set element expressions mismatch");
+
+	nftnl_set_free(b);
+}
+
+static struct nftnl_set *build_elems(const uint32_t *keys, int num,
+				     uint32_t data_key)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+	struct nftnl_set_elem *e;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		e = nftnl_set_elem_alloc();
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_KEY, htonl(keys[i]));
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_DATA, keys[i] == data_key ?
+				       keys[i] * 10 + 1 : keys[i] * 10);
+		nftnl_set_elem_add(s, e);
+	}
+	return s;
+}
+
+/* Keys of the elements in @s as a bitmask, and whether they carry data. */
+static uint32_t elems_mask(struct nftnl_set *s, bool *data)
+{
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set_elem *e;
+	uint32_t mask = 0;
+
+	*data = false;
+	nftnl_set_elems_iter_init(&iter, s);
+	while ((e = nftnl_set_elems_iter_next(&iter))) {
+		mask |= 1 << ntohl(nftnl_set_elem_get_u32(e, NFTNL_SET_ELEM_KEY));
+		if (nftnl_set_elem_is_set(e, NFTNL_SET_ELEM_DATA))
+			*data = true;
+	}
+	return mask;
+}
+
+static void test_elems_diff(void)
+{
+	static const uint32_t cur_keys[] = { 1, 2, 3, 5 };
+	static const uint32_t want_keys[] = { 2, 3, 4 };
+	uint32_t keys[] = { htonl(2), htonl(2), htonl(3), htonl(4), htonl(6) };
+	struct nftnl_set *cur, *want, *add, *del;
+	bool data;
+
+	cur = build_elems(cur_keys, 4, 0);
+	want = build_elems(want_keys, 3, 3);
+	add = nftnl_set_alloc();
+	del = nftnl_set_alloc();
+
+	if (nftnl_set_elems_diff(cur, want, add, del) < 0)
+		print_err("set element diff failed");
+	if (elems_mask(add, &data) != ((1 << 3) | (1 << 4)) || !data)
+		print_err("added set elements mismatch");
+	if (elems_mask(del, &data) != ((1 << 1) | (1 << 3) | (1 << 5)) || data)
+		print_err("deleted set elements mismatch");
+
+	nftnl_set_free(add);
+	nftnl_set_free(del);
+	add = nftnl_set_alloc();
+	del = nftnl_set_alloc();
+
+	if (nftnl_set_elems_diff_keys(cur, keys, sizeof(uint32_t), 5,
+				      add, del) < 0)
+		print_err("set key diff failed");
+	if (elems_mask(add, &data) != ((1 << 4) | (1 << 6)))
+		print_err("added set keys mismatch");
+	if (elems_mask(del, &data) != ((1 << 1) | (1 << 5)))
+		print_err("deleted set keys mismatch");
+
+	keys[0] = htonl(7);
+	if (nftnl_set_elems_diff_keys(cur, keys, sizeof(uint32_t), 5,
+				      NULL, NULL) == 0)
+		print_err("unsorted keys accepted");
+
+	nftnl_set_free(add);
+	nftnl_set_free(del);
+	nftnl_set_free(cur);
+	nftnl_set_free(want);
+}
+
+static void test_concat(void)
+{
+	static const uint8_t field_len[] = { 4, 4, 2 };
+	static const uint8_t tuples[2][10] = {
+		{ 10, 0, 0, 1, 192, 168, 0, 1, 0, 22 },
+		{ 10, 0, 0, 2, 192, 168, 0, 2, 0, 80 },
+	};
+	static const uint8_t key[12] = {
+		10, 0, 0, 1, 192, 168, 0, 1, 0, 22, 0, 0,
+	};
+	struct nftnl_set_elems_iter iter;
+	struct nftnl_set_elem *e;
+	uint8_t buf[16], tuple[10];
+	struct nftnl_set *s;
+	const void *data;
+	uint32_t len;
+
+	s = nftnl_set_alloc();
+	if (nftnl_set_concat_key_len(s) >= 0)
+		print_err("concat key length without description");
+
+	nftnl_set_set_data(s, NFTNL_SET_DESC_CONCAT, field_len,
+			   sizeof(field_len));
+	if (nftnl_set_concat_key_len(s) != sizeof(key))
+		print_err("concat key length mismatches");
+
+	memset(buf, 0xff, sizeof(buf));
+	if (nftnl_set_concat_pack(s, buf, tuples[0]) != sizeof(key) ||
+	    memcmp(buf, key, sizeof(key)))
+		print_err("packed concat key mismatches");
+
+	if (nftnl_set_concat_unpack(s, tuple, buf, sizeof(key)) !=
+	    sizeof(tuple) || memcmp(tuple, tuples[0], sizeof(tuple)))
+		print_err("unpacked concat key mismatches");
+
+	if (nftnl_set_elems_add_concat(s, tuples, tuples, 2) < 0)
+		print_err("adding concat elements failed");
+
+	nftnl_set_elems_iter_init(&iter, s);
+	e = nftnl_set_elems_iter_next(&iter);
+	data = e ? nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY_END, &len) : NULL;
+	if (data == NULL || len != sizeof(key) || memcmp(data, key, len))
+		print_err("concat element range end mismatches");
+
+	e = nftnl_set_elems_iter_next(&iter);
+	data = e ? nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY, &len) : NULL;
+	if (data == NULL ||
+	    nftnl_set_concat_unpack(s, tuple, data, len) < 0 ||
+	    memcmp(tuple, tuples[1], sizeof(tuple)))
+		print_err("concat element key mismatches");
+
+	nftnl_set_free(s);
+}
+
 int main(int argc, char *argv[])
 {
 	struct nftnl_set *a, *b = NULL;
@@ -82,7 +278,10 @@ int main(int argc, char *argv[])
 
 	cmp_nftnl_set(a,b);
 
-	nftnl_set_free(a); nftnl_set_free(b);
+	nftnl_set_free(b);
+	test_clone(a);
+	test_elems_diff();
+	test_concat();
 
 	if (!test_ok)
 		exit(EXIT_FAILURE);
@@ -0,0 +1,203 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/validate.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_rule *build_rule(void)
+{
+	struct nftnl_rule *r = nftnl_rule_alloc();
+
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	return r;
+}
+
+static struct nftnl_expr *add_payload(struct nftnl_rule *r, uint32_t dreg,
+				      uint32_t offset, uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("payload");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_DREG, dreg);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET, offset);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_LEN, len);
+	nftnl_rule_add_expr(r, e);
+	return e;
+}
+
+static struct nftnl_expr *add_cmp(struct nftnl_rule *r, uint32_t sreg,
+				  uint32_t len)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("cmp");
+	uint8_t data[64] = {};
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, sreg);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, data, len);
+	nftnl_rule_add_expr(r, e);
+	return e;
+}
+
+static struct nftnl_expr *add_verdict(struct nftnl_rule *r, uint32_t dreg)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("immediate");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, dreg);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, NF_DROP);
+	nftnl_rule_add_expr(r, e);
+	return e;
+}
+
+static struct nftnl_expr *add_lookup(struct nftnl_rule *r, const char *set,
+				     uint32_t sreg)
+{
+	struct nftnl_expr *e = nftnl_expr_alloc("lookup");
+
+	nftnl_expr_set_u32(e, NFTNL_EXPR_LOOKUP_SREG, sreg);
+	nftnl_expr_set_str(e, NFTNL_EXPR_LOOKUP_SET, set);
+	nftnl_rule_add_expr(r, e);
+	return e;
+}
+
+static void add_set(struct nftnl_set_list *sets, const char *name,
+		    uint32_t key_len, uint32_t flags)
+{
+	struct nftnl_set *s = nftnl_set_alloc();
+
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, NFPROTO_IPV4);
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, name);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, key_len);
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS, flags);
+	nftnl_set_list_add_tail(s, sets);
+}
+
+/* Expects @r to fail with @err at @bad, or to pass if @err is 0. */
+static void check(struct nftnl_rule *r, const struct nftnl_set_list *sets,
+		  int err, const struct nftnl_expr *bad, const char *msg)
+{
+	const struct nftnl_expr *found = NULL;
+	int ret;
+
+	errno = 0;
+	ret = nftnl_rule_validate(r, sets, &found);
+	if (err == 0 ? ret != 0 : ret != -1 || errno != err || found != bad)
+		print_err(msg);
+
+	nftnl_rule_free(r);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_set_list *sets = nftnl_set_list_alloc();
+	struct nftnl_rule *r;
+	struct nftnl_expr *e;
+
+	add_set(sets, "addrs", 4, 0);
+	add_set(sets, "ports", 2, 0);
+	add_set(sets, "pairs", 8, NFT_SET_CONCAT);
+
+	/* ip saddr 10.0.0.1 drop */
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	add_cmp(r, NFT_REG_1, 4);
+	add_verdict(r, NFT_REG_VERDICT);
+	check(r, sets, 0, NULL, "valid rule rejected");
+
+	/* compare on a register nothing was loaded into */
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	e = add_cmp(r, NFT_REG_2, 4);
+	check(r, sets, ENODATA, e, "read of unset register passed");
+
+	/* compare wider than what is left of the register file */
+	r = build_rule();
+	add_payload(r, NFT_REG32_15, 12, 4);
+	e = add_cmp(r, NFT_REG32_15, 8);
+	check(r, sets, EINVAL, e, "compare beyond register file passed");
+
+	/* part of a wide compare was never loaded */
+	r = build_rule();
+	add_payload(r, NFT_REG32_00, 12, 4);
+	e = add_cmp(r, NFT_REG32_00, 8);
+	check(r, sets, ENODATA, e, "partly loaded compare passed");
+
+	/* four byte address against a two byte key */
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	e = add_lookup(r, "ports", NFT_REG_1);
+	check(r, sets, EINVAL, e, "key length mismatch passed");
+
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	add_lookup(r, "addrs", NFT_REG_1);
+	check(r, sets, 0, NULL, "valid lookup rejected");
+
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	e = add_lookup(r, "nonexistent", NFT_REG_1);
+	check(r, sets, ENOENT, e, "lookup on missing set passed");
+
+	/* ip saddr . ip protocol, one register word each */
+	r = build_rule();
+	add_payload(r, NFT_REG32_00, 12, 4);
+	add_payload(r, NFT_REG32_01, 9, 1);
+	add_lookup(r, "pairs", NFT_REG32_00);
+	check(r, sets, 0, NULL, "valid concatenation rejected");
+
+	/* the second field of the concatenation is missing */
+	r = build_rule();
+	add_payload(r, NFT_REG32_00, 12, 4);
+	e = add_lookup(r, "pairs", NFT_REG32_00);
+	check(r, sets, ENODATA, e, "short concatenation passed");
+
+	/* verdict map lookup on a plain set */
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	e = add_lookup(r, "addrs", NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_LOOKUP_DREG, NFT_REG_VERDICT);
+	check(r, sets, EINVAL, e, "map lookup on set passed");
+
+	r = build_rule();
+	e = add_verdict(r, NFT_REG_1);
+	check(r, sets, EINVAL, e, "verdict to data register passed");
+
+	/* without sets, only registers are checked */
+	r = build_rule();
+	add_payload(r, NFT_REG_1, 12, 4);
+	add_lookup(r, "ports", NFT_REG_1);
+	check(r, NULL, 0, NULL, "lookup without sets rejected");
+
+	nftnl_set_list_free(sets);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}